@@ -13,6 +13,7 @@
 #include <unordered_set>
 #include <string>
 #include <memory>
+#include <vector>
 #include "llvm/ADT/StringRef.h"
 #include "llvm/ADT/Twine.h"
 #include "llvm/IR/Constants.h"
@@ -113,6 +114,14 @@ namespace dxilutil {
 
   llvm::Type* StripArrayTypes(llvm::Type *Ty, llvm::SmallVectorImpl<unsigned> *OuterToInnerLengths = nullptr);
   llvm::Type* WrapInArrayTypes(llvm::Type *Ty, llvm::ArrayRef<unsigned> OuterToInnerLengths);
+
+  // Collect the byte offsets loaded through a cbuffer handle.
+  void CollectCBufferUsage(llvm::Value *cbHandle,
+                           std::vector<unsigned> &cbufUsage);
+  // Collect the byte offsets loaded from each cbuffer, indexed by cbuffer ID.
+  // Returns false if the module creates no handles.
+  bool CollectCBufferUsage(llvm::Module &M,
+                           std::vector<std::vector<unsigned>> &cbufUsage);
 }
 
 }
@@ -15,6 +15,7 @@
 #define __DXC_CONTAINER__
 
 #include <stdint.h>
+#include <string.h>
 #include <iterator>
 #include "dxc/DXIL/DxilConstants.h"
 #include "dxc/Support/WinAdapter.h"
@@ -95,6 +96,8 @@ enum DxilFourCC {
   DFCC_PipelineStateValidation  = DXIL_FOURCC('P', 'S', 'V', '0'),
   DFCC_RuntimeData              = DXIL_FOURCC('R', 'D', 'A', 'T'),
   DFCC_ShaderHash               = DXIL_FOURCC('H', 'A', 'S', 'H'),
+  DFCC_LibraryIndex             = DXIL_FOURCC('L', 'I', 'D', 'X'),
+  DFCC_ConstantBufferLayout     = DXIL_FOURCC('C', 'B', 'L', 'O'),
 };
 
 #undef DXIL_FOURCC
@@ -209,6 +212,100 @@ struct DxilShaderDebugName {
 };
 static const size_t MinDxilShaderDebugNameSize = sizeof(DxilShaderDebugName) + 4;
 
+/// Index of the functions a library defines, so a linker can register the
+/// library without loading its module.
+struct DxilLibraryIndex {
+  uint32_t FunctionCount;
+  // Followed by DxilLibraryIndexFunction[FunctionCount].
+  // Followed by the null-terminated UTF-8 names of the functions.
+  // Followed by [0-3] zero bytes to align to a 4-byte boundary.
+};
+
+enum class DxilLibraryIndexFunctionFlags : uint32_t {
+  None = 0,
+  Internal = 1, // Function has internal linkage.
+};
+
+struct DxilLibraryIndexFunction {
+  uint32_t NameOffset; // From the start of the part data.
+  uint32_t Flags;      // DxilLibraryIndexFunctionFlags
+};
+
+/// Layout of the constant buffers and structured buffers of a shader, so
+/// reflection can describe them without loading the module.
+struct DxilCBufferLayout {
+  uint32_t Version;       // DxilCBufferLayoutVersion
+  uint32_t BufferCount;
+  uint32_t VariableCount;
+  uint32_t TypeCount;
+  uint32_t MemberCount;
+  // Followed by DxilCBufferLayoutBuffer[BufferCount].
+  // Followed by DxilCBufferLayoutVariable[VariableCount].
+  // Followed by DxilCBufferLayoutType[TypeCount].
+  // Followed by DxilCBufferLayoutMember[MemberCount].
+  // Followed by the null-terminated UTF-8 names.
+  // Followed by [0-3] zero bytes to align to a 4-byte boundary.
+};
+static const uint32_t DxilCBufferLayoutVersion = 1;
+static const uint32_t DxilCBufferLayoutNoType = 0xFFFFFFFF;
+
+enum class DxilCBufferLayoutBufferKind : uint32_t {
+  CBuffer = 0,
+  StructuredBuffer = 1,
+};
+
+struct DxilCBufferLayoutBuffer {
+  uint32_t NameOffset;      // Global name of the resource.
+  uint32_t Kind;            // DxilCBufferLayoutBufferKind
+  uint32_t Size;            // In bytes.
+  uint32_t RangeSize;       // Bind count, 0xFFFFFFFF when unbounded.
+  uint32_t ArrayDimensions; // Of the resource global.
+  uint32_t FirstVariable;
+  uint32_t VariableCount;
+};
+
+enum class DxilCBufferLayoutVariableFlags : uint32_t {
+  None = 0,
+  Used = 1, // The shader loads from the variable.
+};
+
+struct DxilCBufferLayoutVariable {
+  uint32_t NameOffset;  // Empty for the element of a structured buffer.
+  uint32_t StartOffset; // From the start of the buffer.
+  uint32_t Size;        // In bytes.
+  uint32_t Flags;       // DxilCBufferLayoutVariableFlags
+  uint32_t TypeIndex;   // DxilCBufferLayoutNoType without type annotations.
+};
+
+enum class DxilCBufferLayoutTypeClass : uint32_t {
+  Scalar = 0,
+  Vector = 1,
+  Matrix = 2,
+  Struct = 3,
+  Object = 4,
+  Void = 5,
+};
+
+struct DxilCBufferLayoutType {
+  uint32_t NameOffset;  // Type name of structs and objects, empty otherwise.
+  uint32_t Class;       // DxilCBufferLayoutTypeClass
+  uint32_t CompType;    // DXIL::ComponentType
+  uint32_t Orientation; // MatrixOrientation of matrices.
+  uint32_t Rows;
+  uint32_t Columns;     // For structs, the number of scalars they contain.
+  uint32_t Elements;    // Array elements, 0 when not an array.
+  uint32_t ArrayStride; // Bytes from one array element to the next.
+  uint32_t Offset;      // From the start of the enclosing struct.
+  uint32_t Size;        // In bytes, including all array elements.
+  uint32_t FirstMember;
+  uint32_t MemberCount;
+};
+
+struct DxilCBufferLayoutMember {
+  uint32_t NameOffset;
+  uint32_t TypeIndex; // Less than the index of the type it is a member of.
+};
+
 #pragma pack(pop)
 
 /// Gets a part header by index.
@@ -402,12 +499,65 @@ inline bool GetDxilShaderDebugName(const DxilPartHeader *pDebugNamePart,
   return true;
 }
 
+inline bool IsDxilLibraryIndexValid(const DxilPartHeader *pPart) {
+  if (pPart->PartFourCC != DFCC_LibraryIndex) return false;
+  if (pPart->PartSize < sizeof(DxilLibraryIndex)) return false;
+  const DxilLibraryIndex *pIndex =
+      reinterpret_cast<const DxilLibraryIndex *>(GetDxilPartData(pPart));
+  uint64_t NamesOffset = sizeof(DxilLibraryIndex) +
+      (uint64_t)pIndex->FunctionCount * sizeof(DxilLibraryIndexFunction);
+  if (NamesOffset > pPart->PartSize) return false;
+  const char *pData = GetDxilPartData(pPart);
+  const DxilLibraryIndexFunction *pFunctions =
+      reinterpret_cast<const DxilLibraryIndexFunction *>(pIndex + 1);
+  for (uint32_t i = 0; i < pIndex->FunctionCount; ++i) {
+    uint32_t NameOffset = pFunctions[i].NameOffset;
+    if (NameOffset < NamesOffset || NameOffset >= pPart->PartSize) return false;
+    // The name must be terminated inside the part.
+    if (!memchr(pData + NameOffset, 0, pPart->PartSize - NameOffset))
+      return false;
+  }
+  return true;
+}
+
+/// Gets the functions of a library index part, which must be valid.
+inline const DxilLibraryIndexFunction *
+GetDxilLibraryIndexFunctions(const DxilPartHeader *pPart, uint32_t *pCount) {
+  const DxilLibraryIndex *pIndex =
+      reinterpret_cast<const DxilLibraryIndex *>(GetDxilPartData(pPart));
+  *pCount = pIndex->FunctionCount;
+  return reinterpret_cast<const DxilLibraryIndexFunction *>(pIndex + 1);
+}
+
+/// Tables of a constant buffer layout part. Names are at their offsets from
+/// the start of the part data.
+struct DxilCBufferLayoutTables {
+  const char *pPartData;
+  const DxilCBufferLayoutBuffer *Buffers;
+  const DxilCBufferLayoutVariable *Variables;
+  const DxilCBufferLayoutType *Types;
+  const DxilCBufferLayoutMember *Members;
+  const char *GetName(uint32_t NameOffset) const {
+    return pPartData + NameOffset;
+  }
+};
+
+/// Checks that a constant buffer layout part is of a known version and that
+/// its indices, ranges and names are in bounds.
+bool IsDxilCBufferLayoutValid(const DxilPartHeader *pPart);
+
+/// Gets the tables of a constant buffer layout part, which must be valid.
+void GetDxilCBufferLayoutTables(const DxilPartHeader *pPart,
+                                DxilCBufferLayoutTables &Tables);
+
 enum class SerializeDxilFlags : uint32_t {
   None = 0,                         // No flags defined.
   IncludeDebugInfoPart = 1,         // Include the debug info part in the container.
   IncludeDebugNamePart = 2,         // Include the debug name part in the container.
   DebugNameDependOnSource = 4,      // Make the debug name depend on source (and not just final module).
   StripReflectionFromDxilPart = 8,  // Strip Reflection info from DXIL part.
+  IncludeLibraryIndexPart = 16,     // Include the library index part in a library container.
+  IncludeCBufferLayoutPart = 32,    // Include the constant buffer layout part in a shader container.
 };
 inline SerializeDxilFlags& operator |=(SerializeDxilFlags& l, const SerializeDxilFlags& r) {
   l = static_cast<SerializeDxilFlags>(static_cast<int>(l) | static_cast<int>(r));
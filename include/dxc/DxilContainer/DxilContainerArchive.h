@@ -0,0 +1,183 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilContainerArchive.h                                                    //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Helpers for archives of dxil containers that share program parts.         //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "dxc/DxilContainer/DxilContainer.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringRef.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace llvm {
+class MemoryBuffer;
+}
+
+namespace hlsl {
+
+class AbstractMemoryStream;
+
+// An archive holds many containers, storing each distinct DXIL program part
+// once. Containers that differ only in other parts, such as the debug name
+// or reflection, share the program part.
+//
+// Layout, with every offset from the start of the archive and every
+// structure and data block 4-byte aligned:
+//   DxilArchiveHeader
+//   DxilArchiveProgram[ProgramCount]
+//   DxilArchiveContainer[ContainerCount]
+//   program parts, each a DxilPartHeader followed by its data
+//   the other parts of each container, back to back in container order
+//   container names, each null-terminated
+
+static const uint32_t DxilArchiveFourCC = 0x52415844; // 'DXAR'
+static const uint32_t DxilArchiveVersion = 1;
+static const uint32_t DxilArchiveNoProgram = UINT32_MAX;
+
+struct DxilArchiveHeader {
+  uint32_t HeaderFourCC; // DxilArchiveFourCC
+  uint32_t Version;      // DxilArchiveVersion
+  uint32_t ArchiveSizeInBytes;
+  uint32_t ProgramCount;
+  uint32_t ContainerCount;
+};
+
+struct DxilArchiveProgram {
+  DxilShaderHash Hash;  // Hash of the program bitcode, the key of the part.
+  uint32_t PartOffset;  // To a DxilPartHeader.
+};
+
+struct DxilArchiveContainer {
+  uint32_t NameOffset;
+  uint32_t NameLength;          // Excluding the null terminator.
+  DxilContainerHash Hash;       // Restored into the rebuilt container.
+  DxilContainerVersion Version; // Restored into the rebuilt container.
+  uint32_t ProgramIndex;        // Or DxilArchiveNoProgram.
+  uint32_t ProgramPartIndex;    // Where the program goes among the parts.
+  uint32_t PartCount;           // Parts other than the program part.
+  uint32_t PartsOffset;         // To the first of PartCount parts.
+  uint32_t PartsSizeInBytes;
+};
+
+/// Returns whether Name can name a container in an archive. Containers are
+/// extracted to files by name, so a name must be a plain file name: not
+/// empty, not "." or "..", and without path separators, drive colons or
+/// embedded nulls.
+bool IsValidDxilArchiveContainerName(llvm::StringRef Name);
+
+/// Sizes of an archive and of the containers in it.
+struct DxilContainerArchiveStats {
+  uint32_t ContainerCount = 0;
+  uint32_t ProgramCount = 0;       // Containers with a program part.
+  uint32_t UniqueProgramCount = 0; // Program parts stored.
+  uint64_t ContainerBytes = 0;     // Sum of the container sizes.
+  uint64_t ProgramBytes = 0;       // Sum of the program part sizes.
+  uint64_t UniqueProgramBytes = 0; // Sum of the stored program part sizes.
+  uint64_t ArchiveBytes = 0;
+
+  /// How many times larger the containers are than the archive.
+  double GetRatio() const {
+    return ArchiveBytes ? (double)ContainerBytes / ArchiveBytes : 0.0;
+  }
+};
+
+/// Builds an archive of containers. The program part of each container is
+/// keyed by the hash of its bitcode, which is read from the shader hash part
+/// when the container has one that does not include the source, and is
+/// computed as SerializeDxilContainerForModule does otherwise. Parts with
+/// the same key are compared before they are shared.
+class DxilContainerArchiveWriter {
+public:
+  DxilContainerArchiveWriter();
+  ~DxilContainerArchiveWriter();
+
+  /// Copies the container in pData into the archive under Name. Returns
+  /// E_INVALIDARG if Name is not a valid container name,
+  /// DXC_E_CONTAINER_INVALID if the data is not a valid container, and
+  /// DXC_E_DATA_TOO_LARGE if the archive would not fit in 4GB.
+  HRESULT AddContainer(llvm::StringRef Name, const void *pData, size_t size);
+
+  uint32_t size() const { return (uint32_t)m_size; }
+  void write(AbstractMemoryStream *pStream);
+  const DxilContainerArchiveStats &GetStats() const { return m_stats; }
+
+private:
+  struct Program {
+    DxilShaderHash Hash;
+    std::vector<char> Part; // Part header and data.
+  };
+  struct Container {
+    std::string Name;
+    DxilContainerHash Hash;
+    DxilContainerVersion Version;
+    uint32_t ProgramIndex;
+    uint32_t ProgramPartIndex;
+    uint32_t PartCount;
+    std::vector<char> Parts;
+  };
+
+  uint32_t FindOrAddProgram(const DxilShaderHash &Hash,
+                            const DxilPartHeader *pPart, bool *pAdded);
+
+  std::vector<Program> m_programs;
+  std::vector<Container> m_containers;
+  llvm::StringMap<std::vector<uint32_t>> m_programIndex; // digest to programs
+  uint64_t m_size;
+  DxilContainerArchiveStats m_stats;
+};
+
+/// Reads an archive in place and rebuilds the containers in it.
+class DxilContainerArchiveReader {
+public:
+  DxilContainerArchiveReader();
+  ~DxilContainerArchiveReader();
+
+  /// Loads the archive in pData, which must stay alive while it is read.
+  /// Returns DXC_E_CONTAINER_INVALID if the data is not a valid archive,
+  /// which includes one with a container name that is not valid.
+  HRESULT Load(const void *pData, size_t size);
+  /// Loads the archive in the file at Path, mapping it if possible.
+  HRESULT LoadFile(llvm::StringRef Path);
+  void Reset();
+
+  bool IsLoaded() const { return m_pHeader != nullptr; }
+  uint32_t GetContainerCount() const {
+    return m_pHeader ? m_pHeader->ContainerCount : 0;
+  }
+  llvm::StringRef GetContainerName(uint32_t index) const;
+  /// Returns the index of the first container named Name, or UINT32_MAX.
+  uint32_t FindContainer(llvm::StringRef Name) const;
+  /// Returns the program hash of a container, or null if it has no program.
+  const DxilShaderHash *GetProgramHash(uint32_t index) const;
+  uint32_t GetContainerSize(uint32_t index) const;
+  /// Writes the container at index into pStream, which must be empty.
+  void ExtractContainer(uint32_t index, AbstractMemoryStream *pStream) const;
+
+  DxilContainerArchiveStats GetStats() const;
+
+private:
+  DxilContainerArchiveReader(const DxilContainerArchiveReader &) = delete;
+  DxilContainerArchiveReader &
+  operator=(const DxilContainerArchiveReader &) = delete;
+
+  const DxilArchiveProgram *GetPrograms() const;
+  const DxilArchiveContainer *GetContainers() const;
+  const DxilPartHeader *GetProgramPart(const DxilArchiveContainer &C) const;
+  const char *GetData(uint32_t offset) const {
+    return (const char *)m_pHeader + offset;
+  }
+
+  std::unique_ptr<llvm::MemoryBuffer> m_pFile;
+  const DxilArchiveHeader *m_pHeader;
+};
+
+} // namespace hlsl
@@ -43,6 +43,8 @@ DxilPartWriter *NewRootSignatureWriter(const RootSignatureHandle &S);
 DxilPartWriter *NewFeatureInfoWriter(const DxilModule &M);
 DxilPartWriter *NewPSVWriter(const DxilModule &M, uint32_t PSVVersion = 0);
 DxilPartWriter *NewRDATWriter(const DxilModule &M, uint32_t InfoVersion = 0);
+DxilPartWriter *NewLibraryIndexWriter(const DxilModule &M);
+DxilPartWriter *NewCBufferLayoutWriter(DxilModule &M);
 
 DxilContainerWriter *NewDxilContainerWriter();
 
@@ -51,7 +53,8 @@ void SerializeDxilContainerForModule(hlsl::DxilModule *pModule,
                                      AbstractMemoryStream *pStream,
                                      llvm::StringRef DebugName,
                                      SerializeDxilFlags Flags,
-                                     DxilShaderHash *pShaderHashOut = nullptr);
+                                     DxilShaderHash *pShaderHashOut = nullptr,
+                                     uint64_t *pBytesCopied = nullptr);
 void SerializeDxilContainerForRootSignature(hlsl::RootSignatureHandle *pRootSigHandle,
                                      AbstractMemoryStream *pStream);
 
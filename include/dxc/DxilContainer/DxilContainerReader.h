@@ -11,6 +11,16 @@
 
 #pragma once
 
+#include "dxc/DxilContainer/DxilContainer.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/StringRef.h"
+#include <memory>
+#include <system_error>
+
+namespace llvm {
+class MemoryBuffer;
+}
+
 namespace hlsl {
 
 class DxilSubobjects;
@@ -21,4 +31,59 @@ namespace RDAT {
 bool LoadSubobjectsFromRDAT(DxilSubobjects &subobjects,
   RDAT::SubobjectTableReader *pSubobjectTableReader);
 
+/// Maps an error from opening a container file to an HRESULT, with
+/// HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND) for a missing file.
+HRESULT HResultFromFileError(std::error_code ec);
+
+/// Reads the parts of a DXIL container in place. Loading checks the bounds
+/// of every part and indexes the parts by fourCC, which only reads the part
+/// headers; part contents are not touched until they are used. A file is
+/// memory-mapped when it is large enough, so that scanning many containers
+/// for a few parts only pages in those parts.
+class DxilContainerReader {
+public:
+  typedef DxilPartIterator iterator;
+
+  DxilContainerReader();
+  ~DxilContainerReader();
+
+  /// Loads the container in pData, which must stay alive while it is read.
+  /// Returns DXC_E_CONTAINER_INVALID if the data is not a valid container.
+  HRESULT Load(const void *pData, size_t size);
+  /// Loads the container in the file at Path, mapping it if possible.
+  /// Returns HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND) if there is no file.
+  HRESULT LoadFile(llvm::StringRef Path);
+  /// Releases the loaded container, and the file mapping if any.
+  void Reset();
+
+  bool IsLoaded() const { return m_pHeader != nullptr; }
+  const DxilContainerHeader *GetHeader() const { return m_pHeader; }
+  uint32_t GetPartCount() const {
+    return m_pHeader ? m_pHeader->PartCount : 0;
+  }
+  const DxilPartHeader *GetPart(uint32_t index) const {
+    return GetDxilContainerPart(m_pHeader, index);
+  }
+
+  /// Returns the first part with the given fourCC, or null.
+  const DxilPartHeader *FindPart(DxilFourCC fourCC) const;
+  /// Gets the contents of the first part with the given fourCC; returns
+  /// false if there is no such part.
+  bool GetPartContent(DxilFourCC fourCC, const char **ppData,
+                      uint32_t *pSize) const;
+
+  /// Iterates the part headers in container order, reading each header as
+  /// it is reached.
+  iterator begin() const { return iterator(m_pHeader, 0); }
+  iterator end() const { return iterator(m_pHeader, GetPartCount()); }
+
+private:
+  DxilContainerReader(const DxilContainerReader &) = delete;
+  DxilContainerReader &operator=(const DxilContainerReader &) = delete;
+
+  std::unique_ptr<llvm::MemoryBuffer> m_pFile;
+  const DxilContainerHeader *m_pHeader;
+  llvm::SmallDenseMap<uint32_t, uint32_t, 16> m_partIndex; // fourCC to index
+};
+
 } // namespace hlsl
\ No newline at end of file
@@ -11,6 +11,8 @@
 
 #pragma once
 
+#include <cstdint>
+#include <functional>
 #include <unordered_map>
 #include <unordered_set>
 #include "llvm/ADT/StringRef.h"
@@ -30,6 +32,19 @@ class LLVMContext;
 namespace hlsl {
 class DxilModule;
 class DxilResourceBase;
+struct DxilPartHeader;
+
+// Work done by one link. A library function is loaded, which materializes
+// its body and collects the functions and globals it uses, the first time a
+// link needs it; later links reuse what was collected.
+struct DxilLinkStats {
+  unsigned FunctionsLoaded = 0; // Library functions loaded by this link.
+  unsigned FunctionsReused = 0; // Needed functions loaded by an earlier link.
+  unsigned FunctionsCloned = 0; // Function bodies cloned into the output.
+  uint64_t LoadMicroseconds = 0;    // Time to collect the functions to link.
+  uint64_t CloneMicroseconds = 0;   // Time to clone them into the output.
+  uint64_t PrepareMicroseconds = 0; // Time to run the link passes.
+};
 
 // Linker for DxilModule.
 class DxilLinker {
@@ -37,10 +52,19 @@ public:
   virtual ~DxilLinker() {}
   static DxilLinker *CreateLinker(llvm::LLVMContext &Ctx, unsigned valMajor, unsigned valMinor);
 
+  // Loads the module of a library registered from its index, in the
+  // linker's context. Returns null on failure.
+  typedef std::function<std::unique_ptr<llvm::Module>()> ModuleLoader;
+
   virtual bool HasLibNameRegistered(llvm::StringRef name) = 0;
   virtual bool RegisterLib(llvm::StringRef name,
                            std::unique_ptr<llvm::Module> pModule,
                            std::unique_ptr<llvm::Module> pDebugModule) = 0;
+  // Registers a library from the functions listed in its valid library index
+  // part. The module is loaded the first time a link needs one of them.
+  virtual bool RegisterLib(llvm::StringRef name,
+                           const DxilPartHeader *pIndexPart,
+                           ModuleLoader loadModule) = 0;
   virtual bool AttachLib(llvm::StringRef name) = 0;
   virtual bool DetachLib(llvm::StringRef name) = 0;
   virtual void DetachAll() = 0;
@@ -48,10 +72,13 @@ public:
   virtual std::unique_ptr<llvm::Module>
   Link(llvm::StringRef entry, llvm::StringRef profile, dxilutil::ExportMap &exportMap) = 0;
 
+  const DxilLinkStats &GetLastLinkStats() const { return m_stats; }
+
 protected:
   DxilLinker(llvm::LLVMContext &Ctx, unsigned valMajor, unsigned valMinor) : m_ctx(Ctx), m_valMajor(valMajor), m_valMinor(valMinor) {}
   llvm::LLVMContext &m_ctx;
   unsigned m_valMajor, m_valMinor;
+  DxilLinkStats m_stats;
 };
 
 } // namespace hlsl
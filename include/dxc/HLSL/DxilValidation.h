@@ -11,7 +11,10 @@
 
 #pragma once
 
+#include <array>
 #include <memory>
+#include <set>
+#include <vector>
 #include "dxc/Support/Global.h"
 #include "dxc/DXIL/DxilConstants.h"
 #include "dxc/Support/WinAdapter.h"
@@ -261,8 +264,44 @@ enum class ValidationRule : unsigned {
 
 const char *GetValidationRuleText(ValidationRule value);
 void GetValidationVersion(_Out_ unsigned *pMajor, _Out_ unsigned *pMinor);
+
+/// Fingerprints of library functions that passed validation. A fingerprint
+/// covers the function body and the module-level state that validating it
+/// reads (resources, signatures, type annotations and global variables), so
+/// a function with a known fingerprint needs no revalidation.
+class DxilValidationFingerprints {
+public:
+  typedef std::array<uint8_t, 16> Digest;
+
+  bool Contains(const Digest &D) const { return m_Digests.count(D) != 0; }
+  void Insert(const Digest &D) { m_Digests.insert(D); }
+  size_t size() const { return m_Digests.size(); }
+
+  void Serialize(std::vector<uint8_t> &Data) const;
+  /// Returns false if the data is not a serialized set of fingerprints.
+  bool Deserialize(_In_reads_bytes_(Size) const void *pData, size_t Size);
+
+private:
+  std::set<Digest> m_Digests;
+};
+
+/// Incremental validation state for ValidateDxilModule. In library
+/// profiles, defined functions other than entry points are skipped when
+/// their fingerprint is in pPrior. Current receives the fingerprints of
+/// the functions that passed, whether validated or skipped.
+struct DxilIncrementalValidation {
+  const DxilValidationFingerprints *pPrior = nullptr;
+  DxilValidationFingerprints Current;
+  unsigned FunctionCount = 0;    // Defined functions in the module.
+  unsigned RevalidatedCount = 0; // Defined functions that were validated.
+};
+
+/// Function bodies are validated on ThreadCount threads; zero selects the
+/// number of hardware threads. Diagnostics match those of a single thread.
 HRESULT ValidateDxilModule(_In_ llvm::Module *pModule,
-                           _In_opt_ llvm::Module *pDebugModule);
+                           _In_opt_ llvm::Module *pDebugModule,
+                           _Inout_opt_ DxilIncrementalValidation *pIncremental = nullptr,
+                           unsigned ThreadCount = 1);
 
 // DXIL Container Verification Functions (return false on failure)
 
@@ -315,15 +354,26 @@ HRESULT ValidateLoadModuleFromContainerLazy(
     _In_ llvm::LLVMContext &Ctx, llvm::LLVMContext &DbgCtx,
     _In_ llvm::raw_ostream &DiagStream);
 
+// Checks that the container parts match the module metadata, without
+// validating the module. Function bodies are parsed only for the parts that
+// are built from them.
+HRESULT ValidateDxilContainerPartsOnly(_In_reads_bytes_(ContainerSize) const void *pContainer,
+                                       _In_ uint32_t ContainerSize,
+                                       _In_ llvm::raw_ostream &DiagStream);
+
 // Load and validate Dxil module from bitcode.
 HRESULT ValidateDxilBitcode(_In_reads_bytes_(ILLength) const char *pIL,
                             _In_ uint32_t ILLength,
-                            _In_ llvm::raw_ostream &DiagStream);
+                            _In_ llvm::raw_ostream &DiagStream,
+                            _Inout_opt_ DxilIncrementalValidation *pIncremental = nullptr,
+                            unsigned ThreadCount = 1);
 
 // Full container validation, including ValidateDxilModule
 HRESULT ValidateDxilContainer(_In_reads_bytes_(ContainerSize) const void *pContainer,
                               _In_ uint32_t ContainerSize,
-                              _In_ llvm::raw_ostream &DiagStream);
+                              _In_ llvm::raw_ostream &DiagStream,
+                              _Inout_opt_ DxilIncrementalValidation *pIncremental = nullptr,
+                              unsigned ThreadCount = 1);
 
 class PrintDiagnosticContext {
 private:
@@ -112,6 +112,7 @@ public:
   llvm::StringRef FloatDenormalMode; // OPT_denorm
   std::vector<std::string> Exports; // OPT_exports
   llvm::StringRef DefaultLinkage; // OPT_default_linkage
+  llvm::StringRef CompileCacheDir; // OPT_compile_cache
 
   bool AllResourcesBound = false; // OPT_all_resources_bound
   bool AstDump = false; // OPT_ast_dump
@@ -154,6 +155,8 @@ public:
   bool StripRootSignature = false; // OPT_Qstrip_rootsignature
   bool StripPrivate = false; // OPT_Qstrip_priv
   bool StripReflection = false; // OPT_Qstrip_reflect
+  bool LibraryIndex = false; // OPT_Qlibrary_index
+  bool CBufferLayout = false; // OPT_Qcbuffer_layout
   bool ExtractRootSignature = false; // OPT_extractrootsignature
   bool DisassembleColorCoded = false; // OPT_Cc
   bool DisassembleInstNumbers = false; //OPT_Ni
@@ -164,6 +167,10 @@ public:
   unsigned long AutoBindingSpace = UINT_MAX; // OPT_auto_binding_space
   bool ExportShadersOnly = false; // OPT_export_shaders_only
   bool ResMayAlias = false; // OPT_res_may_alias
+  bool ReportCopies = false; // OPT_report_copies
+  bool ReportLinkStats = false; // OPT_report_link_stats
+  bool TimeReport = false; // OPT_ftime_report
+  unsigned long CompileCacheSizeMB = 1024; // OPT_compile_cache_size
 
   bool IsRootSignatureProfile();
   bool IsLibraryProfile();
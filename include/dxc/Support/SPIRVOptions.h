@@ -50,6 +50,7 @@ struct SpirvCodeGenOptions {
   bool invertW; // Multiplicative inverse
   bool noWarnEmulatedFeatures;
   bool noWarnIgnoredFeatures;
+  bool reportLegalization;
   bool useDxLayout;
   bool useGlLayout;
   bool useScalarLayout;
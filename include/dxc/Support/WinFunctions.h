@@ -46,6 +46,9 @@ HANDLE CreateFileW(_In_ LPCWSTR lpFileName, _In_ DWORD dwDesiredAccess,
                    _In_opt_ HANDLE hTemplateFile);
 
 BOOL GetFileSizeEx(_In_ HANDLE hFile, _Out_ PLARGE_INTEGER lpFileSize);
+BOOL GetFileTime(_In_ HANDLE hFile, _Out_opt_ LPFILETIME lpCreationTime,
+                 _Out_opt_ LPFILETIME lpLastAccessTime,
+                 _Out_opt_ LPFILETIME lpLastWriteTime);
 
 BOOL ReadFile(_In_ HANDLE hFile, _Out_ LPVOID lpBuffer,
               _In_ DWORD nNumberOfBytesToRead,
@@ -0,0 +1,60 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// dxcthreadpool.h                                                           //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Provides a work-stealing pool for running independent tasks in parallel.  //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <functional>
+#include <memory>
+
+namespace hlsl {
+
+/// Runs sets of independent tasks on a pool of threads.
+///
+/// Every worker starts with a contiguous range of task indices in its own
+/// queue and runs them in order. A worker that runs out of tasks steals from
+/// the end of another worker's queue, so a slow task delays only itself
+/// rather than every task queued behind it.
+///
+/// The calling thread takes part as the first worker. The other workers are
+/// threads started by the first run that needs them; they wait for the next
+/// run in between, and are stopped when the pool is destroyed. Tasks run
+/// with the default thread allocator installed; a task that allocates from
+/// another one installs it with DxcThreadMalloc. The pool may therefore only
+/// be used once DxcInitThreadMalloc has been called.
+class WorkStealingThreadPool {
+public:
+  /// Creates a pool of ThreadCount workers; zero selects the number of
+  /// hardware threads.
+  explicit WorkStealingThreadPool(unsigned ThreadCount = 0);
+  ~WorkStealingThreadPool();
+
+  unsigned getThreadCount() const { return m_ThreadCount; }
+
+  /// Calls Task(TaskIndex, WorkerIndex) for every TaskIndex below TaskCount
+  /// and returns once all calls have returned. WorkerIndex is below
+  /// getThreadCount() and identifies the worker running the task; no two
+  /// tasks with the same WorkerIndex run concurrently. If a task throws, the
+  /// tasks not yet started are skipped and the first exception is rethrown.
+  /// Runs of one pool may not overlap, so tasks must not run their own pool.
+  void run(unsigned TaskCount,
+           const std::function<void(unsigned TaskIndex, unsigned WorkerIndex)>
+               &Task);
+
+private:
+  WorkStealingThreadPool(const WorkStealingThreadPool &) = delete;
+  WorkStealingThreadPool &operator=(const WorkStealingThreadPool &) = delete;
+
+  class Workers;
+  unsigned m_ThreadCount;
+  std::unique_ptr<Workers> m_Workers; // Created by the first parallel run.
+};
+
+} // namespace hlsl
@@ -160,6 +160,16 @@ IDxcOperationResult : public IUnknown {
   DECLARE_CROSS_PLATFORM_UUIDOF(IDxcOperationResult)
 };
 
+// Implemented by the result of a compile run with -ftime-report.
+struct __declspec(uuid("5C7E2A91-3B4D-4F86-A1E0-9D2C6B8F4E17"))
+IDxcTimeReportResult : public IUnknown {
+  // Gets a UTF-8 JSON report of the wall time and peak allocator bytes of
+  // each compile phase, and of the time and instruction counts of each pass.
+  virtual HRESULT STDMETHODCALLTYPE GetTimeReport(_COM_Outptr_ IDxcBlobEncoding **ppReport) = 0;
+
+  DECLARE_CROSS_PLATFORM_UUIDOF(IDxcTimeReportResult)
+};
+
 struct __declspec(uuid("7f61fc7d-950d-467f-b3e3-3c02fb49187c"))
 IDxcIncludeHandler : public IUnknown {
   virtual HRESULT STDMETHODCALLTYPE LoadSource(
@@ -170,6 +180,25 @@ IDxcIncludeHandler : public IUnknown {
   DECLARE_CROSS_PLATFORM_UUIDOF(IDxcIncludeHandler)
 };
 
+// Optionally implemented by include handlers whose files can be identified
+// without loading them. Files with a stamp are kept, converted to UTF-8, in
+// a process-wide cache keyed by the handler and the resolved file name, so
+// compilations that reuse a handler share its files; LoadSource is only
+// called when the file is not cached for that handler with the same stamp.
+// The cache holds a reference to the handler while it has entries for it.
+struct __declspec(uuid("A3C5E7F9-0B2D-4E61-8C4A-5F7B9D1E3A26"))
+IDxcIncludeHandlerStamp : public IUnknown {
+  // Returns S_OK with a value that changes whenever the contents LoadSource
+  // returns for pFilename change, for example a hash of the last write time
+  // and size. Any other result bypasses the cache for this file.
+  virtual HRESULT STDMETHODCALLTYPE GetSourceStamp(
+    _In_ LPCWSTR pFilename, // Candidate filename.
+    _Out_ UINT64 *pStamp    // Stamp for the current contents.
+    ) = 0;
+
+  DECLARE_CROSS_PLATFORM_UUIDOF(IDxcIncludeHandlerStamp)
+};
+
 struct DxcDefine {
   LPCWSTR Name;
   _Maybenull_ LPCWSTR Value;
@@ -233,6 +262,119 @@ IDxcCompiler2 : public IDxcCompiler {
   DECLARE_CROSS_PLATFORM_UUIDOF(IDxcCompiler2)
 };
 
+// One compilation in a batch; the fields match the arguments of
+// IDxcCompiler::Compile.
+struct DxcCompileJob {
+  IDxcBlob *pSource;              // Source text to compile
+  LPCWSTR pSourceName;            // Optional file name for pSource
+  LPCWSTR pEntryPoint;            // Entry point name
+  LPCWSTR pTargetProfile;         // Shader profile to compile
+  LPCWSTR *pArguments;            // Array of pointers to arguments
+  UINT32 argCount;                // Number of arguments
+  const DxcDefine *pDefines;      // Array of defines
+  UINT32 defineCount;             // Number of defines
+};
+
+// Receives the result of each job of a batch as soon as it is compiled.
+// Calls are made from the worker threads of the batch, one at a time, in the
+// order in which jobs finish.
+struct __declspec(uuid("8E3B6A0D-1C4F-4E27-B5D9-64A2F0C7E1B3"))
+IDxcBatchCompileHandler : public IUnknown {
+  // Returning a failure cancels the jobs that have not started yet, and the
+  // results of jobs that are still running are not reported.
+  virtual HRESULT STDMETHODCALLTYPE OnJobCompleted(
+    _In_ UINT32 jobIndex,                         // Index of the job in the batch
+    _In_ IDxcOperationResult *pResult             // Compiler output status, buffer, and errors
+  ) = 0;
+
+  DECLARE_CROSS_PLATFORM_UUIDOF(IDxcBatchCompileHandler)
+};
+
+struct __declspec(uuid("4C7A9E21-5B3D-4A8F-8E16-D0F2B9C3A574"))
+IDxcBatchCompiler : public IUnknown {
+  // Compiles independent jobs in parallel on a work-stealing pool of
+  // threadCount threads, or one per hardware thread when threadCount is zero.
+  // The include handler and any registered container event handler are
+  // called from several threads at once. Fails with the HRESULT returned by
+  // the handler if it cancels the batch. The threads are kept for later
+  // batches with the same threadCount until the compiler is released.
+  virtual HRESULT STDMETHODCALLTYPE CompileBatch(
+    _In_count_(jobCount) const DxcCompileJob *pJobs, // Array of jobs
+    _In_ UINT32 jobCount,                            // Number of jobs
+    _In_opt_ IDxcIncludeHandler *pIncludeHandler,    // user-provided interface to handle #include directives (optional)
+    _In_ UINT32 threadCount,                         // Number of threads, or zero
+    _In_ IDxcBatchCompileHandler *pHandler           // Receives the results
+  ) = 0;
+
+  DECLARE_CROSS_PLATFORM_UUIDOF(IDxcBatchCompiler)
+};
+
+struct __declspec(uuid("6B1E4D93-2F7A-4C58-A0E3-91D5C6B8F247"))
+IDxcPermutationCompiler : public IUnknown {
+  // Compiles one shader under permutationCount sets of defines. pDefines holds
+  // permutationCount rows of defineCount defines, and every row names the
+  // same macros in the same order. Permutations whose preprocessed sources
+  // are identical are compiled once and share a result, which is reported
+  // for each of them with jobIndex set to the permutation index. Sharing is
+  // disabled when the output depends on define values in other ways, such
+  // as with debug information or a root signature define.
+  virtual HRESULT STDMETHODCALLTYPE CompilePermutations(
+    _In_ IDxcBlob *pSource,                       // Source text to compile
+    _In_opt_ LPCWSTR pSourceName,                 // Optional file name for pSource. Used in errors and include handlers.
+    _In_ LPCWSTR pEntryPoint,                     // entry point name
+    _In_ LPCWSTR pTargetProfile,                  // shader profile to compile
+    _In_count_(argCount) LPCWSTR *pArguments,     // Array of pointers to arguments
+    _In_ UINT32 argCount,                         // Number of arguments
+    _In_count_(defineCount * permutationCount)
+      const DxcDefine *pDefines,                  // Array of defines, one row per permutation
+    _In_ UINT32 defineCount,                      // Number of defines in each row
+    _In_ UINT32 permutationCount,                 // Number of rows
+    _In_opt_ IDxcIncludeHandler *pIncludeHandler, // user-provided interface to handle #include directives (optional)
+    _In_ UINT32 threadCount,                      // Number of threads, or zero
+    _In_ IDxcBatchCompileHandler *pHandler,       // Receives the results
+    _Out_opt_ UINT32 *pUniqueCount                // Number of distinct compilations
+  ) = 0;
+
+  DECLARE_CROSS_PLATFORM_UUIDOF(IDxcPermutationCompiler)
+};
+
+struct DxcCompileCacheStats {
+  UINT64 Hits;      // Compilations answered from the cache.
+  UINT64 Misses;    // Cacheable compilations that had to run the compiler.
+  UINT64 Stores;    // Results written to the cache.
+  UINT64 Evictions; // Results removed to keep the cache under its size limit.
+};
+
+// Reports statistics for the compilation result cache enabled with the
+// -compile-cache option. Statistics are shared by all compiler instances in
+// the process.
+struct __declspec(uuid("5F1E5B7C-8D3E-4B8A-9D2C-7A4C1E0B3F61"))
+IDxcCompileCache : public IUnknown {
+  virtual HRESULT STDMETHODCALLTYPE GetStats(_Out_ DxcCompileCacheStats *pStats) = 0;
+  virtual HRESULT STDMETHODCALLTYPE ResetStats() = 0;
+
+  DECLARE_CROSS_PLATFORM_UUIDOF(IDxcCompileCache)
+};
+
+struct DxcMallocStats {
+  UINT64 AllocCount;   // Alloc and Realloc calls that returned a block.
+  UINT64 FreeCount;    // Counted blocks released by Free or by Realloc to zero bytes.
+  UINT64 TotalBytes;   // Bytes requested by the counted Alloc and Realloc calls.
+  UINT64 CurrentBytes; // Bytes in counted blocks not freed yet.
+  UINT64 PeakBytes;    // High-water mark of CurrentBytes.
+};
+
+// Implemented by allocators created with CLSID_DxcProfilingMalloc. Only
+// blocks allocated after the allocator was created are counted.
+struct __declspec(uuid("EC6477C1-E5D7-4914-9B55-B521D16C98FA"))
+IDxcMallocStats : public IUnknown {
+  virtual HRESULT STDMETHODCALLTYPE GetStats(_Out_ DxcMallocStats *pStats) = 0;
+  // Clears the counts and restarts the high-water mark at the current bytes.
+  virtual HRESULT STDMETHODCALLTYPE ResetStats() = 0;
+
+  DECLARE_CROSS_PLATFORM_UUIDOF(IDxcMallocStats)
+};
+
 struct __declspec(uuid("F1B5BE2A-62DD-4327-A1C2-42AC1E1E78E6"))
 IDxcLinker : public IUnknown {
 public:
@@ -260,11 +402,43 @@ public:
   DECLARE_CROSS_PLATFORM_UUIDOF(IDxcLinker)
 };
 
+// One link in a batch; the fields match the arguments of IDxcLinker::Link.
+struct DxcLinkJob {
+  LPCWSTR pEntryName;             // Entry point name
+  LPCWSTR pTargetProfile;         // Shader profile to link
+  const LPCWSTR *pLibNames;       // Array of library names to link
+  UINT32 libCount;                // Number of libraries to link
+  const LPCWSTR *pArguments;      // Array of pointers to arguments
+  UINT32 argCount;                // Number of arguments
+};
+
+struct __declspec(uuid("E7A4C2B9-3D51-4F8E-A06B-92C5D1F3E748"))
+IDxcBatchLinker : public IUnknown {
+  // Links independent jobs against the libraries registered on the linker,
+  // in parallel on a work-stealing pool of threadCount threads, or one per
+  // hardware thread when threadCount is zero. Each thread loads the
+  // libraries it needs into its own context, so libraries must not be
+  // registered while a batch runs. ppResults receives the result of every
+  // job, in job order, once all of them have been linked. A registered
+  // container event handler is called for one job at a time.
+  virtual HRESULT STDMETHODCALLTYPE LinkBatch(
+    _In_count_(jobCount) const DxcLinkJob *pJobs,     // Array of jobs
+    _In_ UINT32 jobCount,                             // Number of jobs
+    _In_ UINT32 threadCount,                          // Number of threads, or zero
+    _Out_writes_(jobCount) IDxcOperationResult **ppResults // Linker output status, buffer, and errors of each job
+  ) = 0;
+
+  DECLARE_CROSS_PLATFORM_UUIDOF(IDxcBatchLinker)
+};
+
 static const UINT32 DxcValidatorFlags_Default = 0;
 static const UINT32 DxcValidatorFlags_InPlaceEdit = 1;  // Validator is allowed to update shader blob in-place.
 static const UINT32 DxcValidatorFlags_RootSignatureOnly = 2;
 static const UINT32 DxcValidatorFlags_ModuleOnly = 4;
-static const UINT32 DxcValidatorFlags_ValidMask = 0x7;
+// Checks only that the container parts match the module metadata; function
+// bodies are not validated and are parsed only if a part is built from them.
+static const UINT32 DxcValidatorFlags_ContainerPartsOnly = 8;
+static const UINT32 DxcValidatorFlags_ValidMask = 0xF;
 
 struct __declspec(uuid("A6E82BD2-1FD7-4826-9811-2857E797F49A"))
 IDxcValidator : public IUnknown {
@@ -278,6 +452,34 @@ IDxcValidator : public IUnknown {
   DECLARE_CROSS_PLATFORM_UUIDOF(IDxcValidator)
 };
 
+// Validates a shader, skipping library functions that passed validation in a
+// previous run with identical content and module-level state. The state blob
+// records the functions that passed; pass it back as pPriorState next time.
+struct __declspec(uuid("5C2E8F41-7A93-4D06-B1E5-2F8C4A6D9B37"))
+IDxcIncrementalValidator : public IUnknown {
+  virtual HRESULT STDMETHODCALLTYPE ValidateIncremental(
+    _In_ IDxcBlob *pShader,                       // Shader to validate.
+    _In_ UINT32 Flags,                            // Validation flags.
+    _In_opt_ IDxcBlob *pPriorState,               // State from a previous run; ignored if stale.
+    _COM_Outptr_ IDxcOperationResult **ppResult,  // Validation output status, buffer, and errors
+    _COM_Outptr_opt_ IDxcBlob **ppState,          // State for the next run.
+    _Out_opt_ UINT32 *pFunctionCount,             // Functions with bodies in the module.
+    _Out_opt_ UINT32 *pRevalidatedCount           // Functions validated in this run.
+    ) = 0;
+
+  DECLARE_CROSS_PLATFORM_UUIDOF(IDxcIncrementalValidator)
+};
+
+struct __declspec(uuid("8D7F1B2C-4E6A-4F39-9C05-B3A1E7D2F648"))
+IDxcValidatorOptions : public IUnknown {
+  // Sets the number of threads that validate function bodies; zero selects
+  // the number of hardware threads. The default is one. Diagnostics are the
+  // same for every thread count.
+  virtual HRESULT STDMETHODCALLTYPE SetThreadCount(UINT32 threadCount) = 0;
+
+  DECLARE_CROSS_PLATFORM_UUIDOF(IDxcValidatorOptions)
+};
+
 struct __declspec(uuid("334b1f50-2292-4b35-99a1-25588d8c17fe"))
 IDxcContainerBuilder : public IUnknown {
   virtual HRESULT STDMETHODCALLTYPE Load(_In_ IDxcBlob *pDxilContainerHeader) = 0;                // Loads DxilContainer to the builder
@@ -338,6 +540,37 @@ IDxcOptimizer : public IUnknown {
   DECLARE_CROSS_PLATFORM_UUIDOF(IDxcOptimizer)
 };
 
+// A pass pipeline parsed once from RunOptimizer options, to run over many
+// modules. Passes are created once per thread and reused for each module.
+struct __declspec(uuid("9A3E6F42-1C7B-4D85-B2E9-5F0A8C4D1E73"))
+IDxcOptimizerPipeline : public IUnknown {
+  // Runs the pipeline on one module, like RunOptimizer.
+  virtual HRESULT STDMETHODCALLTYPE Run(IDxcBlob *pBlob,
+    _COM_Outptr_opt_ IDxcBlob **ppOutputModule,
+    _COM_Outptr_opt_ IDxcBlobEncoding **ppOutputText) = 0;
+  // Runs the pipeline on each module in parallel, on threadCount threads or
+  // one per hardware thread when threadCount is zero. Outputs are returned
+  // in module order; either output array may be null. Fails, returning no
+  // outputs, if any module fails.
+  virtual HRESULT STDMETHODCALLTYPE RunBatch(
+    _In_count_(blobCount) IDxcBlob **ppBlobs, UINT32 blobCount,
+    UINT32 threadCount,
+    _Out_writes_opt_(blobCount) IDxcBlob **ppOutputModules,
+    _Out_writes_opt_(blobCount) IDxcBlobEncoding **ppOutputTexts) = 0;
+
+  DECLARE_CROSS_PLATFORM_UUIDOF(IDxcOptimizerPipeline)
+};
+
+struct __declspec(uuid("6B0C2E1D-84F3-4A97-9E5C-3D71B8A2F046"))
+IDxcOptimizer2 : public IDxcOptimizer {
+  // Parses RunOptimizer options into a pipeline that can be run repeatedly.
+  virtual HRESULT STDMETHODCALLTYPE CreatePipeline(
+    _In_count_(optionCount) LPCWSTR *ppOptions, UINT32 optionCount,
+    _COM_Outptr_ IDxcOptimizerPipeline **ppPipeline) = 0;
+
+  DECLARE_CROSS_PLATFORM_UUIDOF(IDxcOptimizer2)
+};
+
 static const UINT32 DxcVersionInfoFlags_None = 0;
 static const UINT32 DxcVersionInfoFlags_Debug = 1; // Matches VS_FF_DEBUG
 static const UINT32 DxcVersionInfoFlags_Internal = 2; // Internal Validator (non-signing)
@@ -436,4 +669,33 @@ __declspec(selectany) EXTERN const GUID CLSID_DxcContainerBuilder = {
   0x4574,  
   { 0xb4, 0xd0, 0x87, 0x41, 0xe2, 0x52, 0x40, 0xd2 }
 };
+
+// Allocators to pass to DxcCreateInstance2. Both take their memory from the
+// IMalloc given to the DxcCreateInstance2 call that creates them, so they can
+// be stacked, and they can be used from several threads at once.
+
+// Creates an IMalloc that bumps a pointer through large chunks and returns
+// them all when its last reference is released. Objects allocated from it,
+// such as compilers and their results, keep it alive, so creating one per
+// compile frees the memory of the compile in one shot once its compiler and
+// results are released. Freed blocks are only reused in a few cases, so it
+// suits short-lived work, not long-lived objects.
+// {5459301E-DE4C-400D-A9EC-4302FDE593BD}
+__declspec(selectany) EXTERN const GUID CLSID_DxcArenaMalloc = {
+  0x5459301e,
+  0xde4c,
+  0x400d,
+  { 0xa9, 0xec, 0x43, 0x02, 0xfd, 0xe5, 0x93, 0xbd }
+};
+
+// Creates an IMalloc that forwards to another one and counts the
+// allocations, bytes and peak bytes that go through it. It implements
+// IDxcMallocStats.
+// {9182D4F1-28EF-4566-B0B1-5D20A379C076}
+__declspec(selectany) EXTERN const GUID CLSID_DxcProfilingMalloc = {
+  0x9182d4f1,
+  0x28ef,
+  0x4566,
+  { 0xb0, 0xb1, 0x5d, 0x20, 0xa3, 0x79, 0xc0, 0x76 }
+};
 #endif
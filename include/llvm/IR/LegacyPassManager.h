@@ -90,11 +90,48 @@ public:
   ///
   bool doFinalization();
 
+  // HLSL Change Begins.
+  /// setModule - Run the passes on functions of another module.
+  void setModule(Module *m) { M = m; }
+  // HLSL Change Ends.
+
 private:
   FunctionPassManagerImpl *FPM;
   Module *M;
 };
 
+// HLSL Change Starts
+/// PassObserver - Notified by the pass managers before and after each pass
+/// they run on the current thread, while installed with ScopedPassObserver.
+/// Pass managers themselves are not reported.
+class PassObserver {
+public:
+  virtual ~PassObserver() {}
+
+  /// F is the function the pass runs on, or null for a module pass.
+  virtual void beforePass(Pass *P, Module &M, Function *F) = 0;
+  virtual void afterPass(Pass *P, Module &M, Function *F) = 0;
+
+  /// addCounter - Adds Value to a named counter reported by a pass while it
+  /// runs, such as the number of calls it lowered.
+  virtual void addCounter(StringRef Name, uint64_t Value) {}
+};
+
+/// getPassObserver - Return the observer installed on this thread, if any.
+PassObserver *getPassObserver();
+
+/// ScopedPassObserver - Installs an observer on the current thread for the
+/// lifetime of this object, and restores the previous one after.
+class ScopedPassObserver {
+public:
+  explicit ScopedPassObserver(PassObserver *O);
+  ~ScopedPassObserver();
+
+private:
+  PassObserver *Prior;
+};
+// HLSL Change Ends
+
 } // End legacy namespace
 
 // Create wrappers for C Binding types (see CBindingWrapping.h).
@@ -735,10 +735,10 @@ Function *OP::GetOpFunc(OpCode opCode, Type *pOverloadType) {
   DXASSERT(IsOverloadLegal(opCode, pOverloadType), "otherwise the caller requested illegal operation overload (eg HLSL function with unsupported types for mapped intrinsic function)");
   OpCodeClass opClass = m_OpCodeProps[(unsigned)opCode].opCodeClass;
   Function *&F = m_OpCodeClassCache[(unsigned)opClass].pOverloads[pOverloadType];
-  if (F != nullptr) {
-    UpdateCache(opClass, pOverloadType, F);
+  // Cached functions are always in m_FunctionToOpClass too, so a hit needs no
+  // cache update.
+  if (F != nullptr)
     return F;
-  }
 
   vector<Type*> ArgTypes;      // RetType is ArgTypes[0]
   Type *pETy = pOverloadType;
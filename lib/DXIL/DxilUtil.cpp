@@ -13,6 +13,8 @@
 #include "dxc/DXIL/DxilTypeSystem.h"
 #include "dxc/DXIL/DxilUtil.h"
 #include "dxc/DXIL/DxilModule.h"
+#include "dxc/DXIL/DxilOperations.h"
+#include "dxc/DXIL/DxilInstructions.h"
 #include "dxc/Support/Global.h"
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/Twine.h"
@@ -29,6 +31,7 @@
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/DIBuilder.h"
 #include "llvm/IR/IRBuilder.h"
+#include <unordered_set>
 
 using namespace llvm;
 using namespace hlsl;
@@ -609,6 +612,114 @@ llvm::Type* WrapInArrayTypes(llvm::Type *Ty, llvm::ArrayRef<unsigned> OuterToInn
   return Ty;
 }
 
+// Find the imm offset part from a value.
+// It must exist unless offset is 0.
+static unsigned GetCBOffset(Value *V) {
+  if (ConstantInt *Imm = dyn_cast<ConstantInt>(V))
+    return Imm->getLimitedValue();
+  else if (isa<UnaryInstruction>(V)) {
+    return 0;
+  } else if (BinaryOperator *BO = dyn_cast<BinaryOperator>(V)) {
+    switch (BO->getOpcode()) {
+    case Instruction::Add: {
+      unsigned left = GetCBOffset(BO->getOperand(0));
+      unsigned right = GetCBOffset(BO->getOperand(1));
+      return left + right;
+    } break;
+    case Instruction::Or: {
+      unsigned left = GetCBOffset(BO->getOperand(0));
+      unsigned right = GetCBOffset(BO->getOperand(1));
+      return left | right;
+    } break;
+    default:
+      return 0;
+    }
+  } else {
+    return 0;
+  }
+}
+
+static void CollectInPhiChain(PHINode *cbUser, std::vector<unsigned> &cbufUsage,
+                              unsigned offset,
+                              std::unordered_set<Value *> &userSet) {
+  if (userSet.count(cbUser) > 0)
+    return;
+
+  userSet.insert(cbUser);
+  for (User *cbU : cbUser->users()) {
+    if (ExtractValueInst *EV = dyn_cast<ExtractValueInst>(cbU)) {
+      for (unsigned idx : EV->getIndices()) {
+        cbufUsage.emplace_back(offset + idx * 4);
+      }
+    } else {
+      PHINode *phi = cast<PHINode>(cbU);
+      CollectInPhiChain(phi, cbufUsage, offset, userSet);
+    }
+  }
+}
+
+void CollectCBufferUsage(llvm::Value *cbHandle,
+                         std::vector<unsigned> &cbufUsage) {
+  for (User *U : cbHandle->users()) {
+    CallInst *CI = cast<CallInst>(U);
+    ConstantInt *opcodeV =
+        cast<ConstantInt>(CI->getArgOperand(DXIL::OperandIndex::kOpcodeIdx));
+    DXIL::OpCode opcode = static_cast<DXIL::OpCode>(opcodeV->getLimitedValue());
+    if (opcode == DXIL::OpCode::CBufferLoadLegacy) {
+      DxilInst_CBufferLoadLegacy cbload(CI);
+      Value *resIndex = cbload.get_regIndex();
+      unsigned offset = GetCBOffset(resIndex);
+      // 16 bytes align.
+      offset <<= 4;
+      for (User *cbU : U->users()) {
+        if (ExtractValueInst *EV = dyn_cast<ExtractValueInst>(cbU)) {
+          for (unsigned idx : EV->getIndices()) {
+            cbufUsage.emplace_back(offset + idx * 4);
+          }
+        } else {
+          PHINode *phi = cast<PHINode>(cbU);
+          std::unordered_set<Value *> userSet;
+          CollectInPhiChain(phi, cbufUsage, offset, userSet);
+        }
+      }
+    } else if (opcode == DXIL::OpCode::CBufferLoad) {
+      DxilInst_CBufferLoad cbload(CI);
+      Value *byteOffset = cbload.get_byteOffset();
+      unsigned offset = GetCBOffset(byteOffset);
+      cbufUsage.emplace_back(offset);
+    } else {
+      //
+      DXASSERT(0, "invalid opcode");
+    }
+  }
+}
+
+bool CollectCBufferUsage(llvm::Module &M,
+                         std::vector<std::vector<unsigned>> &cbufUsage) {
+  // Look the function up rather than asking OP for it, so that neither a
+  // missing declaration is added nor a stale function cache is trusted.
+  bool bHasHandles = false;
+  for (Function &F : M.functions()) {
+    if (!OP::IsDxilOpFunc(&F) || F.user_empty())
+      continue;
+    if (OP::GetDxilOpFuncCallInst(cast<CallInst>(*F.user_begin())) !=
+        DXIL::OpCode::CreateHandle)
+      continue;
+    bHasHandles = true;
+    for (User *U : F.users()) {
+      DxilInst_CreateHandle handle(cast<CallInst>(U));
+      ConstantInt *immResClass = cast<ConstantInt>(handle.get_resourceClass());
+      if (immResClass->getLimitedValue() !=
+          (unsigned)DXIL::ResourceClass::CBuffer)
+        continue;
+      uint64_t cbID = cast<ConstantInt>(handle.get_rangeId())->getLimitedValue();
+      if (cbID < cbufUsage.size())
+        CollectCBufferUsage(U, cbufUsage[cbID]);
+    }
+  }
+  return bHasHandles;
+}
+
 }
 }
 
@@ -219,6 +219,42 @@ BOOL GetFileSizeEx(_In_ HANDLE hFile, _Out_ PLARGE_INTEGER lpFileSize) {
   return false;
 }
 
+static void TimespecToFileTime(const struct timespec &ts, LPFILETIME ft) {
+  // FILETIME counts 100-nanosecond intervals since January 1, 1601.
+  const uint64_t EpochDifference = 116444736000000000ULL;
+  uint64_t t = EpochDifference + (uint64_t)ts.tv_sec * 10000000ULL +
+               ts.tv_nsec / 100;
+  ft->dwLowDateTime = (DWORD)t;
+  ft->dwHighDateTime = (DWORD)(t >> 32);
+}
+
+BOOL GetFileTime(_In_ HANDLE hFile, _Out_opt_ LPFILETIME lpCreationTime,
+                 _Out_opt_ LPFILETIME lpLastAccessTime,
+                 _Out_opt_ LPFILETIME lpLastWriteTime) {
+  int fd = (size_t)hFile;
+  struct stat fdstat;
+  int rv = fstat(fd, &fdstat);
+  if (rv)
+    return false;
+#ifdef __APPLE__
+  const struct timespec &ctim = fdstat.st_ctimespec;
+  const struct timespec &atim = fdstat.st_atimespec;
+  const struct timespec &mtim = fdstat.st_mtimespec;
+#else
+  const struct timespec &ctim = fdstat.st_ctim;
+  const struct timespec &atim = fdstat.st_atim;
+  const struct timespec &mtim = fdstat.st_mtim;
+#endif
+  // There is no creation time; report the last status change instead.
+  if (lpCreationTime)
+    TimespecToFileTime(ctim, lpCreationTime);
+  if (lpLastAccessTime)
+    TimespecToFileTime(atim, lpLastAccessTime);
+  if (lpLastWriteTime)
+    TimespecToFileTime(mtim, lpLastWriteTime);
+  return true;
+}
+
 BOOL ReadFile(_In_ HANDLE hFile, _Out_ LPVOID lpBuffer,
               _In_ DWORD nNumberOfBytesToRead,
               _Out_opt_ LPDWORD lpNumberOfBytesRead,
@@ -0,0 +1,248 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// dxcthreadpool.cpp                                                         //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Provides a work-stealing pool for running independent tasks in parallel.  //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/Support/Global.h"
+#include "dxc/Support/WinIncludes.h"
+#include "dxc/Support/dxcthreadpool.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+using namespace hlsl;
+
+namespace {
+
+typedef std::function<void(unsigned, unsigned)> TaskFn;
+
+// Tasks waiting to run on one worker. The owner takes tasks from the front,
+// thieves take them from the back.
+struct WorkerQueue {
+  std::mutex Mutex;
+  std::deque<unsigned> Tasks;
+};
+
+// State shared by the workers of a single WorkStealingThreadPool::run call.
+class PoolRun {
+public:
+  PoolRun(unsigned TaskCount, unsigned WorkerCount, const TaskFn &Task)
+      : m_Queues(new WorkerQueue[WorkerCount]), m_WorkerCount(WorkerCount),
+        m_Task(Task), m_Failed(false) {
+    for (unsigned W = 0; W < WorkerCount; ++W) {
+      unsigned Begin = (unsigned)((uint64_t)TaskCount * W / WorkerCount);
+      unsigned End = (unsigned)((uint64_t)TaskCount * (W + 1) / WorkerCount);
+      for (unsigned i = Begin; i < End; ++i)
+        m_Queues[W].Tasks.push_back(i);
+    }
+  }
+
+  void Work(unsigned WorkerIndex) {
+    unsigned TaskIndex;
+    while (!m_Failed && (PopOwn(WorkerIndex, TaskIndex) ||
+                         Steal(WorkerIndex, TaskIndex))) {
+      try {
+        m_Task(TaskIndex, WorkerIndex);
+      } catch (...) {
+        std::lock_guard<std::mutex> Lock(m_ErrorMutex);
+        if (!m_Error)
+          m_Error = std::current_exception();
+        m_Failed = true;
+      }
+    }
+  }
+
+  void RethrowError() {
+    if (m_Error)
+      std::rethrow_exception(m_Error);
+  }
+
+private:
+  bool PopOwn(unsigned WorkerIndex, unsigned &TaskIndex) {
+    WorkerQueue &Queue = m_Queues[WorkerIndex];
+    std::lock_guard<std::mutex> Lock(Queue.Mutex);
+    if (Queue.Tasks.empty())
+      return false;
+    TaskIndex = Queue.Tasks.front();
+    Queue.Tasks.pop_front();
+    return true;
+  }
+
+  // No tasks are added once the run starts, so a worker that finds every
+  // queue empty is done.
+  bool Steal(unsigned WorkerIndex, unsigned &TaskIndex) {
+    for (unsigned Offset = 1; Offset < m_WorkerCount; ++Offset) {
+      WorkerQueue &Victim = m_Queues[(WorkerIndex + Offset) % m_WorkerCount];
+      std::lock_guard<std::mutex> Lock(Victim.Mutex);
+      if (Victim.Tasks.empty())
+        continue;
+      TaskIndex = Victim.Tasks.back();
+      Victim.Tasks.pop_back();
+      return true;
+    }
+    return false;
+  }
+
+  std::unique_ptr<WorkerQueue[]> m_Queues;
+  unsigned m_WorkerCount;
+  const TaskFn &m_Task;
+  std::atomic<bool> m_Failed;
+  std::mutex m_ErrorMutex;
+  std::exception_ptr m_Error;
+};
+
+// Releases the default allocator a worker thread installed once the thread
+// exits. The runtime frees the thread's start arguments after the thread
+// function returns, so the allocator has to stay installed until then.
+class WorkerThreadMalloc {
+public:
+  WorkerThreadMalloc() : m_Installed(false) {}
+  ~WorkerThreadMalloc() {
+    if (m_Installed)
+      DxcClearThreadMalloc();
+  }
+  void Install() {
+    DxcSetThreadMallocToDefault();
+    m_Installed = true;
+  }
+
+private:
+  bool m_Installed;
+};
+
+thread_local WorkerThreadMalloc t_WorkerThreadMalloc;
+
+} // namespace
+
+// The threads of a pool, which wait for a run between runs.
+class WorkStealingThreadPool::Workers {
+public:
+  Workers() : m_pRun(nullptr), m_Generation(0), m_RunThreads(0), m_Busy(0),
+              m_Stopping(false) {}
+
+  ~Workers() {
+    {
+      std::lock_guard<std::mutex> Lock(m_Mutex);
+      m_Stopping = true;
+    }
+    m_RunReady.notify_all();
+    for (std::thread &Thread : m_Threads)
+      Thread.join();
+  }
+
+  // Starts threads until there are Count, and returns how many there are.
+  // Fewer are returned if a thread cannot be started.
+  unsigned Reserve(unsigned Count) {
+    while (m_Threads.size() < Count) {
+      try {
+        m_Threads.emplace_back(&Workers::ThreadMain, this,
+                               (unsigned)m_Threads.size() + 1);
+      } catch (const std::system_error &) {
+        break;
+      }
+    }
+    return (unsigned)m_Threads.size();
+  }
+
+  // Has the first ThreadCount threads work on Run as workers 1 and up.
+  void Start(PoolRun *pRun, unsigned ThreadCount) {
+    std::lock_guard<std::mutex> Lock(m_Mutex);
+    m_pRun = pRun;
+    m_RunThreads = ThreadCount;
+    m_Busy = ThreadCount;
+    ++m_Generation;
+    m_RunReady.notify_all();
+  }
+
+  // Returns once the threads of the started run are done with it.
+  void Wait() {
+    std::unique_lock<std::mutex> Lock(m_Mutex);
+    m_RunDone.wait(Lock, [this] { return m_Busy == 0; });
+    m_pRun = nullptr;
+  }
+
+private:
+  void ThreadMain(unsigned WorkerIndex) {
+    t_WorkerThreadMalloc.Install();
+    uint64_t Seen = 0;
+    std::unique_lock<std::mutex> Lock(m_Mutex);
+    for (;;) {
+      m_RunReady.wait(Lock,
+                      [&] { return m_Stopping || m_Generation != Seen; });
+      if (m_Stopping)
+        return;
+      Seen = m_Generation;
+      if (WorkerIndex > m_RunThreads)
+        continue;
+      PoolRun *pRun = m_pRun;
+      Lock.unlock();
+      pRun->Work(WorkerIndex);
+      Lock.lock();
+      if (--m_Busy == 0)
+        m_RunDone.notify_all();
+    }
+  }
+
+  std::vector<std::thread> m_Threads; // Worker i + 1 runs on m_Threads[i].
+  std::mutex m_Mutex;
+  std::condition_variable m_RunReady;
+  std::condition_variable m_RunDone;
+  PoolRun *m_pRun;
+  uint64_t m_Generation; // Counts runs, so that each is worked on once.
+  unsigned m_RunThreads;
+  unsigned m_Busy;
+  bool m_Stopping;
+};
+
+WorkStealingThreadPool::WorkStealingThreadPool(unsigned ThreadCount)
+    : m_ThreadCount(ThreadCount) {
+  if (m_ThreadCount == 0)
+    m_ThreadCount = std::max(1u, std::thread::hardware_concurrency());
+}
+
+WorkStealingThreadPool::~WorkStealingThreadPool() {
+  if (m_Workers) {
+    // The threads were started with the default allocator.
+    DxcThreadMalloc TM(nullptr);
+    m_Workers.reset();
+  }
+}
+
+void WorkStealingThreadPool::run(unsigned TaskCount, const TaskFn &Task) {
+  if (TaskCount == 0)
+    return;
+
+  // Thread start arguments are allocated here and freed on the new thread,
+  // so both sides use the default allocator.
+  DxcThreadMalloc TM(nullptr);
+  unsigned WorkerCount = std::min(m_ThreadCount, TaskCount);
+  PoolRun Run(TaskCount, WorkerCount, Task);
+  unsigned ThreadCount = 0;
+  if (WorkerCount > 1) {
+    if (!m_Workers)
+      m_Workers.reset(new Workers());
+    // Tasks queued for a worker that could not be started are stolen by the
+    // others.
+    ThreadCount = std::min(m_Workers->Reserve(WorkerCount - 1),
+                           WorkerCount - 1);
+    if (ThreadCount > 0)
+      m_Workers->Start(&Run, ThreadCount);
+  }
+  Run.Work(0);
+  if (ThreadCount > 0)
+    m_Workers->Wait();
+  Run.RethrowError();
+}
@@ -122,4 +122,87 @@ DxilProgramHeader *GetDxilProgramHeader(DxilContainerHeader *pHeader, DxilFourCC
       GetDxilProgramHeader(static_cast<const DxilContainerHeader *>(pHeader), fourCC));
 }
 
+static bool IsDxilCBufferLayoutNameValid(const DxilPartHeader *pPart,
+                                         uint32_t NamesOffset,
+                                         uint32_t NameOffset) {
+  if (NameOffset < NamesOffset || NameOffset >= pPart->PartSize)
+    return false;
+  // The name must be terminated inside the part.
+  return memchr(GetDxilPartData(pPart) + NameOffset, 0,
+                pPart->PartSize - NameOffset) != nullptr;
+}
+
+bool IsDxilCBufferLayoutValid(const DxilPartHeader *pPart) {
+  if (pPart->PartFourCC != DFCC_ConstantBufferLayout) return false;
+  if (pPart->PartSize < sizeof(DxilCBufferLayout)) return false;
+  const DxilCBufferLayout *pLayout =
+      reinterpret_cast<const DxilCBufferLayout *>(GetDxilPartData(pPart));
+  if (pLayout->Version != DxilCBufferLayoutVersion) return false;
+  uint64_t NamesOffset =
+      sizeof(DxilCBufferLayout) +
+      (uint64_t)pLayout->BufferCount * sizeof(DxilCBufferLayoutBuffer) +
+      (uint64_t)pLayout->VariableCount * sizeof(DxilCBufferLayoutVariable) +
+      (uint64_t)pLayout->TypeCount * sizeof(DxilCBufferLayoutType) +
+      (uint64_t)pLayout->MemberCount * sizeof(DxilCBufferLayoutMember);
+  if (NamesOffset > pPart->PartSize) return false;
+
+  DxilCBufferLayoutTables Tables;
+  GetDxilCBufferLayoutTables(pPart, Tables);
+  for (uint32_t i = 0; i < pLayout->BufferCount; ++i) {
+    const DxilCBufferLayoutBuffer &Buffer = Tables.Buffers[i];
+    if (!IsDxilCBufferLayoutNameValid(pPart, NamesOffset, Buffer.NameOffset))
+      return false;
+    if (Buffer.Kind > (uint32_t)DxilCBufferLayoutBufferKind::StructuredBuffer)
+      return false;
+    if ((uint64_t)Buffer.FirstVariable + Buffer.VariableCount >
+        pLayout->VariableCount)
+      return false;
+  }
+  for (uint32_t i = 0; i < pLayout->VariableCount; ++i) {
+    const DxilCBufferLayoutVariable &Variable = Tables.Variables[i];
+    if (!IsDxilCBufferLayoutNameValid(pPart, NamesOffset, Variable.NameOffset))
+      return false;
+    if (Variable.TypeIndex != DxilCBufferLayoutNoType &&
+        Variable.TypeIndex >= pLayout->TypeCount)
+      return false;
+  }
+  for (uint32_t i = 0; i < pLayout->TypeCount; ++i) {
+    const DxilCBufferLayoutType &Type = Tables.Types[i];
+    if (!IsDxilCBufferLayoutNameValid(pPart, NamesOffset, Type.NameOffset))
+      return false;
+    if (Type.Class > (uint32_t)DxilCBufferLayoutTypeClass::Void)
+      return false;
+    if ((uint64_t)Type.FirstMember + Type.MemberCount > pLayout->MemberCount)
+      return false;
+    // Members refer to earlier types only, so types cannot contain
+    // themselves.
+    for (uint32_t m = 0; m < Type.MemberCount; ++m) {
+      const DxilCBufferLayoutMember &Member = Tables.Members[Type.FirstMember + m];
+      if (Member.TypeIndex >= i)
+        return false;
+    }
+  }
+  for (uint32_t i = 0; i < pLayout->MemberCount; ++i) {
+    if (!IsDxilCBufferLayoutNameValid(pPart, NamesOffset,
+                                      Tables.Members[i].NameOffset))
+      return false;
+  }
+  return true;
+}
+
+void GetDxilCBufferLayoutTables(const DxilPartHeader *pPart,
+                                DxilCBufferLayoutTables &Tables) {
+  const DxilCBufferLayout *pLayout =
+      reinterpret_cast<const DxilCBufferLayout *>(GetDxilPartData(pPart));
+  Tables.pPartData = GetDxilPartData(pPart);
+  Tables.Buffers =
+      reinterpret_cast<const DxilCBufferLayoutBuffer *>(pLayout + 1);
+  Tables.Variables = reinterpret_cast<const DxilCBufferLayoutVariable *>(
+      Tables.Buffers + pLayout->BufferCount);
+  Tables.Types = reinterpret_cast<const DxilCBufferLayoutType *>(
+      Tables.Variables + pLayout->VariableCount);
+  Tables.Members = reinterpret_cast<const DxilCBufferLayoutMember *>(
+      Tables.Types + pLayout->TypeCount);
+}
+
 } // namespace hlsl
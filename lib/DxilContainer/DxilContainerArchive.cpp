@@ -0,0 +1,443 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilContainerArchive.cpp                                                  //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Provides support for archives of dxil containers.                         //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/Support/Global.h"
+#include "dxc/Support/WinIncludes.h"
+#include "dxc/Support/FileIOHelper.h"
+#include "dxc/DxilContainer/DxilContainerArchive.h"
+#include "dxc/DxilContainer/DxilContainerAssembler.h"
+#include "dxc/DxilContainer/DxilContainerReader.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/MemoryBuffer.h"
+
+using namespace llvm;
+
+namespace hlsl {
+
+static uint64_t AlignedPartSize(const DxilPartHeader *pPart) {
+  return sizeof(DxilPartHeader) + RoundUpToAlignment(pPart->PartSize, 4);
+}
+
+static void AppendPart(std::vector<char> &Data, const DxilPartHeader *pPart) {
+  const char *pBegin = (const char *)pPart;
+  Data.insert(Data.end(), pBegin,
+              pBegin + sizeof(DxilPartHeader) + pPart->PartSize);
+  Data.resize(RoundUpToAlignment(Data.size(), 4), '\0');
+}
+
+// Gets the hash that SerializeDxilContainerForModule computes for the
+// program, taking it from the shader hash part when that matches.
+static bool GetProgramHash(const DxilContainerReader &Reader,
+                           const DxilPartHeader *pProgramPart,
+                           DxilShaderHash *pHash) {
+  const char *pData;
+  uint32_t size;
+  if (Reader.GetPartContent(DFCC_ShaderHash, &pData, &size) &&
+      size == sizeof(DxilShaderHash)) {
+    memcpy(pHash, pData, sizeof(DxilShaderHash));
+    if (pHash->Flags == (uint32_t)DxilShaderHashFlags::None)
+      return true;
+  }
+
+  const DxilProgramHeader *pProgramHeader =
+      (const DxilProgramHeader *)GetDxilPartData(pProgramPart);
+  if (!IsValidDxilProgramHeader(pProgramHeader, pProgramPart->PartSize))
+    return false;
+  const char *pBitcode;
+  uint32_t bitcodeSize;
+  GetDxilProgramBitcode(pProgramHeader, &pBitcode, &bitcodeSize);
+  MD5 md5;
+  md5.update(ArrayRef<uint8_t>((const uint8_t *)pBitcode, bitcodeSize));
+  md5.final(pHash->Digest);
+  pHash->Flags = (uint32_t)DxilShaderHashFlags::None;
+  return true;
+}
+
+DxilContainerArchiveWriter::DxilContainerArchiveWriter()
+    : m_size(sizeof(DxilArchiveHeader)) {
+  m_stats.ArchiveBytes = m_size;
+}
+
+DxilContainerArchiveWriter::~DxilContainerArchiveWriter() {}
+
+uint32_t DxilContainerArchiveWriter::FindOrAddProgram(
+    const DxilShaderHash &Hash, const DxilPartHeader *pPart, bool *pAdded) {
+  std::vector<uint32_t> &candidates = m_programIndex[StringRef(
+      (const char *)Hash.Digest, DxilContainerHashSize)];
+  const size_t partSize = sizeof(DxilPartHeader) + pPart->PartSize;
+  for (uint32_t index : candidates) {
+    const std::vector<char> &Part = m_programs[index].Part;
+    // The part header is compared too, so equal bytes mean equal sizes.
+    if (Part.size() >= partSize && memcmp(Part.data(), pPart, partSize) == 0) {
+      *pAdded = false;
+      return index;
+    }
+  }
+
+  Program program;
+  program.Hash = Hash;
+  AppendPart(program.Part, pPart);
+  m_programs.push_back(std::move(program));
+  candidates.push_back((uint32_t)m_programs.size() - 1);
+  *pAdded = true;
+  return (uint32_t)m_programs.size() - 1;
+}
+
+bool IsValidDxilArchiveContainerName(StringRef Name) {
+  return !Name.empty() && Name != "." && Name != ".." &&
+         Name.find_first_of(StringRef("/\\:\0", 4)) == StringRef::npos;
+}
+
+HRESULT DxilContainerArchiveWriter::AddContainer(StringRef Name,
+                                                 const void *pData,
+                                                 size_t size) {
+  if (!IsValidDxilArchiveContainerName(Name))
+    return E_INVALIDARG;
+  DxilContainerReader reader;
+  IFR(reader.Load(pData, size));
+  const DxilContainerHeader *pHeader = reader.GetHeader();
+  const DxilPartHeader *pProgramPart = reader.FindPart(DFCC_DXIL);
+
+  DxilShaderHash hash;
+  if (pProgramPart && !GetProgramHash(reader, pProgramPart, &hash))
+    return DXC_E_CONTAINER_INVALID;
+
+  // Check the size before anything is added, so a failure leaves the
+  // archive as it was.
+  uint64_t addedSize = sizeof(DxilArchiveContainer) +
+                       RoundUpToAlignment(Name.size() + 1, 4);
+  for (const DxilPartHeader *pPart : reader) {
+    if (pPart != pProgramPart)
+      addedSize += AlignedPartSize(pPart);
+  }
+  uint64_t programSize =
+      pProgramPart ? sizeof(DxilArchiveProgram) + AlignedPartSize(pProgramPart)
+                   : 0;
+  if (m_size + addedSize + programSize > UINT32_MAX)
+    return DXC_E_DATA_TOO_LARGE;
+
+  Container container;
+  container.Name = Name;
+  container.Hash = pHeader->Hash;
+  container.Version = pHeader->Version;
+  container.ProgramIndex = DxilArchiveNoProgram;
+  container.ProgramPartIndex = 0;
+  container.PartCount = 0;
+  uint32_t partIndex = 0;
+  for (const DxilPartHeader *pPart : reader) {
+    if (pPart == pProgramPart) {
+      container.ProgramPartIndex = partIndex;
+    } else {
+      AppendPart(container.Parts, pPart);
+      ++container.PartCount;
+    }
+    ++partIndex;
+  }
+
+  if (pProgramPart) {
+    bool added;
+    container.ProgramIndex = FindOrAddProgram(hash, pProgramPart, &added);
+    ++m_stats.ProgramCount;
+    m_stats.ProgramBytes += sizeof(DxilPartHeader) + pProgramPart->PartSize;
+    if (added) {
+      addedSize += programSize;
+      ++m_stats.UniqueProgramCount;
+      m_stats.UniqueProgramBytes +=
+          sizeof(DxilPartHeader) + pProgramPart->PartSize;
+    }
+  }
+  m_containers.push_back(std::move(container));
+
+  m_size += addedSize;
+  ++m_stats.ContainerCount;
+  m_stats.ContainerBytes += pHeader->ContainerSizeInBytes;
+  m_stats.ArchiveBytes = m_size;
+  return S_OK;
+}
+
+void DxilContainerArchiveWriter::write(AbstractMemoryStream *pStream) {
+  IFT(pStream->Reserve(size()));
+
+  DxilArchiveHeader header;
+  header.HeaderFourCC = DxilArchiveFourCC;
+  header.Version = DxilArchiveVersion;
+  header.ArchiveSizeInBytes = size();
+  header.ProgramCount = (uint32_t)m_programs.size();
+  header.ContainerCount = (uint32_t)m_containers.size();
+  IFT(WriteStreamValue(pStream, header));
+
+  uint32_t offset = sizeof(DxilArchiveHeader) +
+                    sizeof(DxilArchiveProgram) * header.ProgramCount +
+                    sizeof(DxilArchiveContainer) * header.ContainerCount;
+  for (const Program &program : m_programs) {
+    DxilArchiveProgram entry;
+    entry.Hash = program.Hash;
+    entry.PartOffset = offset;
+    IFT(WriteStreamValue(pStream, entry));
+    offset += (uint32_t)program.Part.size();
+  }
+  uint32_t nameOffset = offset;
+  for (const Container &container : m_containers)
+    nameOffset += (uint32_t)container.Parts.size();
+  for (const Container &container : m_containers) {
+    DxilArchiveContainer entry;
+    entry.NameOffset = nameOffset;
+    entry.NameLength = (uint32_t)container.Name.size();
+    entry.Hash = container.Hash;
+    entry.Version = container.Version;
+    entry.ProgramIndex = container.ProgramIndex;
+    entry.ProgramPartIndex = container.ProgramPartIndex;
+    entry.PartCount = container.PartCount;
+    entry.PartsOffset = offset;
+    entry.PartsSizeInBytes = (uint32_t)container.Parts.size();
+    IFT(WriteStreamValue(pStream, entry));
+    offset += entry.PartsSizeInBytes;
+    nameOffset += (uint32_t)RoundUpToAlignment(entry.NameLength + 1, 4);
+  }
+
+  ULONG cbWritten;
+  for (const Program &program : m_programs)
+    IFT(pStream->Write(program.Part.data(), program.Part.size(), &cbWritten));
+  for (const Container &container : m_containers) {
+    if (!container.Parts.empty())
+      IFT(pStream->Write(container.Parts.data(), container.Parts.size(),
+                         &cbWritten));
+  }
+  const char Pad[] = { '\0', '\0', '\0', '\0' };
+  for (const Container &container : m_containers) {
+    IFT(pStream->Write(container.Name.data(), container.Name.size(),
+                       &cbWritten));
+    // Always writes at least one null to terminate the name.
+    IFT(pStream->Write(Pad, 4 - (container.Name.size() & 0x3), &cbWritten));
+  }
+  DXASSERT(nameOffset == size(), "else archive size is incorrect");
+}
+
+DxilContainerArchiveReader::DxilContainerArchiveReader()
+    : m_pHeader(nullptr) {}
+
+DxilContainerArchiveReader::~DxilContainerArchiveReader() {}
+
+void DxilContainerArchiveReader::Reset() {
+  m_pHeader = nullptr;
+  m_pFile.reset();
+}
+
+static bool IsInBounds(uint64_t offset, uint64_t size, uint64_t bound) {
+  return offset <= bound && size <= bound - offset;
+}
+
+// Checks that everything the archive refers to is in bounds, so that
+// reading and extracting need not check again.
+static bool IsValidDxilArchive(const DxilArchiveHeader *pHeader,
+                               size_t size) {
+  if (size < sizeof(DxilArchiveHeader) ||
+      pHeader->HeaderFourCC != DxilArchiveFourCC ||
+      pHeader->Version != DxilArchiveVersion ||
+      pHeader->ArchiveSizeInBytes > size)
+    return false;
+  const uint64_t bound = pHeader->ArchiveSizeInBytes;
+  const uint64_t programsOffset = sizeof(DxilArchiveHeader);
+  const uint64_t containersOffset =
+      programsOffset +
+      (uint64_t)sizeof(DxilArchiveProgram) * pHeader->ProgramCount;
+  if (!IsInBounds(containersOffset,
+                  (uint64_t)sizeof(DxilArchiveContainer) *
+                      pHeader->ContainerCount,
+                  bound))
+    return false;
+
+  const char *pBase = (const char *)pHeader;
+  auto IsValidPart = [&](uint64_t offset, uint64_t end) {
+    if (offset % 4 != 0 || !IsInBounds(offset, sizeof(DxilPartHeader), end))
+      return false;
+    const DxilPartHeader *pPart = (const DxilPartHeader *)(pBase + offset);
+    return IsInBounds(offset, AlignedPartSize(pPart), end);
+  };
+
+  const DxilArchiveProgram *pPrograms =
+      (const DxilArchiveProgram *)(pBase + programsOffset);
+  for (uint32_t i = 0; i < pHeader->ProgramCount; ++i) {
+    if (!IsValidPart(pPrograms[i].PartOffset, bound))
+      return false;
+  }
+
+  const DxilArchiveContainer *pContainers =
+      (const DxilArchiveContainer *)(pBase + containersOffset);
+  for (uint32_t i = 0; i < pHeader->ContainerCount; ++i) {
+    const DxilArchiveContainer &C = pContainers[i];
+    if (!IsInBounds(C.NameOffset, (uint64_t)C.NameLength + 1, bound) ||
+        pBase[C.NameOffset + C.NameLength] != '\0' ||
+        !IsValidDxilArchiveContainerName(
+            StringRef(pBase + C.NameOffset, C.NameLength)))
+      return false;
+    if (C.ProgramIndex != DxilArchiveNoProgram &&
+        (C.ProgramIndex >= pHeader->ProgramCount ||
+         C.ProgramPartIndex > C.PartCount))
+      return false;
+    if (!IsInBounds(C.PartsOffset, C.PartsSizeInBytes, bound))
+      return false;
+    const uint64_t partsEnd = (uint64_t)C.PartsOffset + C.PartsSizeInBytes;
+    uint64_t offset = C.PartsOffset;
+    for (uint32_t part = 0; part < C.PartCount; ++part) {
+      if (!IsValidPart(offset, partsEnd))
+        return false;
+      offset += AlignedPartSize((const DxilPartHeader *)(pBase + offset));
+    }
+    if (offset != partsEnd)
+      return false;
+  }
+  return true;
+}
+
+HRESULT DxilContainerArchiveReader::Load(const void *pData, size_t size) {
+  Reset();
+  const DxilArchiveHeader *pHeader = (const DxilArchiveHeader *)pData;
+  if (pData == nullptr || !IsValidDxilArchive(pHeader, size))
+    return DXC_E_CONTAINER_INVALID;
+  m_pHeader = pHeader;
+  return S_OK;
+}
+
+HRESULT DxilContainerArchiveReader::LoadFile(StringRef Path) {
+  Reset();
+  ErrorOr<std::unique_ptr<MemoryBuffer>> File =
+      MemoryBuffer::getFile(Path, -1, /*RequiresNullTerminator*/ false);
+  if (std::error_code ec = File.getError())
+    return HResultFromFileError(ec);
+  std::unique_ptr<MemoryBuffer> pFile = std::move(File.get());
+  HRESULT hr = Load(pFile->getBufferStart(), pFile->getBufferSize());
+  if (SUCCEEDED(hr))
+    m_pFile = std::move(pFile);
+  return hr;
+}
+
+const DxilArchiveProgram *DxilContainerArchiveReader::GetPrograms() const {
+  return (const DxilArchiveProgram *)GetData(sizeof(DxilArchiveHeader));
+}
+
+const DxilArchiveContainer *DxilContainerArchiveReader::GetContainers() const {
+  return (const DxilArchiveContainer *)GetData(
+      sizeof(DxilArchiveHeader) +
+      sizeof(DxilArchiveProgram) * m_pHeader->ProgramCount);
+}
+
+const DxilPartHeader *
+DxilContainerArchiveReader::GetProgramPart(const DxilArchiveContainer &C) const {
+  if (C.ProgramIndex == DxilArchiveNoProgram)
+    return nullptr;
+  return (const DxilPartHeader *)GetData(
+      GetPrograms()[C.ProgramIndex].PartOffset);
+}
+
+StringRef DxilContainerArchiveReader::GetContainerName(uint32_t index) const {
+  DXASSERT_NOMSG(index < GetContainerCount());
+  const DxilArchiveContainer &C = GetContainers()[index];
+  return StringRef(GetData(C.NameOffset), C.NameLength);
+}
+
+uint32_t DxilContainerArchiveReader::FindContainer(StringRef Name) const {
+  for (uint32_t i = 0; i < GetContainerCount(); ++i) {
+    if (GetContainerName(i) == Name)
+      return i;
+  }
+  return UINT32_MAX;
+}
+
+const DxilShaderHash *
+DxilContainerArchiveReader::GetProgramHash(uint32_t index) const {
+  DXASSERT_NOMSG(index < GetContainerCount());
+  const DxilArchiveContainer &C = GetContainers()[index];
+  if (C.ProgramIndex == DxilArchiveNoProgram)
+    return nullptr;
+  return &GetPrograms()[C.ProgramIndex].Hash;
+}
+
+uint32_t DxilContainerArchiveReader::GetContainerSize(uint32_t index) const {
+  DXASSERT_NOMSG(index < GetContainerCount());
+  const DxilArchiveContainer &C = GetContainers()[index];
+  uint64_t partsSize = 0;
+  const char *pPartData = GetData(C.PartsOffset);
+  for (uint32_t i = 0; i < C.PartCount; ++i) {
+    const DxilPartHeader *pPart = (const DxilPartHeader *)pPartData;
+    partsSize += pPart->PartSize;
+    pPartData += AlignedPartSize(pPart);
+  }
+  uint32_t partCount = C.PartCount;
+  if (const DxilPartHeader *pProgramPart = GetProgramPart(C)) {
+    partsSize += pProgramPart->PartSize;
+    ++partCount;
+  }
+  return (uint32_t)GetDxilContainerSizeFromParts(partCount,
+                                                 (uint32_t)partsSize);
+}
+
+void DxilContainerArchiveReader::ExtractContainer(
+    uint32_t index, AbstractMemoryStream *pStream) const {
+  DXASSERT_NOMSG(index < GetContainerCount());
+  DXASSERT(pStream->GetPosition() == 0, "else stream is not empty");
+  const DxilArchiveContainer &C = GetContainers()[index];
+  std::unique_ptr<DxilContainerWriter> pWriter(NewDxilContainerWriter());
+
+  auto AddPart = [&](const DxilPartHeader *pPart) {
+    const char *pData = GetDxilPartData(pPart);
+    const uint32_t partSize = pPart->PartSize;
+    pWriter->AddPart(pPart->PartFourCC, partSize,
+                     [pData, partSize](AbstractMemoryStream *pStream) {
+      ULONG cbWritten;
+      IFT(pStream->Write(pData, partSize, &cbWritten));
+    });
+  };
+
+  const DxilPartHeader *pProgramPart = GetProgramPart(C);
+  const char *pPartData = GetData(C.PartsOffset);
+  for (uint32_t i = 0; i < C.PartCount; ++i) {
+    if (pProgramPart && i == C.ProgramPartIndex)
+      AddPart(pProgramPart);
+    const DxilPartHeader *pPart = (const DxilPartHeader *)pPartData;
+    AddPart(pPart);
+    pPartData += AlignedPartSize(pPart);
+  }
+  if (pProgramPart && C.ProgramPartIndex == C.PartCount)
+    AddPart(pProgramPart);
+  pWriter->write(pStream);
+
+  // The writer starts a new container; restore the hash and version of the
+  // archived one, so that a signed container is rebuilt as it was signed.
+  DxilContainerHeader *pHeader = (DxilContainerHeader *)pStream->GetPtr();
+  pHeader->Hash = C.Hash;
+  pHeader->Version = C.Version;
+}
+
+DxilContainerArchiveStats DxilContainerArchiveReader::GetStats() const {
+  DxilContainerArchiveStats stats;
+  if (!m_pHeader)
+    return stats;
+  stats.ContainerCount = m_pHeader->ContainerCount;
+  stats.UniqueProgramCount = m_pHeader->ProgramCount;
+  stats.ArchiveBytes = m_pHeader->ArchiveSizeInBytes;
+  for (uint32_t i = 0; i < m_pHeader->ProgramCount; ++i) {
+    const DxilPartHeader *pPart =
+        (const DxilPartHeader *)GetData(GetPrograms()[i].PartOffset);
+    stats.UniqueProgramBytes += sizeof(DxilPartHeader) + pPart->PartSize;
+  }
+  for (uint32_t i = 0; i < m_pHeader->ContainerCount; ++i) {
+    stats.ContainerBytes += GetContainerSize(i);
+    if (const DxilPartHeader *pPart = GetProgramPart(GetContainers()[i])) {
+      ++stats.ProgramCount;
+      stats.ProgramBytes += sizeof(DxilPartHeader) + pPart->PartSize;
+    }
+  }
+  return stats;
+}
+
+} // namespace hlsl
@@ -19,6 +19,7 @@
 #include "dxc/DxilContainer/DxilContainer.h"
 #include "dxc/DXIL/DxilModule.h"
 #include "dxc/DXIL/DxilShaderModel.h"
+#include "dxc/DXIL/DxilTypeSystem.h"
 #include "dxc/DxilRootSignature/DxilRootSignature.h"
 #include "dxc/DxilContainer/DxilContainerAssembler.h"
 #include "dxc/DXIL/DxilUtil.h"
@@ -361,6 +362,380 @@ DxilPartWriter *hlsl::NewFeatureInfoWriter(const DxilModule &M) {
   return new DxilFeatureInfoWriter(M);
 }
 
+class DxilLibraryIndexWriter : public DxilPartWriter {
+private:
+  std::vector<DxilLibraryIndexFunction> m_Functions;
+  std::string m_Names;
+
+public:
+  DxilLibraryIndexWriter(const DxilModule &M) {
+    // Only names and linkage are needed, so this does not materialize the
+    // bodies of a lazily loaded module.
+    for (const Function &F : M.GetModule()->functions()) {
+      if (F.isDeclaration())
+        continue;
+      DxilLibraryIndexFunction Info;
+      Info.NameOffset = m_Names.size();
+      Info.Flags = (uint32_t)(F.hasInternalLinkage()
+                                  ? DxilLibraryIndexFunctionFlags::Internal
+                                  : DxilLibraryIndexFunctionFlags::None);
+      m_Functions.push_back(Info);
+      m_Names.append(F.getName().begin(), F.getName().end());
+      m_Names.push_back('\0');
+    }
+    uint32_t NamesOffset = sizeof(DxilLibraryIndex) +
+                           m_Functions.size() * sizeof(DxilLibraryIndexFunction);
+    for (DxilLibraryIndexFunction &Info : m_Functions)
+      Info.NameOffset += NamesOffset;
+    m_Names.resize(PSVALIGN4(m_Names.size()), '\0');
+  }
+  uint32_t size() const override {
+    return sizeof(DxilLibraryIndex) +
+           m_Functions.size() * sizeof(DxilLibraryIndexFunction) +
+           m_Names.size();
+  }
+  void write(AbstractMemoryStream *pStream) override {
+    DxilLibraryIndex Index;
+    Index.FunctionCount = m_Functions.size();
+    IFT(WriteStreamValue(pStream, Index));
+    for (const DxilLibraryIndexFunction &Info : m_Functions)
+      IFT(WriteStreamValue(pStream, Info));
+    ULONG cbWritten;
+    IFT(pStream->Write(m_Names.data(), m_Names.size(), &cbWritten));
+  }
+};
+
+DxilPartWriter *hlsl::NewLibraryIndexWriter(const DxilModule &M) {
+  return new DxilLibraryIndexWriter(M);
+}
+
+// Same as the structured buffer element size in reflection.
+static unsigned CalcTypeSize(Type *Ty) {
+  // Assume aligned values.
+  if (Ty->isIntegerTy() || Ty->isFloatTy()) {
+    return Ty->getPrimitiveSizeInBits() / 8;
+  } else if (ArrayType *AT = dyn_cast<ArrayType>(Ty)) {
+    return AT->getNumElements() * CalcTypeSize(AT->getArrayElementType());
+  } else if (StructType *ST = dyn_cast<StructType>(Ty)) {
+    unsigned result = 0;
+    for (Type *EltTy : ST->elements())
+      result += CalcTypeSize(EltTy);
+    return result;
+  } else if (VectorType *VT = dyn_cast<VectorType>(Ty)) {
+    return VT->getNumElements() * CalcTypeSize(VT->getElementType());
+  } else {
+    DXASSERT_NOMSG(false);
+    return 0;
+  }
+}
+
+class DxilCBufferLayoutWriter : public DxilPartWriter {
+private:
+  DxilModule &m_Module;
+  std::vector<DxilCBufferLayoutBuffer> m_Buffers;
+  std::vector<DxilCBufferLayoutVariable> m_Variables;
+  std::vector<DxilCBufferLayoutType> m_Types;
+  std::vector<DxilCBufferLayoutMember> m_Members;
+  std::string m_Names;
+  StringMap<uint32_t> m_NameOffsets;
+
+  uint32_t AddName(StringRef Name) {
+    auto Inserted = m_NameOffsets.insert(std::make_pair(Name, m_Names.size()));
+    if (Inserted.second) {
+      m_Names.append(Name.begin(), Name.end());
+      m_Names.push_back('\0');
+    }
+    return Inserted.first->second;
+  }
+
+  static bool IsObjectType(Type *Ty) {
+    return dxilutil::IsHLSLObjectType(dxilutil::StripArrayTypes(Ty));
+  }
+
+  // Computes the shape, offset and size that reflection reports for a type,
+  // following CShaderReflectionType::Initialize. Member types are added
+  // before the type that contains them.
+  uint32_t AddType(Type *Ty, const DxilFieldAnnotation &Annotation,
+                   unsigned BaseOffset, bool IsCBuffer) {
+    DxilCBufferLayoutType Info = {};
+    Info.NameOffset = AddName("");
+    Info.Class = (uint32_t)DxilCBufferLayoutTypeClass::Scalar;
+    Info.CompType = (uint32_t)Annotation.GetCompType().GetKind();
+    Info.Offset = IsCBuffer ? Annotation.GetCBufferOffset() - BaseOffset
+                            : BaseOffset;
+
+    unsigned cbRows = 1;
+    unsigned cbCols = 1;
+    unsigned cbCompSize = 4;    // or 8 for 64-bit types.
+    unsigned cbRowStride = 16;  // or 32 if 64-bit and cols > 2.
+    switch (Annotation.GetCompType().GetKind()) {
+    case DXIL::ComponentType::I64:
+    case DXIL::ComponentType::U64:
+    case DXIL::ComponentType::F64:
+    case DXIL::ComponentType::SNormF64:
+    case DXIL::ComponentType::UNormF64:
+      cbCompSize = 8;
+      break;
+    default:
+      break;
+    }
+
+    // Matrices may be arrays at this point, so the annotation decides where
+    // the array dimensions stop.
+    while (Ty->isArrayTy()) {
+      Type *EltTy = Ty->getArrayElementType();
+      if (Annotation.HasMatrixAnnotation() && !EltTy->isArrayTy())
+        break;
+      if (!Info.Elements)
+        Info.Elements = 1;
+      Info.Elements *= Ty->getArrayNumElements();
+      Ty = EltTy;
+    }
+
+    if (Annotation.HasMatrixAnnotation()) {
+      const DxilMatrixAnnotation &Matrix = Annotation.GetMatrixAnnotation();
+      Info.Class = (uint32_t)DxilCBufferLayoutTypeClass::Matrix;
+      Info.Orientation = (uint32_t)Matrix.Orientation;
+      Info.Rows = Matrix.Rows;
+      Info.Columns = Matrix.Cols;
+      cbRows = Matrix.Rows;
+      cbCols = Matrix.Cols;
+      if (Matrix.Orientation != MatrixOrientation::RowMajor)
+        std::swap(cbRows, cbCols);
+    } else if (Ty->isVectorTy()) {
+      Info.Class = (uint32_t)DxilCBufferLayoutTypeClass::Vector;
+      Info.Rows = 1;
+      Info.Columns = Ty->getVectorNumElements();
+      cbCols = Info.Columns;
+    } else if (StructType *ST = dyn_cast<StructType>(Ty)) {
+      Info.NameOffset = AddName(ST->getName());
+      if (dxilutil::IsHLSLObjectType(ST)) {
+        Info.Class = (uint32_t)DxilCBufferLayoutTypeClass::Object;
+      } else {
+        Info.Class = (uint32_t)DxilCBufferLayoutTypeClass::Struct;
+        Info.Rows = 1;
+        const StructLayout *Layout =
+            IsCBuffer ? nullptr
+                      : m_Module.GetModule()->getDataLayout().getStructLayout(ST);
+        // There is no annotation for empty structs.
+        const DxilStructAnnotation *SA =
+            m_Module.GetTypeSystem().GetStructAnnotation(ST);
+        unsigned FieldCount = SA ? ST->getNumElements() : 0;
+        SmallVector<DxilCBufferLayoutMember, 8> Members;
+        uint32_t LastField = DxilCBufferLayoutNoType;
+        for (unsigned i = 0; i < FieldCount; ++i) {
+          Type *FieldTy = ST->getElementType(i);
+          // Objects are not part of constant buffers.
+          if (IsObjectType(FieldTy))
+            continue;
+          const DxilFieldAnnotation &FieldAnnotation = SA->GetFieldAnnotation(i);
+          unsigned FieldOffset =
+              Layout ? (unsigned)Layout->getElementOffset(i) : 0;
+          DxilCBufferLayoutMember Member;
+          Member.TypeIndex =
+              AddType(FieldTy, FieldAnnotation, FieldOffset, IsCBuffer);
+          Member.NameOffset = AddName(FieldAnnotation.GetFieldName());
+          Members.push_back(Member);
+          // Structs count every scalar they contain as a column.
+          const DxilCBufferLayoutType &Field = m_Types[Member.TypeIndex];
+          Info.Columns += std::max(Field.Columns, 1U) *
+                          std::max(Field.Rows, 1U) *
+                          std::max(Field.Elements, 1U);
+          LastField = Member.TypeIndex;
+        }
+        if (LastField != DxilCBufferLayoutNoType) {
+          // The size runs to the end of the last field.
+          const DxilCBufferLayoutType &Field = m_Types[LastField];
+          Info.Size = Field.Offset + Field.Size;
+          if (Info.Elements) {
+            Info.ArrayStride = (Info.Size + 15) & ~0xF;
+            if (Info.Elements > 1)
+              Info.Size += (Info.Elements - 1) * Info.ArrayStride;
+          }
+        }
+        Info.FirstMember = m_Members.size();
+        Info.MemberCount = Members.size();
+        m_Members.insert(m_Members.end(), Members.begin(), Members.end());
+      }
+    } else if (Ty->isVoidTy()) {
+      Info.Class = (uint32_t)DxilCBufferLayoutTypeClass::Void;
+      Info.Rows = 1;
+      Info.Columns = 1;
+    } else if (!Ty->isPointerTy()) {
+      Info.Rows = 1;
+      Info.Columns = 1;
+    }
+
+    switch ((DxilCBufferLayoutTypeClass)Info.Class) {
+    case DxilCBufferLayoutTypeClass::Scalar:
+    case DxilCBufferLayoutTypeClass::Vector:
+    case DxilCBufferLayoutTypeClass::Matrix:
+    case DxilCBufferLayoutTypeClass::Void:
+      if (cbCompSize > 4 && cbCols > 2)
+        cbRowStride = 32;
+      if (Info.Elements)
+        Info.ArrayStride = cbRowStride * cbRows;
+      if (Info.Elements > 1)
+        cbRows = cbRows * Info.Elements;
+      Info.Size = cbRowStride * (cbRows - 1) + cbCompSize * cbCols;
+      break;
+    default:
+      break;
+    }
+
+    m_Types.push_back(Info);
+    return m_Types.size() - 1;
+  }
+
+  void AddCBuffer(const DxilCBuffer &CB) {
+    DxilCBufferLayoutBuffer Buffer = {};
+    Buffer.NameOffset = AddName(CB.GetGlobalName());
+    Buffer.Kind = (uint32_t)DxilCBufferLayoutBufferKind::CBuffer;
+    Buffer.Size = CB.GetSize();
+    Buffer.RangeSize = CB.GetRangeSize();
+    Buffer.FirstVariable = m_Variables.size();
+    // For ConstantBuffer<> buf[2], the array size is in the range size.
+    SmallVector<unsigned, 4> Dims;
+    StructType *ST = cast<StructType>(dxilutil::StripArrayTypes(
+        CB.GetGlobalSymbol()->getType()->getPointerElementType(), &Dims));
+    Buffer.ArrayDimensions = Dims.size();
+    // Dxil from dxbc doesn't have annotation.
+    if (const DxilStructAnnotation *SA =
+            m_Module.GetTypeSystem().GetStructAnnotation(ST)) {
+      for (unsigned i = 0; i < ST->getNumElements(); ++i) {
+        const DxilFieldAnnotation &FieldAnnotation = SA->GetFieldAnnotation(i);
+        DxilCBufferLayoutVariable Variable;
+        Variable.TypeIndex =
+            AddType(ST->getElementType(i), FieldAnnotation,
+                    FieldAnnotation.GetCBufferOffset(), /*IsCBuffer*/ true);
+        Variable.NameOffset = AddName(FieldAnnotation.GetFieldName());
+        Variable.StartOffset = FieldAnnotation.GetCBufferOffset();
+        Variable.Size = m_Types[Variable.TypeIndex].Size;
+        Variable.Flags = (uint32_t)DxilCBufferLayoutVariableFlags::Used;
+        m_Variables.push_back(Variable);
+      }
+    }
+    Buffer.VariableCount = m_Variables.size() - Buffer.FirstVariable;
+    m_Buffers.push_back(Buffer);
+  }
+
+  void AddStructuredBuffer(const DxilResource &R) {
+    DxilCBufferLayoutBuffer Buffer = {};
+    Buffer.NameOffset = AddName(R.GetGlobalName());
+    Buffer.Kind = (uint32_t)DxilCBufferLayoutBufferKind::StructuredBuffer;
+    Buffer.RangeSize = R.GetRangeSize();
+    Buffer.FirstVariable = m_Variables.size();
+    Buffer.VariableCount = 1;
+    SmallVector<unsigned, 4> Dims;
+    StructType *ST = cast<StructType>(dxilutil::StripArrayTypes(
+        R.GetGlobalSymbol()->getType()->getPointerElementType(), &Dims));
+    Buffer.ArrayDimensions = Dims.size();
+
+    DxilCBufferLayoutVariable Variable;
+    Variable.NameOffset = AddName("");
+    Variable.StartOffset = 0;
+    Variable.Size = CalcTypeSize(ST);
+    Variable.Flags = (uint32_t)DxilCBufferLayoutVariableFlags::Used;
+    Variable.TypeIndex = DxilCBufferLayoutNoType;
+    // The element type is the first field of the wrapper struct.
+    if (const DxilStructAnnotation *SA =
+            m_Module.GetTypeSystem().GetStructAnnotation(ST)) {
+      Variable.TypeIndex = AddType(ST->getElementType(0),
+                                   SA->GetFieldAnnotation(0), 0,
+                                   /*IsCBuffer*/ false);
+    }
+    m_Variables.push_back(Variable);
+    Buffer.Size = Variable.Size;
+    m_Buffers.push_back(Buffer);
+  }
+
+  // Clears the used flag of cbuffer variables no load reaches, as reflection
+  // does when it marks usage.
+  void SetCBufferUsage() {
+    const unsigned CBufferCount = m_Module.GetCBuffers().size();
+    std::vector<std::vector<unsigned>> Usage(CBufferCount);
+    if (!dxilutil::CollectCBufferUsage(*m_Module.GetModule(), Usage))
+      return;
+    for (unsigned i = 0; i < CBufferCount; ++i) {
+      std::sort(Usage[i].begin(), Usage[i].end());
+      const DxilCBufferLayoutBuffer &Buffer = m_Buffers[i];
+      for (unsigned v = 0; v < Buffer.VariableCount; ++v) {
+        DxilCBufferLayoutVariable &Variable =
+            m_Variables[Buffer.FirstVariable + v];
+        auto It = std::lower_bound(Usage[i].begin(), Usage[i].end(),
+                                   Variable.StartOffset);
+        if (It == Usage[i].end() ||
+            *It >= Variable.StartOffset + Variable.Size)
+          Variable.Flags &= ~(uint32_t)DxilCBufferLayoutVariableFlags::Used;
+      }
+    }
+  }
+
+public:
+  DxilCBufferLayoutWriter(DxilModule &M) : m_Module(M) {
+    // Buffers are in the order reflection lists them.
+    for (auto &CB : M.GetCBuffers())
+      AddCBuffer(*CB);
+    for (auto &UAV : M.GetUAVs()) {
+      if (UAV->GetKind() == DxilResource::Kind::StructuredBuffer)
+        AddStructuredBuffer(*UAV);
+    }
+    for (auto &SRV : M.GetSRVs()) {
+      if (SRV->GetKind() == DxilResource::Kind::StructuredBuffer)
+        AddStructuredBuffer(*SRV);
+    }
+    SetCBufferUsage();
+
+    // Make the name offsets relative to the part data.
+    uint32_t NamesOffset =
+        sizeof(DxilCBufferLayout) +
+        m_Buffers.size() * sizeof(DxilCBufferLayoutBuffer) +
+        m_Variables.size() * sizeof(DxilCBufferLayoutVariable) +
+        m_Types.size() * sizeof(DxilCBufferLayoutType) +
+        m_Members.size() * sizeof(DxilCBufferLayoutMember);
+    for (DxilCBufferLayoutBuffer &Buffer : m_Buffers)
+      Buffer.NameOffset += NamesOffset;
+    for (DxilCBufferLayoutVariable &Variable : m_Variables)
+      Variable.NameOffset += NamesOffset;
+    for (DxilCBufferLayoutType &Type : m_Types)
+      Type.NameOffset += NamesOffset;
+    for (DxilCBufferLayoutMember &Member : m_Members)
+      Member.NameOffset += NamesOffset;
+    m_Names.resize(PSVALIGN4(m_Names.size()), '\0');
+  }
+  uint32_t size() const override {
+    return sizeof(DxilCBufferLayout) +
+           m_Buffers.size() * sizeof(DxilCBufferLayoutBuffer) +
+           m_Variables.size() * sizeof(DxilCBufferLayoutVariable) +
+           m_Types.size() * sizeof(DxilCBufferLayoutType) +
+           m_Members.size() * sizeof(DxilCBufferLayoutMember) +
+           m_Names.size();
+  }
+  void write(AbstractMemoryStream *pStream) override {
+    DxilCBufferLayout Layout;
+    Layout.Version = DxilCBufferLayoutVersion;
+    Layout.BufferCount = m_Buffers.size();
+    Layout.VariableCount = m_Variables.size();
+    Layout.TypeCount = m_Types.size();
+    Layout.MemberCount = m_Members.size();
+    IFT(WriteStreamValue(pStream, Layout));
+    for (const DxilCBufferLayoutBuffer &Buffer : m_Buffers)
+      IFT(WriteStreamValue(pStream, Buffer));
+    for (const DxilCBufferLayoutVariable &Variable : m_Variables)
+      IFT(WriteStreamValue(pStream, Variable));
+    for (const DxilCBufferLayoutType &Type : m_Types)
+      IFT(WriteStreamValue(pStream, Type));
+    for (const DxilCBufferLayoutMember &Member : m_Members)
+      IFT(WriteStreamValue(pStream, Member));
+    ULONG cbWritten;
+    IFT(pStream->Write(m_Names.data(), m_Names.size(), &cbWritten));
+  }
+};
+
+DxilPartWriter *hlsl::NewCBufferLayoutWriter(DxilModule &M) {
+  return new DxilCBufferLayoutWriter(M);
+}
+
 class DxilPSVWriter : public DxilPartWriter  {
 private:
   const DxilModule &m_Module;
@@ -1358,12 +1733,77 @@ private:
   };
 
   llvm::SmallVector<DxilPart, 8> m_Parts;
+  uint32_t m_LastPartFourCC = 0;
+  uint32_t m_LastPartSizeHint = 0;
+  WriteFn m_LastPartWrite;
+
+  // Writes the container at the current position of pStream. Offsets within
+  // the container are relative to that position.
+  void writeWithLastPartInPlace(AbstractMemoryStream *pStream) {
+    const uint32_t base = (uint32_t)pStream->GetPosition();
+    const uint32_t PartCount = (uint32_t)m_Parts.size() + 1;
+    const uint32_t lastPartOffset = size() + (uint32_t)GetOffsetTableSize(1);
+    const uint32_t lastPartStart = lastPartOffset + sizeof(DxilPartHeader);
+    IFT(pStream->Reserve(std::max<ULONG>(
+        pStream->GetPtrSize(), base + lastPartStart + m_LastPartSizeHint)));
+
+    // Write the last part first, so the other parts may depend on it.
+    LARGE_INTEGER move;
+    move.QuadPart = base + lastPartStart;
+    IFT(pStream->Seek(move, STREAM_SEEK_SET, nullptr));
+    m_LastPartWrite(pStream);
+    const uint32_t containerSizeInBytes =
+        (uint32_t)pStream->GetPosition() - base;
+    DXASSERT(((containerSizeInBytes - lastPartStart) % 4) == 0,
+             "else part is not aligned");
+
+    DxilContainerHeader header;
+    InitDxilContainer(&header, PartCount, containerSizeInBytes);
+    move.QuadPart = base;
+    IFT(pStream->Seek(move, STREAM_SEEK_SET, nullptr));
+    IFT(WriteStreamValue(pStream, header));
+    uint32_t offset = sizeof(header) + (uint32_t)GetOffsetTableSize(PartCount);
+    for (auto &&part : m_Parts) {
+      IFT(WriteStreamValue(pStream, offset));
+      offset += sizeof(DxilPartHeader) + part.Header.PartSize;
+    }
+    IFT(WriteStreamValue(pStream, offset));
+    for (auto &&part : m_Parts) {
+      IFT(WriteStreamValue(pStream, part.Header));
+      size_t start = pStream->GetPosition();
+      part.Write(pStream);
+      DXASSERT_LOCALVAR(start, pStream->GetPosition() - start == (size_t)part.Header.PartSize, "out of bound");
+    }
+    DXASSERT(offset == lastPartOffset && pStream->GetPosition() == base + offset,
+             "else part offsets are incorrect");
+    DxilPartHeader lastHeader;
+    lastHeader.PartFourCC = m_LastPartFourCC;
+    lastHeader.PartSize = containerSizeInBytes - lastPartStart;
+    IFT(WriteStreamValue(pStream, lastHeader));
+    move.QuadPart = base + containerSizeInBytes;
+    IFT(pStream->Seek(move, STREAM_SEEK_SET, nullptr));
+    // Give back what the size hint over-estimated, unless the stream already
+    // held data past the container.
+    if (containerSizeInBytes < lastPartStart + m_LastPartSizeHint &&
+        pStream->GetPtrSize() == base + containerSizeInBytes)
+      IFT(pStream->Reserve(base + containerSizeInBytes));
+  }
 
 public:
   void AddPart(uint32_t FourCC, uint32_t Size, WriteFn Write) override {
     m_Parts.emplace_back(FourCC, Size, Write);
   }
 
+  // Adds a last part whose size is known only once it is written, so it can
+  // be written straight into the container stream rather than copied from
+  // an intermediate stream. Its data must be 4-byte aligned. It is written
+  // before the other parts, whose writers may therefore depend on it.
+  void SetLastPartInPlace(uint32_t FourCC, uint32_t SizeHint, WriteFn Write) {
+    m_LastPartFourCC = FourCC;
+    m_LastPartSizeHint = SizeHint;
+    m_LastPartWrite = Write;
+  }
+
   uint32_t size() const override {
     uint32_t partSize = 0;
     for (auto &part : m_Parts) {
@@ -1373,6 +1813,10 @@ public:
   }
 
   void write(AbstractMemoryStream *pStream) override {
+    if (m_LastPartWrite) {
+      writeWithLastPartInPlace(pStream);
+      return;
+    }
     DxilContainerHeader header;
     const uint32_t PartCount = (uint32_t)m_Parts.size();
     uint32_t containerSizeInBytes = size();
@@ -1443,6 +1887,40 @@ static void WriteProgramPart(const ShaderModel *pModel,
   }
 }
 
+// Serializes the module as a program part at the current stream position,
+// without an intermediate copy of the bitcode. Returns the bitcode, which
+// stays valid until the stream is written to again.
+static ArrayRef<uint8_t> WriteProgramPartInPlace(const ShaderModel *pModel,
+                                                 llvm::Module *pModule,
+                                                 bool ShouldPreserveUseListOrder,
+                                                 AbstractMemoryStream *pStream) {
+  DXASSERT(pModel != nullptr, "else generation should have failed");
+  const uint64_t headerOffset = pStream->GetPosition();
+  DxilProgramHeader programHeader = {};
+  IFT(WriteStreamValue(pStream, programHeader));
+  {
+    raw_stream_ostream outStream(pStream);
+    WriteBitcodeToFile(pModule, outStream, ShouldPreserveUseListOrder);
+  }
+  const uint32_t bitcodeSize =
+      (uint32_t)(pStream->GetPosition() - headerOffset - sizeof(programHeader));
+  if (bitcodeSize % 4) {
+    ULONG cbWritten;
+    uint32_t paddingValue = 0;
+    IFT(pStream->Write(&paddingValue, 4 - (bitcodeSize % 4), &cbWritten));
+  }
+
+  uint32_t shaderVersion =
+      EncodeVersion(pModel->GetKind(), pModel->GetMajor(), pModel->GetMinor());
+  unsigned dxilMajor, dxilMinor;
+  pModel->GetDxilVersion(dxilMajor, dxilMinor);
+  uint32_t dxilVersion = DXIL::MakeDxilVersion(dxilMajor, dxilMinor);
+  InitProgramHeader(programHeader, shaderVersion, dxilVersion, bitcodeSize);
+  uint8_t *pHeader = pStream->GetPtr() + headerOffset;
+  memcpy(pHeader, &programHeader, sizeof(programHeader));
+  return ArrayRef<uint8_t>(pHeader + sizeof(programHeader), bitcodeSize);
+}
+
 namespace {
 
 class RootSignatureWriter : public DxilPartWriter {
@@ -1465,7 +1943,8 @@ void hlsl::SerializeDxilContainerForModule(DxilModule *pModule,
                                            AbstractMemoryStream *pFinalStream,
                                            llvm::StringRef DebugName,
                                            SerializeDxilFlags Flags,
-                                           DxilShaderHash *pShaderHashOut) {
+                                           DxilShaderHash *pShaderHashOut,
+                                           uint64_t *pBytesCopied) {
   // TODO: add a flag to update the module and remove information that is not part
   // of DXIL proper and is used only to assemble the container.
 
@@ -1528,6 +2007,8 @@ void hlsl::SerializeDxilContainerForModule(DxilModule *pModule,
   }
   std::unique_ptr<DxilRDATWriter> pRDATWriter = nullptr;
   std::unique_ptr<DxilPSVWriter> pPSVWriter = nullptr;
+  std::unique_ptr<DxilPartWriter> pLibraryIndexWriter;
+  std::unique_ptr<DxilPartWriter> pCBufferLayoutWriter;
   unsigned int major, minor;
   pModule->GetDxilVersion(major, minor);
   RootSignatureWriter rootSigWriter(std::move(pModule->GetSerializedRootSignature())); // Grab RS here
@@ -1542,6 +2023,13 @@ void hlsl::SerializeDxilContainerForModule(DxilModule *pModule,
     writer.AddPart(
         DFCC_RuntimeData, pRDATWriter->size(),
         [&](AbstractMemoryStream *pStream) { pRDATWriter->write(pStream); });
+    if (Flags & SerializeDxilFlags::IncludeLibraryIndexPart) {
+      pLibraryIndexWriter.reset(NewLibraryIndexWriter(*pModule));
+      writer.AddPart(DFCC_LibraryIndex, pLibraryIndexWriter->size(),
+                     [&](AbstractMemoryStream *pStream) {
+                       pLibraryIndexWriter->write(pStream);
+                     });
+    }
     bMetadataStripped |= pModule->StripSubobjectsFromMetadata();
     pModule->ResetSubobjects(nullptr);
   } else {
@@ -1550,6 +2038,16 @@ void hlsl::SerializeDxilContainerForModule(DxilModule *pModule,
     writer.AddPart(
         DFCC_PipelineStateValidation, pPSVWriter->size(),
         [&](AbstractMemoryStream *pStream) { pPSVWriter->write(pStream); });
+    // Write the constant buffer layout (CBLO) part. It is built here, before
+    // reflection may be stripped, and left out when it is.
+    if ((Flags & SerializeDxilFlags::IncludeCBufferLayoutPart) &&
+        !(Flags & SerializeDxilFlags::StripReflectionFromDxilPart)) {
+      pCBufferLayoutWriter.reset(NewCBufferLayoutWriter(*pModule));
+      writer.AddPart(DFCC_ConstantBufferLayout, pCBufferLayoutWriter->size(),
+                     [&](AbstractMemoryStream *pStream) {
+                       pCBufferLayoutWriter->write(pStream);
+                     });
+    }
     // Write the root signature (RTS0) part.
     if (rootSigWriter.size()) {
       writer.AddPart(
@@ -1559,19 +2057,21 @@ void hlsl::SerializeDxilContainerForModule(DxilModule *pModule,
     }
   }
 
-  // If metadata was stripped, re-serialize the input module.
+  // If metadata was stripped, re-serialize the input module. Without debug
+  // info it is only needed as the program part, which is then serialized
+  // straight into the container below.
+  bool bHasDebugInfo = HasDebugInfo(*pModule->GetModule());
   CComPtr<AbstractMemoryStream> pInputProgramStream = pModuleBitcode;
-  if (bMetadataStripped) {
+  if (bMetadataStripped && bHasDebugInfo) {
     pInputProgramStream.Release();
     IFT(CreateMemoryStream(DxcGetThreadMallocNoRef(), &pInputProgramStream));
+    IFT(pInputProgramStream->Reserve(pModuleBitcode->GetPtrSize()));
     raw_stream_ostream outStream(pInputProgramStream.p);
     WriteBitcodeToFile(pModule->GetModule(), outStream, true);
   }
 
   // If we have debug information present, serialize it to a debug part, then use the stripped version as the canonical program version.
-  CComPtr<AbstractMemoryStream> pProgramStream = pInputProgramStream;
   bool bModuleStripped = false;
-  bool bHasDebugInfo = HasDebugInfo(*pModule->GetModule());
   if (bHasDebugInfo) {
     uint32_t debugInUInt32, debugPaddingBytes;
     GetPaddedProgramPartSize(pInputProgramStream, debugInUInt32, debugPaddingBytes);
@@ -1579,6 +2079,8 @@ void hlsl::SerializeDxilContainerForModule(DxilModule *pModule,
       writer.AddPart(DFCC_ShaderDebugInfoDXIL, debugInUInt32 * sizeof(uint32_t) + sizeof(DxilProgramHeader), [&](AbstractMemoryStream *pStream) {
         WriteProgramPart(pModule->GetShaderModel(), pInputProgramStream, pStream);
       });
+      if (pBytesCopied)
+        *pBytesCopied += pInputProgramStream->GetPtrSize();
     }
 
     llvm::StripDebugInfo(*pModule->GetModule());
@@ -1595,53 +2097,63 @@ void hlsl::SerializeDxilContainerForModule(DxilModule *pModule,
     bModuleStripped = true;
   }
 
-  // If debug info or reflection was stripped, re-serialize the module.
-  if (bModuleStripped) {
-    pProgramStream.Release();
-    IFT(CreateMemoryStream(DxcGetThreadMallocNoRef(), &pProgramStream));
-    raw_stream_ostream outStream(pProgramStream.p);
-    WriteBitcodeToFile(pModule->GetModule(), outStream, false);
-  }
+  // If debug info, reflection or metadata was stripped, the module is
+  // re-serialized into the program part in place; otherwise the input
+  // bitcode is the program.
+  const bool bSerializeProgram = bModuleStripped || bMetadataStripped;
+  // A module that only had metadata stripped keeps its use-list order, as the
+  // re-serialized input module always has.
+  const bool bPreserveUseListOrder = !bModuleStripped;
+  CComPtr<AbstractMemoryStream> pProgramStream;
+  if (!bSerializeProgram)
+    pProgramStream = pInputProgramStream;
 
   // Serialize debug name if requested.
-  CComPtr<AbstractMemoryStream> pHashStream;
+  // If the debug name should be specific to the sources, base the name on the debug
+  // bitcode, which will include the source references, line numbers, etc. Otherwise,
+  // do it exclusively on the target shader bitcode, which may only be available
+  // once the program part has been written.
   std::string DebugNameStr; // Used if constructing name based on hash
   DxilShaderHash HashContent;
-  if (pShaderHashOut || Flags & SerializeDxilFlags::IncludeDebugNamePart) {
-    // If the debug name should be specific to the sources, base the name on the debug
-    // bitcode, which will include the source references, line numbers, etc. Otherwise,
-    // do it exclusively on the target shader bitcode.
+  const bool bHashProgram = pShaderHashOut || Flags & SerializeDxilFlags::IncludeDebugNamePart;
+  auto HashProgram = [&](ArrayRef<uint8_t> Data) {
+    llvm::MD5 md5;
+    md5.update(Data);
+    md5.final(HashContent.Digest);
+    if ((Flags & SerializeDxilFlags::IncludeDebugNamePart) && DebugName.empty()) {
+      SmallString<32> Hash;
+      llvm::MD5::stringifyResult(HashContent.Digest, Hash);
+      DebugNameStr += Hash;
+      DebugNameStr += ".pdb";
+      DebugName = DebugNameStr;
+    }
+    if (pShaderHashOut) {
+      memcpy(pShaderHashOut, &HashContent, sizeof(DxilShaderHash));
+    }
+  };
+  if (bHashProgram) {
     if (Flags & SerializeDxilFlags::DebugNameDependOnSource) {
-      pHashStream = CComPtr<AbstractMemoryStream>(pModuleBitcode);
       HashContent.Flags = (uint32_t)DxilShaderHashFlags::IncludesSource;
+      HashProgram(ArrayRef<uint8_t>((uint8_t *)pModuleBitcode->GetPtr(),
+                                    pModuleBitcode->GetPtrSize()));
     } else {
-      pHashStream = CComPtr<AbstractMemoryStream>(pProgramStream);
       HashContent.Flags = (uint32_t)DxilShaderHashFlags::None;
+      if (!bSerializeProgram)
+        HashProgram(ArrayRef<uint8_t>((uint8_t *)pProgramStream->GetPtr(),
+                                      pProgramStream->GetPtrSize()));
     }
 
-    ArrayRef<uint8_t> Data((uint8_t *)pHashStream->GetPtr(),
-                           pHashStream->GetPtrSize());
-    llvm::MD5 md5;
-    SmallString<32> Hash;
-    md5.update(Data);
-    md5.final(HashContent.Digest);
-
     if (Flags & SerializeDxilFlags::IncludeDebugNamePart) {
-      if (DebugName.empty()) {
-        md5.stringifyResult(HashContent.Digest, Hash);
-        DebugNameStr += Hash;
-        DebugNameStr += ".pdb";
-        DebugName = DebugNameStr;
-      }
-
+      // A name derived from the hash is the hex digest and ".pdb".
       DebugName = DebugName.trim("\"");
+      const size_t DebugNameLen = DebugName.empty() ? 32 + 4 : DebugName.size();
 
       // Calculate the size of the blob part.
       const uint32_t DebugInfoContentLen = PSVALIGN4(
-          sizeof(DxilShaderDebugName) + DebugName.size() + 1); // 1 for null
+          sizeof(DxilShaderDebugName) + DebugNameLen + 1); // 1 for null
 
       writer.AddPart(DFCC_ShaderDebugName, DebugInfoContentLen,
-        [DebugName]
+        [&DebugName]
         (AbstractMemoryStream *pStream)
       {
         DxilShaderDebugName NameContent;
@@ -1660,26 +2172,36 @@ void hlsl::SerializeDxilContainerForModule(DxilModule *pModule,
 
     if (bSupportsShaderHash) {
       writer.AddPart(DFCC_ShaderHash, sizeof(HashContent),
-        [HashContent]
+        [&HashContent]
         (AbstractMemoryStream *pStream)
       {
         IFT(WriteStreamValue(pStream, HashContent));
       });
     }
-
-    if (pShaderHashOut) {
-      memcpy(pShaderHashOut, &HashContent, sizeof(DxilShaderHash));
-    }
   }
 
-  // Compute padded bitcode size.
-  uint32_t programInUInt32, programPaddingBytes;
-  GetPaddedProgramPartSize(pProgramStream, programInUInt32, programPaddingBytes);
-
   // Write the program part.
-  writer.AddPart(DFCC_DXIL, programInUInt32 * sizeof(uint32_t) + sizeof(DxilProgramHeader), [&](AbstractMemoryStream *pStream) {
-    WriteProgramPart(pModule->GetShaderModel(), pProgramStream, pStream);
-  });
+  if (bSerializeProgram) {
+    writer.SetLastPartInPlace(DFCC_DXIL,
+        sizeof(DxilProgramHeader) + PSVALIGN4(pInputProgramStream->GetPtrSize()),
+        [&](AbstractMemoryStream *pStream) {
+      ArrayRef<uint8_t> Bitcode =
+          WriteProgramPartInPlace(pModule->GetShaderModel(),
+                                  pModule->GetModule(),
+                                  bPreserveUseListOrder, pStream);
+      if (bHashProgram && !(Flags & SerializeDxilFlags::DebugNameDependOnSource))
+        HashProgram(Bitcode);
+    });
+  } else {
+    // Compute padded bitcode size.
+    uint32_t programInUInt32, programPaddingBytes;
+    GetPaddedProgramPartSize(pProgramStream, programInUInt32, programPaddingBytes);
+    writer.AddPart(DFCC_DXIL, programInUInt32 * sizeof(uint32_t) + sizeof(DxilProgramHeader), [&](AbstractMemoryStream *pStream) {
+      WriteProgramPart(pModule->GetShaderModel(), pProgramStream, pStream);
+    });
+    if (pBytesCopied)
+      *pBytesCopied += pProgramStream->GetPtrSize();
+  }
 
   writer.write(pFinalStream);
 }
@@ -15,9 +15,82 @@
 #include "dxc/DXIL/DxilSubobject.h"
 #include "dxc/DxilContainer/DxilContainerReader.h"
 #include "dxc/DxilContainer/DxilRuntimeReflection.h"
+#include "llvm/Support/MemoryBuffer.h"
 
 namespace hlsl {
 
+DxilContainerReader::DxilContainerReader() : m_pHeader(nullptr) {}
+
+DxilContainerReader::~DxilContainerReader() {}
+
+void DxilContainerReader::Reset() {
+  m_pHeader = nullptr;
+  m_partIndex.clear();
+  m_pFile.reset();
+}
+
+HRESULT DxilContainerReader::Load(const void *pData, size_t size) {
+  Reset();
+  const DxilContainerHeader *pHeader = IsDxilContainerLike(pData, size);
+  if (!IsValidDxilContainer(pHeader, size))
+    return DXC_E_CONTAINER_INVALID;
+  for (uint32_t i = 0; i < pHeader->PartCount; ++i) {
+    // Keep the first part of each kind, as GetDxilPartByType does.
+    m_partIndex.insert(
+        std::make_pair(GetDxilContainerPart(pHeader, i)->PartFourCC, i));
+  }
+  m_pHeader = pHeader;
+  return S_OK;
+}
+
+// Maps an error from opening a file to an HRESULT. Error values differ by
+// platform (Win32 codes on Windows, errno elsewhere), so they are compared
+// against portable error conditions.
+HRESULT HResultFromFileError(std::error_code ec) {
+  if (ec == std::errc::no_such_file_or_directory)
+    return HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND);
+  if (ec == std::errc::permission_denied)
+    return E_ACCESSDENIED;
+  if (ec == std::errc::not_enough_memory)
+    return E_OUTOFMEMORY;
+  if (ec == std::errc::invalid_argument)
+    return E_INVALIDARG;
+  return E_FAIL;
+}
+
+HRESULT DxilContainerReader::LoadFile(llvm::StringRef Path) {
+  Reset();
+  // No null terminator is needed, so the file can be mapped rather than read
+  // when it spans enough pages.
+  llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> File =
+      llvm::MemoryBuffer::getFile(Path, -1, /*RequiresNullTerminator*/ false);
+  if (std::error_code ec = File.getError())
+    return HResultFromFileError(ec);
+  std::unique_ptr<llvm::MemoryBuffer> pFile = std::move(File.get());
+  HRESULT hr = Load(pFile->getBufferStart(), pFile->getBufferSize());
+  if (SUCCEEDED(hr))
+    m_pFile = std::move(pFile);
+  return hr;
+}
+
+const DxilPartHeader *DxilContainerReader::FindPart(DxilFourCC fourCC) const {
+  auto it = m_partIndex.find((uint32_t)fourCC);
+  if (it == m_partIndex.end())
+    return nullptr;
+  return GetPart(it->second);
+}
+
+bool DxilContainerReader::GetPartContent(DxilFourCC fourCC,
+                                         const char **ppData,
+                                         uint32_t *pSize) const {
+  const DxilPartHeader *pPart = FindPart(fourCC);
+  if (pPart == nullptr)
+    return false;
+  *ppData = GetDxilPartData(pPart);
+  *pSize = pPart->PartSize;
+  return true;
+}
+
 bool LoadSubobjectsFromRDAT(DxilSubobjects &subobjects, RDAT::SubobjectTableReader *pSubobjectTableReader) {
   if (!pSubobjectTableReader)
     return false;
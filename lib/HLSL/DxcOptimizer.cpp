@@ -22,6 +22,7 @@
 #include "dxc/HLSL/ComputeViewIdState.h"
 #include "dxc/DXIL/DxilUtil.h"
 #include "dxc/Support/dxcapi.impl.h"
+#include "dxc/Support/dxcthreadpool.h"
 
 #include "llvm/Pass.h"
 #include "llvm/PassInfo.h"
@@ -38,7 +39,7 @@
 #include "llvm/Transforms/IPO/PassManagerBuilder.h"
 
 #include <algorithm>
-#include <list>   // should change this for string_table
+#include <mutex>
 #include <vector>
 
 // This is pretty ugly; should be refactored to a proper library
@@ -489,7 +490,7 @@ public:
   }
 };
 
-class DxcOptimizer : public IDxcOptimizer {
+class DxcOptimizer : public IDxcOptimizer2 {
 private:
   DXC_MICROCOM_TM_REF_FIELDS()
   PassRegistry *m_registry;
@@ -499,7 +500,8 @@ public:
   DXC_MICROCOM_TM_CTOR(DxcOptimizer)
 
   HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void **ppvObject) override {
-    return DoBasicQueryInterface<IDxcOptimizer>(this, iid, ppvObject);
+    return DoBasicQueryInterface<IDxcOptimizer, IDxcOptimizer2>(this, iid,
+                                                                ppvObject);
   }
 
   HRESULT Initialize();
@@ -513,6 +515,9 @@ public:
     _In_count_(optionCount) LPCWSTR *ppOptions, UINT32 optionCount,
     _COM_Outptr_ IDxcBlob **ppOutputModule,
     _COM_Outptr_opt_ IDxcBlobEncoding **ppOutputText) override;
+  HRESULT STDMETHODCALLTYPE CreatePipeline(
+    _In_count_(optionCount) LPCWSTR *ppOptions, UINT32 optionCount,
+    _COM_Outptr_ IDxcOptimizerPipeline **ppPipeline) override;
 };
 
 class CapturePassManager : public llvm::legacy::PassManagerBase {
@@ -575,233 +580,319 @@ HRESULT STDMETHODCALLTYPE DxcOptimizer::GetAvailablePass(
       GetPassArgDescriptions(m_passes[index]->getPassArgument()), ppResult);
 }
 
-HRESULT STDMETHODCALLTYPE DxcOptimizer::RunOptimizer(
-    IDxcBlob *pBlob, _In_count_(optionCount) LPCWSTR *ppOptions,
-    UINT32 optionCount, _COM_Outptr_ IDxcBlob **ppOutputModule,
-    _COM_Outptr_opt_ IDxcBlobEncoding **ppOutputText) {
-  AssignToOutOpt(nullptr, ppOutputModule);
-  AssignToOutOpt(nullptr, ppOutputText);
-  if (pBlob == nullptr)
-    return E_POINTER;
-  if (optionCount > 0 && ppOptions == nullptr)
-    return E_POINTER;
+namespace {
+// A pass of a pipeline, with its parsed options.
+struct OptimizerPipelineStep {
+  const PassInfo *PassInf; // Null for a module print.
+  std::string Banner;      // Banner of a module print.
+  std::vector<std::pair<std::string, std::string>> Options;
+  bool FunctionPass;       // Added to the per-function prepasses.
+};
 
-  DxcThreadMalloc TM(m_pMalloc);
+// Options of RunOptimizer, parsed once.
+struct OptimizerPipelineDesc {
+  std::vector<OptimizerPipelineStep> Steps;
+  bool OutputAssembly = false;
+  bool AnalyzeOnly = false;
+};
 
-  // Setup input buffer.
-  //
-  // The ir parsing requires the buffer to be null terminated. We deal with
-  // both source and bitcode input, so the input buffer may not be null
-  // terminated; we create a new membuf that copies and appends for this.
-  //
-  // If we have the beginning of a DXIL program header, skip to the bitcode.
-  //
-  LLVMContext Context;
-  SMDiagnostic Err;
-  std::unique_ptr<MemoryBuffer> memBuf;
-  std::unique_ptr<Module> M;
-  const char * pBlobContent = reinterpret_cast<const char *>(pBlob->GetBufferPointer());
-  unsigned blobSize = pBlob->GetBufferSize();
-  const DxilProgramHeader *pProgramHeader =
-    reinterpret_cast<const DxilProgramHeader *>(pBlobContent);
-  if (IsValidDxilProgramHeader(pProgramHeader, blobSize)) {
-    std::string DiagStr;
-    GetDxilProgramBitcode(pProgramHeader, &pBlobContent, &blobSize);
-    M = hlsl::dxilutil::LoadModuleFromBitcode(
-      llvm::StringRef(pBlobContent, blobSize), Context, DiagStr);
-  }
-  else {
-    StringRef bufStrRef(pBlobContent, blobSize);
-    memBuf = MemoryBuffer::getMemBufferCopy(bufStrRef);
-    M = parseIR(memBuf->getMemBufferRef(), Err, Context);
+// Forwards output to the stream of the current run, so that passes created
+// once write to a different stream on every run.
+class RedirectingOStream : public raw_ostream {
+private:
+  raw_ostream *m_pTarget = nullptr;
+  uint64_t m_Pos = 0;
+  void write_impl(const char *Ptr, size_t Size) override {
+    m_Pos += Size;
+    if (m_pTarget)
+      m_pTarget->write(Ptr, Size);
   }
+  uint64_t current_pos() const override { return m_Pos; }
+
+public:
+  RedirectingOStream() { SetUnbuffered(); }
+  void setTarget(raw_ostream *pTarget) { m_pTarget = pTarget; }
+};
+
+// Pass managers built from a pipeline description. An instance runs any
+// number of modules, one at a time.
+class OptimizerPipelineInstance {
+private:
+  RedirectingOStream m_OS;
+  legacy::PassManager m_ModulePasses;
+  legacy::FunctionPassManager m_FunctionPasses;
 
-  if (M == nullptr) {
-    return DXC_E_IR_VERIFICATION_FAILED;
+public:
+  explicit OptimizerPipelineInstance(const OptimizerPipelineDesc &Desc);
+  void Run(Module &M, raw_ostream &OS);
+};
+} // namespace
+
+OptimizerPipelineInstance::OptimizerPipelineInstance(
+    const OptimizerPipelineDesc &Desc)
+    : m_FunctionPasses(nullptr) {
+  SmallVector<PassOption, 2> options;
+  for (const OptimizerPipelineStep &Step : Desc.Steps) {
+    legacy::PassManagerBase *pPassManager = &m_ModulePasses;
+    if (Step.FunctionPass)
+      pPassManager = &m_FunctionPasses;
+    if (!Step.PassInf) {
+      pPassManager->add(llvm::createPrintModulePass(m_OS, Step.Banner));
+      continue;
+    }
+
+    options.clear();
+    for (const auto &Option : Step.Options)
+      options.push_back(PassOption(Option.first, Option.second));
+    Pass *pass = Step.PassInf->getNormalCtor()();
+    pass->setOSOverride(&m_OS);
+    pass->applyOptions(options);
+    pPassManager->add(pass);
+    if (Desc.AnalyzeOnly) {
+      const bool Quiet = false;
+      const PassInfo *PassInf = Step.PassInf;
+      PassKind Kind = pass->getPassKind();
+      switch (Kind) {
+      case PT_BasicBlock:
+        pPassManager->add(createBasicBlockPassPrinter(PassInf, m_OS, Quiet));
+        break;
+      case PT_Region:
+        pPassManager->add(createRegionPassPrinter(PassInf, m_OS, Quiet));
+        break;
+      case PT_Loop:
+        pPassManager->add(createLoopPassPrinter(PassInf, m_OS, Quiet));
+        break;
+      case PT_Function:
+        pPassManager->add(createFunctionPassPrinter(PassInf, m_OS, Quiet));
+        break;
+      case PT_CallGraphSCC:
+        pPassManager->add(createCallGraphPassPrinter(PassInf, m_OS, Quiet));
+        break;
+      default:
+        pPassManager->add(createModulePassPrinter(PassInf, m_OS, Quiet));
+        break;
+      }
+    }
   }
 
-  legacy::PassManager ModulePasses;
-  legacy::FunctionPassManager FunctionPasses(M.get());
-  legacy::PassManagerBase *pPassManager = &ModulePasses;
+  m_ModulePasses.add(createVerifierPass());
 
+  if (Desc.OutputAssembly) {
+    m_ModulePasses.add(llvm::createPrintModulePass(m_OS));
+  }
+}
+
+void OptimizerPipelineInstance::Run(Module &M, raw_ostream &OS) {
+  m_OS.setTarget(&OS);
   try {
-    CComPtr<AbstractMemoryStream> pOutputStream;
-    CComPtr<IDxcBlob> pOutputBlob;
+    raw_ostream *err_ostream = &OS;
+    ScopedFatalErrorHandler errHandler(FatalErrorHandlerStreamWrite, err_ostream);
 
-    IFT(CreateMemoryStream(m_pMalloc, &pOutputStream));
-    IFT(pOutputStream.QueryInterface(&pOutputBlob));
+    m_FunctionPasses.setModule(&M);
+    m_FunctionPasses.doInitialization();
+    for (Function &F : M)
+      if (!F.isDeclaration())
+        m_FunctionPasses.run(F);
+    m_FunctionPasses.doFinalization();
+    m_FunctionPasses.setModule(nullptr);
+    m_ModulePasses.run(M);
+  } catch (...) {
+    m_FunctionPasses.setModule(nullptr);
+    m_OS.setTarget(nullptr);
+    throw;
+  }
+  m_OS.setTarget(nullptr);
+}
 
-    raw_stream_ostream outStream(pOutputStream.p);
+// Parses RunOptimizer options into a pipeline description.
+static HRESULT ParseOptimizerOptions(_In_count_(optionCount) LPCWSTR *ppOptions,
+                                     UINT32 optionCount,
+                                     OptimizerPipelineDesc &Desc) {
+  PassRegistry *registry = PassRegistry::getPassRegistry();
+  //
+  // Consider some differences from opt.exe:
+  //
+  // Create a new optimization pass for each one specified on the command line
+  // as in StandardLinkOpts, OptLevelO1, etc.
+  // No target machine, and so no passes get their target machine ctor called.
+  // No print-after-each-pass option.
+  // No printing of the pass options.
+  // No StripDebug support.
+  // No verifyModule before starting.
+  // Use of PassPipeline for new manager.
+  // No TargetInfo.
+  // No DataLayout.
+  //
 
-    //
-    // Consider some differences from opt.exe:
-    //
-    // Create a new optimization pass for each one specified on the command line
-    // as in StandardLinkOpts, OptLevelO1, etc.
-    // No target machine, and so no passes get their target machine ctor called.
-    // No print-after-each-pass option.
-    // No printing of the pass options.
-    // No StripDebug support.
-    // No verifyModule before starting.
-    // Use of PassPipeline for new manager.
-    // No TargetInfo.
-    // No DataLayout.
-    //
-    bool OutputAssembly = false;
-    bool AnalyzeOnly = false;
-
-    // First gather flags, wherever they may be.
-    SmallVector<UINT32, 2> handled;
-    for (UINT32 i = 0; i < optionCount; ++i) {
-      if (wcseq(L"-S", ppOptions[i])) {
-        OutputAssembly = true;
-        handled.push_back(i);
-        continue;
-      }
-      if (wcseq(L"-analyze", ppOptions[i])) {
-        AnalyzeOnly = true;
-        handled.push_back(i);
-        continue;
-      }
+  // First gather flags, wherever they may be.
+  SmallVector<UINT32, 2> handled;
+  for (UINT32 i = 0; i < optionCount; ++i) {
+    if (wcseq(L"-S", ppOptions[i])) {
+      Desc.OutputAssembly = true;
+      handled.push_back(i);
+      continue;
     }
+    if (wcseq(L"-analyze", ppOptions[i])) {
+      Desc.AnalyzeOnly = true;
+      handled.push_back(i);
+      continue;
+    }
+  }
 
-    // TODO: should really use string_table for this once that's available
-    std::list<std::string> optionsAnsi;
-    SmallVector<PassOption, 2> options;
-    for (UINT32 i = 0; i < optionCount; ++i) {
-      if (std::find(handled.begin(), handled.end(), i) != handled.end()) {
-        continue;
-      }
-
-      // Handle some special cases where we can inject a redirected output stream.
-      if (wcsstartswith(ppOptions[i], L"-print-module")) {
-        LPCWSTR pName = ppOptions[i] + _countof(L"-print-module") - 1;
-        std::string Banner;
-        if (*pName) {
-          IFTARG(*pName != L':' || *pName != L'=');
-          ++pName;
-          CW2A name8(pName);
-          Banner = "MODULE-PRINT ";
-          Banner += name8.m_psz;
-          Banner += "\n";
-        }
-        if (pPassManager == &ModulePasses)
-          pPassManager->add(llvm::createPrintModulePass(outStream, Banner));
-        continue;
-      }
+  SmallVector<PassOption, 2> options;
+  bool FunctionPasses = false;
+  for (UINT32 i = 0; i < optionCount; ++i) {
+    if (std::find(handled.begin(), handled.end(), i) != handled.end()) {
+      continue;
+    }
 
-      // Handle special switches to toggle per-function prepasses vs. module passes.
-      if (wcseq(ppOptions[i], L"-opt-fn-passes")) {
-        pPassManager = &FunctionPasses;
-        continue;
+    // Handle some special cases where we can inject a redirected output stream.
+    if (wcsstartswith(ppOptions[i], L"-print-module")) {
+      LPCWSTR pName = ppOptions[i] + _countof(L"-print-module") - 1;
+      std::string Banner;
+      if (*pName) {
+        IFTARG(*pName != L':' || *pName != L'=');
+        ++pName;
+        CW2A name8(pName);
+        Banner = "MODULE-PRINT ";
+        Banner += name8.m_psz;
+        Banner += "\n";
       }
-      if (wcseq(ppOptions[i], L"-opt-mod-passes")) {
-        pPassManager = &ModulePasses;
-        continue;
+      if (!FunctionPasses) {
+        OptimizerPipelineStep Step;
+        Step.PassInf = nullptr;
+        Step.Banner = std::move(Banner);
+        Step.FunctionPass = false;
+        Desc.Steps.push_back(std::move(Step));
       }
+      continue;
+    }
 
-      CW2A optName(ppOptions[i], CP_UTF8);
-      // The option syntax is
-      const char ArgDelim = ',';
-      // '-' OPTION_NAME (',' ARG_NAME ('=' ARG_VALUE)?)*
-      char *pCursor = optName.m_psz;
-      const char *pEnd = optName.m_psz + strlen(optName.m_psz);
-      if (*pCursor != '-' && *pCursor != '/') {
+    // Handle special switches to toggle per-function prepasses vs. module passes.
+    if (wcseq(ppOptions[i], L"-opt-fn-passes")) {
+      FunctionPasses = true;
+      continue;
+    }
+    if (wcseq(ppOptions[i], L"-opt-mod-passes")) {
+      FunctionPasses = false;
+      continue;
+    }
+
+    CW2A optName(ppOptions[i], CP_UTF8);
+    // The option syntax is
+    const char ArgDelim = ',';
+    // '-' OPTION_NAME (',' ARG_NAME ('=' ARG_VALUE)?)*
+    char *pCursor = optName.m_psz;
+    const char *pEnd = optName.m_psz + strlen(optName.m_psz);
+    if (*pCursor != '-' && *pCursor != '/') {
+      return E_INVALIDARG;
+    }
+    ++pCursor;
+    const char *pOptionNameStart = pCursor;
+    while (*pCursor && *pCursor != ArgDelim) {
+      ++pCursor;
+    }
+    *pCursor = '\0';
+    const llvm::PassInfo *PassInf =
+        registry->getPassInfo(StringRef(pOptionNameStart));
+    if (!PassInf) {
+      return E_INVALIDARG;
+    }
+    while (pCursor < pEnd) {
+      // *pCursor is '\0' when we overwrite ',' to get a null-terminated string
+      if (*pCursor && *pCursor != ArgDelim) {
         return E_INVALIDARG;
       }
       ++pCursor;
-      const char *pOptionNameStart = pCursor;
+      const char *pArgStart = pCursor;
       while (*pCursor && *pCursor != ArgDelim) {
         ++pCursor;
       }
-      *pCursor = '\0';
-      const llvm::PassInfo *PassInf = getPassByName(pOptionNameStart);
-      if (!PassInf) {
+      StringRef argString = StringRef(pArgStart, pCursor - pArgStart);
+      std::pair<StringRef, StringRef> nameValue = argString.split('=');
+      if (!IsPassOptionName(nameValue.first)) {
         return E_INVALIDARG;
       }
-      while (pCursor < pEnd) {
-        // *pCursor is '\0' when we overwrite ',' to get a null-terminated string
-        if (*pCursor && *pCursor != ArgDelim) {
-          return E_INVALIDARG;
-        }
-        ++pCursor;
-        const char *pArgStart = pCursor;
-        while (*pCursor && *pCursor != ArgDelim) {
-          ++pCursor;
-        }
-        StringRef argString = StringRef(pArgStart, pCursor - pArgStart);
-        std::pair<StringRef, StringRef> nameValue = argString.split('=');
-        if (!IsPassOptionName(nameValue.first)) {
-          return E_INVALIDARG;
-        }
 
-        PassOption *OptionPos = std::lower_bound(options.begin(), options.end(), nameValue, PassOptionsCompare());
-        // If empty, remove if available; otherwise upsert.
-        if (nameValue.second.empty()) {
-          if (OptionPos != options.end() && OptionPos->first == nameValue.first) {
-            options.erase(OptionPos);
-          }
-        }
-        else {
-          if (OptionPos != options.end() && OptionPos->first == nameValue.first) {
-            OptionPos->second = nameValue.second;
-          }
-          else {
-            options.insert(OptionPos, nameValue);
-          }
+      PassOption *OptionPos = std::lower_bound(options.begin(), options.end(), nameValue, PassOptionsCompare());
+      // If empty, remove if available; otherwise upsert.
+      if (nameValue.second.empty()) {
+        if (OptionPos != options.end() && OptionPos->first == nameValue.first) {
+          options.erase(OptionPos);
         }
       }
-
-      DXASSERT(PassInf->getNormalCtor(), "else pass with no default .ctor was added");
-      Pass *pass = PassInf->getNormalCtor()();
-      pass->setOSOverride(&outStream);
-      pass->applyOptions(options);
-      options.clear();
-      pPassManager->add(pass);
-      if (AnalyzeOnly) {
-        const bool Quiet = false;
-        PassKind Kind = pass->getPassKind();
-        switch (Kind) {
-        case PT_BasicBlock:
-          pPassManager->add(createBasicBlockPassPrinter(PassInf, outStream, Quiet));
-          break;
-        case PT_Region:
-          pPassManager->add(createRegionPassPrinter(PassInf, outStream, Quiet));
-          break;
-        case PT_Loop:
-          pPassManager->add(createLoopPassPrinter(PassInf, outStream, Quiet));
-          break;
-        case PT_Function:
-          pPassManager->add(createFunctionPassPrinter(PassInf, outStream, Quiet));
-          break;
-        case PT_CallGraphSCC:
-          pPassManager->add(createCallGraphPassPrinter(PassInf, outStream, Quiet));
-          break;
-        default:
-          pPassManager->add(createModulePassPrinter(PassInf, outStream, Quiet));
-          break;
+      else {
+        if (OptionPos != options.end() && OptionPos->first == nameValue.first) {
+          OptionPos->second = nameValue.second;
+        }
+        else {
+          options.insert(OptionPos, nameValue);
         }
       }
     }
 
-    ModulePasses.add(createVerifierPass());
+    DXASSERT(PassInf->getNormalCtor(), "else pass with no default .ctor was added");
+    OptimizerPipelineStep Step;
+    Step.PassInf = PassInf;
+    Step.FunctionPass = FunctionPasses;
+    // The option strings live in optName, so keep copies.
+    for (const PassOption &Option : options)
+      Step.Options.emplace_back(Option.first.str(), Option.second.str());
+    options.clear();
+    Desc.Steps.push_back(std::move(Step));
+  }
+  return S_OK;
+}
 
-    if (OutputAssembly) {
-      ModulePasses.add(llvm::createPrintModulePass(outStream));
-    }
+// Loads the module of a DXIL program or of bitcode or IR text.
+static std::unique_ptr<Module> LoadOptimizerInput(IDxcBlob *pBlob,
+                                                  LLVMContext &Context) {
+  // Setup input buffer.
+  //
+  // The ir parsing requires the buffer to be null terminated. We deal with
+  // both source and bitcode input, so the input buffer may not be null
+  // terminated; in that case we create a new membuf that copies and appends.
+  //
+  // If we have the beginning of a DXIL program header, skip to the bitcode.
+  //
+  SMDiagnostic Err;
+  const char * pBlobContent = reinterpret_cast<const char *>(pBlob->GetBufferPointer());
+  unsigned blobSize = pBlob->GetBufferSize();
+  const DxilProgramHeader *pProgramHeader =
+    reinterpret_cast<const DxilProgramHeader *>(pBlobContent);
+  if (IsValidDxilProgramHeader(pProgramHeader, blobSize)) {
+    std::string DiagStr;
+    GetDxilProgramBitcode(pProgramHeader, &pBlobContent, &blobSize);
+    return hlsl::dxilutil::LoadModuleFromBitcode(
+      llvm::StringRef(pBlobContent, blobSize), Context, DiagStr);
+  }
+
+  std::unique_ptr<MemoryBuffer> memBuf;
+  if (blobSize > 0 && pBlobContent[blobSize - 1] == '\0') {
+    memBuf = MemoryBuffer::getMemBuffer(StringRef(pBlobContent, blobSize - 1));
+  } else {
+    memBuf = MemoryBuffer::getMemBufferCopy(StringRef(pBlobContent, blobSize));
+  }
+  return parseIR(memBuf->getMemBufferRef(), Err, Context);
+}
+
+// Runs an instance of a pipeline on M.
+static HRESULT RunOptimizerPipeline(IMalloc *pMalloc,
+                                    OptimizerPipelineInstance &Instance,
+                                    std::unique_ptr<Module> &M,
+                                    IDxcBlob **ppOutputModule,
+                                    IDxcBlobEncoding **ppOutputText) {
+  try {
+    CComPtr<AbstractMemoryStream> pOutputStream;
+    CComPtr<IDxcBlob> pOutputBlob;
+
+    IFT(CreateMemoryStream(pMalloc, &pOutputStream));
+    IFT(pOutputStream.QueryInterface(&pOutputBlob));
+
+    raw_stream_ostream outStream(pOutputStream.p);
 
     // Now that we have all of the passes ready, run them.
-    {
-      raw_ostream *err_ostream = &outStream;
-      ScopedFatalErrorHandler errHandler(FatalErrorHandlerStreamWrite, err_ostream);
-
-      FunctionPasses.doInitialization();
-      for (Function &F : *M.get())
-        if (!F.isDeclaration())
-          FunctionPasses.run(F);
-      FunctionPasses.doFinalization();
-      ModulePasses.run(*M.get());
-    }
+    Instance.Run(*M.get(), outStream);
 
     outStream.flush();
     if (ppOutputText != nullptr) {
@@ -809,7 +900,7 @@ HRESULT STDMETHODCALLTYPE DxcOptimizer::RunOptimizer(
     }
     if (ppOutputModule != nullptr) {
       CComPtr<AbstractMemoryStream> pProgramStream;
-      IFT(CreateMemoryStream(m_pMalloc, &pProgramStream));
+      IFT(CreateMemoryStream(pMalloc, &pProgramStream));
       {
         raw_stream_ostream outStream(pProgramStream.p);
         WriteBitcodeToFile(M.get(), outStream, true);
@@ -822,6 +913,177 @@ HRESULT STDMETHODCALLTYPE DxcOptimizer::RunOptimizer(
   return S_OK;
 }
 
+HRESULT STDMETHODCALLTYPE DxcOptimizer::RunOptimizer(
+    IDxcBlob *pBlob, _In_count_(optionCount) LPCWSTR *ppOptions,
+    UINT32 optionCount, _COM_Outptr_ IDxcBlob **ppOutputModule,
+    _COM_Outptr_opt_ IDxcBlobEncoding **ppOutputText) {
+  AssignToOutOpt(nullptr, ppOutputModule);
+  AssignToOutOpt(nullptr, ppOutputText);
+  if (pBlob == nullptr)
+    return E_POINTER;
+  if (optionCount > 0 && ppOptions == nullptr)
+    return E_POINTER;
+
+  DxcThreadMalloc TM(m_pMalloc);
+
+  try {
+    LLVMContext Context;
+    std::unique_ptr<Module> M = LoadOptimizerInput(pBlob, Context);
+    if (M == nullptr) {
+      return DXC_E_IR_VERIFICATION_FAILED;
+    }
+    OptimizerPipelineDesc Desc;
+    IFR(ParseOptimizerOptions(ppOptions, optionCount, Desc));
+    OptimizerPipelineInstance Instance(Desc);
+    return RunOptimizerPipeline(m_pMalloc, Instance, M, ppOutputModule,
+                                ppOutputText);
+  }
+  CATCH_CPP_RETURN_HRESULT();
+}
+
+class DxcOptimizerPipeline : public IDxcOptimizerPipeline {
+private:
+  DXC_MICROCOM_TM_REF_FIELDS()
+  OptimizerPipelineDesc m_Desc;
+  // Instances not running a module. Passes are not thread-safe, so each
+  // concurrent run takes its own instance.
+  std::mutex m_InstancesMutex;
+  std::vector<std::unique_ptr<OptimizerPipelineInstance>> m_Instances;
+
+  std::unique_ptr<OptimizerPipelineInstance> TakeInstance() {
+    {
+      std::lock_guard<std::mutex> lock(m_InstancesMutex);
+      if (!m_Instances.empty()) {
+        std::unique_ptr<OptimizerPipelineInstance> pInstance =
+            std::move(m_Instances.back());
+        m_Instances.pop_back();
+        return pInstance;
+      }
+    }
+    return llvm::make_unique<OptimizerPipelineInstance>(m_Desc);
+  }
+  void ReturnInstance(std::unique_ptr<OptimizerPipelineInstance> pInstance) {
+    std::lock_guard<std::mutex> lock(m_InstancesMutex);
+    m_Instances.push_back(std::move(pInstance));
+  }
+
+public:
+  DXC_MICROCOM_TM_ADDREF_RELEASE_IMPL()
+  DXC_MICROCOM_TM_CTOR(DxcOptimizerPipeline)
+
+  HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void **ppvObject) override {
+    return DoBasicQueryInterface<IDxcOptimizerPipeline>(this, iid, ppvObject);
+  }
+
+  HRESULT Initialize(LPCWSTR *ppOptions, UINT32 optionCount) {
+    IFR(ParseOptimizerOptions(ppOptions, optionCount, m_Desc));
+    // Build the first instance now, so a single-threaded caller never
+    // creates passes while running.
+    m_Instances.push_back(llvm::make_unique<OptimizerPipelineInstance>(m_Desc));
+    return S_OK;
+  }
+
+  HRESULT STDMETHODCALLTYPE Run(IDxcBlob *pBlob,
+                                _COM_Outptr_opt_ IDxcBlob **ppOutputModule,
+                                _COM_Outptr_opt_ IDxcBlobEncoding **ppOutputText) override {
+    AssignToOutOpt(nullptr, ppOutputModule);
+    AssignToOutOpt(nullptr, ppOutputText);
+    if (pBlob == nullptr)
+      return E_POINTER;
+
+    DxcThreadMalloc TM(m_pMalloc);
+    try {
+      // Each module gets its own context, so that types and constants of
+      // earlier modules are not kept alive.
+      LLVMContext Context;
+      std::unique_ptr<Module> M = LoadOptimizerInput(pBlob, Context);
+      if (M == nullptr) {
+        return DXC_E_IR_VERIFICATION_FAILED;
+      }
+      std::unique_ptr<OptimizerPipelineInstance> pInstance = TakeInstance();
+      HRESULT hr = RunOptimizerPipeline(m_pMalloc, *pInstance, M,
+                                        ppOutputModule, ppOutputText);
+      // A failed run may leave passes midway, so its instance is dropped.
+      if (SUCCEEDED(hr))
+        ReturnInstance(std::move(pInstance));
+      return hr;
+    }
+    CATCH_CPP_RETURN_HRESULT();
+  }
+
+  HRESULT STDMETHODCALLTYPE RunBatch(
+      _In_count_(blobCount) IDxcBlob **ppBlobs, UINT32 blobCount,
+      UINT32 threadCount,
+      _Out_writes_opt_(blobCount) IDxcBlob **ppOutputModules,
+      _Out_writes_opt_(blobCount) IDxcBlobEncoding **ppOutputTexts) override {
+    if (blobCount > 0 && ppBlobs == nullptr)
+      return E_POINTER;
+    if (ppOutputModules)
+      std::fill(ppOutputModules, ppOutputModules + blobCount, nullptr);
+    if (ppOutputTexts)
+      std::fill(ppOutputTexts, ppOutputTexts + blobCount, nullptr);
+
+    DxcThreadMalloc TM(m_pMalloc);
+    try {
+      std::vector<CComPtr<IDxcBlob>> outputModules(blobCount);
+      std::vector<CComPtr<IDxcBlobEncoding>> outputTexts(blobCount);
+      hlsl::WorkStealingThreadPool pool(threadCount);
+      // Tasks of one worker never run concurrently, so each worker runs all
+      // of its modules on one instance.
+      std::vector<std::unique_ptr<OptimizerPipelineInstance>> instances(
+          pool.getThreadCount());
+      pool.run(blobCount, [&](unsigned blobIndex, unsigned workerIndex) {
+        DxcThreadMalloc TM(m_pMalloc);
+        IFTPTR(ppBlobs[blobIndex]);
+        std::unique_ptr<OptimizerPipelineInstance> &pInstance =
+            instances[workerIndex];
+        if (!pInstance)
+          pInstance = TakeInstance();
+        LLVMContext Context;
+        std::unique_ptr<Module> M =
+            LoadOptimizerInput(ppBlobs[blobIndex], Context);
+        if (M == nullptr)
+          throw hlsl::Exception(DXC_E_IR_VERIFICATION_FAILED);
+        IFT(RunOptimizerPipeline(
+            m_pMalloc, *pInstance, M,
+            ppOutputModules ? &outputModules[blobIndex] : nullptr,
+            ppOutputTexts ? &outputTexts[blobIndex] : nullptr));
+      });
+      for (std::unique_ptr<OptimizerPipelineInstance> &pInstance : instances) {
+        if (pInstance)
+          ReturnInstance(std::move(pInstance));
+      }
+      for (UINT32 i = 0; i < blobCount; ++i) {
+        if (ppOutputModules)
+          ppOutputModules[i] = outputModules[i].Detach();
+        if (ppOutputTexts)
+          ppOutputTexts[i] = outputTexts[i].Detach();
+      }
+      return S_OK;
+    }
+    CATCH_CPP_RETURN_HRESULT();
+  }
+};
+
+HRESULT STDMETHODCALLTYPE DxcOptimizer::CreatePipeline(
+    _In_count_(optionCount) LPCWSTR *ppOptions, UINT32 optionCount,
+    _COM_Outptr_ IDxcOptimizerPipeline **ppPipeline) {
+  IFR(AssignToOut(nullptr, ppPipeline));
+  if (optionCount > 0 && ppOptions == nullptr)
+    return E_POINTER;
+
+  DxcThreadMalloc TM(m_pMalloc);
+  try {
+    CComPtr<DxcOptimizerPipeline> pPipeline =
+        DxcOptimizerPipeline::Alloc(m_pMalloc);
+    IFROOM(pPipeline.p);
+    IFR(pPipeline->Initialize(ppOptions, optionCount));
+    *ppPipeline = pPipeline.Detach();
+    return S_OK;
+  }
+  CATCH_CPP_RETURN_HRESULT();
+}
+
 HRESULT CreateDxcOptimizer(_In_ REFIID riid, _Out_ LPVOID *ppv) {
   CComPtr<DxcOptimizer> result = DxcOptimizer::Alloc(DxcGetThreadMallocNoRef());
   if (result == nullptr) {
@@ -14,6 +14,7 @@
 #include "llvm/IR/InstIterator.h"
 #include "llvm/IR/Operator.h"
 #include "dxc/DxilContainer/DxilContainer.h"
+#include "dxc/DxilContainer/DxilPipelineStateValidation.h"
 #include "dxc/DXIL/DxilModule.h"
 #include "dxc/DXIL/DxilShaderModel.h"
 #include "dxc/DXIL/DxilOperations.h"
@@ -88,8 +89,13 @@ public:
   std::vector<std::unique_ptr<CShaderReflectionConstantBuffer>>    m_CBs;
   std::vector<D3D12_SHADER_INPUT_BIND_DESC>       m_Resources;
   std::vector<std::unique_ptr<CShaderReflectionType>> m_Types;
+  // Set when m_CBs were created from the constant buffer layout part, which
+  // also carries variable usage.
+  bool m_bCBufferLayout = false;
   void CreateReflectionObjects();
   void CreateReflectionObjectForResource(DxilResourceBase *R);
+  void CreateReflectionObjectsFromLayout(IDxcBlob *pBlob,
+                                         const DxilPartHeader *pLayoutPart);
 
   HRESULT LoadModule(IDxcBlob *pBlob, const DxilPartHeader *pPart);
 
@@ -115,12 +121,30 @@ private:
   std::vector<D3D12_SIGNATURE_PARAMETER_DESC>     m_OutputSignature;
   std::vector<D3D12_SIGNATURE_PARAMETER_DESC>     m_PatchConstantSignature;
   std::vector<std::unique_ptr<char[]>>            m_UpperCaseNames;
+  bool m_bUsageMarked = false;
+  HRESULT m_hrUsageMarked = S_OK;
+  // Set when reflecting from the pipeline state validation part. The module
+  // is then loaded from the program part only by queries that need it.
+  const DxilPartHeader *m_pProgramPart = nullptr;
+  bool m_bModuleLoadTried = false;
+  DXIL::ShaderKind m_ShaderKind = DXIL::ShaderKind::Invalid;
+  uint32_t m_ProgramVersion = 0;
+  DxilPipelineStateValidation m_PSV;
+  uint64_t m_FeatureInfo = 0;
+  bool IsPSVReflection() const { return m_pProgramPart != nullptr; }
+  bool EnsureModuleLoaded();
   void SetCBufferUsage();
   void CreateReflectionObjectsForSignature(
       const DxilSignature &Sig,
       std::vector<D3D12_SIGNATURE_PARAMETER_DESC> &Descs);
+  void CreateReflectionObjectsForSignature(
+      PSVSignatureElement0 *(DxilPipelineStateValidation::*GetElement)(uint32_t) const,
+      uint32_t Count, bool IsInput, DXIL::TessellatorDomain Domain,
+      std::vector<D3D12_SIGNATURE_PARAMETER_DESC> &Descs);
   LPCSTR CreateUpperCase(LPCSTR pValue);
   void MarkUsedSignatureElements();
+  HRESULT EnsureUsageMarked();
+  void GetDescFromPSV(D3D12_SHADER_DESC *pDesc);
 public:
   PublicAPI m_PublicAPI;
   void SetPublicAPI(PublicAPI value) { m_PublicAPI = value; }
@@ -149,7 +173,12 @@ public:
     return hr;
   }
 
-  HRESULT Load(IDxcBlob *pBlob, const DxilPartHeader *pPart);
+  HRESULT Load(IDxcBlob *pBlob, const DxilPartHeader *pPart,
+               const DxilPartHeader *pLayoutPart = nullptr);
+  HRESULT LoadFromPSV(IDxcBlob *pBlob, const DxilPartHeader *pPSVPart,
+                      const DxilPartHeader *pProgramPart,
+                      const DxilPartHeader *pFeatureInfoPart,
+                      const DxilPartHeader *pLayoutPart);
 
   // ID3D12ShaderReflection
   STDMETHODIMP GetDesc(THIS_ _Out_ D3D12_SHADER_DESC *pDesc);
@@ -310,6 +339,15 @@ HRESULT DxilContainerReflection::GetPartReflection(UINT32 idx, REFIID iid, void
   if (!IsLoaded()) return E_NOT_VALID_STATE;
   if (idx >= m_pHeader->PartCount) return E_BOUNDS;
   const DxilPartHeader *pPart = GetDxilContainerPart(m_pHeader, idx);
+  // The pipeline state validation part reflects the shader in the DXIL part,
+  // answering what it can from the container parts without the module.
+  const DxilPartHeader *pPSVPart = nullptr;
+  if (pPart->PartFourCC == DFCC_PipelineStateValidation) {
+    pPSVPart = pPart;
+    pPart = GetDxilPartByType(m_pHeader, DFCC_DXIL);
+    if (pPart == nullptr)
+      return E_NOTIMPL;
+  }
   if (pPart->PartFourCC != DFCC_DXIL && pPart->PartFourCC != DFCC_ShaderDebugInfoDXIL) {
     return E_NOTIMPL;
   }
@@ -324,6 +362,8 @@ HRESULT DxilContainerReflection::GetPartReflection(UINT32 idx, REFIID iid, void
 
   DXIL::ShaderKind SK = GetVersionShaderType(pProgramHeader->ProgramVersion);
   if (SK == DXIL::ShaderKind::Library) {
+    if (pPSVPart != nullptr)
+      return E_NOTIMPL;
     CComPtr<DxilLibraryReflection> pReflection = DxilLibraryReflection::Alloc(m_pMalloc);
     IFCOOM(pReflection.p);
     IFC(pReflection->Load(m_container, pPart));
@@ -334,7 +374,18 @@ HRESULT DxilContainerReflection::GetPartReflection(UINT32 idx, REFIID iid, void
     PublicAPI api = DxilShaderReflection::IIDToAPI(iid);
     pReflection->SetPublicAPI(api);
 
-    IFC(pReflection->Load(m_container, pPart));
+    // Constant buffers are described by the layout part when there is one.
+    const DxilPartHeader *pLayoutPart =
+        GetDxilPartByType(m_pHeader, DFCC_ConstantBufferLayout);
+    if (pLayoutPart != nullptr && !IsDxilCBufferLayoutValid(pLayoutPart))
+      pLayoutPart = nullptr;
+    if (pPSVPart != nullptr) {
+      IFC(pReflection->LoadFromPSV(
+          m_container, pPSVPart, pPart,
+          GetDxilPartByType(m_pHeader, DFCC_FeatureInfo), pLayoutPart));
+    } else {
+      IFC(pReflection->Load(m_container, pPart, pLayoutPart));
+    }
     IFC(pReflection.p->QueryInterface(iid, ppvObject));
   }
 
@@ -379,6 +430,10 @@ public:
     unsigned int            baseOffset,
     std::vector<std::unique_ptr<CShaderReflectionType>>& allTypes,
     bool                    isCBuffer);
+  HRESULT InitializeFromLayout(
+    const DxilCBufferLayoutTables &layout,
+    uint32_t                typeIndex,
+    std::vector<std::unique_ptr<CShaderReflectionType>>& allTypes);
 
   // ID3D12ShaderReflectionType
   STDMETHOD(GetDesc)(D3D12_SHADER_TYPE_DESC *pDesc);
@@ -447,6 +502,9 @@ public:
   void InitializeStructuredBuffer(DxilModule &M,
                                   DxilResource &R,
                                   std::vector<std::unique_ptr<CShaderReflectionType>>& allTypes);
+  void InitializeFromLayout(const DxilCBufferLayoutTables &layout,
+                            const DxilCBufferLayoutBuffer &buffer,
+                            std::vector<std::unique_ptr<CShaderReflectionType>>& allTypes);
   LPCSTR GetName() { return m_Desc.Name; }
 
   // ID3D12ShaderReflectionConstantBuffer
@@ -638,12 +696,12 @@ STDMETHODIMP CShaderReflectionType::ImplementsInterface(THIS_ ID3D12ShaderReflec
 // Helper routine for types that don't have an obvious mapping
 // to the existing shader reflection interface.
 static bool ProcessUnhandledObjectType(
-  llvm::StructType            *structType,
+  llvm::StringRef             structName,
   D3D_SHADER_VARIABLE_TYPE    *outObjectType)
 {
   // Don't actually make this a hard error, but instead report the problem using a suitable debug message.
 #ifdef DBG
-  OutputDebugFormatA("DxilContainerReflection.cpp: error: unhandled object type '%s'.\n", structType->getName().str().c_str());
+  OutputDebugFormatA("DxilContainerReflection.cpp: error: unhandled object type '%s'.\n", structName.str().c_str());
 #endif
   *outObjectType = D3D_SVT_VOID;
   return true;
@@ -653,7 +711,7 @@ static bool ProcessUnhandledObjectType(
 // (a texture, sampler, buffer, etc.), and to extract the coresponding shader
 // reflection type.
 static bool TryToDetectObjectType(
-  llvm::StructType            *structType,
+  llvm::StringRef             structName,
   D3D_SHADER_VARIABLE_TYPE    *outObjectType)
 {
   // Note: This logic is largely duplicated from `dxilutil::IsHLSLObjectType`
@@ -663,11 +721,11 @@ static bool TryToDetectObjectType(
   // type names, including cases that just test against a prefix.
   // This code doesn't try to be any more robust.
 
-  StringRef name = structType->getName();
+  StringRef name = structName;
 
   if(name.startswith("dx.types.wave_t") )
   {
-    return ProcessUnhandledObjectType(structType, outObjectType);
+    return ProcessUnhandledObjectType(structName, outObjectType);
   }
 
   // Strip off some prefixes we are likely to see.
@@ -688,9 +746,9 @@ static bool TryToDetectObjectType(
   EXACT_MATCH(SamplerComparisonState,     D3D_SVT_SAMPLER);
 
   // Note: GS output stream types are supported in the reflection interface.
-  else if(name.startswith("TriangleStream"))    { return ProcessUnhandledObjectType(structType, outObjectType); }
-  else if(name.startswith("PointStream"))       { return ProcessUnhandledObjectType(structType, outObjectType); }
-  else if(name.startswith("LineStream"))        { return ProcessUnhandledObjectType(structType, outObjectType); }
+  else if(name.startswith("TriangleStream"))    { return ProcessUnhandledObjectType(structName, outObjectType); }
+  else if(name.startswith("PointStream"))       { return ProcessUnhandledObjectType(structName, outObjectType); }
+  else if(name.startswith("LineStream"))        { return ProcessUnhandledObjectType(structName, outObjectType); }
 
   PREFIX_MATCH(AppendStructuredBuffer,    D3D_SVT_APPEND_STRUCTURED_BUFFER);
   PREFIX_MATCH(ConsumeStructuredBuffer,   D3D_SVT_CONSUME_STRUCTURED_BUFFER);
@@ -748,7 +806,89 @@ static bool IsObjectType(
     return false;
 
   D3D_SHADER_VARIABLE_TYPE ignored;
-  return TryToDetectObjectType(structType, &ignored);
+  return TryToDetectObjectType(structType->getName(), &ignored);
+}
+
+// Helper to translate a DXIL component type into a D3D shader reflection
+// type, along with its type name and the size of one component in a
+// constant buffer.
+static D3D_SHADER_VARIABLE_TYPE CompTypeToShaderVariableType(
+  hlsl::DXIL::ComponentType   Kind,
+  std::string                 &Name,
+  unsigned                    &CompSize)
+{
+  // Note that DXIL supports some types that don't currently have equivalents
+  // in the reflection interface, so we try to muddle through here.
+  D3D_SHADER_VARIABLE_TYPE result = D3D_SVT_VOID;
+  switch(Kind)
+  {
+  case hlsl::DXIL::ComponentType::Invalid:
+    break;
+
+  case hlsl::DXIL::ComponentType::I1:
+    result = D3D_SVT_BOOL;
+    Name = "bool";
+    break;
+
+  case hlsl::DXIL::ComponentType::I16:
+    result = D3D_SVT_MIN16INT;
+    Name = "min16int";
+    break;
+
+  case hlsl::DXIL::ComponentType::U16:
+    result = D3D_SVT_MIN16UINT;
+    Name = "min16uint";
+    break;
+
+  case hlsl::DXIL::ComponentType::I64:
+    CompSize = 8;
+#ifdef DBG
+    OutputDebugStringA("DxilContainerReflection.cpp: warning: component of type 'I64' being reflected as if 'I32'\n");
+#endif
+  case hlsl::DXIL::ComponentType::I32:
+    result = D3D_SVT_INT;
+    Name = "int";
+    break;
+
+  case hlsl::DXIL::ComponentType::U64:
+    CompSize = 8;
+#ifdef DBG
+    OutputDebugStringA("DxilContainerReflection.cpp: warning: component of type 'U64' being reflected as if 'U32'\n");
+#endif
+  case hlsl::DXIL::ComponentType::U32:
+    result = D3D_SVT_UINT;
+    Name = "uint";
+    break;
+
+  case hlsl::DXIL::ComponentType::F16:
+  case hlsl::DXIL::ComponentType::SNormF16:
+  case hlsl::DXIL::ComponentType::UNormF16:
+    result = D3D_SVT_MIN16FLOAT;
+    Name = "min16float";
+    break;
+
+  case hlsl::DXIL::ComponentType::F32:
+  case hlsl::DXIL::ComponentType::SNormF32:
+  case hlsl::DXIL::ComponentType::UNormF32:
+    result = D3D_SVT_FLOAT;
+    Name = "float";
+    break;
+
+  case hlsl::DXIL::ComponentType::F64:
+  case hlsl::DXIL::ComponentType::SNormF64:
+  case hlsl::DXIL::ComponentType::UNormF64:
+    CompSize = 8;
+    result = D3D_SVT_DOUBLE;
+    Name = "double";
+    break;
+
+  default:
+#ifdef DBG
+    OutputDebugStringA("DxilContainerReflection.cpp: error: unknown component type\n");
+#endif
+    break;
+  }
+  return result;
 }
 
 // Main logic for translating an LLVM type and associated
@@ -825,79 +965,8 @@ HRESULT CShaderReflectionType::Initialize(
   m_Desc.Class = D3D_SVC_SCALAR;
 
   // Look at the annotation to try to determine the basic type of value.
-  //
-  // Note that DXIL supports some types that don't currently have equivalents
-  // in the reflection interface, so we try to muddle through here.
-  D3D_SHADER_VARIABLE_TYPE componentType = D3D_SVT_VOID;
-  switch(typeAnnotation.GetCompType().GetKind())
-  {
-  case hlsl::DXIL::ComponentType::Invalid:
-    break;
-
-  case hlsl::DXIL::ComponentType::I1:
-    componentType = D3D_SVT_BOOL;
-    m_Name = "bool";
-    break;
-
-  case hlsl::DXIL::ComponentType::I16:
-    componentType = D3D_SVT_MIN16INT;
-    m_Name = "min16int";
-    break;
-
-  case hlsl::DXIL::ComponentType::U16:
-    componentType = D3D_SVT_MIN16UINT;
-    m_Name = "min16uint";
-    break;
-
-  case hlsl::DXIL::ComponentType::I64:
-    cbCompSize = 8;
-#ifdef DBG
-    OutputDebugStringA("DxilContainerReflection.cpp: warning: component of type 'I64' being reflected as if 'I32'\n");
-#endif
-  case hlsl::DXIL::ComponentType::I32:
-    componentType = D3D_SVT_INT;
-    m_Name = "int";
-    break;
-
-  case hlsl::DXIL::ComponentType::U64:
-    cbCompSize = 8;
-#ifdef DBG
-    OutputDebugStringA("DxilContainerReflection.cpp: warning: component of type 'U64' being reflected as if 'U32'\n");
-#endif
-  case hlsl::DXIL::ComponentType::U32:
-    componentType = D3D_SVT_UINT;
-    m_Name = "uint";
-    break;
-
-  case hlsl::DXIL::ComponentType::F16:
-  case hlsl::DXIL::ComponentType::SNormF16:
-  case hlsl::DXIL::ComponentType::UNormF16:
-    componentType = D3D_SVT_MIN16FLOAT;
-    m_Name = "min16float";
-    break;
-
-  case hlsl::DXIL::ComponentType::F32:
-  case hlsl::DXIL::ComponentType::SNormF32:
-  case hlsl::DXIL::ComponentType::UNormF32:
-    componentType = D3D_SVT_FLOAT;
-    m_Name = "float";
-    break;
-
-  case hlsl::DXIL::ComponentType::F64:
-  case hlsl::DXIL::ComponentType::SNormF64:
-  case hlsl::DXIL::ComponentType::UNormF64:
-    cbCompSize = 8;
-    componentType = D3D_SVT_DOUBLE;
-    m_Name = "double";
-    break;
-
-  default:
-#ifdef DBG
-    OutputDebugStringA("DxilContainerReflection.cpp: error: unknown component type\n");
-#endif
-    break;
-  }
-  m_Desc.Type = componentType;
+  m_Desc.Type = CompTypeToShaderVariableType(
+      typeAnnotation.GetCompType().GetKind(), m_Name, cbCompSize);
 
   // A matrix type is encoded as a vector type, plus annotations, so we
   // need to check for this case before other vector cases.
@@ -959,7 +1028,7 @@ HRESULT CShaderReflectionType::Initialize(
 
     // We use our function to try to detect an object type
     // based on its name.
-    if(TryToDetectObjectType(structType, &m_Desc.Type))
+    if(TryToDetectObjectType(structType->getName(), &m_Desc.Type))
     {
       m_Desc.Class = D3D_SVC_OBJECT;
     }
@@ -1098,6 +1167,86 @@ HRESULT CShaderReflectionType::Initialize(
   return S_OK;
 }
 
+// Translates a type of the constant buffer layout part. The layout already
+// has the shape, offset and size computed by Initialize above; only the
+// mapping to reflection types and names happens here.
+HRESULT CShaderReflectionType::InitializeFromLayout(
+  const DxilCBufferLayoutTables &layout,
+  uint32_t                typeIndex,
+  std::vector<std::unique_ptr<CShaderReflectionType>>& allTypes)
+{
+  const DxilCBufferLayoutType &info = layout.Types[typeIndex];
+  m_Desc.Rows = info.Rows;
+  m_Desc.Columns = info.Columns;
+  m_Desc.Elements = info.Elements;
+  m_Desc.Members = 0;
+  m_Desc.Offset = info.Offset;
+  m_SizeInCBuffer = info.Size;
+
+  unsigned compSize = 4;
+  m_Desc.Class = D3D_SVC_SCALAR;
+  m_Desc.Type = CompTypeToShaderVariableType(
+      (hlsl::DXIL::ComponentType)info.CompType, m_Name, compSize);
+
+  switch ((DxilCBufferLayoutTypeClass)info.Class) {
+  case DxilCBufferLayoutTypeClass::Scalar:
+    // Scalar `uint` gets reflected as `dword`, while vectors/matrices use `uint`...
+    if (m_Desc.Rows == 1 && m_Desc.Type == D3D_SVT_UINT)
+      m_Name = "dword";
+    break;
+
+  case DxilCBufferLayoutTypeClass::Vector:
+    m_Desc.Class = D3D_SVC_VECTOR;
+    m_Name += std::to_string(m_Desc.Columns);
+    break;
+
+  case DxilCBufferLayoutTypeClass::Matrix:
+    m_Desc.Class = (hlsl::MatrixOrientation)info.Orientation ==
+                           hlsl::MatrixOrientation::RowMajor
+                       ? D3D_SVC_MATRIX_ROWS
+                       : D3D_SVC_MATRIX_COLUMNS;
+    m_Name += std::to_string(m_Desc.Rows) + "x" + std::to_string(m_Desc.Columns);
+    break;
+
+  case DxilCBufferLayoutTypeClass::Object:
+    m_Desc.Class = D3D_SVC_OBJECT;
+    if (!TryToDetectObjectType(layout.GetName(info.NameOffset), &m_Desc.Type))
+      m_Desc.Type = D3D_SVT_VOID;
+    break;
+
+  case DxilCBufferLayoutTypeClass::Struct: {
+    m_Desc.Class = D3D_SVC_STRUCT;
+
+    // Try to "clean" the type name for use in reflection data
+    llvm::StringRef name = layout.GetName(info.NameOffset);
+    name = name.ltrim("dx.alignment.legacy.");
+    name = name.ltrim("struct.");
+    m_Name = name;
+
+    // Member types come before the types that contain them, which the part
+    // validation checks, so this recursion ends.
+    for (uint32_t mm = 0; mm < info.MemberCount; ++mm) {
+      const DxilCBufferLayoutMember &member = layout.Members[info.FirstMember + mm];
+      CShaderReflectionType *memberReflectionType = new CShaderReflectionType();
+      allTypes.push_back(std::unique_ptr<CShaderReflectionType>(memberReflectionType));
+      memberReflectionType->InitializeFromLayout(layout, member.TypeIndex, allTypes);
+      m_MemberTypes.push_back(memberReflectionType);
+      m_MemberNames.push_back(layout.GetName(member.NameOffset));
+    }
+    m_Desc.Members = m_MemberTypes.size();
+    break;
+  }
+
+  case DxilCBufferLayoutTypeClass::Void:
+    m_Name = "void";
+    break;
+  }
+
+  m_Desc.Name = m_Name.c_str();
+
+  return S_OK;
+}
+
 
 void CShaderReflectionConstantBuffer::Initialize(
   DxilModule &M,
@@ -1252,6 +1401,63 @@ void CShaderReflectionConstantBuffer::InitializeStructuredBuffer(
   m_Desc.Size = VarDesc.Size;
 }
 
+void CShaderReflectionConstantBuffer::InitializeFromLayout(
+  const DxilCBufferLayoutTables &layout,
+  const DxilCBufferLayoutBuffer &buffer,
+  std::vector<std::unique_ptr<CShaderReflectionType>>& allTypes) {
+  ZeroMemory(&m_Desc, sizeof(m_Desc));
+  bool isCBuffer = buffer.Kind == (uint32_t)DxilCBufferLayoutBufferKind::CBuffer;
+  if (isCBuffer) {
+    m_Desc.Name = layout.GetName(buffer.NameOffset);
+    m_Desc.Size = (buffer.Size + 0x0f) & ~(0x0f); // Round up to 16 bytes for reflection.
+    m_Desc.Type = D3D_CT_CBUFFER;
+  } else {
+    m_ReflectionName = layout.GetName(buffer.NameOffset);
+    for (unsigned i = 0; i < buffer.ArrayDimensions; ++i) {
+      m_ReflectionName += "[0]";
+    }
+    m_Desc.Name = m_ReflectionName.c_str();
+    m_Desc.Size = buffer.Size;
+    m_Desc.Type = D3D11_CT_RESOURCE_BIND_INFO;
+  }
+  m_Desc.uFlags = 0;
+  m_Desc.Variables = buffer.VariableCount;
+
+  for (uint32_t i = 0; i < buffer.VariableCount; ++i) {
+    const DxilCBufferLayoutVariable &variable =
+        layout.Variables[buffer.FirstVariable + i];
+
+    D3D12_SHADER_VARIABLE_DESC VarDesc;
+    ZeroMemory(&VarDesc, sizeof(VarDesc));
+    if (variable.Flags & (uint32_t)DxilCBufferLayoutVariableFlags::Used)
+      VarDesc.uFlags |= D3D_SVF_USED;
+    CShaderReflectionVariable Var;
+    CShaderReflectionType *pVarType = nullptr;
+    if (variable.TypeIndex != DxilCBufferLayoutNoType) {
+      pVarType = new CShaderReflectionType();
+      allTypes.push_back(std::unique_ptr<CShaderReflectionType>(pVarType));
+      pVarType->InitializeFromLayout(layout, variable.TypeIndex, allTypes);
+      // Replicate fxc bug, where Elements == 1 for inner struct of CB array, instead of 0.
+      if (isCBuffer && buffer.RangeSize > 1)
+        pVarType->m_Desc.Elements = 1;
+    }
+
+    if (isCBuffer) {
+      VarDesc.Name = layout.GetName(variable.NameOffset);
+      VarDesc.StartOffset = variable.StartOffset;
+    } else {
+      VarDesc.Name = "$Element";
+      VarDesc.StartTexture = UINT_MAX;
+      VarDesc.StartSampler = UINT_MAX;
+    }
+    VarDesc.Size = variable.Size;
+
+    BYTE *pDefaultValue = nullptr;
+    Var.Initialize(this, &VarDesc, pVarType, pDefaultValue);
+    m_Variables.push_back(Var);
+  }
+}
+
 HRESULT CShaderReflectionConstantBuffer::GetDesc(D3D12_SHADER_BUFFER_DESC *pDesc) {
   if (!pDesc)
     return E_POINTER;
@@ -1448,87 +1654,6 @@ void DxilModuleReflection::CreateReflectionObjectForResource(DxilResourceBase *R
   m_Resources.push_back(inputBind);
 }
 
-// Find the imm offset part from a value.
-// It must exist unless offset is 0.
-static unsigned GetCBOffset(Value *V) {
-  if (ConstantInt *Imm = dyn_cast<ConstantInt>(V))
-    return Imm->getLimitedValue();
-  else if (UnaryInstruction *UI = dyn_cast<UnaryInstruction>(V)) {
-    return 0;
-  } else if (BinaryOperator *BO = dyn_cast<BinaryOperator>(V)) {
-    switch (BO->getOpcode()) {
-    case Instruction::Add: {
-      unsigned left = GetCBOffset(BO->getOperand(0));
-      unsigned right = GetCBOffset(BO->getOperand(1));
-      return left + right;
-    } break;
-    case Instruction::Or: {
-      unsigned left = GetCBOffset(BO->getOperand(0));
-      unsigned right = GetCBOffset(BO->getOperand(1));
-      return left | right;
-    } break;
-    default:
-      return 0;
-    }
-  } else {
-    return 0;
-  }
-}
-
-void CollectInPhiChain(PHINode *cbUser, std::vector<unsigned> &cbufUsage,
-                  unsigned offset, std::unordered_set<Value *> &userSet) {
-  if (userSet.count(cbUser) > 0)
-    return;
-
-  userSet.insert(cbUser);
-  for (User *cbU : cbUser->users()) {
-    if (ExtractValueInst *EV = dyn_cast<ExtractValueInst>(cbU)) {
-      for (unsigned idx : EV->getIndices()) {
-        cbufUsage.emplace_back(offset + idx * 4);
-      }
-    } else {
-      PHINode *phi = cast<PHINode>(cbU);
-      CollectInPhiChain(phi, cbufUsage, offset, userSet);
-    }
-  }
-}
-
-static void CollectCBufUsage(Value *cbHandle,
-                             std::vector<unsigned> &cbufUsage) {
-  for (User *U : cbHandle->users()) {
-    CallInst *CI = cast<CallInst>(U);
-    ConstantInt *opcodeV =
-        cast<ConstantInt>(CI->getArgOperand(DXIL::OperandIndex::kOpcodeIdx));
-    DXIL::OpCode opcode = static_cast<DXIL::OpCode>(opcodeV->getLimitedValue());
-    if (opcode == DXIL::OpCode::CBufferLoadLegacy) {
-      DxilInst_CBufferLoadLegacy cbload(CI);
-      Value *resIndex = cbload.get_regIndex();
-      unsigned offset = GetCBOffset(resIndex);
-      // 16 bytes align.
-      offset <<= 4;
-      for (User *cbU : U->users()) {
-        if (ExtractValueInst *EV = dyn_cast<ExtractValueInst>(cbU)) {
-          for (unsigned idx : EV->getIndices()) {
-            cbufUsage.emplace_back(offset + idx * 4);
-          }
-        } else {
-          PHINode *phi = cast<PHINode>(cbU);
-          std::unordered_set<Value *> userSet;
-          CollectInPhiChain(phi, cbufUsage, offset, userSet);
-        }
-      }
-    } else if (opcode == DXIL::OpCode::CBufferLoad) {
-      DxilInst_CBufferLoad cbload(CI);
-      Value *byteOffset = cbload.get_byteOffset();
-      unsigned offset = GetCBOffset(byteOffset);
-      cbufUsage.emplace_back(offset);
-    } else {
-      //
-      DXASSERT(0, "invalid opcode");
-    }
-  }
-}
-
 static void SetCBufVarUsage(CShaderReflectionConstantBuffer &cb,
                             std::vector<unsigned> usage) {
   D3D12_SHADER_BUFFER_DESC Desc;
@@ -1567,31 +1692,13 @@ static void SetCBufVarUsage(CShaderReflectionConstantBuffer &cb,
 }
 
 void DxilShaderReflection::SetCBufferUsage() {
-  hlsl::OP *hlslOP = m_pDxilModule->GetOP();
-  LLVMContext &Ctx = m_pDxilModule->GetCtx();
-
   // Indexes >= cbuffer size from DxilModule are SRV or UAV structured buffers.
   // We only collect usage for actual cbuffers, so don't go clearing usage on other buffers.
   unsigned cbSize = std::min(m_CBs.size(), m_pDxilModule->GetCBuffers().size());
   std::vector< std::vector<unsigned> > cbufUsage(cbSize);
 
-  Function *createHandle = hlslOP->GetOpFunc(DXIL::OpCode::CreateHandle, Type::getVoidTy(Ctx));
-
-  if (createHandle->user_empty()) {
-    createHandle->eraseFromParent();
+  if (!dxilutil::CollectCBufferUsage(*m_pModule, cbufUsage))
     return;
-  }
-
-  // Find all cb handles.
-  for (User *U : createHandle->users()) {
-    DxilInst_CreateHandle handle(cast<CallInst>(U));
-    Value *resClass = handle.get_resourceClass();
-    ConstantInt *immResClass = cast<ConstantInt>(resClass);
-    if (immResClass->getLimitedValue() == (unsigned)DXIL::ResourceClass::CBuffer) {
-      ConstantInt *cbID = cast<ConstantInt>(handle.get_rangeId());
-      CollectCBufUsage(U, cbufUsage[cbID->getLimitedValue()]);
-    }
-  }
 
   for (unsigned i=0;i<cbSize;i++) {
     SetCBufVarUsage(*m_CBs[i], cbufUsage[i]);
@@ -1602,28 +1709,31 @@ void DxilModuleReflection::CreateReflectionObjects() {
   DXASSERT_NOMSG(m_pDxilModule != nullptr);
 
   // Create constant buffers, resources and signatures.
-  for (auto && cb : m_pDxilModule->GetCBuffers()) {
-    std::unique_ptr<CShaderReflectionConstantBuffer> rcb(new CShaderReflectionConstantBuffer());
-    rcb->Initialize(*m_pDxilModule, *(cb.get()), m_Types);
-    m_CBs.emplace_back(std::move(rcb));
-  }
+  // Constant buffers read from the layout part are already created.
+  if (!m_bCBufferLayout) {
+    for (auto && cb : m_pDxilModule->GetCBuffers()) {
+      std::unique_ptr<CShaderReflectionConstantBuffer> rcb(new CShaderReflectionConstantBuffer());
+      rcb->Initialize(*m_pDxilModule, *(cb.get()), m_Types);
+      m_CBs.emplace_back(std::move(rcb));
+    }
 
-  // TODO: add tbuffers into m_CBs
-  for (auto && uav : m_pDxilModule->GetUAVs()) {
-    if (uav->GetKind() != DxilResource::Kind::StructuredBuffer) {
-      continue;
+    // TODO: add tbuffers into m_CBs
+    for (auto && uav : m_pDxilModule->GetUAVs()) {
+      if (uav->GetKind() != DxilResource::Kind::StructuredBuffer) {
+        continue;
+      }
+      std::unique_ptr<CShaderReflectionConstantBuffer> rcb(new CShaderReflectionConstantBuffer());
+      rcb->InitializeStructuredBuffer(*m_pDxilModule, *(uav.get()), m_Types);
+      m_CBs.emplace_back(std::move(rcb));
     }
-    std::unique_ptr<CShaderReflectionConstantBuffer> rcb(new CShaderReflectionConstantBuffer());
-    rcb->InitializeStructuredBuffer(*m_pDxilModule, *(uav.get()), m_Types);
-    m_CBs.emplace_back(std::move(rcb));
-  }
-  for (auto && srv : m_pDxilModule->GetSRVs()) {
-    if (srv->GetKind() != DxilResource::Kind::StructuredBuffer) {
-      continue;
+    for (auto && srv : m_pDxilModule->GetSRVs()) {
+      if (srv->GetKind() != DxilResource::Kind::StructuredBuffer) {
+        continue;
+      }
+      std::unique_ptr<CShaderReflectionConstantBuffer> rcb(new CShaderReflectionConstantBuffer());
+      rcb->InitializeStructuredBuffer(*m_pDxilModule, *(srv.get()), m_Types);
+      m_CBs.emplace_back(std::move(rcb));
     }
-    std::unique_ptr<CShaderReflectionConstantBuffer> rcb(new CShaderReflectionConstantBuffer());
-    rcb->InitializeStructuredBuffer(*m_pDxilModule, *(srv.get()), m_Types);
-    m_CBs.emplace_back(std::move(rcb));
   }
 
   // Populate all resources.
@@ -1641,6 +1751,24 @@ void DxilModuleReflection::CreateReflectionObjects() {
   }
 }
 
+// Creates the constant buffers from a valid constant buffer layout part. The
+// names are read in place, so the container is kept alive with them.
+void DxilModuleReflection::CreateReflectionObjectsFromLayout(
+    IDxcBlob *pBlob, const DxilPartHeader *pLayoutPart) {
+  DXASSERT_NOMSG(m_CBs.empty());
+  m_pContainer = pBlob;
+  DxilCBufferLayoutTables layout;
+  GetDxilCBufferLayoutTables(pLayoutPart, layout);
+  const DxilCBufferLayout *pLayout =
+      reinterpret_cast<const DxilCBufferLayout *>(GetDxilPartData(pLayoutPart));
+  for (uint32_t i = 0; i < pLayout->BufferCount; ++i) {
+    std::unique_ptr<CShaderReflectionConstantBuffer> rcb(new CShaderReflectionConstantBuffer());
+    rcb->InitializeFromLayout(layout, layout.Buffers[i], m_Types);
+    m_CBs.emplace_back(std::move(rcb));
+  }
+  m_bCBufferLayout = true;
+}
+
 static D3D_REGISTER_COMPONENT_TYPE CompTypeToRegisterComponentType(CompType CT) {
   switch (CT.GetKind()) {
   case DXIL::ComponentType::F16:
@@ -1785,6 +1913,83 @@ void DxilShaderReflection::CreateReflectionObjectsForSignature(
   }
 }
 
+static D3D_REGISTER_COMPONENT_TYPE
+SigCompTypeToRegisterComponentType(DxilProgramSigCompType CT) {
+  switch (CT) {
+  case DxilProgramSigCompType::Float16:
+  case DxilProgramSigCompType::Float32:
+    return D3D_REGISTER_COMPONENT_FLOAT32;
+  case DxilProgramSigCompType::UInt16:
+  case DxilProgramSigCompType::UInt32:
+    return D3D_REGISTER_COMPONENT_UINT32;
+  case DxilProgramSigCompType::SInt16:
+  case DxilProgramSigCompType::SInt32:
+    return D3D_REGISTER_COMPONENT_SINT32;
+  default:
+    return D3D_REGISTER_COMPONENT_UNKNOWN;
+  }
+}
+
+static D3D_MIN_PRECISION SigCompTypeToMinPrecision(DxilProgramSigCompType CT) {
+  switch (CT) {
+  case DxilProgramSigCompType::Float16:
+    return D3D_MIN_PRECISION_FLOAT_16;
+  case DxilProgramSigCompType::SInt16:
+    return D3D_MIN_PRECISION_SINT_16;
+  case DxilProgramSigCompType::UInt16:
+    return D3D_MIN_PRECISION_UINT_16;
+  default:
+    return D3D_MIN_PRECISION_DEFAULT;
+  }
+}
+
+// PSV signature elements are in the same order as the module signature
+// elements, so this builds the same descriptions as the overload above.
+// Usage is not in the part; every declared component is reported as read
+// for inputs and as written for outputs.
+void DxilShaderReflection::CreateReflectionObjectsForSignature(
+  PSVSignatureElement0 *(DxilPipelineStateValidation::*GetElement)(uint32_t) const,
+  uint32_t Count, bool IsInput, DXIL::TessellatorDomain Domain,
+  std::vector<D3D12_SIGNATURE_PARAMETER_DESC> &Descs) {
+  bool clipDistanceSeen = false;
+  for (uint32_t i = 0; i < Count; ++i) {
+    PSVSignatureElement SigElem = m_PSV.GetSignatureElement((m_PSV.*GetElement)(i));
+    D3D12_SIGNATURE_PARAMETER_DESC Desc;
+
+    Semantic::Kind kind = (Semantic::Kind)SigElem.GetSemanticKind();
+    if (kind >= Semantic::Kind::Invalid)
+      throw hlsl::Exception(E_INVALIDARG);
+    const Semantic *pSemantic = Semantic::Get(kind);
+    if (kind == DXIL::SemanticKind::ClipDistance) {
+      if (clipDistanceSeen) continue;
+      clipDistanceSeen = true;
+    }
+
+    DxilProgramSigCompType compType =
+        (DxilProgramSigCompType)SigElem.GetComponentType();
+    Desc.ComponentType = SigCompTypeToRegisterComponentType(compType);
+    unsigned startCol = SigElem.IsAllocated() ? SigElem.GetStartCol() : 0;
+    Desc.Mask = (uint8_t)((((1 << SigElem.GetCols()) - 1) << startCol) & 0xF);
+    // D3D11_43 does not have MinPrecison.
+    if (m_PublicAPI != PublicAPI::D3D11_43)
+      Desc.MinPrecision = SigCompTypeToMinPrecision(compType);
+    Desc.ReadWriteMask = IsInput ? Desc.Mask : 0;
+    Desc.Register = (UINT)SigElem.GetStartRow();
+    Desc.Stream = SigElem.GetOutputStream();
+    Desc.SystemValueType = SemanticToSystemValueType(pSemantic, Domain);
+    if (pSemantic->IsArbitrary())
+      Desc.SemanticName = SigElem.GetSemanticName();
+    else
+      Desc.SemanticName = CreateUpperCase(pSemantic->GetName());
+
+    const uint32_t *pIndexes = SigElem.GetSemanticIndexes();
+    for (unsigned semIdx = 0; semIdx < SigElem.GetRows(); ++semIdx) {
+      Desc.SemanticIndex = pIndexes[semIdx];
+      Descs.push_back(Desc);
+    }
+  }
+}
+
 LPCSTR DxilShaderReflection::CreateUpperCase(LPCSTR pValue) {
   // Restricted only to [a-z] ASCII.
   LPCSTR pCursor = pValue;
@@ -1825,13 +2030,10 @@ HRESULT DxilModuleReflection::LoadModule(IDxcBlob *pBlob,
     GetDxilProgramBitcode((DxilProgramHeader *)pData, &pBitcode, &bitcodeLength);
     std::unique_ptr<MemoryBuffer> pMemBuffer =
         MemoryBuffer::getMemBufferCopy(StringRef(pBitcode, bitcodeLength));
-#if 0 // We materialize eagerly, because we'll need to walk instructions to look for usage information.
+    // Only globals and metadata are read here; function bodies are
+    // materialized when usage information is first needed.
     ErrorOr<std::unique_ptr<Module>> module =
         getLazyBitcodeModule(std::move(pMemBuffer), Context);
-#else
-    ErrorOr<std::unique_ptr<Module>> module =
-      parseBitcodeFile(pMemBuffer->getMemBufferRef(), Context, nullptr);
-#endif
     if (!module) {
       return E_INVALIDARG;
     }
@@ -1844,26 +2046,135 @@ HRESULT DxilModuleReflection::LoadModule(IDxcBlob *pBlob,
 };
 
 HRESULT DxilShaderReflection::Load(IDxcBlob *pBlob,
-                                   const DxilPartHeader *pPart) {
+                                   const DxilPartHeader *pPart,
+                                   const DxilPartHeader *pLayoutPart) {
+  if (pLayoutPart != nullptr) {
+    try {
+      CreateReflectionObjectsFromLayout(pBlob, pLayoutPart);
+    }
+    CATCH_CPP_RETURN_HRESULT();
+  }
   IFR(LoadModule(pBlob, pPart));
 
   try {
-    // Set cbuf usage.
-    SetCBufferUsage();
-
     // Populate input/output/patch constant signatures.
+    // Usage is marked on first query, see EnsureUsageMarked.
     CreateReflectionObjectsForSignature(m_pDxilModule->GetInputSignature(), m_InputSignature);
     CreateReflectionObjectsForSignature(m_pDxilModule->GetOutputSignature(), m_OutputSignature);
     CreateReflectionObjectsForSignature(m_pDxilModule->GetPatchConstantSignature(), m_PatchConstantSignature);
-    MarkUsedSignatureElements();
     return S_OK;
   }
   CATCH_CPP_RETURN_HRESULT();
 }
 
+HRESULT DxilShaderReflection::LoadFromPSV(IDxcBlob *pBlob,
+                                          const DxilPartHeader *pPSVPart,
+                                          const DxilPartHeader *pProgramPart,
+                                          const DxilPartHeader *pFeatureInfoPart,
+                                          const DxilPartHeader *pLayoutPart) {
+  DXASSERT_NOMSG(pBlob != nullptr);
+  DXASSERT_NOMSG(pPSVPart != nullptr);
+  DXASSERT_NOMSG(pProgramPart != nullptr);
+  if (!m_PSV.InitFromPSV0(GetDxilPartData(pPSVPart), pPSVPart->PartSize))
+    return E_INVALIDARG;
+  // Signatures are only in version 1 and later of the part.
+  if (m_PSV.GetPSVRuntimeInfo1() == nullptr)
+    return Load(pBlob, pProgramPart, pLayoutPart);
+
+  m_pContainer = pBlob;
+  m_pProgramPart = pProgramPart;
+  const DxilProgramHeader *pProgramHeader =
+      reinterpret_cast<const DxilProgramHeader *>(GetDxilPartData(pProgramPart));
+  m_ProgramVersion = pProgramHeader->ProgramVersion;
+  m_ShaderKind = GetVersionShaderType(m_ProgramVersion);
+  if (pFeatureInfoPart != nullptr &&
+      pFeatureInfoPart->PartSize >= sizeof(DxilShaderFeatureInfo)) {
+    m_FeatureInfo = reinterpret_cast<const DxilShaderFeatureInfo *>(
+                        GetDxilPartData(pFeatureInfoPart))->FeatureFlags;
+  }
+
+  DXIL::TessellatorDomain domain = DXIL::TessellatorDomain::Undefined;
+  if (m_ShaderKind == DXIL::ShaderKind::Hull)
+    domain = (DXIL::TessellatorDomain)m_PSV.GetPSVRuntimeInfo0()->HS.TessellatorDomain;
+  else if (m_ShaderKind == DXIL::ShaderKind::Domain)
+    domain = (DXIL::TessellatorDomain)m_PSV.GetPSVRuntimeInfo0()->DS.TessellatorDomain;
+
+  try {
+    if (pLayoutPart != nullptr)
+      CreateReflectionObjectsFromLayout(pBlob, pLayoutPart);
+    CreateReflectionObjectsForSignature(
+        &DxilPipelineStateValidation::GetInputElement0,
+        m_PSV.GetSigInputElements(), true, domain, m_InputSignature);
+    CreateReflectionObjectsForSignature(
+        &DxilPipelineStateValidation::GetOutputElement0,
+        m_PSV.GetSigOutputElements(), false, domain, m_OutputSignature);
+    CreateReflectionObjectsForSignature(
+        &DxilPipelineStateValidation::GetPatchConstantElement0,
+        m_PSV.GetSigPatchConstantElements(),
+        m_ShaderKind == DXIL::ShaderKind::Domain, domain,
+        m_PatchConstantSignature);
+    return S_OK;
+  }
+  CATCH_CPP_RETURN_HRESULT();
+}
+
+// Loads the module of a reflection made from the PSV part, for the queries
+// that need names, cbuffer layouts or other properties not in the parts.
+bool DxilShaderReflection::EnsureModuleLoaded() {
+  if (m_pDxilModule != nullptr)
+    return true;
+  if (m_bModuleLoadTried)
+    return false;
+  m_bModuleLoadTried = true;
+  DxcThreadMalloc TM(m_pMalloc);
+  return SUCCEEDED(LoadModule(m_pContainer, m_pProgramPart));
+}
+
+// Cbuffer variable and signature element usage requires walking function
+// bodies, so it is deferred until a query returns it. Descriptions that
+// only come from metadata never parse the bodies. Signatures reflected from
+// the PSV part are not marked, so their queries never load the module.
+// Cbuffer usage from the constant buffer layout part is already marked.
+HRESULT DxilShaderReflection::EnsureUsageMarked() {
+  if (m_bUsageMarked)
+    return m_hrUsageMarked;
+  m_bUsageMarked = true;
+  if (!EnsureModuleLoaded()) {
+    m_hrUsageMarked = E_INVALIDARG;
+    return m_hrUsageMarked;
+  }
+  DxcThreadMalloc TM(m_pMalloc);
+  HRESULT hr = S_OK;
+  try {
+    // Function bodies that cannot be read leave the usage unknown, so the
+    // queries that return it fail.
+    if (m_pModule->materializeAll()) {
+      hr = E_INVALIDARG;
+    } else {
+      if (!m_bCBufferLayout)
+        SetCBufferUsage();
+      if (!IsPSVReflection())
+        MarkUsedSignatureElements();
+    }
+  }
+  CATCH_CPP_ASSIGN_HRESULT();
+  m_hrUsageMarked = hr;
+  return hr;
+}
+
 _Use_decl_annotations_
 HRESULT DxilShaderReflection::GetDesc(D3D12_SHADER_DESC *pDesc) {
   IFR(ZeroMemoryToOut(pDesc));
+  if (IsPSVReflection()) {
+    // The GS instance count and HS partitioning are not in the PSV part.
+    if (m_ShaderKind != DXIL::ShaderKind::Geometry &&
+        m_ShaderKind != DXIL::ShaderKind::Hull) {
+      GetDescFromPSV(pDesc);
+      return S_OK;
+    }
+    if (!EnsureModuleLoaded())
+      return E_FAIL;
+  }
   const DxilModule &M = *m_pDxilModule;
   const ShaderModel *pSM = M.GetShaderModel();
 
@@ -1925,6 +2236,34 @@ HRESULT DxilShaderReflection::GetDesc(D3D12_SHADER_DESC *pDesc) {
   return S_OK;
 }
 
+void DxilShaderReflection::GetDescFromPSV(D3D12_SHADER_DESC *pDesc) {
+  const PSVRuntimeInfo0 *pInfo = m_PSV.GetPSVRuntimeInfo0();
+  pDesc->Version = m_ProgramVersion;
+
+  // Structured buffers are reflected as constant buffers too.
+  for (uint32_t i = 0; i < m_PSV.GetBindCount(); ++i) {
+    switch ((PSVResourceType)m_PSV.GetPSVResourceBindInfo0(i)->ResType) {
+    case PSVResourceType::CBV:
+    case PSVResourceType::SRVStructured:
+    case PSVResourceType::UAVStructured:
+    case PSVResourceType::UAVStructuredWithCounter:
+      ++pDesc->ConstantBuffers;
+      break;
+    default:
+      break;
+    }
+  }
+  pDesc->BoundResources = m_PSV.GetBindCount();
+  pDesc->InputParameters = m_InputSignature.size();
+  pDesc->OutputParameters = m_OutputSignature.size();
+  pDesc->PatchConstantParameters = m_PatchConstantSignature.size();
+
+  if (m_ShaderKind == DXIL::ShaderKind::Domain) {
+    pDesc->cControlPoints = pInfo->DS.InputControlPointCount;
+    pDesc->TessellatorDomain = (D3D_TESSELLATOR_DOMAIN)pInfo->DS.TessellatorDomain;
+  }
+}
+
 static bool GetUnsignedVal(Value *V, uint32_t *pValue) {
   ConstantInt *CI = dyn_cast<ConstantInt>(V);
   if (!CI) return false;
@@ -1999,6 +2338,8 @@ void DxilShaderReflection::MarkUsedSignatureElements() {
 
 _Use_decl_annotations_
 ID3D12ShaderReflectionConstantBuffer* DxilShaderReflection::GetConstantBufferByIndex(UINT Index) {
+  if (!m_bCBufferLayout && FAILED(EnsureUsageMarked()))
+    return &g_InvalidSRConstantBuffer;
   return DxilModuleReflection::_GetConstantBufferByIndex(Index);
 }
 ID3D12ShaderReflectionConstantBuffer* DxilModuleReflection::_GetConstantBufferByIndex(UINT Index) {
@@ -2010,6 +2351,8 @@ ID3D12ShaderReflectionConstantBuffer* DxilModuleReflection::_GetConstantBufferBy
 
 _Use_decl_annotations_
 ID3D12ShaderReflectionConstantBuffer* DxilShaderReflection::GetConstantBufferByName(LPCSTR Name) {
+  if (!m_bCBufferLayout && FAILED(EnsureUsageMarked()))
+    return &g_InvalidSRConstantBuffer;
   return DxilModuleReflection::_GetConstantBufferByName(Name);
 }
 ID3D12ShaderReflectionConstantBuffer* DxilModuleReflection::_GetConstantBufferByName(LPCSTR Name) {
@@ -2027,6 +2370,7 @@ ID3D12ShaderReflectionConstantBuffer* DxilModuleReflection::_GetConstantBufferBy
 _Use_decl_annotations_
 HRESULT DxilShaderReflection::GetResourceBindingDesc(UINT ResourceIndex,
   _Out_ D3D12_SHADER_INPUT_BIND_DESC *pDesc) {
+  EnsureModuleLoaded();
   return DxilModuleReflection::_GetResourceBindingDesc(ResourceIndex, pDesc, m_PublicAPI);
 }
 HRESULT DxilModuleReflection::_GetResourceBindingDesc(UINT ResourceIndex,
@@ -2047,6 +2391,8 @@ HRESULT DxilShaderReflection::GetInputParameterDesc(UINT ParameterIndex,
   _Out_ D3D12_SIGNATURE_PARAMETER_DESC *pDesc) {
   IFRBOOL(pDesc != nullptr, E_INVALIDARG);
   IFRBOOL(ParameterIndex < m_InputSignature.size(), E_INVALIDARG);
+  if (!IsPSVReflection())
+    IFR(EnsureUsageMarked());
   if (m_PublicAPI != PublicAPI::D3D11_43)
     *pDesc = m_InputSignature[ParameterIndex];
   else
@@ -2062,6 +2408,8 @@ HRESULT DxilShaderReflection::GetOutputParameterDesc(UINT ParameterIndex,
   D3D12_SIGNATURE_PARAMETER_DESC *pDesc) {
   IFRBOOL(pDesc != nullptr, E_INVALIDARG);
   IFRBOOL(ParameterIndex < m_OutputSignature.size(), E_INVALIDARG);
+  if (!IsPSVReflection())
+    IFR(EnsureUsageMarked());
   if (m_PublicAPI != PublicAPI::D3D11_43)
     *pDesc = m_OutputSignature[ParameterIndex];
   else
@@ -2077,6 +2425,8 @@ HRESULT DxilShaderReflection::GetPatchConstantParameterDesc(UINT ParameterIndex,
   D3D12_SIGNATURE_PARAMETER_DESC *pDesc) {
   IFRBOOL(pDesc != nullptr, E_INVALIDARG);
   IFRBOOL(ParameterIndex < m_PatchConstantSignature.size(), E_INVALIDARG);
+  if (!IsPSVReflection())
+    IFR(EnsureUsageMarked());
   if (m_PublicAPI != PublicAPI::D3D11_43)
     *pDesc = m_PatchConstantSignature[ParameterIndex];
   else
@@ -2089,6 +2439,8 @@ HRESULT DxilShaderReflection::GetPatchConstantParameterDesc(UINT ParameterIndex,
 
 _Use_decl_annotations_
 ID3D12ShaderReflectionVariable* DxilShaderReflection::GetVariableByName(LPCSTR Name) {
+  if (!m_bCBufferLayout && FAILED(EnsureUsageMarked()))
+    return &g_InvalidSRVariable;
   return DxilModuleReflection::_GetVariableByName(Name);
 }
 ID3D12ShaderReflectionVariable* DxilModuleReflection::_GetVariableByName(LPCSTR Name) {
@@ -2108,6 +2460,7 @@ ID3D12ShaderReflectionVariable* DxilModuleReflection::_GetVariableByName(LPCSTR
 _Use_decl_annotations_
 HRESULT DxilShaderReflection::GetResourceBindingDescByName(LPCSTR Name,
   D3D12_SHADER_INPUT_BIND_DESC *pDesc) {
+  EnsureModuleLoaded();
   return DxilModuleReflection::_GetResourceBindingDescByName(Name, pDesc, m_PublicAPI);
 }
 HRESULT DxilModuleReflection::_GetResourceBindingDescByName(LPCSTR Name,
@@ -2135,6 +2488,11 @@ UINT DxilShaderReflection::GetConversionInstructionCount() { return 0; }
 UINT DxilShaderReflection::GetBitwiseInstructionCount() { return 0; }
 
 D3D_PRIMITIVE DxilShaderReflection::GetGSInputPrimitive() {
+  if (IsPSVReflection()) {
+    if (m_ShaderKind != DXIL::ShaderKind::Geometry)
+      return D3D_PRIMITIVE::D3D10_PRIMITIVE_UNDEFINED;
+    return (D3D_PRIMITIVE)m_PSV.GetPSVRuntimeInfo0()->GS.InputPrimitive;
+  }
   if (!m_pDxilModule->GetShaderModel()->IsGS())
     return D3D_PRIMITIVE::D3D10_PRIMITIVE_UNDEFINED;
   return (D3D_PRIMITIVE)m_pDxilModule->GetInputPrimitive();
@@ -2155,7 +2513,11 @@ HRESULT DxilShaderReflection::GetMinFeatureLevel(enum D3D_FEATURE_LEVEL* pLevel)
 
 _Use_decl_annotations_
 UINT DxilShaderReflection::GetThreadGroupSize(UINT *pSizeX, UINT *pSizeY, UINT *pSizeZ) {
-  if (!m_pDxilModule->GetShaderModel()->IsCS()) {
+  // The thread group size is not in the PSV part; only compute shaders
+  // reflected from it load the module.
+  bool isCS = IsPSVReflection() ? m_ShaderKind == DXIL::ShaderKind::Compute
+                                : m_pDxilModule->GetShaderModel()->IsCS();
+  if (!isCS || !EnsureModuleLoaded()) {
     AssignToOutOpt((UINT)0, pSizeX);
     AssignToOutOpt((UINT)0, pSizeY);
     AssignToOutOpt((UINT)0, pSizeZ);
@@ -2172,7 +2534,9 @@ UINT DxilShaderReflection::GetThreadGroupSize(UINT *pSizeX, UINT *pSizeY, UINT *
 
 UINT64 DxilShaderReflection::GetRequiresFlags() {
   UINT64 result = 0;
-  uint64_t features = m_pDxilModule->m_ShaderFlags.GetFeatureInfo();
+  uint64_t features = IsPSVReflection()
+                         ? m_FeatureInfo
+                         : m_pDxilModule->m_ShaderFlags.GetFeatureInfo();
   if (features & ShaderFeatureInfo_Doubles) result |= D3D_SHADER_REQUIRES_DOUBLES;
   if (features & ShaderFeatureInfo_UAVsAtEveryStage) result |= D3D_SHADER_REQUIRES_UAVS_AT_EVERY_STAGE;
   if (features & ShaderFeatureInfo_64UAVs) result |= D3D_SHADER_REQUIRES_64_UAVS;
@@ -2413,7 +2777,7 @@ static void CollectCBufUsageForLib(Value *V, std::vector<unsigned> &cbufUsage) {
     Value *V = user;
     if (auto *CI = dyn_cast<CallInst>(V)) {
       if (hlsl::OP::IsDxilOpFuncCallInst(CI, hlsl::OP::OpCode::CreateHandleForLib)) {
-        CollectCBufUsage(CI, cbufUsage);
+        dxilutil::CollectCBufferUsage(CI, cbufUsage);
       }
     } else if (isa<GEPOperator>(V) ||
                isa<LoadInst>(V)) {
@@ -2440,6 +2804,8 @@ HRESULT DxilLibraryReflection::Load(IDxcBlob *pBlob,
   IFR(LoadModule(pBlob, pPart));
 
   try {
+    // Resource dependencies are found per function, so bodies are needed.
+    IFTBOOL(!m_pModule->materializeAll(), E_INVALIDARG);
     AddResourceDependencies();
     SetCBufferUsage();
     return S_OK;
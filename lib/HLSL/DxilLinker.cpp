@@ -28,6 +28,7 @@
 #include "llvm/ADT/SetVector.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/Support/raw_ostream.h"
+#include <chrono>
 #include <memory>
 #include <vector>
 
@@ -71,6 +72,12 @@ void AddResourceMap(
   }
 }
 
+uint64_t MicrosecondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
 void CloneFunction(Function *F, Function *NewF, ValueToValueMapTy &vmap,
                    hlsl::DxilTypeSystem *TypeSys = nullptr,
                    hlsl::DxilTypeSystem *SrcTypeSys = nullptr) {
@@ -100,7 +107,11 @@ namespace {
 
 struct DxilFunctionLinkInfo {
   DxilFunctionLinkInfo(llvm::Function *F);
+  // Null until the module of a library registered from its index is loaded.
   llvm::Function *func;
+  // Set once func is materialized and usedFunctions is collected. Library
+  // modules are not changed by links, so this stays valid for later links.
+  bool loaded;
   std::unordered_set<llvm::Function *> usedFunctions;
   std::unordered_set<llvm::GlobalVariable *> usedGVs;
   std::unordered_set<DxilResourceBase *> usedResources;
@@ -111,7 +122,11 @@ class DxilLib {
 
 public:
   DxilLib(std::unique_ptr<llvm::Module> pModule);
+  DxilLib(StringRef name, const DxilPartHeader *pIndexPart,
+          DxilLinker::ModuleLoader loadModule);
   virtual ~DxilLib() {}
+  // Loads the module of a library registered from its index.
+  bool EnsureLoaded();
   bool HasFunction(std::string &name);
   llvm::StringMap<std::unique_ptr<DxilFunctionLinkInfo>> &GetFunctionTable() {
     return m_functionNameMap;
@@ -120,21 +135,28 @@ public:
   bool IsResourceGlobal(const llvm::Constant *GV);
   DxilResourceBase *GetResource(const llvm::Constant *GV);
 
-  DxilModule &GetDxilModule() { return m_DM; }
-  void LazyLoadFunction(Function *F);
-  void BuildGlobalUsage();
+  DxilModule &GetDxilModule() { return *m_pDM; }
+  bool LazyLoadFunction(Function *F);
+  unsigned BuildGlobalUsage();
   void CollectUsedInitFunctions(StringSet<> &addedFunctionSet,
                                 SmallVector<StringRef, 4> &workList);
 
 private:
+  bool InitModule();
+
   std::unique_ptr<llvm::Module> m_pModule;
-  DxilModule &m_DM;
+  DxilModule *m_pDM;
+  // Name and loader of a library registered from its index.
+  std::string m_name;
+  DxilLinker::ModuleLoader m_loadModule;
   // Map from name to Link info for extern functions.
   llvm::StringMap<std::unique_ptr<DxilFunctionLinkInfo>> m_functionNameMap;
   // Map from resource link global to resource.
   std::unordered_map<const llvm::Constant *, DxilResourceBase *> m_resourceMap;
   // Set of initialize functions for global variable.
   std::unordered_set<llvm::Function *> m_initFuncSet;
+  // Global usage is up to date with the loaded functions.
+  bool m_bGlobalUsageBuilt;
 };
 
 struct DxilLinkJob;
@@ -146,6 +168,8 @@ public:
   bool HasLibNameRegistered(StringRef name) override;
   bool RegisterLib(StringRef name, std::unique_ptr<llvm::Module> pModule,
                    std::unique_ptr<llvm::Module> pDebugModule) override;
+  bool RegisterLib(StringRef name, const DxilPartHeader *pIndexPart,
+                   ModuleLoader loadModule) override;
   bool AttachLib(StringRef name) override;
   bool DetachLib(StringRef name) override;
   void DetachAll() override;
@@ -155,6 +179,7 @@ public:
 
 private:
   bool AttachLib(DxilLib *lib);
+  bool LoadLib(DxilLib *lib);
   bool DetachLib(DxilLib *lib);
   bool AddFunctions(SmallVector<StringRef, 4> &workList,
                     DenseSet<DxilLib *> &libSet, StringSet<> &addedFunctionSet,
@@ -174,9 +199,8 @@ private:
 //
 // DxilFunctionLinkInfo methods.
 //
-DxilFunctionLinkInfo::DxilFunctionLinkInfo(Function *F) : func(F) {
-  DXASSERT_NOMSG(F);
-}
+DxilFunctionLinkInfo::DxilFunctionLinkInfo(Function *F)
+    : func(F), loaded(false) {}
 
 //------------------------------------------------------------------------------
 //
@@ -184,9 +208,55 @@ DxilFunctionLinkInfo::DxilFunctionLinkInfo(Function *F) : func(F) {
 //
 
 DxilLib::DxilLib(std::unique_ptr<llvm::Module> pModule)
-    : m_pModule(std::move(pModule)), m_DM(m_pModule->GetOrCreateDxilModule()) {
+    : m_pModule(std::move(pModule)), m_pDM(nullptr),
+      m_bGlobalUsageBuilt(false) {
+  InitModule();
+}
+
+DxilLib::DxilLib(StringRef name, const DxilPartHeader *pIndexPart,
+                 DxilLinker::ModuleLoader loadModule)
+    : m_pDM(nullptr), m_name(name), m_loadModule(std::move(loadModule)),
+      m_bGlobalUsageBuilt(false) {
+  // Collect function defines from the index, named as InitModule names them.
+  const char *pData = GetDxilPartData(pIndexPart);
+  uint32_t functionCount;
+  const DxilLibraryIndexFunction *pFunctions =
+      GetDxilLibraryIndexFunctions(pIndexPart, &functionCount);
+  for (uint32_t i = 0; i < functionCount; ++i) {
+    StringRef funcName(pData + pFunctions[i].NameOffset);
+    if (pFunctions[i].Flags &
+        (uint32_t)DxilLibraryIndexFunctionFlags::Internal)
+      m_functionNameMap[m_name + funcName.str()] =
+          llvm::make_unique<DxilFunctionLinkInfo>(nullptr);
+    else
+      m_functionNameMap[funcName] =
+          llvm::make_unique<DxilFunctionLinkInfo>(nullptr);
+  }
+}
+
+bool DxilLib::EnsureLoaded() {
+  // A module that does not match the index is kept, so it is not reloaded.
+  if (m_pModule)
+    return m_pDM != nullptr;
+  m_pModule = m_loadModule();
+  if (!m_pModule)
+    return false;
+  m_pModule->setModuleIdentifier(m_name);
+  if (!InitModule()) {
+    m_pDM = nullptr;
+    return false;
+  }
+  return true;
+}
+
+// Returns false if the module does not define the functions of the index
+// the library was registered from.
+bool DxilLib::InitModule() {
   Module &M = *m_pModule;
+  m_pDM = &M.GetOrCreateDxilModule();
   const std::string &MID = M.getModuleIdentifier();
+  const bool bFromIndex = !m_functionNameMap.empty();
+  unsigned definedCount = 0;
 
   // Collect function defines.
   for (Function &F : M.functions()) {
@@ -196,9 +266,19 @@ DxilLib::DxilLib(std::unique_ptr<llvm::Module> pModule)
       // Add prefix to internal function.
       F.setName(MID + F.getName());
     }
+    definedCount++;
+    if (bFromIndex) {
+      auto it = m_functionNameMap.find(F.getName());
+      if (it == m_functionNameMap.end())
+        return false;
+      it->second->func = &F;
+      continue;
+    }
     m_functionNameMap[F.getName()] =
         llvm::make_unique<DxilFunctionLinkInfo>(&F);
   }
+  if (definedCount != m_functionNameMap.size())
+    return false;
 
   // Update internal global name.
   for (GlobalVariable &GV : M.globals()) {
@@ -207,11 +287,15 @@ DxilLib::DxilLib(std::unique_ptr<llvm::Module> pModule)
       GV.setName(MID + GV.getName());
     }
   }
+  return true;
 }
 
-void DxilLib::LazyLoadFunction(Function *F) {
+// Returns false when F was already loaded by an earlier call.
+bool DxilLib::LazyLoadFunction(Function *F) {
   DXASSERT(m_functionNameMap.count(F->getName()), "else invalid Function");
   DxilFunctionLinkInfo *linkInfo = m_functionNameMap[F->getName()].get();
+  if (linkInfo->loaded)
+    return false;
   std::error_code EC = F->materialize();
   DXASSERT_LOCALVAR(EC, !EC, "else fail to materialize");
 
@@ -224,19 +308,26 @@ void DxilLib::LazyLoadFunction(Function *F) {
     }
   }
 
-  if (m_DM.HasDxilFunctionProps(F)) {
-    DxilFunctionProps &props = m_DM.GetDxilFunctionProps(F);
+  if (m_pDM->HasDxilFunctionProps(F)) {
+    DxilFunctionProps &props = m_pDM->GetDxilFunctionProps(F);
     if (props.IsHS()) {
       // Add patch constant function to usedFunctions of entry.
       Function *patchConstantFunc = props.ShaderProps.HS.patchConstantFunc;
       linkInfo->usedFunctions.insert(patchConstantFunc);
     }
   }
+  linkInfo->loaded = true;
   // Used globals will be build before link.
+  m_bGlobalUsageBuilt = false;
+  return true;
 }
 
-void DxilLib::BuildGlobalUsage() {
+// Returns the number of init functions loaded.
+unsigned DxilLib::BuildGlobalUsage() {
+  if (m_bGlobalUsageBuilt)
+    return 0;
   Module &M = *m_pModule;
+  unsigned loadCount = 0;
 
   // Collect init functions for static globals.
   if (GlobalVariable *Ctors = M.getGlobalVariable("llvm.global_ctors")) {
@@ -257,7 +348,7 @@ void DxilLib::BuildGlobalUsage() {
                "function type must be void (void)");
         // Add Ctor.
         m_initFuncSet.insert(Ctor);
-        LazyLoadFunction(Ctor);
+        loadCount += LazyLoadFunction(Ctor);
       }
     }
   }
@@ -274,12 +365,14 @@ void DxilLib::BuildGlobalUsage() {
   }
 
   // Build resource map.
-  AddResourceMap(m_DM.GetUAVs(), DXIL::ResourceClass::UAV, m_resourceMap, m_DM);
-  AddResourceMap(m_DM.GetSRVs(), DXIL::ResourceClass::SRV, m_resourceMap, m_DM);
-  AddResourceMap(m_DM.GetCBuffers(), DXIL::ResourceClass::CBuffer,
-                 m_resourceMap, m_DM);
-  AddResourceMap(m_DM.GetSamplers(), DXIL::ResourceClass::Sampler,
-                 m_resourceMap, m_DM);
+  AddResourceMap(m_pDM->GetUAVs(), DXIL::ResourceClass::UAV, m_resourceMap, *m_pDM);
+  AddResourceMap(m_pDM->GetSRVs(), DXIL::ResourceClass::SRV, m_resourceMap, *m_pDM);
+  AddResourceMap(m_pDM->GetCBuffers(), DXIL::ResourceClass::CBuffer,
+                 m_resourceMap, *m_pDM);
+  AddResourceMap(m_pDM->GetSamplers(), DXIL::ResourceClass::Sampler,
+                 m_resourceMap, *m_pDM);
+  m_bGlobalUsageBuilt = true;
+  return loadCount;
 }
 
 void DxilLib::CollectUsedInitFunctions(StringSet<> &addedFunctionSet,
@@ -331,9 +424,9 @@ namespace {
 // Create module from link defines.
 struct DxilLinkJob {
   DxilLinkJob(LLVMContext &Ctx, dxilutil::ExportMap &exportMap,
-              unsigned valMajor, unsigned valMinor)
+              unsigned valMajor, unsigned valMinor, DxilLinkStats &stats)
       : m_ctx(Ctx), m_exportMap(exportMap), m_valMajor(valMajor),
-        m_valMinor(valMinor) {}
+        m_valMinor(valMinor), m_stats(stats) {}
   std::unique_ptr<llvm::Module>
   Link(std::pair<DxilFunctionLinkInfo *, DxilLib *> &entryLinkPair,
        const ShaderModel *pSM);
@@ -364,6 +457,7 @@ private:
   LLVMContext &m_ctx;
   dxilutil::ExportMap &m_exportMap;
   unsigned m_valMajor, m_valMinor;
+  DxilLinkStats &m_stats;
 };
 } // namespace
 
@@ -383,6 +477,7 @@ const char kInvalidValidatorVersion[] = "Validator version does not support targ
 const char kExportNameCollision[] = "Export name collides with another export: ";
 const char kExportFunctionMissing[] = "Could not find target for export: ";
 const char kNoFunctionsToExport[] = "Library has no functions to export";
+const char kLoadLibFailed[] = "Cannot load module of library ";
 } // namespace
 //------------------------------------------------------------------------------
 //
@@ -638,6 +733,7 @@ bool DxilLinkJob::AddGlobals(DxilModule &DM, ValueToValueMapTy &vmap) {
 }
 
 void DxilLinkJob::CloneFunctions(ValueToValueMapTy &vmap) {
+  auto start = std::chrono::steady_clock::now();
   for (auto &it : m_functionDefs) {
     DxilFunctionLinkInfo *linkInfo = it.first;
 
@@ -656,6 +752,8 @@ void DxilLinkJob::CloneFunctions(ValueToValueMapTy &vmap) {
 
     CloneFunction(F, NewF, vmap);
   }
+  m_stats.FunctionsCloned += m_functionDefs.size();
+  m_stats.CloneMicroseconds += MicrosecondsSince(start);
 }
 
 void DxilLinkJob::AddFunctions(DxilModule &DM, ValueToValueMapTy &vmap,
@@ -1019,6 +1117,7 @@ void DxilLinkJob::StripDeadDebugInfo(Module &M) {
 }
 
 void DxilLinkJob::RunPreparePass(Module &M) {
+  auto start = std::chrono::steady_clock::now();
   StripDeadDebugInfo(M);
   legacy::PassManager PM;
   PM.add(createAlwaysInlinerPass(/*InsertLifeTime*/ false));
@@ -1057,6 +1156,7 @@ void DxilLinkJob::RunPreparePass(Module &M) {
   PM.add(createDxilEmitMetadataPass());
 
   PM.run(M);
+  m_stats.PrepareMicroseconds += MicrosecondsSince(start);
 }
 
 //------------------------------------------------------------------------------
@@ -1087,6 +1187,17 @@ bool DxilLinkerImpl::RegisterLib(StringRef name,
   return true;
 }
 
+bool DxilLinkerImpl::RegisterLib(StringRef name,
+                                 const DxilPartHeader *pIndexPart,
+                                 ModuleLoader loadModule) {
+  if (m_LibMap.count(name))
+    return false;
+
+  m_LibMap[name] =
+      llvm::make_unique<DxilLib>(name, pIndexPart, std::move(loadModule));
+  return true;
+}
+
 bool DxilLinkerImpl::AttachLib(StringRef name) {
   auto iter = m_LibMap.find(name);
   if (iter == m_LibMap.end()) {
@@ -1171,6 +1282,16 @@ bool DxilLinkerImpl::DetachLib(DxilLib *lib) {
   return true;
 }
 
+bool DxilLinkerImpl::LoadLib(DxilLib *lib) {
+  if (lib->EnsureLoaded())
+    return true;
+  for (auto &it : m_LibMap) {
+    if (it.second.get() == lib)
+      m_ctx.emitError(Twine(kLoadLibFailed) + it.getKey());
+  }
+  return false;
+}
+
 bool DxilLinkerImpl::AddFunctions(SmallVector<StringRef, 4> &workList,
                                   DenseSet<DxilLib *> &libSet,
                                   StringSet<> &addedFunctionSet,
@@ -1189,13 +1310,18 @@ bool DxilLinkerImpl::AddFunctions(SmallVector<StringRef, 4> &workList,
 
     std::pair<DxilFunctionLinkInfo *, DxilLib *> &linkPair =
         m_functionNameMap[name];
+    DxilLib *pLib = linkPair.second;
+    if (!LoadLib(pLib))
+      return false;
     linkJob.AddFunction(linkPair);
 
-    DxilLib *pLib = linkPair.second;
     libSet.insert(pLib);
     if (!bLazyLoadDone) {
       Function *F = linkPair.first->func;
-      pLib->LazyLoadFunction(F);
+      if (pLib->LazyLoadFunction(F))
+        m_stats.FunctionsLoaded++;
+      else
+        m_stats.FunctionsReused++;
     }
     for (Function *F : linkPair.first->usedFunctions) {
       if (hlsl::OP::IsDxilOpFunc(F) || F->isIntrinsic()) {
@@ -1243,7 +1369,9 @@ DxilLinkerImpl::Link(StringRef entry, StringRef profile, dxilutil::ExportMap &ex
     return nullptr;
   }
 
-  DxilLinkJob linkJob(m_ctx, exportMap, m_valMajor, m_valMinor);
+  m_stats = DxilLinkStats();
+  auto loadStart = std::chrono::steady_clock::now();
+  DxilLinkJob linkJob(m_ctx, exportMap, m_valMajor, m_valMinor, m_stats);
 
   DenseSet<DxilLib *> libSet;
   StringSet<> addedFunctionSet;
@@ -1266,9 +1394,14 @@ DxilLinkerImpl::Link(StringRef entry, StringRef profile, dxilutil::ExportMap &ex
         std::pair<DxilFunctionLinkInfo *, DxilLib *> &linkPair = it.second;
         DxilFunctionLinkInfo *linkInfo = linkPair.first;
         DxilLib *pLib = linkPair.second;
+        if (!LoadLib(pLib))
+          return nullptr;
 
         Function *F = linkInfo->func;
-        pLib->LazyLoadFunction(F);
+        if (pLib->LazyLoadFunction(F))
+          m_stats.FunctionsLoaded++;
+        else
+          m_stats.FunctionsReused++;
 
         linkJob.AddFunction(linkPair);
 
@@ -1309,7 +1442,7 @@ DxilLinkerImpl::Link(StringRef entry, StringRef profile, dxilutil::ExportMap &ex
 
   // Save global users.
   for (auto &pLib : libSet) {
-    pLib->BuildGlobalUsage();
+    m_stats.FunctionsLoaded += pLib->BuildGlobalUsage();
   }
 
   SmallVector<StringRef, 4> workList;
@@ -1326,6 +1459,7 @@ DxilLinkerImpl::Link(StringRef entry, StringRef profile, dxilutil::ExportMap &ex
                     /*bLazyLoadDone*/ true,
                     /*bAllowFuncionDecls*/ false))
     return nullptr;
+  m_stats.LoadMicroseconds = MicrosecondsSince(loadStart);
 
   if (!bIsLib) {
     std::pair<DxilFunctionLinkInfo *, DxilLib *> &entryLinkPair =
@@ -12,6 +12,7 @@
 #include "dxc/Support/Global.h"
 #include "dxc/Support/WinIncludes.h"
 #include "dxc/Support/FileIOHelper.h"
+#include "dxc/Support/dxcthreadpool.h"
 
 #include "dxc/HLSL/DxilValidation.h"
 #include "dxc/DxilContainer/DxilContainerAssembler.h"
@@ -39,7 +40,10 @@
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/DiagnosticInfo.h"
 #include "llvm/IR/DiagnosticPrinter.h"
+#include "llvm/IR/DebugInfoMetadata.h"
+#include "llvm/IR/TypeFinder.h"
 #include "llvm/ADT/BitVector.h"
+#include "llvm/Support/MD5.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Bitcode/ReaderWriter.h"
@@ -371,6 +375,19 @@ struct EntryStatus {
     patchConstCols.resize(
         entryProps.sig.PatchConstantSignature.GetElements().size(), 0);
   }
+  bool operator==(const EntryStatus &Other) const {
+    return std::equal(hasOutputPosition,
+                      hasOutputPosition + DXIL::kNumOutputStreams,
+                      Other.hasOutputPosition) &&
+           std::equal(OutputPositionMask,
+                      OutputPositionMask + DXIL::kNumOutputStreams,
+                      Other.OutputPositionMask) &&
+           outputCols == Other.outputCols &&
+           patchConstCols == Other.patchConstCols &&
+           m_bCoverageIn == Other.m_bCoverageIn &&
+           m_bInnerCoverageIn == Other.m_bInnerCoverageIn &&
+           hasViewID == Other.hasViewID && domainLocSize == Other.domainLocSize;
+  }
 };
 
 struct ValidationContext {
@@ -382,6 +399,8 @@ struct ValidationContext {
   DiagnosticPrinterRawOStream &DiagPrinter;
   DebugLoc LastDebugLocEmit;
   ValidationRule LastRuleEmit;
+  DebugLoc FirstDebugLocEmit;
+  ValidationRule FirstRuleEmit;
   std::unordered_set<Function *> entryFuncCallSet;
   std::unordered_set<Function *> patchConstFuncCallSet;
   std::unordered_map<unsigned, bool> UavCounterIncMap;
@@ -389,6 +408,12 @@ struct ValidationContext {
   std::unordered_map<Value *, DxilResourceBase *> ResMap;
   std::unordered_map<Function *, std::vector<Function*>> PatchConstantFuncMap;
   std::unordered_map<Function *, std::unique_ptr<EntryStatus>> entryStatusMap;
+  // Set on a context that validates function bodies on a worker thread. The
+  // resource and entry maps are read from the parent, and entry statuses are
+  // updated in copies, with the parent's status kept in entryStatusSnapshots.
+  const ValidationContext *pParent = nullptr;
+  std::unordered_map<Function *, std::unique_ptr<EntryStatus>> entryStatusSnapshots;
+  bool UavCounterIncMapUsed = false;
   bool isLibProfile;
   const unsigned kDxilControlFlowHintMDKind;
   const unsigned kDxilPreciseMDKind;
@@ -401,7 +426,7 @@ struct ValidationContext {
                     DiagnosticPrinterRawOStream &DiagPrn)
       : M(llvmModule), pDebugModule(DebugModule), DxilMod(dxilModule),
         DL(llvmModule.getDataLayout()), DiagPrinter(DiagPrn),
-        LastRuleEmit((ValidationRule)-1),
+        LastRuleEmit((ValidationRule)-1), FirstRuleEmit((ValidationRule)-1),
         kDxilControlFlowHintMDKind(llvmModule.getContext().getMDKindID(
             DxilMDHelper::kDxilControlFlowHintMDName)),
         kDxilPreciseMDKind(llvmModule.getContext().getMDKindID(
@@ -446,6 +471,22 @@ struct ValidationContext {
     }
   }
 
+  // Creates a context for validating function bodies on a worker thread. It
+  // reads the resource and entry maps of Parent, which must not change until
+  // the worker is done, and starts from a copy of its UAV counter uses.
+  ValidationContext(const ValidationContext &Parent,
+                    DiagnosticPrinterRawOStream &DiagPrn)
+      : M(Parent.M), pDebugModule(Parent.pDebugModule),
+        DxilMod(Parent.DxilMod), DL(Parent.DL), DiagPrinter(DiagPrn),
+        LastRuleEmit((ValidationRule)-1), FirstRuleEmit((ValidationRule)-1),
+        UavCounterIncMap(Parent.UavCounterIncMap), pParent(&Parent),
+        isLibProfile(Parent.isLibProfile),
+        kDxilControlFlowHintMDKind(Parent.kDxilControlFlowHintMDKind),
+        kDxilPreciseMDKind(Parent.kDxilPreciseMDKind),
+        kDxilNonUniformMDKind(Parent.kDxilNonUniformMDKind),
+        kLLVMLoopMDKind(Parent.kLLVMLoopMDKind),
+        m_DxilMajor(Parent.m_DxilMajor), m_DxilMinor(Parent.m_DxilMinor) {}
+
   void PropagateResMap(Value *V, DxilResourceBase *Res) {
     auto it = ResMap.find(V);
     if (it != ResMap.end()) {
@@ -580,10 +621,37 @@ struct ValidationContext {
   }
 
   bool HasEntryStatus(Function *F) {
-    return entryStatusMap.find(F) != entryStatusMap.end();
+    const auto &Map = pParent ? pParent->entryStatusMap : entryStatusMap;
+    return Map.find(F) != Map.end();
+  }
+
+  EntryStatus &GetEntryStatus(Function *F) {
+    std::unique_ptr<EntryStatus> &Status = entryStatusMap[F];
+    if (!Status && pParent) {
+      const EntryStatus &ParentStatus = *pParent->entryStatusMap.at(F);
+      Status = llvm::make_unique<EntryStatus>(ParentStatus);
+      entryStatusSnapshots[F] = llvm::make_unique<EntryStatus>(ParentStatus);
+    }
+    return *Status;
   }
 
-  EntryStatus &GetEntryStatus(Function *F) { return *entryStatusMap[F]; }
+  // Returns the hull shaders that use F as their patch constant function, or
+  // null if there are none.
+  const std::vector<Function *> *GetPatchConstantHullShaders(Function *F) const {
+    const auto &Map = pParent ? pParent->PatchConstantFuncMap : PatchConstantFuncMap;
+    auto it = Map.find(F);
+    return it != Map.end() ? &it->second : nullptr;
+  }
+
+  std::unordered_map<unsigned, bool> &GetUavCounterIncMap() {
+    UavCounterIncMapUsed = true;
+    return UavCounterIncMap;
+  }
+
+  bool IsCalledFromEntry(Function *F) const {
+    const auto &Set = pParent ? pParent->entryFuncCallSet : entryFuncCallSet;
+    return Set.count(F) > 0;
+  }
 
   DxilResourceBase *GetResourceFromVal(Value *resVal);
 
@@ -699,6 +767,10 @@ struct ValidationContext {
       if (Rule == LastRuleEmit && L == LastDebugLocEmit) {
         return false;
       }
+      if (FirstRuleEmit == (ValidationRule)-1) {
+        FirstRuleEmit = Rule;
+        FirstDebugLocEmit = L;
+      }
       LastRuleEmit = Rule;
       LastDebugLocEmit = L;
 
@@ -1020,8 +1092,9 @@ DxilFieldAnnotation *GetFieldAnnotation(Type *Ty,
 
 
 DxilResourceBase *ValidationContext::GetResourceFromVal(Value *resVal) {
-  auto it = ResMap.find(resVal);
-  if (it != ResMap.end())
+  const auto &Map = pParent ? pParent->ResMap : ResMap;
+  auto it = Map.find(resVal);
+  if (it != Map.end())
     return it->second;
   else
     return nullptr;
@@ -1383,15 +1456,16 @@ static void ValidateSignatureDxilOp(CallInst *CI, DXIL::OpCode opcode,
   DxilModule &DM = ValCtx.DxilMod;
   bool bIsPatchConstantFunc = false;
   if (!DM.HasDxilEntryProps(F)) {
-    auto it = ValCtx.PatchConstantFuncMap.find(F);
-    if (it == ValCtx.PatchConstantFuncMap.end()) {
+    const std::vector<Function *> *pHullShaders =
+        ValCtx.GetPatchConstantHullShaders(F);
+    if (pHullShaders == nullptr) {
       // Missing entry props.
       ValCtx.EmitInstrError(CI,
                             ValidationRule::InstrSignatureOperationNotInEntry);
       return;
     }
     // Use hull entry instead of patch constant function.
-    F = it->second.front();
+    F = pHullShaders->front();
     bIsPatchConstantFunc = true;
   }
   if (!ValCtx.HasEntryStatus(F)) {
@@ -1483,7 +1557,7 @@ static void ValidateSignatureDxilOp(CallInst *CI, DXIL::OpCode opcode,
   case DXIL::OpCode::LoadOutputControlPoint: {
     // Only used in patch constant function.
     Function *func = CI->getParent()->getParent();
-    if (ValCtx.entryFuncCallSet.count(func) > 0) {
+    if (ValCtx.IsCalledFromEntry(func)) {
       ValCtx.EmitFormatError(
           ValidationRule::SmOpcodeInInvalidFunction,
           {"LoadOutputControlPoint", "PatchConstant function"});
@@ -1502,8 +1576,7 @@ static void ValidateSignatureDxilOp(CallInst *CI, DXIL::OpCode opcode,
       ValCtx.EmitFormatError(ValidationRule::SmOpcodeInInvalidFunction,
                              {"StorePatchConstant", "PatchConstant function"});
     } else {
-      auto &hullShaders = ValCtx.PatchConstantFuncMap[func];
-      for (Function *F : hullShaders) {
+      for (Function *F : *ValCtx.GetPatchConstantHullShaders(func)) {
         EntryStatus &Status = ValCtx.GetEntryStatus(F);
         DxilEntryProps &EntryProps = DM.GetDxilEntryProps(F);
         DxilEntrySignature &S = EntryProps.sig;
@@ -2328,12 +2401,13 @@ static void ValidateDxilOperationCallInProfile(CallInst *CI,
       bool isInc = cInc->getLimitedValue() == 1;
       if (!ValCtx.isLibProfile) {
         unsigned resIndex = res->GetLowerBound();
-        if (ValCtx.UavCounterIncMap.count(resIndex)) {
-          if (isInc != ValCtx.UavCounterIncMap[resIndex]) {
+        auto &UavCounterIncMap = ValCtx.GetUavCounterIncMap();
+        if (UavCounterIncMap.count(resIndex)) {
+          if (isInc != UavCounterIncMap[resIndex]) {
             ValCtx.EmitInstrError(CI, ValidationRule::InstrOnlyOneAllocConsume);
           }
         } else {
-          ValCtx.UavCounterIncMap[resIndex] = isInc;
+          UavCounterIncMap[resIndex] = isInc;
         }
       } else {
         // TODO: validate ValidationRule::InstrOnlyOneAllocConsume for lib
@@ -5118,8 +5192,550 @@ void GetValidationVersion(_Out_ unsigned *pMajor, _Out_ unsigned *pMinor) {
   *pMinor = 5;
 }
 
+// Bump when the fingerprint inputs or their encoding change.
+static const uint32_t kValidationFingerprintVersion = 1;
+static const uint32_t kValidationFingerprintMagic = 0x46565844; // 'DXVF'
+
+namespace {
+// Hashes IR by content. Values local to a function are identified by
+// position and metadata by structure, so the hash of an unchanged function
+// does not depend on how the rest of the module is numbered.
+class ValidationFingerprinter {
+public:
+  explicit ValidationFingerprinter(LLVMContext &Ctx) {
+    Ctx.getMDKindNames(m_MDKindNames);
+  }
+
+  void AddInt(uint64_t Value) {
+    uint8_t Bytes[sizeof(Value)];
+    for (unsigned i = 0; i < sizeof(Value); ++i)
+      Bytes[i] = (uint8_t)(Value >> (i * 8));
+    m_Hasher.update(ArrayRef<uint8_t>(Bytes));
+  }
+
+  void AddString(StringRef Value) {
+    AddInt(Value.size());
+    m_Hasher.update(Value);
+  }
+
+  void AddAPInt(const APInt &Value) {
+    AddInt(Value.getBitWidth());
+    for (unsigned i = 0; i < Value.getNumWords(); ++i)
+      AddInt(Value.getRawData()[i]);
+  }
+
+  void AddDigest(const DxilValidationFingerprints::Digest &D) {
+    m_Hasher.update(ArrayRef<uint8_t>(D.data(), D.size()));
+  }
+
+  void AddType(Type *Ty) {
+    AddInt(Ty->getTypeID());
+    switch (Ty->getTypeID()) {
+    case Type::IntegerTyID:
+      AddInt(Ty->getIntegerBitWidth());
+      break;
+    case Type::PointerTyID:
+      AddInt(Ty->getPointerAddressSpace());
+      AddType(Ty->getPointerElementType());
+      break;
+    case Type::ArrayTyID:
+      AddInt(Ty->getArrayNumElements());
+      AddType(Ty->getArrayElementType());
+      break;
+    case Type::VectorTyID:
+      AddInt(Ty->getVectorNumElements());
+      AddType(Ty->getVectorElementType());
+      break;
+    case Type::StructTyID: {
+      StructType *ST = cast<StructType>(Ty);
+      AddString(ST->hasName() ? ST->getName() : StringRef());
+      auto Inserted = m_TypeIds.insert(std::make_pair(Ty, (unsigned)m_TypeIds.size()));
+      if (!Inserted.second) {
+        AddInt(Inserted.first->second);
+        break;
+      }
+      AddInt(ST->isPacked());
+      AddInt(ST->isOpaque() ? UINT64_MAX : ST->getNumElements());
+      if (!ST->isOpaque()) {
+        for (Type *ElTy : ST->elements())
+          AddType(ElTy);
+      }
+      break;
+    }
+    case Type::FunctionTyID: {
+      FunctionType *FT = cast<FunctionType>(Ty);
+      AddInt(FT->isVarArg());
+      AddType(FT->getReturnType());
+      AddInt(FT->getNumParams());
+      for (Type *ParamTy : FT->params())
+        AddType(ParamTy);
+      break;
+    }
+    default:
+      break;
+    }
+  }
+
+  void AddAttributes(AttributeSet Attrs) {
+    AddInt(Attrs.getNumSlots());
+    for (unsigned i = 0, e = Attrs.getNumSlots(); i != e; ++i) {
+      unsigned Index = Attrs.getSlotIndex(i);
+      AddInt(Index);
+      AddString(Attrs.getAsString(Index));
+    }
+  }
+
+  void AddMetadata(const Metadata *MD) {
+    if (!MD) {
+      AddInt(0);
+      return;
+    }
+    AddInt(MD->getMetadataID() + 1);
+    if (const MDString *Str = dyn_cast<MDString>(MD)) {
+      AddString(Str->getString());
+    } else if (const ValueAsMetadata *VAM = dyn_cast<ValueAsMetadata>(MD)) {
+      AddValue(VAM->getValue());
+    } else if (const MDNode *N = dyn_cast<MDNode>(MD)) {
+      // Debug information does not change validation results.
+      if (isa<DINode>(N) || isa<DILocation>(N))
+        return;
+      auto Inserted = m_NodeIds.insert(std::make_pair(N, (unsigned)m_NodeIds.size()));
+      if (!Inserted.second) {
+        AddInt(Inserted.first->second);
+        return;
+      }
+      AddInt(N->getNumOperands());
+      for (const MDOperand &Op : N->operands())
+        AddMetadata(Op.get());
+    }
+  }
+
+  void AddValue(const Value *V) {
+    if (!V) {
+      AddInt(UINT64_MAX);
+      return;
+    }
+    auto Local = m_LocalIds.find(V);
+    if (Local != m_LocalIds.end()) {
+      AddInt(UINT64_MAX - 1);
+      AddInt(Local->second);
+      return;
+    }
+    AddInt(V->getValueID());
+    AddType(V->getType());
+    if (const GlobalValue *GV = dyn_cast<GlobalValue>(V)) {
+      AddString(GV->getName());
+      if (const Function *F = dyn_cast<Function>(GV))
+        AddAttributes(F->getAttributes());
+    } else if (const ConstantInt *CI = dyn_cast<ConstantInt>(V)) {
+      AddAPInt(CI->getValue());
+    } else if (const ConstantFP *CFP = dyn_cast<ConstantFP>(V)) {
+      AddAPInt(CFP->getValueAPF().bitcastToAPInt());
+    } else if (const ConstantDataSequential *CDS = dyn_cast<ConstantDataSequential>(V)) {
+      AddString(CDS->getRawDataValues());
+    } else if (const MetadataAsValue *MAV = dyn_cast<MetadataAsValue>(V)) {
+      AddMetadata(MAV->getMetadata());
+    } else if (const BasicBlock *BB = dyn_cast<BasicBlock>(V)) {
+      AddString(BB->getName());
+    } else if (const Constant *C = dyn_cast<Constant>(V)) {
+      if (const ConstantExpr *CE = dyn_cast<ConstantExpr>(C)) {
+        AddInt(CE->getOpcode());
+        AddInt(CE->getRawSubclassOptionalData());
+        if (CE->isCompare())
+          AddInt(CE->getPredicate());
+        if (CE->hasIndices()) {
+          for (unsigned Idx : CE->getIndices())
+            AddInt(Idx);
+        }
+      }
+      AddInt(C->getNumOperands());
+      for (const Use &Op : C->operands())
+        AddValue(Op.get());
+    }
+  }
+
+  void AddGlobalVariable(const GlobalVariable &GV) {
+    AddValue(&GV);
+    AddInt(GV.getLinkage());
+    AddInt(GV.isConstant());
+    AddInt(GV.getAlignment());
+    AddInt(GV.getThreadLocalMode());
+    AddValue(GV.hasInitializer() ? GV.getInitializer() : nullptr);
+  }
+
+  void AddFunction(const Function &F) {
+    AddValue(&F);
+    AddInt(F.getLinkage());
+    AddInt(F.getCallingConv());
+    SmallVector<std::pair<unsigned, MDNode *>, 4> MDs;
+    F.getAllMetadata(MDs);
+    AddMetadataAttachments(MDs);
+
+    m_LocalIds.clear();
+    for (const Argument &Arg : F.args())
+      m_LocalIds[&Arg] = m_LocalIds.size();
+    for (const BasicBlock &BB : F) {
+      m_LocalIds[&BB] = m_LocalIds.size();
+      for (const Instruction &I : BB)
+        m_LocalIds[&I] = m_LocalIds.size();
+    }
+
+    for (const BasicBlock &BB : F) {
+      AddInt(BB.size());
+      for (const Instruction &I : BB)
+        AddInstruction(I);
+    }
+  }
+
+  DxilValidationFingerprints::Digest Finish() {
+    MD5::MD5Result Result;
+    m_Hasher.final(Result);
+    DxilValidationFingerprints::Digest D;
+    std::copy(std::begin(Result), std::end(Result), D.begin());
+    return D;
+  }
+
+private:
+  void AddMetadataAttachments(const SmallVectorImpl<std::pair<unsigned, MDNode *>> &MDs) {
+    AddInt(MDs.size());
+    for (const auto &MD : MDs) {
+      AddString(MD.first < m_MDKindNames.size() ? m_MDKindNames[MD.first] : StringRef());
+      AddMetadata(MD.second);
+    }
+  }
+
+  void AddOrdering(AtomicOrdering Ordering, SynchronizationScope Scope) {
+    AddInt(Ordering);
+    AddInt(Scope);
+  }
+
+  void AddInstruction(const Instruction &I) {
+    AddInt(I.getOpcode());
+    AddType(I.getType());
+    // Wrap flags, exactness, fast-math flags and inbounds.
+    AddInt(I.getRawSubclassOptionalData());
+    AddInt(I.getNumOperands());
+    for (const Use &Op : I.operands())
+      AddValue(Op.get());
+
+    if (const CmpInst *Cmp = dyn_cast<CmpInst>(&I)) {
+      AddInt(Cmp->getPredicate());
+    } else if (const LoadInst *LI = dyn_cast<LoadInst>(&I)) {
+      AddInt(LI->getAlignment());
+      AddInt(LI->isVolatile());
+      AddOrdering(LI->getOrdering(), LI->getSynchScope());
+    } else if (const StoreInst *SI = dyn_cast<StoreInst>(&I)) {
+      AddInt(SI->getAlignment());
+      AddInt(SI->isVolatile());
+      AddOrdering(SI->getOrdering(), SI->getSynchScope());
+    } else if (const AllocaInst *AI = dyn_cast<AllocaInst>(&I)) {
+      AddInt(AI->getAlignment());
+      AddType(AI->getAllocatedType());
+    } else if (const CallInst *CI = dyn_cast<CallInst>(&I)) {
+      AddInt(CI->getCallingConv());
+      AddInt(CI->isTailCall());
+      AddInt(CI->isMustTailCall());
+      AddAttributes(CI->getAttributes());
+    } else if (const ExtractValueInst *EVI = dyn_cast<ExtractValueInst>(&I)) {
+      for (unsigned Idx : EVI->getIndices())
+        AddInt(Idx);
+    } else if (const InsertValueInst *IVI = dyn_cast<InsertValueInst>(&I)) {
+      for (unsigned Idx : IVI->getIndices())
+        AddInt(Idx);
+    } else if (const AtomicRMWInst *RMW = dyn_cast<AtomicRMWInst>(&I)) {
+      AddInt(RMW->getOperation());
+      AddInt(RMW->isVolatile());
+      AddOrdering(RMW->getOrdering(), RMW->getSynchScope());
+    } else if (const AtomicCmpXchgInst *CX = dyn_cast<AtomicCmpXchgInst>(&I)) {
+      AddInt(CX->isVolatile());
+      AddInt(CX->isWeak());
+      AddOrdering(CX->getSuccessOrdering(), CX->getSynchScope());
+      AddInt(CX->getFailureOrdering());
+    } else if (const PHINode *Phi = dyn_cast<PHINode>(&I)) {
+      for (unsigned i = 0, e = Phi->getNumIncomingValues(); i != e; ++i)
+        AddValue(Phi->getIncomingBlock(i));
+    }
+
+    SmallVector<std::pair<unsigned, MDNode *>, 4> MDs;
+    I.getAllMetadataOtherThanDebugLoc(MDs);
+    AddMetadataAttachments(MDs);
+  }
+
+  MD5 m_Hasher;
+  SmallVector<StringRef, 16> m_MDKindNames;
+  DenseMap<const Value *, unsigned> m_LocalIds;
+  DenseMap<const MDNode *, unsigned> m_NodeIds;
+  DenseMap<const Type *, unsigned> m_TypeIds;
+};
+} // namespace
+
+// Hashes the module-level state that function validation reads.
+static DxilValidationFingerprints::Digest
+FingerprintModuleState(Module &M, DxilModule &DM) {
+  ValidationFingerprinter FP(M.getContext());
+  unsigned ValMajor, ValMinor, DxilMajor, DxilMinor;
+  GetValidationVersion(&ValMajor, &ValMinor);
+  DM.GetDxilVersion(DxilMajor, DxilMinor);
+  FP.AddInt(kValidationFingerprintVersion);
+  FP.AddInt(ValMajor);
+  FP.AddInt(ValMinor);
+  FP.AddInt(DxilMajor);
+  FP.AddInt(DxilMinor);
+  FP.AddString(M.getTargetTriple());
+  FP.AddString(M.getDataLayoutStr());
+  // Resources, signatures, entry properties and type annotations.
+  for (const NamedMDNode &NMD : M.named_metadata()) {
+    if (!NMD.getName().startswith("dx."))
+      continue;
+    FP.AddString(NMD.getName());
+    FP.AddInt(NMD.getNumOperands());
+    for (const MDNode *N : NMD.operands())
+      FP.AddMetadata(N);
+  }
+  for (const GlobalVariable &GV : M.globals())
+    FP.AddGlobalVariable(GV);
+  return FP.Finish();
+}
+
+static DxilValidationFingerprints::Digest
+FingerprintFunction(Function &F,
+                    const DxilValidationFingerprints::Digest &ModuleState) {
+  ValidationFingerprinter FP(F.getContext());
+  FP.AddDigest(ModuleState);
+  FP.AddFunction(F);
+  return FP.Finish();
+}
+
+void DxilValidationFingerprints::Serialize(std::vector<uint8_t> &Data) const {
+  uint32_t Header[3] = { kValidationFingerprintMagic,
+                         kValidationFingerprintVersion,
+                         (uint32_t)m_Digests.size() };
+  Data.resize(sizeof(Header) + m_Digests.size() * sizeof(Digest));
+  memcpy(Data.data(), Header, sizeof(Header));
+  uint8_t *pOut = Data.data() + sizeof(Header);
+  for (const Digest &D : m_Digests) {
+    memcpy(pOut, D.data(), D.size());
+    pOut += D.size();
+  }
+}
+
+_Use_decl_annotations_
+bool DxilValidationFingerprints::Deserialize(const void *pData, size_t Size) {
+  uint32_t Header[3];
+  if (Size < sizeof(Header))
+    return false;
+  memcpy(Header, pData, sizeof(Header));
+  if (Header[0] != kValidationFingerprintMagic ||
+      Header[1] != kValidationFingerprintVersion ||
+      Size != sizeof(Header) + (size_t)Header[2] * sizeof(Digest))
+    return false;
+  m_Digests.clear();
+  const uint8_t *pIn = (const uint8_t *)pData + sizeof(Header);
+  for (uint32_t i = 0; i < Header[2]; ++i) {
+    Digest D;
+    memcpy(D.data(), pIn, D.size());
+    m_Digests.insert(D);
+    pIn += D.size();
+  }
+  return true;
+}
+
+namespace {
+// A function body to validate, and the fingerprint to record if it passes.
+struct PendingFunction {
+  Function *F;
+  bool bRecordPass;
+  DxilValidationFingerprints::Digest Digest;
+};
+
+// The diagnostics of a function body validated on a worker thread, and the
+// shared state it read and updated.
+struct FunctionValidationResult {
+  std::string Diag;
+  bool Failed = false;
+  ValidationRule FirstRuleEmit = (ValidationRule)-1;
+  DebugLoc FirstDebugLocEmit;
+  ValidationRule LastRuleEmit = (ValidationRule)-1;
+  DebugLoc LastDebugLocEmit;
+  // Entry statuses as the worker copied them, and as it left them.
+  std::unordered_map<Function *, std::unique_ptr<EntryStatus>> EntryStatusBefore;
+  std::unordered_map<Function *, std::unique_ptr<EntryStatus>> EntryStatusAfter;
+  bool UavCounterIncMapUsed = false;
+  std::unordered_map<unsigned, bool> UavCounterIncMap;
+};
+} // namespace
+
+// Workers share the LLVMContext, the DataLayout and the hlsl::OP of the
+// module, which create some types and tables the first time they are asked
+// for them. Everything of that kind that function checks ask for is created
+// here, before the workers start, so that they only read shared state.
+static void PrepareSharedStateForWorkers(ValidationContext &ValCtx,
+                                         ArrayRef<PendingFunction> Functions) {
+  // Struct layouts are computed on first use, and the DXIL return types that
+  // dx.* structs are compared against are created on first use.
+  TypeFinder StructTypes;
+  StructTypes.run(ValCtx.M, /*onlyNamed*/ false);
+  hlsl::OP *hlslOP = ValCtx.DxilMod.GetOP();
+  for (StructType *ST : StructTypes) {
+    if (ST->isSized())
+      ValCtx.DL.getStructLayout(ST);
+    if (ST->hasName() && ST->getName().startswith("dx."))
+      IsDxilBuiltinStructType(ST, hlslOP);
+  }
+  // Function attribute sets are uniqued in the context when they are first
+  // taken apart.
+  for (const PendingFunction &PF : Functions)
+    PF.F->getAttributes().getFnAttributes();
+}
+
+static void
+ValidateFunctionsInParallel(ValidationContext &ValCtx,
+                            ArrayRef<PendingFunction> Functions,
+                            unsigned ThreadCount,
+                            std::vector<FunctionValidationResult> &Results) {
+  PrepareSharedStateForWorkers(ValCtx, Functions);
+
+  IMalloc *pMalloc = DxcGetThreadMallocNoRef();
+  DXASSERT_NOMSG(Results.size() == Functions.size());
+  WorkStealingThreadPool Pool(ThreadCount);
+  Pool.run(Functions.size(), [&](unsigned TaskIndex, unsigned) {
+    DxcThreadMalloc TM(pMalloc);
+    FunctionValidationResult &Result = Results[TaskIndex];
+    raw_string_ostream DiagStream(Result.Diag);
+    DiagnosticPrinterRawOStream DiagPrinter(DiagStream);
+    ValidationContext WorkerCtx(ValCtx, DiagPrinter);
+    ValidateFunction(*Functions[TaskIndex].F, WorkerCtx);
+    DiagStream.flush();
+    Result.Failed = WorkerCtx.Failed;
+    Result.FirstRuleEmit = WorkerCtx.FirstRuleEmit;
+    Result.FirstDebugLocEmit = WorkerCtx.FirstDebugLocEmit;
+    Result.LastRuleEmit = WorkerCtx.LastRuleEmit;
+    Result.LastDebugLocEmit = WorkerCtx.LastDebugLocEmit;
+    Result.EntryStatusBefore = std::move(WorkerCtx.entryStatusSnapshots);
+    Result.EntryStatusAfter = std::move(WorkerCtx.entryStatusMap);
+    Result.UavCounterIncMapUsed = WorkerCtx.UavCounterIncMapUsed;
+    Result.UavCounterIncMap = std::move(WorkerCtx.UavCounterIncMap);
+  });
+}
+
+// Whether a worker saw the state that validating in order would have seen.
+// Workers start from the state before any function was validated; the
+// functions and declarations validated in order before this one may have
+// changed it since.
+static bool WorkerSawStateInOrder(ValidationContext &ValCtx,
+                                  const FunctionValidationResult &Result,
+                                  const std::unordered_map<unsigned, bool>
+                                      &UavCounterIncMapAtStart) {
+  // A located diagnostic is not repeated right after an identical one, and
+  // the worker could not see the diagnostic before its first one.
+  if (Result.FirstRuleEmit != (ValidationRule)-1 &&
+      Result.FirstRuleEmit == ValCtx.LastRuleEmit &&
+      Result.FirstDebugLocEmit == ValCtx.LastDebugLocEmit)
+    return false;
+  for (auto &it : Result.EntryStatusBefore) {
+    if (!(*ValCtx.entryStatusMap[it.first] == *it.second))
+      return false;
+  }
+  if (Result.UavCounterIncMapUsed &&
+      ValCtx.UavCounterIncMap != UavCounterIncMapAtStart)
+    return false;
+  return true;
+}
+
+// Appends the diagnostics of a function validated on a worker thread, and
+// applies its updates to entry statuses and UAV counter uses. In the rare
+// case that the worker could not see what it would have seen in order, the
+// function is validated again in order instead.
+static void MergeFunctionResult(ValidationContext &ValCtx, Function &F,
+                                const FunctionValidationResult &Result,
+                                const std::unordered_map<unsigned, bool>
+                                    &UavCounterIncMapAtStart) {
+  if (!WorkerSawStateInOrder(ValCtx, Result, UavCounterIncMapAtStart)) {
+    ValidateFunction(F, ValCtx);
+    return;
+  }
+  for (auto &it : Result.EntryStatusAfter)
+    *ValCtx.entryStatusMap[it.first] = *it.second;
+  if (Result.UavCounterIncMapUsed)
+    ValCtx.UavCounterIncMap = Result.UavCounterIncMap;
+  ValCtx.DiagPrinter << Result.Diag;
+  ValCtx.Failed |= Result.Failed;
+  if (Result.LastRuleEmit != (ValidationRule)-1) {
+    ValCtx.LastRuleEmit = Result.LastRuleEmit;
+    ValCtx.LastDebugLocEmit = Result.LastDebugLocEmit;
+  }
+}
+
+static void ValidateFunctions(ValidationContext &ValCtx,
+                              DxilIncrementalValidation *pIncremental,
+                              unsigned ThreadCount) {
+  DxilModule &DM = ValCtx.DxilMod;
+  // Only library functions that are not entry points are validated
+  // independently of each other; declarations check every call site.
+  bool bSkipUnchanged = pIncremental && ValCtx.isLibProfile;
+  DxilValidationFingerprints::Digest ModuleState;
+  if (bSkipUnchanged)
+    ModuleState = FingerprintModuleState(ValCtx.M, DM);
+
+  std::vector<PendingFunction> Pending;
+  for (Function &F : ValCtx.M.functions()) {
+    if (F.isDeclaration())
+      continue;
+    PendingFunction PF = { &F, false, {} };
+    if (pIncremental)
+      pIncremental->FunctionCount++;
+    if (bSkipUnchanged && !ValCtx.HasEntryStatus(&F) &&
+        !DM.HasDxilFunctionProps(&F) && !DM.IsPatchConstantShader(&F)) {
+      PF.bRecordPass = true;
+      PF.Digest = FingerprintFunction(F, ModuleState);
+      if (pIncremental->pPrior && pIncremental->pPrior->Contains(PF.Digest)) {
+        pIncremental->Current.Insert(PF.Digest);
+        continue;
+      }
+    }
+    if (pIncremental)
+      pIncremental->RevalidatedCount++;
+    Pending.push_back(PF);
+  }
+
+  // Function bodies are independent of each other. Declarations update
+  // state shared across call sites, so they are validated on this thread.
+  bool bParallel = ThreadCount != 1 && Pending.size() > 1;
+  std::vector<FunctionValidationResult> Results(bParallel ? Pending.size() : 0);
+  std::unordered_map<unsigned, bool> UavCounterIncMapAtStart;
+  if (bParallel) {
+    UavCounterIncMapAtStart = ValCtx.UavCounterIncMap;
+    ValidateFunctionsInParallel(ValCtx, Pending, ThreadCount, Results);
+  }
+
+  // Report in module order, as a single thread would.
+  unsigned PendingIndex = 0;
+  for (Function &F : ValCtx.M.functions()) {
+    if (F.isDeclaration()) {
+      ValidateFunction(F, ValCtx);
+      continue;
+    }
+    if (PendingIndex == Pending.size() || Pending[PendingIndex].F != &F)
+      continue; // Unchanged since it last passed.
+    const PendingFunction &PF = Pending[PendingIndex];
+    bool FailedBefore = ValCtx.Failed;
+    ValCtx.Failed = false;
+    if (bParallel)
+      MergeFunctionResult(ValCtx, F, Results[PendingIndex],
+                          UavCounterIncMapAtStart);
+    else
+      ValidateFunction(F, ValCtx);
+    if (PF.bRecordPass && !ValCtx.Failed)
+      pIncremental->Current.Insert(PF.Digest);
+    ValCtx.Failed |= FailedBefore;
+    ++PendingIndex;
+  }
+}
+
 _Use_decl_annotations_ HRESULT
-ValidateDxilModule(llvm::Module *pModule, llvm::Module *pDebugModule) {
+ValidateDxilModule(llvm::Module *pModule, llvm::Module *pDebugModule,
+                   DxilIncrementalValidation *pIncremental,
+                   unsigned ThreadCount) {
   std::string diagStr;
   raw_string_ostream diagStream(diagStr);
   DiagnosticPrinterRawOStream DiagPrinter(diagStream);
@@ -5144,9 +5760,7 @@ ValidateDxilModule(llvm::Module *pModule, llvm::Module *pDebugModule) {
   ValidateFlowControl(ValCtx);
 
   // Validate functions.
-  for (Function &F : pModule->functions()) {
-    ValidateFunction(F, ValCtx);
-  }
+  ValidateFunctions(ValCtx, pIncremental, ThreadCount);
 
   ValidateShaderFlags(ValCtx);
 
@@ -5278,6 +5892,29 @@ static void VerifyFeatureInfoMatches(_In_ ValidationContext &ValCtx,
   VerifyBlobPartMatches(ValCtx, "Feature Info", pWriter.get(), pFeatureInfoData, FeatureInfoSize);
 }
 
+static void VerifyLibraryIndexMatches(_In_ ValidationContext &ValCtx,
+                                      _In_ const DxilPartHeader *pPart) {
+  const char *PartName = "Library Index";
+  if (!IsDxilLibraryIndexValid(pPart)) {
+    ValCtx.EmitFormatError(ValidationRule::ContainerPartMatches, { PartName });
+    return;
+  }
+  unique_ptr<DxilPartWriter> pWriter(NewLibraryIndexWriter(ValCtx.DxilMod));
+  VerifyBlobPartMatches(ValCtx, PartName, pWriter.get(),
+                        GetDxilPartData(pPart), pPart->PartSize);
+}
+
+static void VerifyCBufferLayoutMatches(_In_ ValidationContext &ValCtx,
+                                      _In_ const DxilPartHeader *pPart) {
+  const char *PartName = "Constant Buffer Layout";
+  if (!IsDxilCBufferLayoutValid(pPart)) {
+    ValCtx.EmitFormatError(ValidationRule::ContainerPartMatches, { PartName });
+    return;
+  }
+  unique_ptr<DxilPartWriter> pWriter(NewCBufferLayoutWriter(ValCtx.DxilMod));
+  VerifyBlobPartMatches(ValCtx, PartName, pWriter.get(),
+                        GetDxilPartData(pPart), pPart->PartSize);
+}
 
 static void VerifyRDATMatches(_In_ ValidationContext &ValCtx,
                               _In_reads_bytes_(RDATSize) const void *pRDATData,
@@ -5441,12 +6078,36 @@ HRESULT ValidateDxilContainerParts(llvm::Module *pModule,
     // Runtime Data (RDAT) for libraries
     case DFCC_RuntimeData:
       if (ValCtx.isLibProfile) {
+        // RDAT is built from function bodies, which a lazily loaded module
+        // has not parsed yet.
+        if (pModule->materializeAll())
+          return DXC_E_IR_VERIFICATION_FAILED;
         VerifyRDATMatches(ValCtx, GetDxilPartData(pPart), pPart->PartSize);
       } else {
         ValCtx.EmitFormatError(ValidationRule::ContainerPartInvalid, { szFourCC });
       }
       break;
 
+    case DFCC_LibraryIndex:
+      if (ValCtx.isLibProfile) {
+        VerifyLibraryIndexMatches(ValCtx, pPart);
+      } else {
+        ValCtx.EmitFormatError(ValidationRule::ContainerPartInvalid, { szFourCC });
+      }
+      break;
+
+    case DFCC_ConstantBufferLayout:
+      if (!ValCtx.isLibProfile) {
+        // Variable usage comes from function bodies, which a lazily loaded
+        // module has not parsed yet.
+        if (pModule->materializeAll())
+          return DXC_E_IR_VERIFICATION_FAILED;
+        VerifyCBufferLayoutMatches(ValCtx, pPart);
+      } else {
+        ValCtx.EmitFormatError(ValidationRule::ContainerPartInvalid, { szFourCC });
+      }
+      break;
+
     case DFCC_Container:
     default:
       ValCtx.EmitFormatError(ValidationRule::ContainerPartInvalid, {szFourCC});
@@ -5568,7 +6229,9 @@ HRESULT ValidateLoadModule(const char *pIL,
 HRESULT ValidateDxilBitcode(
   _In_reads_bytes_(ILLength) const char *pIL,
   _In_ uint32_t ILLength,
-  _In_ llvm::raw_ostream &DiagStream) {
+  _In_ llvm::raw_ostream &DiagStream,
+  _Inout_opt_ DxilIncrementalValidation *pIncremental,
+  unsigned ThreadCount) {
 
   LLVMContext Ctx;
   std::unique_ptr<llvm::Module> pModule;
@@ -5583,7 +6246,8 @@ HRESULT ValidateDxilBitcode(
                                      /*bLazyLoad*/ false)))
     return hr;
 
-  if (FAILED(hr = ValidateDxilModule(pModule.get(), nullptr)))
+  if (FAILED(hr = ValidateDxilModule(pModule.get(), nullptr, pIncremental,
+                                     ThreadCount)))
     return hr;
 
   DxilModule &dxilModule = pModule->GetDxilModule();
@@ -5685,7 +6349,9 @@ _Use_decl_annotations_ HRESULT ValidateLoadModuleFromContainerLazy(
 _Use_decl_annotations_
 HRESULT ValidateDxilContainer(const void *pContainer,
                               uint32_t ContainerSize,
-                              llvm::raw_ostream &DiagStream) {
+                              llvm::raw_ostream &DiagStream,
+                              DxilIncrementalValidation *pIncremental,
+                              unsigned ThreadCount) {
   LLVMContext Ctx, DbgCtx;
   std::unique_ptr<llvm::Module> pModule, pDebugModule;
 
@@ -5700,7 +6366,8 @@ HRESULT ValidateDxilContainer(const void *pContainer,
       Ctx, DbgCtx, DiagStream));
 
   // Validate DXIL Module
-  IFR(ValidateDxilModule(pModule.get(), pDebugModule.get()));
+  IFR(ValidateDxilModule(pModule.get(), pDebugModule.get(), pIncremental,
+                         ThreadCount));
 
   if (DiagContext.HasErrors() || DiagContext.HasWarnings()) {
     return DXC_E_IR_VERIFICATION_FAILED;
@@ -5710,4 +6377,36 @@ HRESULT ValidateDxilContainer(const void *pContainer,
     IsDxilContainerLike(pContainer, ContainerSize), ContainerSize);
 }
 
+_Use_decl_annotations_
+HRESULT ValidateDxilContainerPartsOnly(const void *pContainer,
+                                       uint32_t ContainerSize,
+                                       llvm::raw_ostream &DiagStream) {
+  LLVMContext Ctx, DbgCtx;
+  std::unique_ptr<llvm::Module> pModule, pDebugModule;
+
+  llvm::DiagnosticPrinterRawOStream DiagPrinter(DiagStream);
+  PrintDiagnosticContext DiagContext(DiagPrinter);
+  Ctx.setDiagnosticHandler(PrintDiagnosticContext::PrintDiagnosticHandler,
+                           &DiagContext, true);
+  DbgCtx.setDiagnosticHandler(PrintDiagnosticContext::PrintDiagnosticHandler,
+                              &DiagContext, true);
+
+  // Globals and metadata are loaded; function bodies are left in the
+  // bitcode until a part needs them.
+  IFR(ValidateLoadModuleFromContainerLazy(pContainer, ContainerSize, pModule,
+                                          pDebugModule, Ctx, DbgCtx,
+                                          DiagStream));
+
+  if (!DxilModule::TryGetDxilModule(pModule.get()))
+    return DXC_E_IR_VERIFICATION_FAILED;
+
+  IFR(ValidateDxilContainerParts(pModule.get(), pDebugModule.get(),
+      IsDxilContainerLike(pContainer, ContainerSize), ContainerSize));
+
+  if (DiagContext.HasErrors() || DiagContext.HasWarnings()) {
+    return DXC_E_IR_VERIFICATION_FAILED;
+  }
+  return S_OK;
+}
+
 } // namespace hlsl
@@ -11,6 +11,7 @@
 
 #define _USE_MATH_DEFINES
 #include <array>
+#include <chrono>
 #include <cmath>
 #include <unordered_set>
 #include <functional>
@@ -30,6 +31,7 @@
 #include "llvm/IR/GetElementPtrTypeIterator.h"
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/Instructions.h"
+#include "llvm/IR/LegacyPassManager.h"
 #include "llvm/IR/Module.h"
 #include "llvm/ADT/APSInt.h"
 
@@ -5062,15 +5064,106 @@ IntrinsicLower gLowerTable[static_cast<unsigned>(IntrinsicOp::Num_Intrinsics)] =
 }
 
 static void TranslateBuiltinIntrinsic(CallInst *CI,
+                                      const IntrinsicLower &lower,
                                       HLOperationLowerHelper &helper,  HLObjectOperationLowerHelper *pObjHelper, bool &Translated) {
-  unsigned opcode = hlsl::GetHLOpcode(CI);
-  const IntrinsicLower &lower = gLowerTable[opcode];
   Value *Result =
       lower.LowerFunc(CI, lower.IntriOpcode, lower.DxilOpcode, helper, pObjHelper, Translated);
   if (Result)
     CI->replaceAllUsesWith(Result);
 }
 
+// Calls to one HL intrinsic function that share an intrinsic opcode.
+struct IntrinsicCallGroup {
+  unsigned opcode;
+  SmallVector<CallInst *, 8> calls;
+};
+
+// Returns the number of source operands when the lowering maps each call
+// onto a single DXIL operation over the call's own operands, or -1 otherwise.
+static int GetTrivialIntrinsicSrcCount(const IntrinsicLower &lower) {
+  if (&lower.LowerFunc == &TrivialNoArgWithRetOperation)
+    return 0;
+  if (&lower.LowerFunc == &TrivialUnaryOperation)
+    return 1;
+  if (&lower.LowerFunc == &TrivialBinaryOperation)
+    return 2;
+  if (&lower.LowerFunc == &TrivialTrinaryOperation)
+    return 3;
+  return -1;
+}
+
+// Lowers calls that each map onto a single DXIL operation. The calls of a
+// group share an HL function, so they share the overload type, the DXIL
+// function and the builder.
+static void TranslateTrivialIntrinsicGroup(IntrinsicCallGroup &group,
+                                           const IntrinsicLower &lower,
+                                           unsigned srcCount,
+                                           HLOperationLowerHelper &helper) {
+  hlsl::OP *hlslOP = &helper.hlslOP;
+  CallInst *firstCI = group.calls.front();
+  Type *Ty = srcCount == 0
+                 ? firstCI->getType()
+                 : firstCI->getArgOperand(HLOperandIndex::kUnaryOpSrc0Idx)
+                       ->getType();
+  // Binary and trinary operations return their overload type.
+  Type *RetTy = srcCount >= 2 ? Ty : firstCI->getType();
+  Function *dxilFunc = hlslOP->GetOpFunc(lower.DxilOpcode, Ty->getScalarType());
+  Value *args[4] = {hlslOP->GetU32Const((unsigned)lower.DxilOpcode)};
+
+  IRBuilder<> Builder(firstCI);
+  for (CallInst *CI : group.calls) {
+    Builder.SetInsertPoint(CI);
+    for (unsigned i = 1; i <= srcCount; i++)
+      args[i] = CI->getArgOperand(i);
+    Value *Result = TrivialDxilOperation(dxilFunc, lower.DxilOpcode,
+                                         makeArrayRef(args, srcCount + 1), Ty,
+                                         RetTy, hlslOP, Builder);
+    CI->replaceAllUsesWith(Result);
+    CI->eraseFromParent();
+  }
+}
+
+static void TranslateBuiltinIntrinsicGroup(IntrinsicCallGroup &group,
+                                           HLOperationLowerHelper &helper,
+                                           HLObjectOperationLowerHelper *pObjHelper,
+                                           legacy::PassObserver *observer) {
+  std::chrono::steady_clock::time_point start;
+  if (observer)
+    start = std::chrono::steady_clock::now();
+
+  // Resolve the lowering once for all calls in the group.
+  const IntrinsicLower &lower = gLowerTable[group.opcode];
+  int trivialSrcCount = GetTrivialIntrinsicSrcCount(lower);
+  if (trivialSrcCount >= 0) {
+    TranslateTrivialIntrinsicGroup(group, lower, trivialSrcCount, helper);
+  } else {
+    for (CallInst *CI : group.calls) {
+      // Keep the instruction to lower by other function.
+      bool Translated = true;
+
+      TranslateBuiltinIntrinsic(CI, lower, helper, pObjHelper, Translated);
+
+      if (Translated) {
+        // delete the call
+        DXASSERT(CI->use_empty(),
+                 "else TranslateBuiltinIntrinsic didn't replace/erase uses");
+        CI->eraseFromParent();
+      }
+    }
+  }
+
+  if (observer) {
+    uint64_t microseconds =
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start)
+            .count();
+    std::string name = std::string("dxilgen.intrinsic.") +
+                       GetIntrinsicOpName((IntrinsicOp)group.opcode);
+    observer->addCounter(name + ".calls", group.calls.size());
+    observer->addCounter(name + ".microseconds", microseconds);
+  }
+}
+
 // SharedMem.
 namespace {
 
@@ -7173,26 +7266,29 @@ static Instruction *CreateTransposeShuffle(IRBuilder<> &Builder, Value *vecVal,
 void TranslateHLBuiltinOperation(Function *F, HLOperationLowerHelper &helper,
                                hlsl::HLOpcodeGroup group, HLObjectOperationLowerHelper *pObjHelper) {
   if (group == HLOpcodeGroup::HLIntrinsic) {
-    // map to dxil operations
-    for (auto U = F->user_begin(); U != F->user_end();) {
-      Value *User = *(U++);
-      if (!isa<Instruction>(User))
+    // Intrinsics with the same signature share an HL function, so group its
+    // calls by opcode, in order of first use, and lower each group at once.
+    SmallVector<IntrinsicCallGroup, 4> callGroups;
+    SmallDenseMap<unsigned, unsigned, 4> groupIndex;
+    for (User *U : F->users()) {
+      if (!isa<Instruction>(U))
         continue;
       // must be call inst
-      CallInst *CI = cast<CallInst>(User);
-
-      // Keep the instruction to lower by other function.
-      bool Translated = true;
-
-      TranslateBuiltinIntrinsic(CI, helper, pObjHelper, Translated);
-
-      if (Translated) {
-        // delete the call
-        DXASSERT(CI->use_empty(),
-                 "else TranslateBuiltinIntrinsic didn't replace/erase uses");
-        CI->eraseFromParent();
+      CallInst *CI = cast<CallInst>(U);
+      unsigned opcode = hlsl::GetHLOpcode(CI);
+      auto it = groupIndex.insert(
+          std::make_pair(opcode, (unsigned)callGroups.size()));
+      if (it.second) {
+        callGroups.emplace_back();
+        callGroups.back().opcode = opcode;
       }
+      callGroups[it.first->second].calls.push_back(CI);
     }
+
+    // map to dxil operations
+    legacy::PassObserver *observer = legacy::getPassObserver();
+    for (IntrinsicCallGroup &callGroup : callGroups)
+      TranslateBuiltinIntrinsicGroup(callGroup, helper, pObjHelper, observer);
   } else {
     if (group == HLOpcodeGroup::HLMatLoadStore) {
       // Both ld/st use arg1 for the pointer.
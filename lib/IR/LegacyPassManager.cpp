@@ -155,6 +155,43 @@ void PassManagerPrettyStackEntry::print(raw_ostream &OS) const {
   OS << "'\n";
 }
 
+// HLSL Change Starts
+thread_local static PassObserver *ThePassObserver = nullptr;
+
+PassObserver *llvm::legacy::getPassObserver() { return ThePassObserver; }
+
+ScopedPassObserver::ScopedPassObserver(PassObserver *O)
+    : Prior(ThePassObserver) {
+  ThePassObserver = O;
+}
+
+ScopedPassObserver::~ScopedPassObserver() { ThePassObserver = Prior; }
+
+namespace {
+/// PassObserverRegion - Reports a pass that is not a pass manager to the
+/// thread's observer, if any, for the lifetime of this object.
+class PassObserverRegion {
+  PassObserver *O;
+  Pass *P;
+  Module &M;
+  Function *F;
+
+public:
+  PassObserverRegion(Pass *P, Module &M, Function *F)
+      : O(ThePassObserver), P(P), M(M), F(F) {
+    if (O && P->getAsPMDataManager())
+      O = nullptr;
+    if (O)
+      O->beforePass(P, M, F);
+  }
+  ~PassObserverRegion() {
+    if (O)
+      O->afterPass(P, M, F);
+  }
+};
+} // namespace
+// HLSL Change Ends
+
 
 namespace {
 //===----------------------------------------------------------------------===//
@@ -1317,6 +1354,7 @@ bool BBPassManager::runOnFunction(Function &F) {
         // If the pass crashes, remember this.
         PassManagerPrettyStackEntry X(BP, *I);
         TimeRegion PassTimer(getPassTimer(BP));
+        PassObserverRegion PassObs(BP, *F.getParent(), &F); // HLSL Change
 
         LocalChanged |= BP->runOnBasicBlock(*I);
       }
@@ -1544,6 +1582,7 @@ bool FPPassManager::runOnFunction(Function &F) {
     {
       PassManagerPrettyStackEntry X(FP, F);
       TimeRegion PassTimer(getPassTimer(FP));
+      PassObserverRegion PassObs(FP, *F.getParent(), &F); // HLSL Change
 
       LocalChanged |= FP->runOnFunction(F);
     }
@@ -1620,6 +1659,7 @@ MPPassManager::runOnModule(Module &M) {
     {
       PassManagerPrettyStackEntry X(MP, M);
       TimeRegion PassTimer(getPassTimer(MP));
+      PassObserverRegion PassObs(MP, M, nullptr); // HLSL Change
 
       LocalChanged |= MP->runOnModule(M);
     }
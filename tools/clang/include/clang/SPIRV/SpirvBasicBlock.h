@@ -78,6 +78,9 @@ public:
   /// instruction.
   bool hasTerminator() const;
 
+  /// Returns the number of instructions belonging to this basic block.
+  size_t getNumInstructions() const;
+
   /// Handle SPIR-V basic block visitors.
   /// If a basic block is the first basic block in a function, it must include
   /// all the variable definitions of the entire function.
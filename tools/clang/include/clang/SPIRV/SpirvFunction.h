@@ -37,8 +37,16 @@ public:
   SpirvFunction &operator=(SpirvFunction &&) = delete;
 
   // Handle SPIR-V function visitors.
+  //
+  // Basic blocks are visited in a human-readable order. The order is computed
+  // on the first visit, once the control flow of the function is complete,
+  // and reused by all later visitors.
   bool invokeVisitor(Visitor *, bool reverseOrder = false);
 
+  // Returns the number of instructions in the function, including its
+  // OpFunction, OpFunctionParameter, OpLabel and OpFunctionEnd instructions.
+  size_t getNumInstructions() const;
+
   uint32_t getResultId() const { return functionId; }
   void setResultId(uint32_t id) { functionId = id; }
 
@@ -119,6 +127,10 @@ private:
 
   /// Basic blocks inside this function.
   std::vector<SpirvBasicBlock *> basicBlocks;
+
+  /// Basic blocks reachable from the entry block, in human-readable order.
+  /// Empty until the function is first visited.
+  std::vector<SpirvBasicBlock *> orderedBlocks;
 };
 
 } // end namespace spirv
@@ -89,6 +89,10 @@ public:
   // Handle SPIR-V module visitors.
   bool invokeVisitor(Visitor *, bool reverseOrder = false);
 
+  // Returns the number of instructions in the functions of the module,
+  // including module-level variables.
+  size_t getNumInstructions() const;
+
   // Add a function to the list of module functions.
   void addFunction(SpirvFunction *);
 
@@ -0,0 +1,71 @@
+//===------ SpirvToolsPool.h - Pooled SPIRV-Tools Instances -----*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//===----------------------------------------------------------------------===//
+//
+//  This file defines a process-wide pool of SPIRV-Tools optimizers and
+//  validators that are reused across compilations.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_SPIRV_SPIRVTOOLSPOOL_H
+#define LLVM_CLANG_SPIRV_SPIRVTOOLSPOOL_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "spirv-tools/libspirv.h"
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringRef.h"
+
+namespace spvtools {
+class Optimizer;
+class ValidatorOptions;
+} // namespace spvtools
+
+namespace clang {
+namespace spirv {
+
+struct SpirvToolsPoolStats {
+  /// Optimizers built, each with its passes registered.
+  uint64_t optimizersCreated;
+  /// Optimizer runs on an optimizer built by an earlier run.
+  uint64_t optimizersReused;
+  /// Validators built.
+  uint64_t validatorsCreated;
+  /// Validations on a validator built by an earlier validation.
+  uint64_t validatorsReused;
+  /// Time spent building optimizers and validators and registering passes.
+  uint64_t constructionMicroseconds;
+};
+
+/// \brief Optimizes the given module in place with an optimizer for the
+/// target environment whose passes are identified by passesKey. The pool
+/// keeps idle optimizers per environment and key, so registerPasses is only
+/// called when no idle optimizer is left, and concurrent compilations each
+/// get their own. Returns false if registering the passes or running them
+/// fails. Messages of the run are appended to messages.
+bool runPooledOptimizer(
+    spv_target_env env, llvm::StringRef passesKey,
+    llvm::function_ref<bool(spvtools::Optimizer &)> registerPasses,
+    std::vector<uint32_t> *module, std::string *messages);
+
+/// \brief Validates the given module with a pooled validator for the target
+/// environment. Messages of the validation are appended to messages.
+bool runPooledValidator(spv_target_env env,
+                        const spvtools::ValidatorOptions &options,
+                        const std::vector<uint32_t> &module,
+                        std::string *messages);
+
+/// \brief Returns the counters of the pool since the process started.
+SpirvToolsPoolStats getSpirvToolsPoolStats();
+
+} // end namespace spirv
+} // end namespace clang
+
+#endif // LLVM_CLANG_SPIRV_SPIRVTOOLSPOOL_H
@@ -9,6 +9,7 @@
 #ifndef LLVM_CLANG_SPIRV_STRING_H
 #define LLVM_CLANG_SPIRV_STRING_H
 
+#include <cstring>
 #include <string>
 #include <vector>
 
@@ -23,6 +24,31 @@ namespace string {
 /// SPIR-V string encoding requirements.
 std::vector<uint32_t> encodeSPIRVString(llvm::StringRef strChars);
 
+/// \brief Appends the words of the given string to the given word vector,
+/// without building an intermediate vector. It follows the SPIR-V string
+/// encoding requirements.
+template <typename WordVector>
+void appendSPIRVString(llvm::StringRef strChars, WordVector *words) {
+  // Initialize all new words to 0.
+  const size_t numChars = strChars.size();
+  const size_t start = words->size();
+  words->resize(start + numChars / 4 + 1, 0);
+
+  // From the SPIR-V spec, literal string is
+  //
+  // A nul-terminated stream of characters consuming an integral number of
+  // words. The character set is Unicode in the UTF-8 encoding scheme. The UTF-8
+  // octets (8-bit bytes) are packed four per word, following the little-endian
+  // convention (i.e., the first octet is in the lowest-order 8 bits of the
+  // word). The final word contains the string's nul-termination character (0),
+  // and all contents past the end of the string in the final word are padded
+  // with 0.
+  //
+  // So the following works on little endian machines.
+  char *strDest = reinterpret_cast<char *>(words->data() + start);
+  strncpy(strDest, strChars.data(), numChars);
+}
+
 /// \brief Reinterprets the given vector of 32-bit words as a string.
 /// Expectes that the words represent a NULL-terminated string.
 /// It follows the SPIR-V string encoding requirements.
@@ -12,6 +12,7 @@
 #include "clang/SPIRV/SpirvBasicBlock.h"
 #include "clang/SPIRV/SpirvFunction.h"
 #include "clang/SPIRV/SpirvInstruction.h"
+#include "clang/SPIRV/SpirvModule.h"
 #include "clang/SPIRV/SpirvType.h"
 #include "clang/SPIRV/String.h"
 
@@ -96,14 +97,12 @@ EmitVisitor::Header::Header(uint32_t bound_, uint32_t version_)
       generator((kGeneratorNumber << 16) | kToolVersion), bound(bound_),
       reserved(0) {}
 
-std::vector<uint32_t> EmitVisitor::Header::takeBinary() {
-  std::vector<uint32_t> words;
-  words.push_back(magicNumber);
-  words.push_back(version);
-  words.push_back(generator);
-  words.push_back(bound);
-  words.push_back(reserved);
-  return words;
+void EmitVisitor::Header::appendTo(std::vector<uint32_t> *binary) const {
+  binary->push_back(magicNumber);
+  binary->push_back(version);
+  binary->push_back(generator);
+  binary->push_back(bound);
+  binary->push_back(reserved);
 }
 
 void EmitVisitor::emitDebugNameForInstruction(uint32_t resultId,
@@ -255,28 +254,40 @@ void EmitVisitor::finalizeInstruction() {
 }
 
 std::vector<uint32_t> EmitVisitor::takeBinary() {
+  const size_t kHeaderWords = 5;
+  std::vector<uint32_t> *sections[] = {&preambleBinary, &debugBinary,
+                                       &annotationsBinary, &typeConstantBinary,
+                                       &mainBinary};
+  size_t numWords = kHeaderWords;
+  for (const auto *section : sections)
+    numWords += section->size();
+
+  // Size the binary once and release each section as soon as it is copied,
+  // which keeps the peak close to one copy of the module.
   std::vector<uint32_t> result;
+  result.reserve(numWords);
   Header header(takeNextId(),
                 spvOptions.targetEnv == "vulkan1.1" ? 0x00010300u : 0x00010000);
-  auto headerBinary = header.takeBinary();
-  result.insert(result.end(), headerBinary.begin(), headerBinary.end());
-  result.insert(result.end(), preambleBinary.begin(), preambleBinary.end());
-  result.insert(result.end(), debugBinary.begin(), debugBinary.end());
-  result.insert(result.end(), annotationsBinary.begin(),
-                annotationsBinary.end());
-  result.insert(result.end(), typeConstantBinary.begin(),
-                typeConstantBinary.end());
-  result.insert(result.end(), mainBinary.begin(), mainBinary.end());
+  header.appendTo(&result);
+  for (auto *section : sections) {
+    result.insert(result.end(), section->begin(), section->end());
+    std::vector<uint32_t>().swap(*section);
+  }
   return result;
 }
 
 void EmitVisitor::encodeString(llvm::StringRef value) {
-  const auto &words = string::encodeSPIRVString(value);
-  curInst.insert(curInst.end(), words.begin(), words.end());
+  string::appendSPIRVString(value, &curInst);
 }
 
-bool EmitVisitor::visit(SpirvModule *, Phase) {
-  // No pre-visit operations needed for SpirvModule.
+bool EmitVisitor::visit(SpirvModule *module, Phase phase) {
+  // Reserve the function section up front, so that emitting a large module
+  // does not keep growing and copying it. Most instructions take a handful of
+  // words, and each may be preceded by an OpLine.
+  if (phase == Visitor::Phase::Init) {
+    const size_t wordsPerInstruction = spvOptions.debugInfoLine ? 8 : 4;
+    mainBinary.reserve(module->getNumInstructions() * wordsPerInstruction);
+  }
   return true;
 }
 
@@ -416,11 +427,11 @@ bool EmitVisitor::visit(SpirvSource *inst) {
   if (firstSnippet.hasValue()) {
     // Note: in order to improve performance and avoid multiple copies, we
     // encode this (potentially large) string directly into the debugBinary.
-    const auto &words = string::encodeSPIRVString(firstSnippet.getValue());
-    const auto numWordsInInstr = curInst.size() + words.size();
-    curInst[0] |= static_cast<uint32_t>(numWordsInInstr) << 16;
+    const size_t instStart = debugBinary.size();
     debugBinary.insert(debugBinary.end(), curInst.begin(), curInst.end());
-    debugBinary.insert(debugBinary.end(), words.begin(), words.end());
+    string::appendSPIRVString(firstSnippet.getValue(), &debugBinary);
+    debugBinary[instStart] |=
+        static_cast<uint32_t>(debugBinary.size() - instStart) << 16;
   } else {
     curInst[0] |= static_cast<uint32_t>(curInst.size()) << 16;
     debugBinary.insert(debugBinary.end(), curInst.begin(), curInst.end());
@@ -431,11 +442,11 @@ bool EmitVisitor::visit(SpirvSource *inst) {
     initInstruction(spv::Op::OpSourceContinued, /* SourceLocation */ {});
     // Note: in order to improve performance and avoid multiple copies, we
     // encode this (potentially large) string directly into the debugBinary.
-    const auto &words = string::encodeSPIRVString(choppedSrcCode[i]);
-    const auto numWordsInInstr = curInst.size() + words.size();
-    curInst[0] |= static_cast<uint32_t>(numWordsInInstr) << 16;
+    const size_t instStart = debugBinary.size();
     debugBinary.insert(debugBinary.end(), curInst.begin(), curInst.end());
-    debugBinary.insert(debugBinary.end(), words.begin(), words.end());
+    string::appendSPIRVString(choppedSrcCode[i], &debugBinary);
+    debugBinary[instStart] |=
+        static_cast<uint32_t>(debugBinary.size() - instStart) << 16;
   }
 
   if (spvOptions.debugInfoLine)
@@ -1634,16 +1645,16 @@ void EmitTypeHandler::emitNameForType(llvm::StringRef name,
                                       llvm::Optional<uint32_t> memberIndex) {
   if (name.empty())
     return;
-  std::vector<uint32_t> nameInstr;
+  // Encode the name directly into the debugBinary.
+  const size_t instStart = debugBinary->size();
   auto op = memberIndex.hasValue() ? spv::Op::OpMemberName : spv::Op::OpName;
-  nameInstr.push_back(static_cast<uint32_t>(op));
-  nameInstr.push_back(targetTypeId);
+  debugBinary->push_back(static_cast<uint32_t>(op));
+  debugBinary->push_back(targetTypeId);
   if (memberIndex.hasValue())
-    nameInstr.push_back(memberIndex.getValue());
-  const auto &words = string::encodeSPIRVString(name);
-  nameInstr.insert(nameInstr.end(), words.begin(), words.end());
-  nameInstr[0] |= static_cast<uint32_t>(nameInstr.size()) << 16;
-  debugBinary->insert(debugBinary->end(), nameInstr.begin(), nameInstr.end());
+    debugBinary->push_back(memberIndex.getValue());
+  string::appendSPIRVString(name, debugBinary);
+  (*debugBinary)[instStart] |=
+      static_cast<uint32_t>(debugBinary->size() - instStart) << 16;
 }
 
 } // end namespace spirv
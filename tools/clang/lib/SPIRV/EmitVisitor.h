@@ -142,8 +142,8 @@ private:
 private:
   ASTContext &astContext;
   SpirvContext &context;
-  std::vector<uint32_t> curTypeInst;
-  std::vector<uint32_t> curDecorationInst;
+  llvm::SmallVector<uint32_t, 16> curTypeInst;
+  llvm::SmallVector<uint32_t, 16> curDecorationInst;
   std::vector<uint32_t> *debugBinary;
   std::vector<uint32_t> *annotationsBinary;
   std::vector<uint32_t> *typeConstantBinary;
@@ -174,8 +174,8 @@ public:
     /// \brief Default constructs a SPIR-V module header with id bound 0.
     Header(uint32_t bound, uint32_t version);
 
-    /// \brief Feeds the consumer with all the SPIR-V words for this header.
-    std::vector<uint32_t> takeBinary();
+    /// \brief Appends all the SPIR-V words for this header to the binary.
+    void appendTo(std::vector<uint32_t> *binary) const;
 
     const uint32_t magicNumber;
     uint32_t version;
@@ -255,11 +255,14 @@ public:
   bool visit(SpirvArrayLength *);
   bool visit(SpirvRayTracingOpNV *);
 
-  // Returns the assembled binary built up in this visitor.
+  // Returns the assembled binary built up in this visitor. The sections are
+  // released as they are copied into the binary.
   std::vector<uint32_t> takeBinary();
 
 private:
-  // Returns the next available result-id.
+  // Returns the next available result-id. Result-ids, and the types and
+  // constants they name, are handed out in visit order, so functions must be
+  // emitted one at a time for the binary to be deterministic.
   uint32_t takeNextId() { return ++id; }
 
   // There is no guarantee that an instruction or a function or a basic block
@@ -22,6 +22,10 @@ bool SpirvBasicBlock::hasTerminator() const {
          isa<SpirvTerminator>(instructions.back().instruction);
 }
 
+size_t SpirvBasicBlock::getNumInstructions() const {
+  return std::distance(instructions.begin(), instructions.end());
+}
+
 bool SpirvBasicBlock::invokeVisitor(Visitor *visitor,
                                     llvm::ArrayRef<SpirvVariable *> vars,
                                     bool reverseOrder) {
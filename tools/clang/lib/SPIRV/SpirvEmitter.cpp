@@ -17,6 +17,7 @@
 #include "dxc/HlslIntrinsicOp.h"
 #include "spirv-tools/optimizer.hpp"
 #include "clang/SPIRV/AstTypeProbe.h"
+#include "clang/SPIRV/SpirvToolsPool.h"
 #include "clang/Sema/Sema.h"
 #include "llvm/ADT/StringExtras.h"
 
@@ -34,6 +35,13 @@ const char *getGitCommitHash() { return "<unknown-hash>"; }
 namespace clang {
 namespace spirv {
 
+/// A SPIRV-Tools pass that legalization may run on its own, with its
+/// spirv-opt flag name for reporting.
+struct LegalizationPass {
+  const char *name;
+  spvtools::Optimizer::PassToken (*create)();
+};
+
 namespace {
 
 // Returns true if the given decl has the given semantic.
@@ -141,66 +149,142 @@ bool isReferencingNonAliasStructuredOrByteBuffer(const Expr *expr) {
   return false;
 }
 
-bool spirvToolsLegalize(spv_target_env env, std::vector<uint32_t> *module,
-                        std::string *messages) {
-  spvtools::Optimizer optimizer(env);
-
-  optimizer.SetMessageConsumer(
-      [messages](spv_message_level_t /*level*/, const char * /*source*/,
-                 const spv_position_t & /*position*/,
-                 const char *message) { *messages += message; });
-
-  spvtools::OptimizerOptions options;
-  options.set_run_validator(false);
+// Inlines all calls, which leaves no function arguments outside the Function
+// storage class, and fixes up the storage classes of the inlined pointers.
+const LegalizationPass kInlineLegalizationPasses[] = {
+    {"eliminate-dead-branches",
+     [] { return spvtools::CreateDeadBranchElimPass(); }},
+    {"merge-return", [] { return spvtools::CreateMergeReturnPass(); }},
+    {"inline-entry-points-exhaustive",
+     [] { return spvtools::CreateInlineExhaustivePass(); }},
+    {"eliminate-dead-functions",
+     [] { return spvtools::CreateEliminateDeadFunctionsPass(); }},
+    {"fix-storage-class", [] { return spvtools::CreateFixStorageClassPass(); }},
+};
+
+// Folds the conditions of the inlined code, so that instructions not allowed
+// in the shader stage are removed if they cannot be reached.
+const LegalizationPass kDeadCodeLegalizationPasses[] = {
+    {"eliminate-local-single-block",
+     [] { return spvtools::CreateLocalSingleBlockLoadStoreElimPass(); }},
+    {"eliminate-local-single-store",
+     [] { return spvtools::CreateLocalSingleStoreElimPass(); }},
+    {"eliminate-local-multi-store",
+     [] { return spvtools::CreateLocalMultiStoreElimPass(); }},
+    {"ccp", [] { return spvtools::CreateCCPPass(); }},
+    {"eliminate-dead-branches",
+     [] { return spvtools::CreateDeadBranchElimPass(); }},
+    {"eliminate-dead-code-aggressive",
+     [] { return spvtools::CreateAggressiveDCEPass(); }},
+};
+
+/// Returns the pool key identifying the given legalization passes.
+std::string getLegalizationKey(llvm::ArrayRef<const LegalizationPass *> passes) {
+  std::string passesKey = "legalize:";
+  if (passes.empty()) {
+    passesKey += "full";
+  } else {
+    for (const LegalizationPass *pass : passes) {
+      passesKey += pass->name;
+      passesKey += ',';
+    }
+  }
+  return passesKey;
+}
 
-  optimizer.RegisterLegalizationPasses();
+/// Registers the given passes to legalize the module, or the whole SPIRV-Tools
+/// legalization pipeline if there are none.
+void registerLegalizationPasses(
+    spvtools::Optimizer &optimizer,
+    llvm::ArrayRef<const LegalizationPass *> passes) {
+  if (passes.empty()) {
+    optimizer.RegisterLegalizationPasses();
+  } else {
+    for (const LegalizationPass *pass : passes)
+      optimizer.RegisterPass(pass->create());
+  }
 
   optimizer.RegisterPass(spvtools::CreateReplaceInvalidOpcodePass());
 
   optimizer.RegisterPass(spvtools::CreateCompactIdsPass());
-
-  return optimizer.Run(module->data(), module->size(), module, options);
 }
 
-bool spirvToolsOptimize(spv_target_env env, std::vector<uint32_t> *module,
-                        const llvm::SmallVector<llvm::StringRef, 4> &flags,
-                        std::string *messages) {
-  spvtools::Optimizer optimizer(env);
-
-  optimizer.SetMessageConsumer(
-      [messages](spv_message_level_t /*level*/, const char * /*source*/,
-                 const spv_position_t & /*position*/,
-                 const char *message) { *messages += message; });
-
-  spvtools::OptimizerOptions options;
-  options.set_run_validator(false);
+/// Returns the pool key identifying the given optimization flags.
+std::string
+getOptimizationKey(const llvm::SmallVector<llvm::StringRef, 4> &flags) {
+  std::string passesKey = "optimize:";
+  if (flags.empty()) {
+    passesKey += "performance";
+  } else {
+    for (const auto &f : flags) {
+      passesKey += f;
+      passesKey += ',';
+    }
+  }
+  return passesKey;
+}
 
+/// Registers the passes given by the optimization flags, or the SPIRV-Tools
+/// performance pipeline if there are none. Returns false for invalid flags.
+bool registerOptimizationPasses(
+    spvtools::Optimizer &optimizer,
+    const llvm::SmallVector<llvm::StringRef, 4> &flags) {
   if (flags.empty()) {
     optimizer.RegisterPerformancePasses();
     optimizer.RegisterPass(spvtools::CreateCompactIdsPass());
-  } else {
-    // Command line options use llvm::SmallVector and llvm::StringRef, whereas
-    // SPIR-V optimizer uses std::vector and std::string.
-    std::vector<std::string> stdFlags;
-    for (const auto &f : flags)
-      stdFlags.push_back(f.str());
-    if (!optimizer.RegisterPassesFromFlags(stdFlags))
-      return false;
+    return true;
   }
+  // Command line options use llvm::SmallVector and llvm::StringRef, whereas
+  // SPIR-V optimizer uses std::vector and std::string.
+  std::vector<std::string> stdFlags;
+  for (const auto &f : flags)
+    stdFlags.push_back(f.str());
+  return optimizer.RegisterPassesFromFlags(stdFlags);
+}
 
-  return optimizer.Run(module->data(), module->size(), module, options);
+bool spirvToolsLegalize(spv_target_env env, std::vector<uint32_t> *module,
+                        llvm::ArrayRef<const LegalizationPass *> passes,
+                        std::string *messages) {
+  return runPooledOptimizer(
+      env, getLegalizationKey(passes),
+      [passes](spvtools::Optimizer &optimizer) {
+        registerLegalizationPasses(optimizer, passes);
+        return true;
+      },
+      module, messages);
+}
+
+bool spirvToolsOptimize(spv_target_env env, std::vector<uint32_t> *module,
+                        const llvm::SmallVector<llvm::StringRef, 4> &flags,
+                        std::string *messages) {
+  return runPooledOptimizer(
+      env, getOptimizationKey(flags),
+      [&flags](spvtools::Optimizer &optimizer) {
+        return registerOptimizationPasses(optimizer, flags);
+      },
+      module, messages);
+}
+
+/// Legalizes and optimizes the module in a single optimizer run, so that the
+/// module is parsed into the SPIRV-Tools IR and serialized back only once
+/// instead of once per step. The module is left untouched on failure.
+bool spirvToolsLegalizeAndOptimize(
+    spv_target_env env, std::vector<uint32_t> *module,
+    llvm::ArrayRef<const LegalizationPass *> passes,
+    const llvm::SmallVector<llvm::StringRef, 4> &flags,
+    std::string *messages) {
+  return runPooledOptimizer(
+      env, getLegalizationKey(passes) + "|" + getOptimizationKey(flags),
+      [passes, &flags](spvtools::Optimizer &optimizer) {
+        registerLegalizationPasses(optimizer, passes);
+        return registerOptimizationPasses(optimizer, flags);
+      },
+      module, messages);
 }
 
 bool spirvToolsValidate(spv_target_env env, const SpirvCodeGenOptions &opts,
                         bool beforeHlslLegalization,
                         std::vector<uint32_t> *module, std::string *messages) {
-  spvtools::SpirvTools tools(env);
-
-  tools.SetMessageConsumer(
-      [messages](spv_message_level_t /*level*/, const char * /*source*/,
-                 const spv_position_t & /*position*/,
-                 const char *message) { *messages += message; });
-
   spvtools::ValidatorOptions options;
   options.SetBeforeHlslLegalization(beforeHlslLegalization);
   // GL: strict block layout rules
@@ -214,7 +298,7 @@ bool spirvToolsValidate(spv_target_env env, const SpirvCodeGenOptions &opts,
     options.SetRelaxBlockLayout(true);
   }
 
-  return tools.Validate(module->data(), module->size(), options);
+  return runPooledValidator(env, options, *module, messages);
 }
 
 /// Translates atomic HLSL opcodes into the equivalent SPIR-V opcode.
@@ -485,7 +569,7 @@ SpirvEmitter::SpirvEmitter(CompilerInstance &ci)
       declIdMapper(astContext, spvContext, spvBuilder, *this, featureManager,
                    spirvOptions),
       entryFunction(nullptr), curFunction(nullptr), curThis(nullptr),
-      seenPushConstantAt(), isSpecConstantMode(false), needsLegalization(false),
+      seenPushConstantAt(), isSpecConstantMode(false), legalizationReasons(0),
       beforeHlslLegalization(false), mainSourceFile(nullptr) {
 
   // Get ShaderModel from command line hlsl profile option.
@@ -636,43 +720,51 @@ void SpirvEmitter::HandleTranslationUnit(ASTContext &context) {
   // Output the constructed module.
   std::vector<uint32_t> m = spvBuilder.takeModule();
 
+  if (declIdMapper.requiresLegalization())
+    legalizationReasons |= LegalizeResourceAlias;
+
+  llvm::SmallVector<const LegalizationPass *, 16> legalizationPasses;
+  bool validated = false;
   if (!spirvOptions.codeGenHighLevel) {
     // Run legalization passes
-    if (needsLegalization || declIdMapper.requiresLegalization()) {
-      std::string messages;
-      if (!spirvToolsLegalize(targetEnv, &m, &messages)) {
-        emitFatalError("failed to legalize SPIR-V: %0", {}) << messages;
-        emitNote("please file a bug report on "
-                 "https://github.com/Microsoft/DirectXShaderCompiler/issues "
-                 "with source code if possible",
-                 {});
-        return;
-      } else if (!messages.empty()) {
-        emitWarning("SPIR-V legalization: %0", {}) << messages;
-      }
-    }
-
-    // Run optimization passes
-    if (theCompilerInstance.getCodeGenOpts().OptimizationLevel > 0) {
+    selectLegalizationPasses(&legalizationPasses);
+    if (spirvOptions.reportLegalization)
+      reportLegalization(legalizationPasses);
+
+    // The selected passes should leave a fully legal module, so check it with
+    // the strict rules. If they did not, start over with the whole pipeline.
+    std::vector<uint32_t> unlegalized;
+    if (!legalizationPasses.empty())
+      unlegalized = m;
+    if (!legalizeAndOptimize(&m, legalizationPasses))
+      return;
+    if (!legalizationPasses.empty()) {
       std::string messages;
-      if (!spirvToolsOptimize(targetEnv, &m, spirvOptions.optConfig,
+      if (!spirvToolsValidate(targetEnv, spirvOptions,
+                              /*beforeHlslLegalization*/ false, &m,
                               &messages)) {
-        emitFatalError("failed to optimize SPIR-V: %0", {}) << messages;
-        emitNote("please file a bug report on "
-                 "https://github.com/Microsoft/DirectXShaderCompiler/issues "
-                 "with source code if possible",
-                 {});
-        return;
+        if (spirvOptions.reportLegalization)
+          emitRemark("SPIR-V legalization: selected passes left the module "
+                     "invalid; running full legalization",
+                     {});
+        m = std::move(unlegalized);
+        legalizationPasses.clear();
+        if (!legalizeAndOptimize(&m, legalizationPasses))
+          return;
+      } else {
+        validated = true;
       }
     }
   }
 
   // Validate the generated SPIR-V code
-  if (!spirvOptions.disableValidation) {
+  if (!spirvOptions.disableValidation && !validated) {
     std::string messages;
-    if (!spirvToolsValidate(targetEnv, spirvOptions,
-                            needsLegalization ||
-                                declIdMapper.requiresLegalization(),
+    // Relaxed rules only apply to what the whole legalization pipeline may
+    // leave behind.
+    const bool beforeHlslLegalization =
+        legalizationReasons && legalizationPasses.empty();
+    if (!spirvToolsValidate(targetEnv, spirvOptions, beforeHlslLegalization,
                             &m, &messages)) {
       emitFatalError("generated SPIR-V is invalid: %0", {}) << messages;
       emitNote("please file a bug report on "
@@ -687,6 +779,110 @@ void SpirvEmitter::HandleTranslationUnit(ASTContext &context) {
       reinterpret_cast<const char *>(m.data()), m.size() * 4);
 }
 
+bool SpirvEmitter::legalizeAndOptimize(
+    std::vector<uint32_t> *m,
+    llvm::ArrayRef<const LegalizationPass *> legalizationPasses) {
+  // Legalization and optimization share one optimizer run when both are
+  // needed. If that fails, they run one by one below to tell which of them
+  // failed.
+  const bool optimize =
+      theCompilerInstance.getCodeGenOpts().OptimizationLevel > 0;
+  bool legalized = !legalizationReasons;
+  bool optimized = !optimize;
+  if (legalizationReasons && optimize) {
+    std::string messages;
+    if (spirvToolsLegalizeAndOptimize(targetEnv, m, legalizationPasses,
+                                      spirvOptions.optConfig, &messages)) {
+      legalized = optimized = true;
+      if (!messages.empty())
+        emitWarning("SPIR-V legalization: %0", {}) << messages;
+    }
+  }
+
+  if (!legalized) {
+    std::string messages;
+    if (!spirvToolsLegalize(targetEnv, m, legalizationPasses, &messages)) {
+      emitFatalError("failed to legalize SPIR-V: %0", {}) << messages;
+      emitNote("please file a bug report on "
+               "https://github.com/Microsoft/DirectXShaderCompiler/issues "
+               "with source code if possible",
+               {});
+      return false;
+    } else if (!messages.empty()) {
+      emitWarning("SPIR-V legalization: %0", {}) << messages;
+    }
+  }
+
+  // Run optimization passes
+  if (!optimized) {
+    std::string messages;
+    if (!spirvToolsOptimize(targetEnv, m, spirvOptions.optConfig, &messages)) {
+      emitFatalError("failed to optimize SPIR-V: %0", {}) << messages;
+      emitNote("please file a bug report on "
+               "https://github.com/Microsoft/DirectXShaderCompiler/issues "
+               "with source code if possible",
+               {});
+      return false;
+    }
+  }
+  return true;
+}
+
+void SpirvEmitter::selectLegalizationPasses(
+    llvm::SmallVectorImpl<const LegalizationPass *> *passes) {
+  // Opaque locals and aliased resources can flow anywhere through memory, so
+  // they need the whole pipeline, which is left empty.
+  if (!legalizationReasons ||
+      (legalizationReasons & (LegalizeOpaqueLocal | LegalizeResourceAlias)))
+    return;
+
+  for (const LegalizationPass &pass : kInlineLegalizationPasses)
+    passes->push_back(&pass);
+  if (legalizationReasons & LegalizeStageInstruction)
+    for (const LegalizationPass &pass : kDeadCodeLegalizationPasses)
+      passes->push_back(&pass);
+}
+
+void SpirvEmitter::reportLegalization(
+    llvm::ArrayRef<const LegalizationPass *> passes) {
+  const llvm::StringRef name =
+      spvContext.isLib() ? llvm::StringRef("library")
+                         : llvm::StringRef(entryFunctionName);
+  if (!legalizationReasons) {
+    emitRemark("SPIR-V legalization of %0: not needed", {}) << name;
+    return;
+  }
+
+  std::string reasons;
+  const std::pair<LegalizationReason, const char *> reasonNames[] = {
+      {LegalizeOpaqueLocal, "opaque-local"},
+      {LegalizeResourceAlias, "resource-alias"},
+      {LegalizeArgumentScope, "argument-scope"},
+      {LegalizeStageInstruction, "stage-instruction"},
+  };
+  for (const auto &reasonName : reasonNames) {
+    if (legalizationReasons & reasonName.first) {
+      if (!reasons.empty())
+        reasons += ", ";
+      reasons += reasonName.second;
+    }
+  }
+
+  std::string passNames;
+  if (passes.empty()) {
+    passNames = "full legalization";
+  } else {
+    for (const LegalizationPass *pass : passes) {
+      if (!passNames.empty())
+        passNames += ", ";
+      passNames += pass->name;
+    }
+  }
+
+  emitRemark("SPIR-V legalization of %0 for %1: %2", {})
+      << name << reasons << passNames;
+}
+
 void SpirvEmitter::doDecl(const Decl *decl) {
   if (isa<EmptyDecl>(decl) || isa<TypedefDecl>(decl))
     return;
@@ -1040,7 +1236,7 @@ void SpirvEmitter::doFunctionDecl(const FunctionDecl *decl) {
                                     /*SourceLocation*/ {}, "param.this");
     if (isOrContainsAKindOfStructuredOrByteBuffer(paramTypes[0])) {
       curThis->setContainsAliasComponent(true);
-      needsLegalization = true;
+      legalizationReasons |= LegalizeResourceAlias;
     }
   }
 
@@ -1344,13 +1540,13 @@ void SpirvEmitter::doVarDecl(const VarDecl *decl) {
 
     // Variables that are not externally visible and of opaque types should
     // request legalization.
-    if (!needsLegalization && isOpaqueType(decl->getType()))
-      needsLegalization = true;
+    if (isOpaqueType(decl->getType()))
+      legalizationReasons |= LegalizeOpaqueLocal;
   }
 
   // All variables that are of opaque struct types should request legalization.
-  if (!needsLegalization && isOpaqueStructType(decl->getType()))
-    needsLegalization = true;
+  if (isOpaqueStructType(decl->getType()))
+    legalizationReasons |= LegalizeOpaqueLocal;
 }
 
 spv::LoopControlMask SpirvEmitter::translateLoopAttribute(const Stmt *stmt,
@@ -2161,7 +2357,7 @@ SpirvInstruction *SpirvEmitter::processCall(const CallExpr *callExpr) {
   }
 
   if (beforeHlslLegalization)
-    needsLegalization = true;
+    legalizationReasons |= LegalizeArgumentScope;
 
   assert(vars.size() == isTempVar.size());
   assert(vars.size() == args.size());
@@ -4067,7 +4263,7 @@ SpirvInstruction *SpirvEmitter::createImageSample(
 
   // Implicit-lod instructions are only allowed in pixel shader.
   if (!spvContext.isPS() && !isExplicit)
-    needsLegalization = true;
+    legalizationReasons |= LegalizeStageInstruction;
 
   auto *retVal = spvBuilder.createImageSample(
       texelType, imageType, image, sampler, coordinate, compareVal, bias, lod,
@@ -5042,7 +5238,7 @@ void SpirvEmitter::storeValue(SpirvInstruction *lhsPtr,
     //
     // Note: legalization specific code
     spvBuilder.createStore(lhsPtr, rhsVal, loc);
-    needsLegalization = true;
+    legalizationReasons |= LegalizeOpaqueLocal;
   } else if (isAKindOfStructuredOrByteBuffer(lhsValType)) {
     // The rhs should be a pointer and the lhs should be a pointer-to-pointer.
     // Directly store the pointer here and let SPIRV-Tools opt to do the clean
@@ -5050,7 +5246,7 @@ void SpirvEmitter::storeValue(SpirvInstruction *lhsPtr,
     //
     // Note: legalization specific code
     spvBuilder.createStore(lhsPtr, rhsVal, loc);
-    needsLegalization = true;
+    legalizationReasons |= LegalizeResourceAlias;
 
     // For ConstantBuffers/TextureBuffers, we decompose and assign each field
     // recursively like normal structs using the following logic.
@@ -5096,7 +5292,7 @@ void SpirvEmitter::storeValue(SpirvInstruction *lhsPtr,
   } else if (lhsPtr->getLayoutRule() == rhsVal->getLayoutRule()) {
     // If lhs and rhs has the same memory layout, we should be safe to load
     // from rhs and directly store into lhs and avoid decomposing rhs.
-    // Note: this check should happen after those setting needsLegalization.
+    // Note: this check should happen after those setting legalizationReasons.
     // TODO: is this optimization always correct?
     spvBuilder.createStore(lhsPtr, rhsVal, loc);
   } else if (lhsValType->isRecordType() || lhsValType->isConstantArrayType() ||
@@ -8877,7 +9073,7 @@ SpirvInstruction *SpirvEmitter::processIntrinsicUsingSpirvInst(
     case spv::Op::OpFwidth:
     case spv::Op::OpFwidthFine:
     case spv::Op::OpFwidthCoarse:
-      needsLegalization = true;
+      legalizationReasons |= LegalizeStageInstruction;
       break;
     default:
       // Only the given opcodes need legalization. Anything else should preserve
@@ -38,6 +38,8 @@
 namespace clang {
 namespace spirv {
 
+struct LegalizationPass;
+
 /// SPIR-V emitter class. It consumes the HLSL AST and emits SPIR-V words.
 ///
 /// This class only overrides the HandleTranslationUnit() method; Traversing
@@ -947,6 +949,23 @@ private:
                               const clang::FunctionDecl *,
                               bool isEntryFunction);
 
+  /// \brief Collects the SPIRV-Tools passes that legalize the constructs
+  /// recorded in legalizationReasons. Leaves passes empty if the whole
+  /// legalization pipeline has to run, or if no legalization is needed.
+  void selectLegalizationPasses(
+      llvm::SmallVectorImpl<const LegalizationPass *> *passes);
+
+  /// \brief Runs the given legalization passes, or the whole legalization
+  /// pipeline if there are none, and the optimization passes if enabled.
+  /// Emits an error and returns false on failure.
+  bool legalizeAndOptimize(
+      std::vector<uint32_t> *m,
+      llvm::ArrayRef<const LegalizationPass *> legalizationPasses);
+
+  /// \brief Reports the legalization reasons and the passes selected for them
+  /// as a remark.
+  void reportLegalization(llvm::ArrayRef<const LegalizationPass *> passes);
+
 private:
   /// \brief Wrapper method to create a fatal error message and report it
   /// in the diagnostic engine associated with this consumer.
@@ -976,6 +995,15 @@ private:
     return diags.Report(loc, diagId);
   }
 
+  /// \brief Wrapper method to create a remark message and report it
+  /// in the diagnostic engine associated with this consumer
+  template <unsigned N>
+  DiagnosticBuilder emitRemark(const char (&message)[N], SourceLocation loc) {
+    const auto diagId =
+        diags.getCustomDiagID(clang::DiagnosticsEngine::Remark, message);
+    return diags.Report(loc, diagId);
+  }
+
   /// \brief Wrapper method to create a note message and report it
   /// in the diagnostic engine associated with this consumer
   template <unsigned N>
@@ -1040,21 +1068,29 @@ private:
   /// all 32-bit scalar constants will be translated into OpSpecConstant.
   bool isSpecConstantMode;
 
-  /// Whether the translated SPIR-V binary needs legalization.
-  ///
-  /// The following cases will require legalization:
-  ///
-  /// 1. Opaque types (textures, samplers) within structs
-  /// 2. Structured buffer aliasing
-  /// 3. Using SPIR-V instructions not allowed in the currect shader stage
+  /// The constructs in the translated SPIR-V binary that need legalization.
+  /// Each one decides which SPIRV-Tools passes have to run.
+  enum LegalizationReason : uint32_t {
+    /// Opaque types (textures, samplers) in local variables or structs.
+    LegalizeOpaqueLocal = 1 << 0,
+    /// Structured buffer aliasing.
+    LegalizeResourceAlias = 1 << 1,
+    /// Function arguments not in the Function storage class.
+    LegalizeArgumentScope = 1 << 2,
+    /// SPIR-V instructions not allowed in the current shader stage.
+    LegalizeStageInstruction = 1 << 3,
+  };
+
+  /// The LegalizationReason flags of the translated SPIR-V binary.
   ///
-  /// This covers the first and third case.
+  /// Structured buffer aliasing of declarations is tracked by DeclResultIdMapper
+  /// instead.
   ///
-  /// If this is true, SPIRV-Tools legalization passes will be executed after
-  /// the translation to legalize the generated SPIR-V binary.
+  /// If this is not zero, SPIRV-Tools legalization passes will be executed
+  /// after the translation to legalize the generated SPIR-V binary.
   ///
   /// Note: legalization specific code
-  bool needsLegalization;
+  uint32_t legalizationReasons;
 
   /// Whether the translated SPIR-V binary passes --before-hlsl-legalization
   /// option to spirv-val because of illegal function parameter scope.
@@ -31,32 +31,36 @@ bool SpirvFunction::invokeVisitor(Visitor *visitor, bool reverseOrder) {
     visitor->visit(param);
 
   // Collect basic blocks in a human-readable order that satisfies SPIR-V
-  // validation rules.
-  std::vector<SpirvBasicBlock *> orderedBlocks;
-  if (!basicBlocks.empty()) {
-    BlockReadableOrderVisitor([&orderedBlocks](SpirvBasicBlock *block) {
-      orderedBlocks.push_back(block);
+  // validation rules. Every visitor of the module walks the same order, so it
+  // is only computed once.
+  if (orderedBlocks.empty() && !basicBlocks.empty()) {
+    std::vector<SpirvBasicBlock *> *blocks = &orderedBlocks;
+    BlockReadableOrderVisitor([blocks](SpirvBasicBlock *block) {
+      blocks->push_back(block);
     }).visit(basicBlocks.front());
   }
 
   SpirvBasicBlock *firstBB = orderedBlocks.empty() ? nullptr : orderedBlocks[0];
 
-  if (reverseOrder)
-    std::reverse(orderedBlocks.begin(), orderedBlocks.end());
-
-  for (auto *bb : orderedBlocks) {
+  auto visitBlock = [this, visitor, firstBB,
+                     reverseOrder](SpirvBasicBlock *bb) {
     // The first basic block of the function should first visit the function
-    // variables.
-    if (bb == firstBB) {
-      if (!bb->invokeVisitor(visitor, variables, reverseOrder))
+    // variables. The rest of the basic blocks in the function do not need to
+    // visit function variables.
+    if (bb == firstBB)
+      return bb->invokeVisitor(visitor, variables, reverseOrder);
+    return bb->invokeVisitor(visitor, {}, reverseOrder);
+  };
+
+  if (reverseOrder) {
+    for (auto iter = orderedBlocks.rbegin(); iter != orderedBlocks.rend();
+         ++iter)
+      if (!visitBlock(*iter))
         return false;
-    }
-    // The rest of the basic blocks in the function do not need to visit
-    // function variables.
-    else {
-      if (!bb->invokeVisitor(visitor, {}, reverseOrder))
+  } else {
+    for (auto *bb : orderedBlocks)
+      if (!visitBlock(bb))
         return false;
-    }
   }
 
   if (!visitor->visit(this, Visitor::Phase::Done))
@@ -75,9 +79,18 @@ void SpirvFunction::addVariable(SpirvVariable *var) {
   variables.push_back(var);
 }
 
+size_t SpirvFunction::getNumInstructions() const {
+  // OpFunction and OpFunctionEnd
+  size_t numInstructions = 2 + parameters.size() + variables.size();
+  for (const auto *bb : basicBlocks)
+    numInstructions += 1 + bb->getNumInstructions();
+  return numInstructions;
+}
+
 void SpirvFunction::addBasicBlock(SpirvBasicBlock *bb) {
   assert(bb && "cannot add null basic block to function");
   basicBlocks.push_back(bb);
+  orderedBlocks.clear();
 }
 
 } // end namespace spirv
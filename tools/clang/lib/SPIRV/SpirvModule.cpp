@@ -166,6 +166,13 @@ bool SpirvModule::invokeVisitor(Visitor *visitor, bool reverseOrder) {
   return true;
 }
 
+size_t SpirvModule::getNumInstructions() const {
+  size_t numInstructions = variables.size();
+  for (const auto *fn : functions)
+    numInstructions += fn->getNumInstructions();
+  return numInstructions;
+}
+
 void SpirvModule::addFunction(SpirvFunction *fn) {
   assert(fn && "cannot add null function to the module");
   functions.push_back(fn);
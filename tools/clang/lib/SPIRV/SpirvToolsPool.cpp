@@ -0,0 +1,217 @@
+//===---- SpirvToolsPool.cpp - Pooled SPIRV-Tools Instances -----*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//===----------------------------------------------------------------------===//
+
+#include "clang/SPIRV/SpirvToolsPool.h"
+
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+#include "dxc/Support/Global.h"
+#include "spirv-tools/libspirv.hpp"
+#include "spirv-tools/optimizer.hpp"
+#include "llvm/Support/ManagedStatic.h"
+
+namespace clang {
+namespace spirv {
+
+namespace {
+
+/// An optimizer with its passes registered, and the buffers its runs write
+/// to. The buffers keep their capacity for the next run.
+struct PooledOptimizer {
+  std::unique_ptr<spvtools::Optimizer> optimizer;
+  std::vector<uint32_t> output;
+  std::string messages;
+  bool registered;
+};
+
+struct PooledValidator {
+  std::unique_ptr<spvtools::SpirvTools> tools;
+  std::string messages;
+};
+
+/// Idle optimizers and validators. Everything in the pool outlives the
+/// compilation that creates it, so it is allocated from the default
+/// allocator and released by llvm_shutdown.
+class SpirvToolsPool {
+public:
+  PooledOptimizer *acquireOptimizer(spv_target_env env, llvm::StringRef key,
+                                    bool *created) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto &idle = idleOptimizers[std::make_pair(env, key.str())];
+    *created = idle.empty();
+    if (*created) {
+      ++stats.optimizersCreated;
+      return nullptr;
+    }
+    ++stats.optimizersReused;
+    PooledOptimizer *result = idle.back().release();
+    idle.pop_back();
+    return result;
+  }
+
+  void releaseOptimizer(spv_target_env env, llvm::StringRef key,
+                        PooledOptimizer *pooled) {
+    std::unique_ptr<PooledOptimizer> owned(pooled);
+    if (!pooled->registered)
+      return;
+    std::lock_guard<std::mutex> lock(mutex);
+    auto &idle = idleOptimizers[std::make_pair(env, key.str())];
+    if (idle.size() < kMaxIdlePerKey)
+      idle.push_back(std::move(owned));
+  }
+
+  PooledValidator *acquireValidator(spv_target_env env) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto &idle = idleValidators[env];
+    if (idle.empty()) {
+      ++stats.validatorsCreated;
+      return nullptr;
+    }
+    ++stats.validatorsReused;
+    PooledValidator *result = idle.back().release();
+    idle.pop_back();
+    return result;
+  }
+
+  void releaseValidator(spv_target_env env, PooledValidator *pooled) {
+    std::unique_ptr<PooledValidator> owned(pooled);
+    std::lock_guard<std::mutex> lock(mutex);
+    auto &idle = idleValidators[env];
+    if (idle.size() < kMaxIdlePerKey)
+      idle.push_back(std::move(owned));
+  }
+
+  void addConstructionTime(std::chrono::steady_clock::time_point start) {
+    const uint64_t microseconds =
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start)
+            .count();
+    std::lock_guard<std::mutex> lock(mutex);
+    stats.constructionMicroseconds += microseconds;
+  }
+
+  SpirvToolsPoolStats getStats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+  }
+
+private:
+  // Bounds the idle instances kept for threads that stopped compiling.
+  static const size_t kMaxIdlePerKey = 16;
+
+  std::mutex mutex;
+  std::map<std::pair<spv_target_env, std::string>,
+           std::vector<std::unique_ptr<PooledOptimizer>>>
+      idleOptimizers;
+  std::map<spv_target_env, std::vector<std::unique_ptr<PooledValidator>>>
+      idleValidators;
+  SpirvToolsPoolStats stats = {};
+};
+
+llvm::ManagedStatic<SpirvToolsPool> pool;
+
+SpirvToolsPool &getPool() {
+  // Only reached with the default allocator installed.
+  return *pool;
+}
+
+} // namespace
+
+bool runPooledOptimizer(
+    spv_target_env env, llvm::StringRef passesKey,
+    llvm::function_ref<bool(spvtools::Optimizer &)> registerPasses,
+    std::vector<uint32_t> *module, std::string *messages) {
+  PooledOptimizer *pooled;
+  bool success;
+  {
+    DxcThreadMalloc TM(nullptr);
+    bool created;
+    pooled = getPool().acquireOptimizer(env, passesKey, &created);
+    if (created) {
+      const auto start = std::chrono::steady_clock::now();
+      pooled = new PooledOptimizer();
+      pooled->optimizer.reset(new spvtools::Optimizer(env));
+      std::string *pooledMessages = &pooled->messages;
+      pooled->optimizer->SetMessageConsumer(
+          [pooledMessages](spv_message_level_t /*level*/,
+                           const char * /*source*/,
+                           const spv_position_t & /*position*/,
+                           const char *message) { *pooledMessages += message; });
+      pooled->registered = registerPasses(*pooled->optimizer);
+      getPool().addConstructionTime(start);
+    }
+
+    success = pooled->registered;
+    if (success) {
+      spvtools::OptimizerOptions options;
+      options.set_run_validator(false);
+      pooled->output.clear();
+      success = pooled->optimizer->Run(module->data(), module->size(),
+                                       &pooled->output, options);
+    }
+  }
+
+  // The results go to buffers of the compilation, so they are copied with
+  // its allocator.
+  if (success)
+    module->assign(pooled->output.begin(), pooled->output.end());
+  messages->append(pooled->messages);
+
+  {
+    DxcThreadMalloc TM(nullptr);
+    pooled->messages.clear();
+    getPool().releaseOptimizer(env, passesKey, pooled);
+  }
+  return success;
+}
+
+bool runPooledValidator(spv_target_env env,
+                        const spvtools::ValidatorOptions &options,
+                        const std::vector<uint32_t> &module,
+                        std::string *messages) {
+  PooledValidator *pooled;
+  bool success;
+  {
+    DxcThreadMalloc TM(nullptr);
+    pooled = getPool().acquireValidator(env);
+    if (pooled == nullptr) {
+      const auto start = std::chrono::steady_clock::now();
+      pooled = new PooledValidator();
+      pooled->tools.reset(new spvtools::SpirvTools(env));
+      std::string *pooledMessages = &pooled->messages;
+      pooled->tools->SetMessageConsumer(
+          [pooledMessages](spv_message_level_t /*level*/,
+                           const char * /*source*/,
+                           const spv_position_t & /*position*/,
+                           const char *message) { *pooledMessages += message; });
+      getPool().addConstructionTime(start);
+    }
+    success = pooled->tools->Validate(module.data(), module.size(), options);
+  }
+
+  messages->append(pooled->messages);
+
+  {
+    DxcThreadMalloc TM(nullptr);
+    pooled->messages.clear();
+    getPool().releaseValidator(env, pooled);
+  }
+  return success;
+}
+
+SpirvToolsPoolStats getSpirvToolsPoolStats() {
+  DxcThreadMalloc TM(nullptr);
+  return getPool().getStats();
+}
+
+} // end namespace spirv
+} // end namespace clang
@@ -12,6 +12,8 @@
 
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/ManagedStatic.h"
 #include "clang/AST/ASTContext.h"
 #include "clang/AST/Attr.h"
 #include "clang/AST/DeclCXX.h"
@@ -2207,6 +2209,99 @@ bool TemplateHasDefaultType(ArBasicKind kind)
   }
 }
 
+/// <summary>
+/// Index over the builtin intrinsic tables. Overloads that share a name and
+/// argument count are adjacent in the generated tables, so each lookup is
+/// answered with a contiguous range of table entries.
+/// </summary>
+class BuiltinIntrinsicIndex
+{
+public:
+  typedef std::pair<const HLSL_INTRINSIC*, const HLSL_INTRINSIC*> Range;
+
+  BuiltinIntrinsicIndex()
+  {
+    AddTable(g_Intrinsics, _countof(g_Intrinsics));
+    for (unsigned kind = 0; kind < AR_BASIC_MAXIMUM_COUNT; ++kind) {
+      const HLSL_INTRINSIC* intrinsics;
+      size_t intrinsicCount;
+      GetIntrinsicMethods((ArBasicKind)kind, &intrinsics, &intrinsicCount);
+      AddTable(intrinsics, intrinsicCount);
+    }
+  }
+
+  /// <summary>Gets the process-wide index, building it on first use.</summary>
+  static const BuiltinIntrinsicIndex& Get();
+
+  /// <summary>Returns the overloads in table with the given name and argument count; the range is empty if there are none.</summary>
+  Range Lookup(_In_opt_ const HLSL_INTRINSIC* table, StringRef name, size_t argCount) const
+  {
+    auto it = m_entries.find(name);
+    if (it != m_entries.end()) {
+      for (const Entry& entry : it->second) {
+        if (entry.Table == table && entry.NumArgs == argCount + 1) { // uNumArgs includes return
+          return Range(entry.First, entry.Last);
+        }
+      }
+    }
+    DXASSERT(table == nullptr || m_tables.count(table), "otherwise table was not indexed");
+    return Range(nullptr, nullptr);
+  }
+
+private:
+  struct Entry {
+    const HLSL_INTRINSIC* Table;
+    UINT NumArgs;
+    const HLSL_INTRINSIC* First;
+    const HLSL_INTRINSIC* Last;
+  };
+
+  void AddTable(_In_count_(count) const HLSL_INTRINSIC* table, size_t count)
+  {
+    if (table == nullptr || !m_tables.insert(table).second) {
+      return;
+    }
+
+    const HLSL_INTRINSIC* end = table + count;
+    for (const HLSL_INTRINSIC* first = table; first != end;) {
+      StringRef name(first->pArgs[0].pName);
+      const HLSL_INTRINSIC* last = first + 1;
+      while (last != end && last->uNumArgs == first->uNumArgs && name.equals(last->pArgs[0].pName)) {
+        ++last;
+      }
+
+      // Lookups have always stopped at the end of the first run, so a later
+      // run with the same name and argument count is not reachable.
+      llvm::SmallVectorImpl<Entry>& entries = m_entries[name];
+      bool found = false;
+      for (const Entry& entry : entries) {
+        found |= entry.Table == table && entry.NumArgs == first->uNumArgs;
+      }
+      if (!found) {
+        Entry entry = { table, first->uNumArgs, first, last };
+        entries.push_back(entry);
+      }
+      first = last;
+    }
+  }
+
+  llvm::StringMap<llvm::SmallVector<Entry, 1> > m_entries;
+  llvm::SmallPtrSet<const HLSL_INTRINSIC*, 64> m_tables;
+};
+
+static llvm::ManagedStatic<BuiltinIntrinsicIndex> g_BuiltinIntrinsicIndex;
+
+const BuiltinIntrinsicIndex& BuiltinIntrinsicIndex::Get()
+{
+  if (!g_BuiltinIntrinsicIndex.isConstructed()) {
+    // The index outlives the compilation that builds it, so it is allocated
+    // from the default allocator and released by llvm_shutdown.
+    DxcThreadMalloc TM(nullptr);
+    return *g_BuiltinIntrinsicIndex;
+  }
+  return *g_BuiltinIntrinsicIndex;
+}
+
 /// <summary>
 /// Use this class to iterate over intrinsic definitions that come from an external source.
 /// </summary>
@@ -2221,6 +2316,8 @@ private:
   unsigned _tableIndex;
   unsigned _argCount;
   bool _firstChecked;
+  std::wstring _wideTypeName;
+  std::wstring _wideFunctionName;
 
   IntrinsicTableDefIter(
     llvm::SmallVector<CComPtr<IDxcIntrinsicTable>, 2>& tables,
@@ -2238,14 +2335,16 @@ private:
       return;
     }
 
+    if (!_firstChecked) {
+      // Convert the names once; every table is queried with the same ones.
+      _wideTypeName = CA2WEX<>(_typeName.str().c_str(), CP_UTF8).m_psz;
+      _wideFunctionName = CA2WEX<>(_functionName.str().c_str(), CP_UTF8).m_psz;
+    }
     _firstChecked = true;
 
-    // TODO: review this - this will allocate at least once per string
-    CA2WEX<> typeName(_typeName.str().c_str(), CP_UTF8);
-    CA2WEX<> functionName(_functionName.str().c_str(), CP_UTF8);
-
     if (FAILED(_tables[_tableIndex]->LookupIntrinsic(
-            typeName, functionName, &_tableIntrinsic, &_tableLookupCookie))) {
+            _wideTypeName.c_str(), _wideFunctionName.c_str(), &_tableIntrinsic,
+            &_tableLookupCookie))) {
       _tableLookupCookie = 0;
       _tableIntrinsic = nullptr;
     }
@@ -2329,22 +2428,26 @@ public:
 class IntrinsicDefIter
 {
   const HLSL_INTRINSIC* _current;
+  const HLSL_INTRINSIC* _rangeEnd;
   const HLSL_INTRINSIC* _end;
   IntrinsicTableDefIter _tableIter;
 
-  IntrinsicDefIter(const HLSL_INTRINSIC* value, const HLSL_INTRINSIC* end, IntrinsicTableDefIter tableIter) :
-    _current(value), _end(end), _tableIter(tableIter)
+  IntrinsicDefIter(const HLSL_INTRINSIC* value, const HLSL_INTRINSIC* rangeEnd, const HLSL_INTRINSIC* end, IntrinsicTableDefIter tableIter) :
+    _current(value), _rangeEnd(rangeEnd), _end(end), _tableIter(tableIter)
   { }
 
 public:
-  static IntrinsicDefIter CreateStart(const HLSL_INTRINSIC* table, size_t count, const HLSL_INTRINSIC* start, IntrinsicTableDefIter tableIter)
+  static IntrinsicDefIter CreateStart(const HLSL_INTRINSIC* table, size_t count, BuiltinIntrinsicIndex::Range range, IntrinsicTableDefIter tableIter)
   {
-    return IntrinsicDefIter(start, table + count, tableIter);
+    if (range.first == range.second) {
+      return CreateEnd(table, count, tableIter);
+    }
+    return IntrinsicDefIter(range.first, range.second, table + count, tableIter);
   }
 
   static IntrinsicDefIter CreateEnd(const HLSL_INTRINSIC* table, size_t count, IntrinsicTableDefIter tableIter)
   {
-    return IntrinsicDefIter(table + count, table + count, tableIter);
+    return IntrinsicDefIter(table + count, table + count, table + count, tableIter);
   }
 
   bool operator!=(const IntrinsicDefIter& other)
@@ -2370,11 +2473,8 @@ public:
   IntrinsicDefIter& operator++()
   {
     if (_current != _end) {
-      const HLSL_INTRINSIC* next = _current + 1;
-      if (next != _end && _current->uNumArgs == next->uNumArgs && 0 == strcmp(_current->pArgs[0].pName, next->pArgs[0].pName)) {
-        _current = next;
-      }
-      else {
+      ++_current;
+      if (_current == _rangeEnd) {
         _current = _end;
       }
     } else {
@@ -3150,6 +3250,9 @@ private:
   };
 
   int FindObjectBasicKindIndex(const CXXRecordDecl* recordDecl) {
+    // Entries for object types that are not declared yet are null.
+    if (recordDecl == nullptr)
+      return -1;
     auto begin = m_objectTypeDeclsMap.begin();
     auto end = m_objectTypeDeclsMap.end();
     auto val = std::make_pair(const_cast<CXXRecordDecl*>(recordDecl), 0);
@@ -3162,110 +3265,143 @@ private:
       return -1;
   }
 
-  // Adds all built-in HLSL object types.
-  void AddObjectTypes()
+  // Declares the built-in object type at the given index into
+  // g_ArBasicKindsAsTypes. Object types are declared on first use, so a
+  // translation unit only pays for the objects it references.
+  CXXRecordDecl *DeclareObjectType(unsigned i)
   {
     DXASSERT(m_context != nullptr, "otherwise caller hasn't initialized context yet");
-
-    QualType float4Type = LookupVectorType(HLSLScalarType_float, 4);
-    TypeSourceInfo *float4TypeSourceInfo = m_context->getTrivialTypeSourceInfo(float4Type, NoLoc);
-    m_objectTypeLazyInitMask = 0;
-    unsigned effectKindIndex = 0;
-    for (unsigned i = 0; i < _countof(g_ArBasicKindsAsTypes); i++)
-    {
-      ArBasicKind kind = g_ArBasicKindsAsTypes[i];
-      if (kind == AR_OBJECT_WAVE) { // wave objects are currently unused
-        continue;
-      }
-      if (kind == AR_OBJECT_LEGACY_EFFECT)
-        effectKindIndex = i;
-
-      DXASSERT(kind < _countof(g_ArBasicTypeNames), "g_ArBasicTypeNames has the wrong number of entries");
-      _Analysis_assume_(kind < _countof(g_ArBasicTypeNames));
-      const char* typeName = g_ArBasicTypeNames[kind];
-      uint8_t templateArgCount = g_ArBasicKindsTemplateCount[i];
-      CXXRecordDecl* recordDecl = nullptr;
-      if (kind == AR_OBJECT_RAY_DESC) {
-        QualType float3Ty = LookupVectorType(HLSLScalarType::HLSLScalarType_float, 3);
-        recordDecl = CreateRayDescStruct(*m_context, float3Ty);
-      } else if (kind == AR_OBJECT_TRIANGLE_INTERSECTION_ATTRIBUTES) {
-        QualType float2Type = LookupVectorType(HLSLScalarType::HLSLScalarType_float, 2);
-        recordDecl = AddBuiltInTriangleIntersectionAttributes(*m_context, float2Type);
-      } else if (IsSubobjectBasicKind(kind)) {
-        switch (kind) {
-        case AR_OBJECT_STATE_OBJECT_CONFIG:
-          recordDecl = CreateSubobjectStateObjectConfig(*m_context);
-          break;
-        case AR_OBJECT_GLOBAL_ROOT_SIGNATURE:
-          recordDecl = CreateSubobjectRootSignature(*m_context, true);
-          break;
-        case AR_OBJECT_LOCAL_ROOT_SIGNATURE:
-          recordDecl = CreateSubobjectRootSignature(*m_context, false);
-          break;
-        case AR_OBJECT_SUBOBJECT_TO_EXPORTS_ASSOC:
-          recordDecl = CreateSubobjectSubobjectToExportsAssoc(*m_context);
-          break;
-          break;
-        case AR_OBJECT_RAYTRACING_SHADER_CONFIG:
-          recordDecl = CreateSubobjectRaytracingShaderConfig(*m_context);
-          break;
-        case AR_OBJECT_RAYTRACING_PIPELINE_CONFIG:
-          recordDecl = CreateSubobjectRaytracingPipelineConfig(*m_context);
-          break;
-        case AR_OBJECT_TRIANGLE_HIT_GROUP:
-          recordDecl = CreateSubobjectTriangleHitGroup(*m_context);
-          break;
-        case AR_OBJECT_PROCEDURAL_PRIMITIVE_HIT_GROUP:
-          recordDecl = CreateSubobjectProceduralPrimitiveHitGroup(*m_context);
-          break;
-        }
-      }
-      else if (templateArgCount == 0)
-      {
-        AddRecordTypeWithHandle(*m_context, &recordDecl, typeName);
-        DXASSERT(recordDecl != nullptr, "AddRecordTypeWithHandle failed to return the object declaration");
-        recordDecl->setImplicit(true);
+    DXASSERT(m_objectTypeDecls[i] == nullptr, "otherwise object type is already declared");
+
+    ArBasicKind kind = g_ArBasicKindsAsTypes[i];
+    DXASSERT(kind != AR_OBJECT_WAVE, "wave objects are currently unused");
+    DXASSERT(kind < _countof(g_ArBasicTypeNames), "g_ArBasicTypeNames has the wrong number of entries");
+    _Analysis_assume_(kind < _countof(g_ArBasicTypeNames));
+    const char* typeName = g_ArBasicTypeNames[kind];
+    uint8_t templateArgCount = g_ArBasicKindsTemplateCount[i];
+    CXXRecordDecl* recordDecl = nullptr;
+    if (kind == AR_OBJECT_RAY_DESC) {
+      QualType float3Ty = LookupVectorType(HLSLScalarType::HLSLScalarType_float, 3);
+      recordDecl = CreateRayDescStruct(*m_context, float3Ty);
+    } else if (kind == AR_OBJECT_TRIANGLE_INTERSECTION_ATTRIBUTES) {
+      QualType float2Type = LookupVectorType(HLSLScalarType::HLSLScalarType_float, 2);
+      recordDecl = AddBuiltInTriangleIntersectionAttributes(*m_context, float2Type);
+    } else if (IsSubobjectBasicKind(kind)) {
+      switch (kind) {
+      case AR_OBJECT_STATE_OBJECT_CONFIG:
+        recordDecl = CreateSubobjectStateObjectConfig(*m_context);
+        break;
+      case AR_OBJECT_GLOBAL_ROOT_SIGNATURE:
+        recordDecl = CreateSubobjectRootSignature(*m_context, true);
+        break;
+      case AR_OBJECT_LOCAL_ROOT_SIGNATURE:
+        recordDecl = CreateSubobjectRootSignature(*m_context, false);
+        break;
+      case AR_OBJECT_SUBOBJECT_TO_EXPORTS_ASSOC:
+        recordDecl = CreateSubobjectSubobjectToExportsAssoc(*m_context);
+        break;
+      case AR_OBJECT_RAYTRACING_SHADER_CONFIG:
+        recordDecl = CreateSubobjectRaytracingShaderConfig(*m_context);
+        break;
+      case AR_OBJECT_RAYTRACING_PIPELINE_CONFIG:
+        recordDecl = CreateSubobjectRaytracingPipelineConfig(*m_context);
+        break;
+      case AR_OBJECT_TRIANGLE_HIT_GROUP:
+        recordDecl = CreateSubobjectTriangleHitGroup(*m_context);
+        break;
+      case AR_OBJECT_PROCEDURAL_PRIMITIVE_HIT_GROUP:
+        recordDecl = CreateSubobjectProceduralPrimitiveHitGroup(*m_context);
+        break;
       }
-      else
-      {
-        DXASSERT(templateArgCount == 1 || templateArgCount == 2, "otherwise a new case has been added");
+    }
+    else if (templateArgCount == 0)
+    {
+      AddRecordTypeWithHandle(*m_context, &recordDecl, typeName);
+      DXASSERT(recordDecl != nullptr, "AddRecordTypeWithHandle failed to return the object declaration");
+      recordDecl->setImplicit(true);
+    }
+    else
+    {
+      DXASSERT(templateArgCount == 1 || templateArgCount == 2, "otherwise a new case has been added");
+
+      ClassTemplateDecl* typeDecl = nullptr;
+      TypeSourceInfo* typeDefault = nullptr;
+      if (TemplateHasDefaultType(kind)) {
+        QualType float4Type = LookupVectorType(HLSLScalarType_float, 4);
+        typeDefault = m_context->getTrivialTypeSourceInfo(float4Type, NoLoc);
+      }
+      AddTemplateTypeWithHandle(*m_context, &typeDecl, &recordDecl, typeName, templateArgCount, typeDefault);
+      DXASSERT(typeDecl != nullptr, "AddTemplateTypeWithHandle failed to return the object declaration");
+      typeDecl->setImplicit(true);
+      recordDecl->setImplicit(true);
+    }
+    m_objectTypeDecls[i] = recordDecl;
+    m_objectTypeLazyInitMask |= ((uint64_t)1)<<i;
+
+    // Undeclared entries are null and sort first; take one and keep the map
+    // in order.
+    DXASSERT(m_objectTypeDeclsMap[0].first == nullptr, "otherwise map has no room for the declaration");
+    m_objectTypeDeclsMap[0] = std::make_pair(recordDecl, i);
+    std::sort(m_objectTypeDeclsMap.begin(), m_objectTypeDeclsMap.end(), ObjectTypeDeclMapTypeCmp);
 
-        ClassTemplateDecl* typeDecl = nullptr;
-        TypeSourceInfo* typeDefault = TemplateHasDefaultType(kind) ? float4TypeSourceInfo : nullptr;
-        AddTemplateTypeWithHandle(*m_context, &typeDecl, &recordDecl, typeName, templateArgCount, typeDefault);
-        DXASSERT(typeDecl != nullptr, "AddTemplateTypeWithHandle failed to return the object declaration");
-        typeDecl->setImplicit(true);
-        recordDecl->setImplicit(true);
-      }
-      m_objectTypeDecls[i] = recordDecl;
-      m_objectTypeDeclsMap[i] = std::make_pair(recordDecl, i);
-      m_objectTypeLazyInitMask |= ((uint64_t)1)<<i;
+    for (auto && intrinsic : m_intrinsicTables) {
+      AddIntrinsicTableMethods(intrinsic, i);
     }
+    return recordDecl;
+  }
 
-    // Create an alias for SamplerState. 'sampler' is very commonly used.
-    {
-      DeclContext* currentDeclContext = m_context->getTranslationUnitDecl();
-      IdentifierInfo& samplerId = m_context->Idents.get(StringRef("sampler"), tok::TokenKind::identifier);
-      TypeSourceInfo* samplerTypeSource = m_context->getTrivialTypeSourceInfo(GetBasicKindType(AR_OBJECT_SAMPLER));
-      TypedefDecl* samplerDecl = TypedefDecl::Create(*m_context, currentDeclContext, NoLoc, NoLoc, &samplerId, samplerTypeSource);
-      currentDeclContext->addDecl(samplerDecl);
-      samplerDecl->setImplicit(true);
-
-      // Create decls for each deprecated effect object type:
-      unsigned effectObjBase = _countof(g_ArBasicKindsAsTypes);
-      // TypeSourceInfo* effectObjTypeSource = m_context->getTrivialTypeSourceInfo(GetBasicKindType(AR_OBJECT_LEGACY_EFFECT));
-      for (unsigned i = 0; i < _countof(g_DeprecatedEffectObjectNames); i++) {
-        IdentifierInfo& idInfo = m_context->Idents.get(StringRef(g_DeprecatedEffectObjectNames[i]), tok::TokenKind::identifier);
-        //TypedefDecl* effectObjDecl = TypedefDecl::Create(*m_context, currentDeclContext, NoLoc, NoLoc, &idInfo, effectObjTypeSource);
-        CXXRecordDecl *effectObjDecl = CXXRecordDecl::Create(*m_context, TagTypeKind::TTK_Struct, currentDeclContext, NoLoc, NoLoc, &idInfo);
-        currentDeclContext->addDecl(effectObjDecl);
-        effectObjDecl->setImplicit(true);
-        m_objectTypeDeclsMap[i+effectObjBase] = std::make_pair(effectObjDecl, effectKindIndex);
-      }
+  // Gets the declaration for the built-in object type at the given index into
+  // g_ArBasicKindsAsTypes, declaring it if this is its first use.
+  CXXRecordDecl *GetObjectTypeDecl(unsigned i)
+  {
+    if (m_objectTypeDecls[i] == nullptr && g_ArBasicKindsAsTypes[i] != AR_OBJECT_WAVE)
+      return DeclareObjectType(i);
+    return m_objectTypeDecls[i];
+  }
+
+  // Finds the index into g_ArBasicKindsAsTypes of the object type with the
+  // given name, or -1 if the name is not a built-in object type.
+  int FindObjectTypeIndexByName(StringRef name)
+  {
+    for (unsigned i = 0; i < _countof(g_ArBasicKindsAsTypes); i++) {
+      ArBasicKind kind = g_ArBasicKindsAsTypes[i];
+      if (kind != AR_OBJECT_WAVE && name == g_ArBasicTypeNames[kind])
+        return i;
+    }
+    return -1;
+  }
+
+  // Adds the declarations that stand in for built-in HLSL object types. The
+  // object types themselves are declared on first use by DeclareObjectType.
+  void AddObjectTypes()
+  {
+    DXASSERT(m_context != nullptr, "otherwise caller hasn't initialized context yet");
+
+    const ArBasicKind* effectKind = std::find(g_ArBasicKindsAsTypes, &g_ArBasicKindsAsTypes[_countof(g_ArBasicKindsAsTypes)], AR_OBJECT_LEGACY_EFFECT);
+    unsigned effectKindIndex = effectKind - g_ArBasicKindsAsTypes;
+
+    DeclContext* currentDeclContext = m_context->getTranslationUnitDecl();
+
+    // Create decls for each deprecated effect object type:
+    // TypeSourceInfo* effectObjTypeSource = m_context->getTrivialTypeSourceInfo(GetBasicKindType(AR_OBJECT_LEGACY_EFFECT));
+    for (unsigned i = 0; i < _countof(g_DeprecatedEffectObjectNames); i++) {
+      IdentifierInfo& idInfo = m_context->Idents.get(StringRef(g_DeprecatedEffectObjectNames[i]), tok::TokenKind::identifier);
+      //TypedefDecl* effectObjDecl = TypedefDecl::Create(*m_context, currentDeclContext, NoLoc, NoLoc, &idInfo, effectObjTypeSource);
+      CXXRecordDecl *effectObjDecl = CXXRecordDecl::Create(*m_context, TagTypeKind::TTK_Struct, currentDeclContext, NoLoc, NoLoc, &idInfo);
+      currentDeclContext->addDecl(effectObjDecl);
+      effectObjDecl->setImplicit(true);
+      m_objectTypeDeclsMap[i] = std::make_pair(effectObjDecl, effectKindIndex);
     }
 
     // Make sure it's in order.
     std::sort(m_objectTypeDeclsMap.begin(), m_objectTypeDeclsMap.end(), ObjectTypeDeclMapTypeCmp);
+
+    // Create an alias for SamplerState. 'sampler' is very commonly used.
+    IdentifierInfo& samplerId = m_context->Idents.get(StringRef("sampler"), tok::TokenKind::identifier);
+    TypeSourceInfo* samplerTypeSource = m_context->getTrivialTypeSourceInfo(GetBasicKindType(AR_OBJECT_SAMPLER));
+    TypedefDecl* samplerDecl = TypedefDecl::Create(*m_context, currentDeclContext, NoLoc, NoLoc, &samplerId, samplerTypeSource);
+    currentDeclContext->addDecl(samplerDecl);
+    samplerDecl->setImplicit(true);
   }
 
   FunctionDecl* AddSubscriptSpecialization(
@@ -3319,8 +3455,11 @@ public:
     m_vectorTemplateDecl(nullptr),
     m_context(nullptr),
     m_sema(nullptr),
-    m_hlslStringTypedef(nullptr)
+    m_hlslStringTypedef(nullptr),
+    m_objectTypeLazyInitMask(0)
   {
+    memset(m_objectTypeDecls, 0, sizeof(m_objectTypeDecls));
+    m_objectTypeDeclsMap.fill(ObjectTypeDeclMapType::value_type(nullptr, 0));
     memset(m_matrixTypes, 0, sizeof(m_matrixTypes));
     memset(m_matrixShorthandTypes, 0, sizeof(m_matrixShorthandTypes));
     memset(m_vectorTypes, 0, sizeof(m_vectorTypes));
@@ -3348,11 +3487,15 @@ public:
     m_sema = &S;
     S.addExternalSource(this);
 
+    // Qualified lookups into the translation unit, such as '::Texture2D',
+    // bypass LookupUnqualified; have them come through
+    // FindExternalVisibleDeclsByName so object types are still declared.
+    m_context->getTranslationUnitDecl()->setHasExternalVisibleStorage(true);
+
+    // Object types pick up methods from registered intrinsic tables as
+    // they are declared.
     AddObjectTypes();
     AddStdIsEqualImplementation(S.getASTContext(), S);
-    for (auto && intrinsic : m_intrinsicTables) {
-      AddIntrinsicTableMethods(intrinsic);
-    }
   }
 
   void ForgetSema() override
@@ -3527,9 +3670,43 @@ public:
       TypedefDecl *strDecl = GetStringTypedef();
       R.addDecl(strDecl);
     }
+    // Built-in object types that are not declared yet.
+    else {
+      int index = FindObjectTypeIndexByName(nameIdentifier);
+      if (index != -1 && m_objectTypeDecls[index] == nullptr) {
+        CXXRecordDecl *recordDecl = DeclareObjectType(index);
+        if (ClassTemplateDecl *typeDecl = recordDecl->getDescribedClassTemplate())
+          R.addDecl(typeDecl);
+        else
+          R.addDecl(recordDecl);
+        return true;
+      }
+    }
     return false;
   }
 
+  bool FindExternalVisibleDeclsByName(const DeclContext *DC, DeclarationName Name) override
+  {
+    if (!DC->isTranslationUnit() || m_sema == nullptr ||
+        m_sema->Diags.hasFatalErrorOccurred()) {
+      return false;
+    }
+    IdentifierInfo* idInfo = Name.getAsIdentifierInfo();
+    if (idInfo == nullptr) {
+      return false;
+    }
+    int index = FindObjectTypeIndexByName(idInfo->getName());
+    if (index == -1 || m_objectTypeDecls[index] != nullptr) {
+      return false;
+    }
+
+    // Record the name as looked up before declaring the type, so adding the
+    // declaration to the translation unit does not come back here.
+    SetNoExternalVisibleDeclsForName(DC, Name);
+    DeclareObjectType(index);
+    return true;
+  }
+
   /// <summary>
   /// Determines whether the specify record type is a matrix, another HLSL object, or a user-defined structure.
   /// </sumary>
@@ -3761,34 +3938,39 @@ public:
     DXASSERT_NOMSG(table != nullptr);
 
     // Function intrinsics are added on-demand, objects get template methods.
+    // Objects that are not declared yet get them from DeclareObjectType.
     for (unsigned i = 0; i < _countof(g_ArBasicKindsAsTypes); i++) {
-      // Grab information already processed by AddObjectTypes.
-      ArBasicKind kind = g_ArBasicKindsAsTypes[i];
-      const char *typeName = g_ArBasicTypeNames[kind];
-      uint8_t templateArgCount = g_ArBasicKindsTemplateCount[i];
-      DXASSERT(templateArgCount <= 2, "otherwise a new case has been added");
-      int startDepth = (templateArgCount == 0) ? 0 : 1;
-      CXXRecordDecl *recordDecl = m_objectTypeDecls[i];
-      if (recordDecl == nullptr) {
-        DXASSERT(kind == AR_OBJECT_WAVE, "else objects other than reserved not initialized");
-        continue;
-      }
+      if (m_objectTypeDecls[i] != nullptr)
+        AddIntrinsicTableMethods(table, i);
+    }
+  }
 
-      // This is a variation of AddObjectMethods using the new table.
-      const HLSL_INTRINSIC *pIntrinsic = nullptr;
-      const HLSL_INTRINSIC *pPrior = nullptr;
-      UINT64 lookupCookie = 0;
-      CA2W wideTypeName(typeName);
-      HRESULT found = table->LookupIntrinsic(wideTypeName, L"*", &pIntrinsic, &lookupCookie);
-      while (pIntrinsic != nullptr && SUCCEEDED(found)) {
-        if (!AreIntrinsicTemplatesEquivalent(pIntrinsic, pPrior)) {
-          AddObjectIntrinsicTemplate(recordDecl, startDepth, pIntrinsic);
-          // NOTE: this only works with the current implementation because
-          // intrinsics are alive as long as the table is alive.
-          pPrior = pIntrinsic;
-        }
-        found = table->LookupIntrinsic(wideTypeName, L"*", &pIntrinsic, &lookupCookie);
+  void AddIntrinsicTableMethods(_In_ IDxcIntrinsicTable *table, unsigned i) {
+    DXASSERT_NOMSG(table != nullptr);
+
+    // Grab information already processed by DeclareObjectType.
+    ArBasicKind kind = g_ArBasicKindsAsTypes[i];
+    const char *typeName = g_ArBasicTypeNames[kind];
+    uint8_t templateArgCount = g_ArBasicKindsTemplateCount[i];
+    DXASSERT(templateArgCount <= 2, "otherwise a new case has been added");
+    int startDepth = (templateArgCount == 0) ? 0 : 1;
+    CXXRecordDecl *recordDecl = m_objectTypeDecls[i];
+    DXASSERT_NOMSG(recordDecl != nullptr);
+
+    // This is a variation of AddObjectMethods using the new table.
+    const HLSL_INTRINSIC *pIntrinsic = nullptr;
+    const HLSL_INTRINSIC *pPrior = nullptr;
+    UINT64 lookupCookie = 0;
+    CA2W wideTypeName(typeName);
+    HRESULT found = table->LookupIntrinsic(wideTypeName, L"*", &pIntrinsic, &lookupCookie);
+    while (pIntrinsic != nullptr && SUCCEEDED(found)) {
+      if (!AreIntrinsicTemplatesEquivalent(pIntrinsic, pPrior)) {
+        AddObjectIntrinsicTemplate(recordDecl, startDepth, pIntrinsic);
+        // NOTE: this only works with the current implementation because
+        // intrinsics are alive as long as the table is alive.
+        pPrior = pIntrinsic;
       }
+      found = table->LookupIntrinsic(wideTypeName, L"*", &pIntrinsic, &lookupCookie);
     }
   }
 
@@ -3909,7 +4091,7 @@ public:
         const ArBasicKind* match = std::find(g_ArBasicKindsAsTypes, &g_ArBasicKindsAsTypes[_countof(g_ArBasicKindsAsTypes)], kind);
         DXASSERT(match != &g_ArBasicKindsAsTypes[_countof(g_ArBasicKindsAsTypes)], "otherwise can't find constant in basic kinds");
         size_t index = match - g_ArBasicKindsAsTypes;
-        return m_context->getTagDeclType(this->m_objectTypeDecls[index]);
+        return m_context->getTagDeclType(GetObjectTypeDecl(index));
     }
 
     case AR_OBJECT_SAMPLER1D:
@@ -4034,30 +4216,10 @@ public:
     StringRef nameIdentifier,
     size_t argumentCount)
   {
-    // This is implemented by a linear scan for now.
-    // We tested binary search on tables, and there was no performance gain on
-    // samples probably for the following reasons.
-    // 1. The tables are not big enough to make noticable difference
-    // 2. The user of this function assumes that it returns the first entry in
-    // the table that matches name and argument count. So even in the binary
-    // search, we have to scan backwards until the entry does not match the name
-    // or arg count. For linear search this is not a problem
-    for (unsigned int i = 0; i < tableSize; i++) {
-      const HLSL_INTRINSIC* pIntrinsic = &table[i];
-
-      // Do some quick checks to verify size and name.
-      if (pIntrinsic->uNumArgs != 1 + argumentCount) {
-        continue;
-      }
-      if (!nameIdentifier.equals(StringRef(pIntrinsic->pArgs[0].pName))) {
-        continue;
-      }
-
-      return IntrinsicDefIter::CreateStart(table, tableSize, pIntrinsic,
-        IntrinsicTableDefIter::CreateStart(m_intrinsicTables, typeName, nameIdentifier, argumentCount));
-    }
-
-    return IntrinsicDefIter::CreateStart(table, tableSize, table + tableSize,
+    // The builtin tables are indexed by name and argument count; extension
+    // tables are queried through IDxcIntrinsicTable::LookupIntrinsic.
+    return IntrinsicDefIter::CreateStart(table, tableSize,
+      BuiltinIntrinsicIndex::Get().Lookup(table, nameIdentifier, argumentCount),
       IntrinsicTableDefIter::CreateStart(m_intrinsicTables, typeName, nameIdentifier, argumentCount));
   }
 
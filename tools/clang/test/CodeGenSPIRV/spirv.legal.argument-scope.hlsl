@@ -0,0 +1,17 @@
+// Run: %dxc -T vs_6_0 -E main -O0
+
+RWStructuredBuffer<float> Data;
+
+void foo(in float a, inout float b, out float c) {
+    b += a;
+    c = a + b;
+}
+
+// Passing buffer elements as inout/out arguments only runs the inlining
+// passes. Their output must pass validation with the strict rules.
+void main(float input : INPUT) {
+    foo(input, Data[0], Data[1]);
+}
+
+// CHECK: OpEntryPoint Vertex %main "main"
+// CHECK-NOT: OpFunctionCall
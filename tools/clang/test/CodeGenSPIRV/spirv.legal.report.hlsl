@@ -0,0 +1,16 @@
+// Run: %dxc -T vs_6_0 -E main -O3 -fspv-report-legalization
+
+RWStructuredBuffer<float> Data;
+
+void foo(in float a, inout float b, out float c) {
+    b += a;
+    c = a + b;
+}
+
+// Passing buffer elements as inout/out arguments only needs the calls to be
+// inlined, not the whole legalization pipeline.
+void main(float input : INPUT) {
+    foo(input, Data[0], Data[1]);
+}
+
+// CHECK: remark: SPIR-V legalization of main for argument-scope: eliminate-dead-branches, merge-return, inline-entry-points-exhaustive, eliminate-dead-functions, fix-storage-class
@@ -0,0 +1,23 @@
+// Run: %dxc -T vs_6_0 -E main -O0
+
+Texture2D<float4> Tex;
+SamplerState      Samp;
+
+float4 sampleTex(float2 uv, bool implicitLod) {
+    if (implicitLod)
+        return Tex.Sample(Samp, uv);
+    return Tex.SampleLevel(Samp, uv, 0);
+}
+
+// Implicit-lod sampling is not allowed in vertex shaders. The call is inlined
+// and the branch that cannot be reached is removed, and the result must pass
+// validation with the strict rules.
+float4 main(float2 uv : TEXCOORD) : SV_Position {
+    return sampleTex(uv, false);
+}
+
+// CHECK: OpEntryPoint Vertex %main "main"
+// CHECK-NOT: OpFunctionCall
+// CHECK-NOT: OpImageSampleImplicitLod
+// CHECK: OpImageSampleExplicitLod
+// CHECK-NOT: OpImageSampleImplicitLod
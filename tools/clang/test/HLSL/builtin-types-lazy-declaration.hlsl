@@ -0,0 +1,46 @@
+// RUN: %clang_cc1 -fsyntax-only -ffreestanding -verify %s
+
+// Built-in object types are declared on first use. Each object type below is
+// first named in a different context, and must resolve the same way it did
+// when every object type was declared up front.
+
+// expected-no-diagnostics
+
+// First use through the 'sampler' alias, then by its own name.
+sampler s0;
+SamplerState s1;
+
+// First use in a typedef.
+typedef RWTexture2D<float> OutputTexture;
+OutputTexture output;
+
+// First use inside a namespace and inside a struct.
+namespace ns {
+  Texture2D<float4> nsTex;
+}
+struct Resources {
+  Texture1D<float> tex1D;
+};
+
+// First use in a parameter list.
+float4 loadFirst(Buffer<float4> b) { return b[0]; }
+
+// A local variable can hide an object type that has not been declared yet.
+int hideObjectName() {
+  int Texture3D = 1;
+  return Texture3D;
+}
+Texture3D<float4> tex3D;
+
+// Methods from the intrinsic tables are there on first use.
+Buffer<float4> buf;
+RWByteAddressBuffer rawOut;
+
+float4 main(float2 uv : TEXCOORD) : SV_Target {
+  uint width, height;
+  ns::nsTex.GetDimensions(width, height);
+  rawOut.Store(0, width + height);
+  output[uint2(0, 0)] = (float)hideObjectName();
+  return ns::nsTex.Sample(s0, uv) + ns::nsTex.Sample(s1, uv) +
+         tex3D.Sample(s1, float3(uv, 0)) + loadFirst(buf);
+}
@@ -0,0 +1,17 @@
+// RUN: %clang_cc1 -fsyntax-only -ffreestanding -verify %s
+
+// Built-in object types are found through qualified lookup into the global
+// namespace, including when the qualified name is their first use.
+
+::Texture2D<float4> tex;
+::SamplerState samp;
+::RWBuffer<uint> buf;
+::ByteAddressBuffer raw;
+
+float4 main(float2 uv : TEXCOORD) : SV_Target {
+  ::Texture2D<float4> local = tex;
+  buf[0] = raw.Load(0);
+  return local.Sample(samp, uv);
+}
+
+::NotABuiltinType nope; // expected-error {{no type named 'NotABuiltinType' in the global namespace}}
@@ -0,0 +1,243 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// dxar.cpp                                                                  //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Provides the entry point for the dxar console program.                    //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/Support/Global.h"
+#include "dxc/Support/Unicode.h"
+#include "dxc/Support/WinIncludes.h"
+#include "dxc/Support/FileIOHelper.h"
+#include "dxc/DxilContainer/DxilContainerArchive.h"
+#include "dxc/DxilContainer/DxilContainerReader.h"
+
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/MSFileSystem.h"
+#include "llvm/Support/Path.h"
+
+using namespace llvm;
+using namespace hlsl;
+
+static cl::opt<bool> Help("h", cl::desc("Alias for -help"), cl::Hidden);
+
+static cl::list<std::string> InputFilenames(cl::Positional,
+                                            cl::desc("<input files>"));
+
+static cl::opt<std::string>
+    OutputFilename("o", cl::desc("Create an archive of the input containers"),
+                   cl::value_desc("archive"));
+
+static cl::opt<bool> ListContainers("list",
+                                    cl::desc("List containers in input archive"),
+                                    cl::init(false));
+
+static cl::opt<std::string>
+    ExtractContainer("extract", cl::desc("Extract one container from input "
+                                         "archive (use '*' for all)"));
+
+static cl::opt<std::string>
+    OutputDirectory("outdir", cl::desc("Directory for extracted containers"),
+                    cl::value_desc("directory"), cl::init("."));
+
+static cl::opt<bool> PrintStats("stats",
+                                cl::desc("Print deduplication statistics of input archive"),
+                                cl::init(false));
+
+class DxarContext {
+private:
+  DxilContainerArchiveReader m_reader;
+
+  void LoadArchive();
+  void ExtractContainerAt(uint32_t index);
+
+public:
+  void Create();
+  void List();
+  bool Extract(const char *pName);
+  void Stats();
+};
+
+static void PrintArchiveStats(const DxilContainerArchiveStats &stats) {
+  printf("Containers: %u (%llu bytes)\n", stats.ContainerCount,
+         (unsigned long long)stats.ContainerBytes);
+  printf("Programs: %u, %u unique (%llu bytes, %llu stored)\n",
+         stats.ProgramCount, stats.UniqueProgramCount,
+         (unsigned long long)stats.ProgramBytes,
+         (unsigned long long)stats.UniqueProgramBytes);
+  printf("Archive: %llu bytes, ratio %.2f\n",
+         (unsigned long long)stats.ArchiveBytes, stats.GetRatio());
+}
+
+void DxarContext::Create() {
+  DxilContainerArchiveWriter writer;
+  for (const std::string &InputFilename : InputFilenames) {
+    DxilContainerReader container;
+    HRESULT hr = container.LoadFile(InputFilename);
+    if (FAILED(hr))
+      throw hlsl::Exception(hr, "Unable to read container " + InputFilename);
+    // Containers are named by file name, which is where they are extracted.
+    hr = writer.AddContainer(sys::path::filename(InputFilename),
+                             container.GetHeader(),
+                             container.GetHeader()->ContainerSizeInBytes);
+    if (FAILED(hr))
+      throw hlsl::Exception(hr, "Unable to archive container " + InputFilename);
+  }
+
+  CComPtr<AbstractMemoryStream> pArchive;
+  IFT(CreateMemoryStream(DxcGetThreadMallocNoRef(), &pArchive));
+  writer.write(pArchive);
+  WriteBinaryFile(
+      Unicode::UTF8ToUTF16StringOrThrow(OutputFilename.c_str()).c_str(),
+      pArchive->GetPtr(), pArchive->GetPtrSize());
+  printf("%u bytes written to %s\n", (unsigned)pArchive->GetPtrSize(),
+         OutputFilename.c_str());
+  PrintArchiveStats(writer.GetStats());
+}
+
+void DxarContext::LoadArchive() {
+  IFTARG(InputFilenames.size() == 1);
+  HRESULT hr = m_reader.LoadFile(InputFilenames[0]);
+  if (FAILED(hr))
+    throw hlsl::Exception(hr, "Unable to read archive " + InputFilenames[0]);
+}
+
+void DxarContext::List() {
+  LoadArchive();
+  printf("Container count: %u\n", m_reader.GetContainerCount());
+  for (uint32_t i = 0; i < m_reader.GetContainerCount(); ++i) {
+    SmallString<32> hash("none");
+    if (const DxilShaderHash *pHash = m_reader.GetProgramHash(i)) {
+      MD5::MD5Result digest;
+      memcpy(digest, pHash->Digest, sizeof(digest));
+      MD5::stringifyResult(digest, hash);
+    }
+    printf("#%u - %s (%u bytes, program %s)\n", i,
+           m_reader.GetContainerName(i).str().c_str(),
+           m_reader.GetContainerSize(i), hash.c_str());
+  }
+}
+
+void DxarContext::ExtractContainerAt(uint32_t index) {
+  // The reader rejects archives with such names, but the name decides where
+  // the file is written, so check it again before writing.
+  StringRef name = m_reader.GetContainerName(index);
+  if (!IsValidDxilArchiveContainerName(name))
+    throw hlsl::Exception(DXC_E_CONTAINER_INVALID,
+                          "Container name " + name.str() +
+                              " is not a plain file name");
+
+  CComPtr<AbstractMemoryStream> pContainer;
+  IFT(CreateMemoryStream(DxcGetThreadMallocNoRef(), &pContainer));
+  m_reader.ExtractContainer(index, pContainer);
+
+  SmallString<128> path(OutputDirectory);
+  sys::path::append(path, name);
+  WriteBinaryFile(Unicode::UTF8ToUTF16StringOrThrow(path.c_str()).c_str(),
+                  pContainer->GetPtr(), pContainer->GetPtrSize());
+  printf("%u bytes written to %s\n", (unsigned)pContainer->GetPtrSize(),
+         path.c_str());
+}
+
+bool DxarContext::Extract(const char *pName) {
+  LoadArchive();
+  if (strcmp("*", pName) == 0) {
+    for (uint32_t i = 0; i < m_reader.GetContainerCount(); ++i)
+      ExtractContainerAt(i);
+    return true;
+  }
+  uint32_t index = m_reader.FindContainer(pName);
+  if (index == UINT32_MAX) {
+    printf("No container named %s found.\n", pName);
+    return false;
+  }
+  ExtractContainerAt(index);
+  return true;
+}
+
+void DxarContext::Stats() {
+  LoadArchive();
+  PrintArchiveStats(m_reader.GetStats());
+}
+
+int __cdecl main(int argc, _In_reads_z_(argc) char **argv) {
+  const char *pStage = "Operation";
+  int retVal = 0;
+  if (llvm::sys::fs::SetupPerThreadFileSystem())
+    return 1;
+  llvm::sys::fs::AutoCleanupPerThreadFileSystem auto_cleanup_fs;
+  if (FAILED(DxcInitThreadMalloc())) return 1;
+  DxcSetThreadMallocToDefault();
+  try {
+    llvm::sys::fs::MSFileSystem *msfPtr;
+    IFT(CreateMSFileSystemForDisk(&msfPtr));
+    std::unique_ptr<::llvm::sys::fs::MSFileSystem> msf(msfPtr);
+
+    ::llvm::sys::fs::AutoPerThreadSystem pts(msf.get());
+    IFTLLVM(pts.error_code());
+
+    pStage = "Argument processing";
+
+    // Parse command line options.
+    cl::ParseCommandLineOptions(argc, argv, "dxil container archiver\n");
+
+    if (InputFilenames.empty() || Help) {
+      cl::PrintHelpMessage();
+      return 2;
+    }
+
+    DxarContext context;
+    if (!OutputFilename.empty()) {
+      pStage = "Archiving";
+      context.Create();
+    }
+    else if (ListContainers) {
+      pStage = "Listing containers";
+      context.List();
+    }
+    else if (!ExtractContainer.empty()) {
+      pStage = "Extracting containers";
+      if (!context.Extract(ExtractContainer.c_str()))
+        retVal = 1;
+    }
+    else if (PrintStats) {
+      pStage = "Reading archive";
+      context.Stats();
+    }
+    else {
+      cl::PrintHelpMessage();
+      retVal = 2;
+    }
+  } catch (const ::hlsl::Exception &hlslException) {
+    try {
+      const char *msg = hlslException.what();
+      Unicode::acp_char printBuffer[128]; // printBuffer is safe to treat as
+                                          // UTF-8 because we use ASCII only errors
+                                          // only
+      if (msg == nullptr || *msg == '\0') {
+        sprintf_s(printBuffer, _countof(printBuffer),
+                  "%s failed - error code 0x%08x.", pStage, hlslException.hr);
+        msg = printBuffer;
+      }
+      printf("%s\n", msg);
+    } catch (...) {
+      printf("%s failed - unable to retrieve error message.\n", pStage);
+    }
+
+    return 1;
+  } catch (std::bad_alloc &) {
+    printf("%s failed - out of memory.\n", pStage);
+    return 1;
+  } catch (...) {
+    printf("%s failed - unknown error.\n", pStage);
+    return 1;
+  }
+
+  return retVal;
+}
@@ -30,21 +30,33 @@
 DEFINE_CROSS_PLATFORM_UUIDOF(IDxcLibrary)
 DEFINE_CROSS_PLATFORM_UUIDOF(IDxcBlobEncoding)
 DEFINE_CROSS_PLATFORM_UUIDOF(IDxcOperationResult)
+DEFINE_CROSS_PLATFORM_UUIDOF(IDxcTimeReportResult)
 DEFINE_CROSS_PLATFORM_UUIDOF(IDxcAssembler)
 DEFINE_CROSS_PLATFORM_UUIDOF(IDxcBlob)
 DEFINE_CROSS_PLATFORM_UUIDOF(IDxcIncludeHandler)
+DEFINE_CROSS_PLATFORM_UUIDOF(IDxcIncludeHandlerStamp)
 DEFINE_CROSS_PLATFORM_UUIDOF(IDxcCompiler)
 DEFINE_CROSS_PLATFORM_UUIDOF(IDxcCompiler2)
+DEFINE_CROSS_PLATFORM_UUIDOF(IDxcBatchCompileHandler)
+DEFINE_CROSS_PLATFORM_UUIDOF(IDxcBatchCompiler)
+DEFINE_CROSS_PLATFORM_UUIDOF(IDxcPermutationCompiler)
+DEFINE_CROSS_PLATFORM_UUIDOF(IDxcCompileCache)
+DEFINE_CROSS_PLATFORM_UUIDOF(IDxcMallocStats)
 DEFINE_CROSS_PLATFORM_UUIDOF(IDxcVersionInfo)
 DEFINE_CROSS_PLATFORM_UUIDOF(IDxcVersionInfo2)
 DEFINE_CROSS_PLATFORM_UUIDOF(IDxcValidator)
+DEFINE_CROSS_PLATFORM_UUIDOF(IDxcIncrementalValidator)
+DEFINE_CROSS_PLATFORM_UUIDOF(IDxcValidatorOptions)
 DEFINE_CROSS_PLATFORM_UUIDOF(IDxcContainerBuilder)
 DEFINE_CROSS_PLATFORM_UUIDOF(IDxcOptimizerPass)
 DEFINE_CROSS_PLATFORM_UUIDOF(IDxcOptimizer)
+DEFINE_CROSS_PLATFORM_UUIDOF(IDxcOptimizerPipeline)
+DEFINE_CROSS_PLATFORM_UUIDOF(IDxcOptimizer2)
 DEFINE_CROSS_PLATFORM_UUIDOF(IDxcRewriter)
 DEFINE_CROSS_PLATFORM_UUIDOF(IDxcRewriter2)
 DEFINE_CROSS_PLATFORM_UUIDOF(IDxcIntelliSense)
 DEFINE_CROSS_PLATFORM_UUIDOF(IDxcLinker)
+DEFINE_CROSS_PLATFORM_UUIDOF(IDxcBatchLinker)
 
 HRESULT CreateDxcCompiler(_In_ REFIID riid, _Out_ LPVOID *ppv);
 HRESULT CreateDxcDiaDataSource(_In_ REFIID riid, _Out_ LPVOID *ppv);
@@ -56,6 +68,8 @@ HRESULT CreateDxcAssembler(_In_ REFIID riid, _Out_ LPVOID *ppv);
 HRESULT CreateDxcOptimizer(_In_ REFIID riid, _Out_ LPVOID *ppv);
 HRESULT CreateDxcContainerBuilder(_In_ REFIID riid, _Out_ LPVOID *ppv);
 HRESULT CreateDxcLinker(_In_ REFIID riid, _Out_ LPVOID *ppv);
+HRESULT CreateDxcArenaMalloc(_In_ REFIID riid, _Out_ LPVOID *ppv);
+HRESULT CreateDxcProfilingMalloc(_In_ REFIID riid, _Out_ LPVOID *ppv);
 
 namespace hlsl {
 void CreateDxcContainerReflection(IDxcContainerReflection **ppResult);
@@ -101,6 +115,12 @@ static HRESULT ThreadMallocDxcCreateInstance(
   else if (IsEqualCLSID(rclsid, CLSID_DxcIntelliSense)) {
     hr = CreateDxcIntelliSense(riid, ppv);
   }
+  else if (IsEqualCLSID(rclsid, CLSID_DxcArenaMalloc)) {
+    hr = CreateDxcArenaMalloc(riid, ppv);
+  }
+  else if (IsEqualCLSID(rclsid, CLSID_DxcProfilingMalloc)) {
+    hr = CreateDxcProfilingMalloc(riid, ppv);
+  }
 // Note: The following targets are not yet enabled for non-Windows platforms.
 #ifdef _WIN32
   else if (IsEqualCLSID(rclsid, CLSID_DxcRewriter)) {
@@ -0,0 +1,302 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// dxccompilecache.cpp                                                       //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Provides a content-addressed, on-disk cache of compilation results.       //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/Support/WinIncludes.h"
+#include "dxc/Support/Global.h"
+#include "dxc/Support/FileIOHelper.h"
+#include "dxc/Support/Unicode.h"
+#include "dxc/DXIL/DxilConstants.h"
+#include "dxccompilecache.h"
+#include "dxcutil.h"
+#include "dxillib.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/MSFileSystem.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <atomic>
+
+#ifdef SUPPORT_QUERY_GIT_COMMIT_INFO
+#include "clang/Basic/Version.h"
+#endif // SUPPORT_QUERY_GIT_COMMIT_INFO
+
+using namespace llvm;
+using namespace hlsl;
+
+namespace {
+
+// Bump when the entry layout or the set of hashed inputs changes.
+static const uint32_t kCacheFormatVersion = 1;
+static const uint32_t kCacheEntryMagic = 0x43435844; // 'DXCC'
+static const char kCacheEntryExtension[] = ".dxcc";
+
+struct DxcCompileCacheEntryHeader {
+  uint32_t Magic;
+  uint32_t Version;
+  char Key[32];
+  uint32_t ResultSize;
+  uint32_t DebugBlobSize;
+  uint32_t DebugBlobNameSize;
+  uint32_t WarningsSize;
+};
+
+std::atomic<uint64_t> g_CacheHits(0);
+std::atomic<uint64_t> g_CacheMisses(0);
+std::atomic<uint64_t> g_CacheStores(0);
+std::atomic<uint64_t> g_CacheEvictions(0);
+
+// Cache files live on disk even while the compiler routes file system calls
+// to the in-memory system built from the source and include handler.
+class DiskFileSystemScope {
+public:
+  DiskFileSystemScope() {
+    ::llvm::sys::fs::MSFileSystem *msfPtr;
+    IFT(CreateMSFileSystemForDisk(&msfPtr));
+    m_pFileSystem.reset(msfPtr);
+    m_pScope.reset(new ::llvm::sys::fs::AutoPerThreadSystem(msfPtr));
+    IFTLLVM(m_pScope->error_code());
+  }
+
+private:
+  std::unique_ptr<::llvm::sys::fs::MSFileSystem> m_pFileSystem;
+  std::unique_ptr<::llvm::sys::fs::AutoPerThreadSystem> m_pScope;
+};
+
+uint32_t GetBlobSize(IDxcBlob *pBlob) {
+  return pBlob ? (uint32_t)pBlob->GetBufferSize() : 0;
+}
+
+void WriteBlob(raw_ostream &OS, IDxcBlob *pBlob) {
+  if (pBlob)
+    OS.write((const char *)pBlob->GetBufferPointer(), pBlob->GetBufferSize());
+}
+
+} // namespace
+
+namespace dxcutil {
+
+DxcCompileCacheKeyBuilder::DxcCompileCacheKeyBuilder() {
+  AddValue(kCacheFormatVersion);
+  AddValue(DXIL::kDxilMajor);
+  AddValue(DXIL::kDxilMinor);
+  unsigned ValMajor, ValMinor;
+  GetValidatorVersion(&ValMajor, &ValMinor);
+  AddValue(ValMajor);
+  AddValue(ValMinor);
+  // An external validator signs the container, the internal one does not.
+  AddValue(DxilLibIsEnabled() ? 1 : 0);
+#ifdef SUPPORT_QUERY_GIT_COMMIT_INFO
+  AddValue(clang::getGitCommitCount());
+  AddString(clang::getGitCommitHash());
+#endif // SUPPORT_QUERY_GIT_COMMIT_INFO
+}
+
+void DxcCompileCacheKeyBuilder::AddString(StringRef Value) {
+  // Length-prefix values so that adjacent strings cannot alias.
+  AddValue(Value.size());
+  m_Hasher.update(Value);
+}
+
+void DxcCompileCacheKeyBuilder::AddWideString(LPCWSTR pValue) {
+  if (pValue == nullptr) {
+    AddValue(UINT64_MAX);
+    return;
+  }
+  std::string Utf8;
+  IFTBOOL(Unicode::UTF16ToUTF8String(pValue, &Utf8), E_INVALIDARG);
+  AddString(Utf8);
+}
+
+void DxcCompileCacheKeyBuilder::AddValue(uint64_t Value) {
+  uint8_t Bytes[sizeof(Value)];
+  for (unsigned i = 0; i < sizeof(Value); ++i)
+    Bytes[i] = (uint8_t)(Value >> (i * 8));
+  m_Hasher.update(ArrayRef<uint8_t>(Bytes));
+}
+
+std::string DxcCompileCacheKeyBuilder::Finish() {
+  MD5::MD5Result Result;
+  m_Hasher.final(Result);
+  SmallString<32> Str;
+  MD5::stringifyResult(Result, Str);
+  return Str.str();
+}
+
+std::string DxcCompileCache::GetEntryPath(StringRef Key) const {
+  SmallString<256> Path(m_Dir);
+  sys::path::append(Path, Twine(Key) + kCacheEntryExtension);
+  return Path.str();
+}
+
+bool DxcCompileCache::Lookup(StringRef Key, DxcCompileCacheEntry &Entry) {
+  DiskFileSystemScope DiskScope;
+  std::string Path = GetEntryPath(Key);
+
+  ErrorOr<std::unique_ptr<MemoryBuffer>> BufOrErr = MemoryBuffer::getFile(
+      Path, /*FileSize*/ -1, /*RequiresNullTerminator*/ false);
+  if (!BufOrErr) {
+    ++g_CacheMisses;
+    return false;
+  }
+
+  const MemoryBuffer &Buf = *BufOrErr.get();
+  const char *pData = Buf.getBufferStart();
+  size_t Size = Buf.getBufferSize();
+  DxcCompileCacheEntryHeader Header;
+  bool Valid = Size >= sizeof(Header);
+  if (Valid) {
+    memcpy(&Header, pData, sizeof(Header));
+    uint64_t PayloadSize = (uint64_t)Header.ResultSize +
+                           Header.DebugBlobSize + Header.DebugBlobNameSize +
+                           Header.WarningsSize;
+    Valid = Header.Magic == kCacheEntryMagic &&
+            Header.Version == kCacheFormatVersion &&
+            Key.size() == sizeof(Header.Key) &&
+            Key.equals(StringRef(Header.Key, sizeof(Header.Key))) &&
+            Header.ResultSize != 0 &&
+            PayloadSize == Size - sizeof(Header);
+  }
+  if (!Valid) {
+    // Truncated or foreign file; drop it so it is rebuilt on this miss.
+    sys::fs::remove(Path);
+    ++g_CacheMisses;
+    return false;
+  }
+
+  pData += sizeof(Header);
+  IFT(DxcCreateBlobOnHeapCopy(pData, Header.ResultSize, &Entry.pResultBlob));
+  pData += Header.ResultSize;
+  if (Header.DebugBlobSize)
+    IFT(DxcCreateBlobOnHeapCopy(pData, Header.DebugBlobSize, &Entry.pDebugBlob));
+  pData += Header.DebugBlobSize;
+  Entry.DebugBlobName.assign(pData, Header.DebugBlobNameSize);
+  pData += Header.DebugBlobNameSize;
+  Entry.Warnings.assign(pData, Header.WarningsSize);
+
+  // Refresh the modification time; it orders entries for eviction.
+  int FD;
+  if (!sys::fs::openFileForWrite(Path, FD, sys::fs::F_Append)) {
+    raw_fd_ostream TouchStream(FD, /*shouldClose*/ true);
+    sys::fs::setLastModificationAndAccessTime(FD, sys::TimeValue::now());
+  }
+
+  ++g_CacheHits;
+  return true;
+}
+
+HRESULT DxcCompileCache::Store(StringRef Key,
+                               const DxcCompileCacheEntry &Entry) throw() {
+  DXASSERT_NOMSG(Key.size() == sizeof(DxcCompileCacheEntryHeader::Key));
+  try {
+    DiskFileSystemScope DiskScope;
+
+    DxcCompileCacheEntryHeader Header = {};
+    Header.Magic = kCacheEntryMagic;
+    Header.Version = kCacheFormatVersion;
+    memcpy(Header.Key, Key.data(), sizeof(Header.Key));
+    Header.ResultSize = GetBlobSize(Entry.pResultBlob);
+    Header.DebugBlobSize = GetBlobSize(Entry.pDebugBlob);
+    Header.DebugBlobNameSize = (uint32_t)Entry.DebugBlobName.size();
+    Header.WarningsSize = (uint32_t)Entry.Warnings.size();
+    uint64_t EntrySize = sizeof(Header) + (uint64_t)Header.ResultSize +
+                         Header.DebugBlobSize + Header.DebugBlobNameSize +
+                         Header.WarningsSize;
+    if (Header.ResultSize == 0 || EntrySize > m_MaxSizeInBytes)
+      return S_FALSE;
+
+    IFTLLVM(sys::fs::create_directories(m_Dir));
+    EvictToFit(EntrySize);
+
+    // Write to a unique temporary and rename into place, so concurrent
+    // readers never observe a partially written entry.
+    SmallString<256> TempModel(m_Dir);
+    sys::path::append(TempModel, Twine(Key) + "-%%%%%%%%.tmp");
+    SmallString<256> TempPath;
+    int FD;
+    IFTLLVM(sys::fs::createUniqueFile(TempModel, FD, TempPath));
+    {
+      raw_fd_ostream OS(FD, /*shouldClose*/ true);
+      OS.write((const char *)&Header, sizeof(Header));
+      WriteBlob(OS, Entry.pResultBlob);
+      WriteBlob(OS, Entry.pDebugBlob);
+      OS << Entry.DebugBlobName << Entry.Warnings;
+      OS.close();
+      if (OS.has_error()) {
+        OS.clear_error();
+        sys::fs::remove(TempPath);
+        return E_FAIL;
+      }
+    }
+    if (std::error_code EC = sys::fs::rename(TempPath, GetEntryPath(Key))) {
+      sys::fs::remove(TempPath);
+      IFTLLVM(EC);
+    }
+    ++g_CacheStores;
+    return S_OK;
+  }
+  CATCH_CPP_RETURN_HRESULT();
+}
+
+void DxcCompileCache::EvictToFit(uint64_t IncomingSize) {
+  struct CachedFile {
+    std::string Path;
+    uint64_t Size;
+    sys::TimeValue LastUsed;
+  };
+  std::vector<CachedFile> Files;
+  uint64_t TotalSize = 0;
+  std::error_code EC;
+  for (sys::fs::directory_iterator It(m_Dir, EC), End; It != End && !EC;
+       It.increment(EC)) {
+    if (sys::path::extension(It->path()) != kCacheEntryExtension)
+      continue;
+    sys::fs::file_status Status;
+    if (It->status(Status) || Status.type() != sys::fs::file_type::regular_file)
+      continue;
+    Files.push_back({It->path(), Status.getSize(),
+                     Status.getLastModificationTime()});
+    TotalSize += Status.getSize();
+  }
+  if (TotalSize + IncomingSize <= m_MaxSizeInBytes)
+    return;
+
+  std::sort(Files.begin(), Files.end(),
+            [](const CachedFile &A, const CachedFile &B) {
+              return A.LastUsed < B.LastUsed;
+            });
+  for (const CachedFile &File : Files) {
+    if (TotalSize + IncomingSize <= m_MaxSizeInBytes)
+      break;
+    // Another compiler may have evicted the same file already.
+    if (!sys::fs::remove(File.Path, /*IgnoreNonExisting*/ false))
+      ++g_CacheEvictions;
+    TotalSize -= File.Size;
+  }
+}
+
+void DxcCompileCache::GetStats(DxcCompileCacheStats *pStats) {
+  pStats->Hits = g_CacheHits;
+  pStats->Misses = g_CacheMisses;
+  pStats->Stores = g_CacheStores;
+  pStats->Evictions = g_CacheEvictions;
+}
+
+void DxcCompileCache::ResetStats() {
+  g_CacheHits = 0;
+  g_CacheMisses = 0;
+  g_CacheStores = 0;
+  g_CacheEvictions = 0;
+}
+
+} // namespace dxcutil
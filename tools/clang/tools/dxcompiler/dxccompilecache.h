@@ -0,0 +1,72 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// dxccompilecache.h                                                         //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Provides a content-addressed, on-disk cache of compilation results.       //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "dxc/dxcapi.h"
+#include "dxc/Support/microcom.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/MD5.h"
+#include <string>
+
+namespace dxcutil {
+
+/// Builds the key that identifies a compilation. Every input that can
+/// change the compiler output must be added; the compiler version is
+/// always part of the key.
+class DxcCompileCacheKeyBuilder {
+public:
+  DxcCompileCacheKeyBuilder();
+  void AddString(llvm::StringRef Value);
+  void AddWideString(_In_opt_z_ LPCWSTR pValue);
+  void AddValue(uint64_t Value);
+  /// Returns the key as a hexadecimal string usable as a file name.
+  std::string Finish();
+
+private:
+  llvm::MD5 m_Hasher;
+};
+
+/// The outputs of a compilation that are restored on a cache hit.
+struct DxcCompileCacheEntry {
+  CComPtr<IDxcBlob> pResultBlob;
+  CComPtr<IDxcBlob> pDebugBlob;  // May be null.
+  std::string DebugBlobName;     // UTF-8, may be empty.
+  std::string Warnings;          // UTF-8 text of the error buffer.
+};
+
+/// A directory of compilation results, bounded in size. When a new result
+/// would exceed the bound, the least recently used results are evicted.
+/// Recency is tracked through file modification times, so the directory can
+/// be shared by concurrent compilers and across processes.
+class DxcCompileCache {
+public:
+  DxcCompileCache(llvm::StringRef Dir, uint64_t MaxSizeInBytes)
+      : m_Dir(Dir), m_MaxSizeInBytes(MaxSizeInBytes) {}
+
+  /// Looks up the result for Key; returns true and fills Entry on a hit.
+  bool Lookup(llvm::StringRef Key, DxcCompileCacheEntry &Entry);
+  /// Stores the result for Key, evicting older results as needed. Failing
+  /// to store is not an error for the compilation, so this does not throw.
+  HRESULT Store(llvm::StringRef Key, const DxcCompileCacheEntry &Entry) throw();
+
+  static void GetStats(_Out_ DxcCompileCacheStats *pStats);
+  static void ResetStats();
+
+private:
+  std::string GetEntryPath(llvm::StringRef Key) const;
+  void EvictToFit(uint64_t IncomingSize);
+
+  std::string m_Dir;
+  uint64_t m_MaxSizeInBytes;
+};
+
+} // namespace dxcutil
@@ -1460,61 +1460,54 @@ HRESULT Disassemble(IDxcBlob *pProgram, raw_string_ostream &Stream) {
   const char *pIL = (const char *)pProgram->GetBufferPointer();
   uint32_t pILLength = pProgram->GetBufferSize();
   const DxilPartHeader *pRDATPart = nullptr;
-  if (const DxilContainerHeader *pContainer =
-          IsDxilContainerLike(pIL, pILLength)) {
-    if (!IsValidDxilContainer(pContainer, pILLength)) {
-      return DXC_E_CONTAINER_INVALID;
-    }
+  if (IsDxilContainerLike(pIL, pILLength)) {
+    // Index the parts once rather than searching the container for each.
+    DxilContainerReader container;
+    IFR(container.Load(pIL, pILLength));
 
-    DxilPartIterator it = std::find_if(begin(pContainer), end(pContainer),
-                                       DxilPartIsType(DFCC_FeatureInfo));
-    if (it != end(pContainer)) {
+    const DxilPartHeader *pPart = container.FindPart(DFCC_FeatureInfo);
+    if (pPart) {
       PrintFeatureInfo(
-          reinterpret_cast<const DxilShaderFeatureInfo *>(GetDxilPartData(*it)),
+          reinterpret_cast<const DxilShaderFeatureInfo *>(GetDxilPartData(pPart)),
           Stream, /*comment*/ ";");
     }
 
-    it = std::find_if(begin(pContainer), end(pContainer),
-                      DxilPartIsType(DFCC_InputSignature));
-    if (it != end(pContainer)) {
+    pPart = container.FindPart(DFCC_InputSignature);
+    if (pPart) {
       PrintSignature(
           "Input",
-          reinterpret_cast<const DxilProgramSignature *>(GetDxilPartData(*it)),
+          reinterpret_cast<const DxilProgramSignature *>(GetDxilPartData(pPart)),
           true, Stream, /*comment*/ ";");
     }
-    it = std::find_if(begin(pContainer), end(pContainer),
-                      DxilPartIsType(DFCC_OutputSignature));
-    if (it != end(pContainer)) {
+    pPart = container.FindPart(DFCC_OutputSignature);
+    if (pPart) {
       PrintSignature(
           "Output",
-          reinterpret_cast<const DxilProgramSignature *>(GetDxilPartData(*it)),
+          reinterpret_cast<const DxilProgramSignature *>(GetDxilPartData(pPart)),
           false, Stream, /*comment*/ ";");
     }
-    it = std::find_if(begin(pContainer), end(pContainer),
-                      DxilPartIsType(DFCC_PatchConstantSignature));
-    if (it != end(pContainer)) {
+    pPart = container.FindPart(DFCC_PatchConstantSignature);
+    if (pPart) {
       PrintSignature(
           "Patch Constant signature",
-          reinterpret_cast<const DxilProgramSignature *>(GetDxilPartData(*it)),
+          reinterpret_cast<const DxilProgramSignature *>(GetDxilPartData(pPart)),
           false, Stream, /*comment*/ ";");
     }
 
-    it = std::find_if(begin(pContainer), end(pContainer),
-                      DxilPartIsType(DFCC_ShaderDebugName));
-    if (it != end(pContainer)) {
+    pPart = container.FindPart(DFCC_ShaderDebugName);
+    if (pPart) {
       const char *pDebugName;
-      if (!GetDxilShaderDebugName(*it, &pDebugName, nullptr)) {
+      if (!GetDxilShaderDebugName(pPart, &pDebugName, nullptr)) {
         Stream << "; shader debug name present; corruption detected\n";
       } else if (pDebugName && *pDebugName) {
         Stream << "; shader debug name: " << pDebugName << "\n";
       }
     }
 
-    it = std::find_if(begin(pContainer), end(pContainer),
-      DxilPartIsType(DFCC_ShaderHash));
-    if (it != end(pContainer)) {
+    pPart = container.FindPart(DFCC_ShaderHash);
+    if (pPart) {
       const DxilShaderHash *pHashContent =
-        reinterpret_cast<const DxilShaderHash *>(GetDxilPartData(*it));
+        reinterpret_cast<const DxilShaderHash *>(GetDxilPartData(pPart));
       Stream << "; shader hash: ";
       for (int i = 0; i < 16; ++i)
         Stream << format("%.2x", pHashContent->Digest[i]);
@@ -1523,40 +1516,32 @@ HRESULT Disassemble(IDxcBlob *pProgram, raw_string_ostream &Stream) {
       Stream << "\n";
     }
 
-    it = std::find_if(begin(pContainer), end(pContainer),
-                      DxilPartIsType(DFCC_DXIL));
-    if (it == end(pContainer)) {
+    pPart = container.FindPart(DFCC_DXIL);
+    if (!pPart) {
       return DXC_E_CONTAINER_MISSING_DXIL;
     }
 
-    DxilPartIterator dbgit =
-        std::find_if(begin(pContainer), end(pContainer),
-                     DxilPartIsType(DFCC_ShaderDebugInfoDXIL));
     // Use dbg module if exist.
-    if (dbgit != end(pContainer))
-      it = dbgit;
+    if (const DxilPartHeader *pDebugPart =
+            container.FindPart(DFCC_ShaderDebugInfoDXIL))
+      pPart = pDebugPart;
 
     const DxilProgramHeader *pProgramHeader =
-        reinterpret_cast<const DxilProgramHeader *>(GetDxilPartData(*it));
-    if (!IsValidDxilProgramHeader(pProgramHeader, (*it)->PartSize)) {
+        reinterpret_cast<const DxilProgramHeader *>(GetDxilPartData(pPart));
+    if (!IsValidDxilProgramHeader(pProgramHeader, pPart->PartSize)) {
       return DXC_E_CONTAINER_INVALID;
     }
 
-    it = std::find_if(begin(pContainer), end(pContainer),
-                      DxilPartIsType(DFCC_PipelineStateValidation));
-    if (it != end(pContainer)) {
+    pPart = container.FindPart(DFCC_PipelineStateValidation);
+    if (pPart) {
       PrintPipelineStateValidationRuntimeInfo(
-          GetDxilPartData(*it),
+          GetDxilPartData(pPart),
           GetVersionShaderType(pProgramHeader->ProgramVersion), Stream,
           /*comment*/ ";");
     }
 
     // RDAT
-    it = std::find_if(begin(pContainer), end(pContainer),
-      DxilPartIsType(DFCC_RuntimeData));
-    if (it != end(pContainer)) {
-      pRDATPart = *it;
-    }
+    pRDATPart = container.FindPart(DFCC_RuntimeData);
 
     GetDxilProgramBitcode(pProgramHeader, &pIL, &pILLength);
   } else {
@@ -14,6 +14,7 @@
 #include "dxc/Support/Global.h"
 #include "dxc/Support/FileIOHelper.h"
 #include "dxc/dxcapi.h"
+#include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/raw_ostream.h"
 #include "dxcutil.h"
 
@@ -21,6 +22,10 @@
 #include "dxc/Support/Unicode.h"
 #include "clang/Frontend/CompilerInstance.h"
 
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
 #ifndef _WIN32
 #include <sys/stat.h>
 #include <unistd.h>
@@ -191,6 +196,100 @@ void MakeAbsoluteOrCurDirRelativeW(LPCWSTR &Path, std::wstring &PathStorage) {
   }
 }
 
+/// Process-wide cache of UTF-8 include files loaded through handlers that
+/// implement IDxcIncludeHandlerStamp. Entries are keyed by the identity of
+/// the handler and the file name resolved through the search directories, so
+/// handlers never see each other's files. An entry is reused while its key
+/// maps to the same stamp; the least recently used entries are dropped once
+/// the cache grows past MaxSizeInBytes. Entries hold a reference to their
+/// handler, so its address cannot be reused by another handler while cached.
+class IncludeFileCache {
+public:
+  static const size_t MaxSizeInBytes = 64 * 1024 * 1024;
+
+  bool Lookup(_In_ IUnknown *pHandler, const std::wstring &name, UINT64 stamp,
+              _COM_Outptr_ IDxcBlobEncoding **ppBlob) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto found = m_index.find(Key(pHandler, name));
+    if (found == m_index.end() || found->second->Stamp != stamp)
+      return false;
+    m_entries.splice(m_entries.begin(), m_entries, found->second);
+    *ppBlob = found->second->Blob;
+    (*ppBlob)->AddRef();
+    return true;
+  }
+
+  /// Caching is an optimization, so failures are returned and not thrown.
+  HRESULT Insert(_In_ IUnknown *pHandler, const std::wstring &name,
+                 UINT64 stamp, _In_ IDxcBlobEncoding *pBlob) throw() {
+    size_t size = pBlob->GetBufferSize();
+    if (size > MaxSizeInBytes)
+      return S_FALSE;
+    // Entries outlive the compilation that loads them, so they are copied
+    // into the default allocator.
+    DxcThreadMalloc TM(nullptr);
+    try {
+      CComPtr<IDxcBlobEncoding> pCopy;
+      IFR(DxcCreateBlobWithEncodingOnHeapCopy(
+          pBlob->GetBufferPointer(), (UINT32)size, CP_UTF8, &pCopy));
+      Key key(pHandler, name);
+      std::lock_guard<std::mutex> lock(m_mutex);
+      auto found = m_index.find(key);
+      if (found != m_index.end())
+        Remove(found);
+      m_entries.push_front(Entry());
+      m_entries.front().Handler = pHandler;
+      m_entries.front().Name = name;
+      m_entries.front().Stamp = stamp;
+      m_entries.front().Blob = pCopy;
+      m_index[key] = m_entries.begin();
+      m_size += size;
+      while (m_size > MaxSizeInBytes) {
+        const Entry &last = m_entries.back();
+        Remove(m_index.find(Key(last.Handler, last.Name)));
+      }
+      return S_OK;
+    }
+    CATCH_CPP_RETURN_HRESULT();
+  }
+
+private:
+  struct Entry {
+    CComPtr<IUnknown> Handler;
+    std::wstring Name;
+    UINT64 Stamp;
+    CComPtr<IDxcBlobEncoding> Blob;
+  };
+  typedef std::pair<IUnknown *, std::wstring> Key;
+  struct KeyHash {
+    size_t operator()(const Key &key) const {
+      return std::hash<std::wstring>()(key.second) ^
+             std::hash<IUnknown *>()(key.first);
+    }
+  };
+  typedef std::list<Entry> EntryList; // Most recently used first.
+  typedef std::unordered_map<Key, EntryList::iterator, KeyHash> EntryIndex;
+
+  void Remove(EntryIndex::iterator found) {
+    m_size -= found->second->Blob->GetBufferSize();
+    m_entries.erase(found->second);
+    m_index.erase(found);
+  }
+
+  std::mutex m_mutex;
+  EntryList m_entries;
+  EntryIndex m_index;
+  size_t m_size = 0;
+};
+
+llvm::ManagedStatic<IncludeFileCache> g_IncludeFileCache;
+
+IncludeFileCache &GetIncludeFileCache() {
+  // Constructed from the default allocator and released by llvm_shutdown.
+  DxcThreadMalloc TM(nullptr);
+  return *g_IncludeFileCache;
+}
+
 }
 
 namespace dxcutil {
@@ -227,6 +326,8 @@ private:
   LPCWSTR m_pOutputStreamName;
   std::wstring m_pAbsOutputStreamName;
   CComPtr<IDxcIncludeHandler> m_includeLoader;
+  CComPtr<IDxcIncludeHandlerStamp> m_includeStamp;
+  CComPtr<IUnknown> m_includeIdentity; // Keys the handler's cached files.
   std::vector<std::wstring> m_searchEntries;
   bool m_bDisplayIncludeProcess;
 
@@ -240,6 +341,7 @@ private:
       : Blob(pBlob), BlobStream(pStream), Name(name) { }
   };
   llvm::SmallVector<IncludedFile, 4> m_includedFiles;
+  std::unordered_map<std::wstring, size_t> m_includedFileIndex;
 
   static bool IsDirOf(LPCWSTR lpDir, size_t dirLen, const std::wstring &fileName) {
     if (fileName.size() <= dirLen) return false;
@@ -275,12 +377,16 @@ private:
     }
     return INVALID_HANDLE_VALUE;
   }
+  void AddIncludedFile(std::wstring &&name, IDxcBlob *pBlob, IStream *pStream) {
+    m_includedFileIndex[name] = m_includedFiles.size();
+    m_includedFiles.push_back(IncludedFile(std::move(name), pBlob, pStream));
+  }
   DWORD TryFindOrOpen(LPCWSTR lpFileName, size_t &index) {
-    for (size_t i = 0; i < m_includedFiles.size(); ++i) {
-      if (0 == wcscmp(lpFileName, m_includedFiles[i].Name.data())) {
-        index = i;
-        return ERROR_SUCCESS;
-      }
+    std::wstring includedName(lpFileName);
+    auto found = m_includedFileIndex.find(includedName);
+    if (found != m_includedFileIndex.end()) {
+      index = found->second;
+      return ERROR_SUCCESS;
     }
 
     if (m_includeLoader.p != nullptr) {
@@ -288,36 +394,48 @@ private:
         return ERROR_OUT_OF_STRUCTURES;
       }
 
-      CComPtr<::IDxcBlob> fileBlob;
-      HRESULT hr = m_includeLoader->LoadSource(lpFileName, &fileBlob);
-      if (FAILED(hr)) {
-        return ERROR_UNHANDLED_EXCEPTION;
-      }
-      if (fileBlob.p != nullptr) {
-        CComPtr<IDxcBlobEncoding> fileBlobEncoded;
-        if (FAILED(hlsl::DxcGetBlobAsUtf8(fileBlob, &fileBlobEncoded))) {
+      CComPtr<IDxcBlobEncoding> fileBlobEncoded;
+      UINT64 stamp;
+      bool stamped = m_includeIdentity.p != nullptr &&
+                     S_OK == m_includeStamp->GetSourceStamp(lpFileName, &stamp);
+      if (!stamped ||
+          !GetIncludeFileCache().Lookup(m_includeIdentity, includedName, stamp,
+                                        &fileBlobEncoded)) {
+        CComPtr<::IDxcBlob> fileBlob;
+        HRESULT hr = m_includeLoader->LoadSource(lpFileName, &fileBlob);
+        if (FAILED(hr)) {
           return ERROR_UNHANDLED_EXCEPTION;
         }
-        CComPtr<IStream> fileStream;
-        if (FAILED(hlsl::CreateReadOnlyBlobStream(fileBlobEncoded, &fileStream))) {
+        if (fileBlob.p == nullptr) {
+          return ERROR_NOT_FOUND;
+        }
+        if (FAILED(hlsl::DxcGetBlobAsUtf8(fileBlob, &fileBlobEncoded))) {
           return ERROR_UNHANDLED_EXCEPTION;
         }
-        m_includedFiles.emplace_back(std::wstring(lpFileName), fileBlobEncoded, fileStream);
-        index = m_includedFiles.size() - 1;
-
-        if (m_bDisplayIncludeProcess) {
-          std::string openFileStr;
-          raw_string_ostream s(openFileStr);
-          std::string fileName = Unicode::UTF16ToUTF8StringOrThrow(lpFileName);
-          s << "Opening file [" << fileName << "], stack top [" << (index-1)
-            << "]\n";
-          s.flush();
-          ULONG cbWritten;
-          IFT(m_pStdErrStream->Write(openFileStr.c_str(), openFileStr.size(),
-                                 &cbWritten));
+        if (stamped) {
+          GetIncludeFileCache().Insert(m_includeIdentity, includedName, stamp,
+                                       fileBlobEncoded);
         }
-        return ERROR_SUCCESS;
       }
+      CComPtr<IStream> fileStream;
+      if (FAILED(hlsl::CreateReadOnlyBlobStream(fileBlobEncoded, &fileStream))) {
+        return ERROR_UNHANDLED_EXCEPTION;
+      }
+      AddIncludedFile(std::move(includedName), fileBlobEncoded, fileStream);
+      index = m_includedFiles.size() - 1;
+
+      if (m_bDisplayIncludeProcess) {
+        std::string openFileStr;
+        raw_string_ostream s(openFileStr);
+        std::string fileName = Unicode::UTF16ToUTF8StringOrThrow(lpFileName);
+        s << "Opening file [" << fileName << "], stack top [" << (index-1)
+          << "]\n";
+        s.flush();
+        ULONG cbWritten;
+        IFT(m_pStdErrStream->Write(openFileStr.c_str(), openFileStr.size(),
+                               &cbWritten));
+      }
+      return ERROR_SUCCESS;
     }
     return ERROR_NOT_FOUND;
   }
@@ -339,7 +457,11 @@ public:
         m_includeLoader(pHandler), m_bDisplayIncludeProcess(false) {
     MakeAbsoluteOrCurDirRelativeW(m_pSourceName, m_pAbsSourceName);
     IFT(CreateReadOnlyBlobStream(m_pSource, &m_pSourceStream));
-    m_includedFiles.push_back(IncludedFile(std::wstring(m_pSourceName), m_pSource, m_pSourceStream));
+    AddIncludedFile(std::wstring(m_pSourceName), m_pSource, m_pSourceStream);
+    if (pHandler != nullptr) {
+      if (SUCCEEDED(pHandler->QueryInterface(&m_includeStamp)))
+        pHandler->QueryInterface(&m_includeIdentity);
+    }
   }
   void EnableDisplayIncludeProcess() override {
     m_bDisplayIncludeProcess = true;
@@ -16,6 +16,7 @@
 #include "llvm/Support/MSFileSystem.h"
 #include "dxc/Support/microcom.h"
 #include "dxc/Support/FileIOHelper.h"
+#include "dxc/Support/WinFunctions.h"
 
 #include "dxc/dxcapi.internal.h"
 #include "dxc/dxctools.h"
@@ -23,7 +24,8 @@
 using namespace llvm;
 using namespace hlsl;
 
-class DxcIncludeHandlerForFS : public IDxcIncludeHandler {
+class DxcIncludeHandlerForFS : public IDxcIncludeHandler,
+                               public IDxcIncludeHandlerStamp {
 private:
   DXC_MICROCOM_TM_REF_FIELDS()
 public:
@@ -31,7 +33,8 @@ public:
   DXC_MICROCOM_TM_CTOR(DxcIncludeHandlerForFS)
 
   HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void **ppvObject) override {
-    return DoBasicQueryInterface<IDxcIncludeHandler>(this, iid, ppvObject);
+    return DoBasicQueryInterface<IDxcIncludeHandler, IDxcIncludeHandlerStamp>(
+        this, iid, ppvObject);
   }
 
   HRESULT STDMETHODCALLTYPE LoadSource(
@@ -45,6 +48,28 @@ public:
     }
     return hr;
   }
+
+  HRESULT STDMETHODCALLTYPE GetSourceStamp(
+    _In_ LPCWSTR pFilename,
+    _Out_ UINT64 *pStamp
+    ) override {
+    if (pFilename == nullptr || pStamp == nullptr)
+      return E_POINTER;
+    HANDLE hFile = CreateFileW(pFilename, GENERIC_READ, FILE_SHARE_READ, NULL,
+                               OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (hFile == INVALID_HANDLE_VALUE)
+      return HRESULT_FROM_WIN32(GetLastError());
+    CHandle h(hFile);
+    LARGE_INTEGER FileSize;
+    FILETIME LastWriteTime;
+    if (!GetFileSizeEx(hFile, &FileSize) ||
+        !GetFileTime(hFile, nullptr, nullptr, &LastWriteTime))
+      return HRESULT_FROM_WIN32(GetLastError());
+    UINT64 WriteTime = ((UINT64)LastWriteTime.dwHighDateTime << 32) |
+                       LastWriteTime.dwLowDateTime;
+    *pStamp = WriteTime ^ ((UINT64)FileSize.QuadPart * 0x9E3779B97F4A7C15ULL);
+    return S_OK;
+  }
 };
 
 class DxcLibrary : public IDxcLibrary {
@@ -15,12 +15,15 @@
 #include "dxc/Support/Global.h"
 #include "dxc/Support/FileIOHelper.h"
 #include "dxc/Support/dxcapi.impl.h"
+#include "dxc/Support/dxcthreadpool.h"
 #include "dxc/Support/microcom.h"
 #include "dxc/dxcapi.h"
 #include "dxillib.h"
 
 #include "llvm/ADT/SmallVector.h"
 #include <algorithm>
+#include <map>
+#include <mutex>
 
 #include "dxc/HLSL/DxilLinker.h"
 #include "dxc/HLSL/DxilValidation.h"
@@ -43,7 +46,9 @@ using namespace llvm;
 // This declaration is used for the locally-linked validator.
 HRESULT CreateDxcValidator(_In_ REFIID riid, _Out_ LPVOID *ppv);
 
-class DxcLinker : public IDxcLinker, public IDxcContainerEvent {
+class DxcLinker : public IDxcLinker,
+                  public IDxcBatchLinker,
+                  public IDxcContainerEvent {
 public:
   DXC_MICROCOM_TM_ADDREF_RELEASE_IMPL()
   DXC_MICROCOM_TM_CTOR(DxcLinker)
@@ -69,6 +74,15 @@ public:
           *ppResult // Linker output status, buffer, and errors
   ) override;
 
+  // IDxcBatchLinker
+  HRESULT STDMETHODCALLTYPE LinkBatch(
+      _In_count_(jobCount) const DxcLinkJob *pJobs, // Array of jobs
+      _In_ UINT32 jobCount,                         // Number of jobs
+      _In_ UINT32 threadCount,                      // Number of threads
+      _Out_writes_(jobCount) IDxcOperationResult *
+          *ppResults // Linker output status, buffer, and errors of each job
+  ) override;
+
   HRESULT STDMETHODCALLTYPE RegisterDxilContainerEventHandler(
       IDxcContainerEventsHandler *pHandler, UINT64 *pCookie) override {
     DxcThreadMalloc TM(m_pMalloc);
@@ -88,13 +102,13 @@ public:
   }
 
   HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void **ppvObject) {
-    return DoBasicQueryInterface<IDxcLinker>(this, riid, ppvObject);
+    return DoBasicQueryInterface<IDxcLinker, IDxcBatchLinker>(this, riid,
+                                                              ppvObject);
   }
 
   void Initialize() {
-    UINT32 valMajor, valMinor;
-    dxcutil::GetValidatorVersion(&valMajor, &valMinor);
-    m_pLinker.reset(DxilLinker::CreateLinker(m_Ctx, valMajor, valMinor));
+    dxcutil::GetValidatorVersion(&m_valMajor, &m_valMinor);
+    m_pLinker.reset(DxilLinker::CreateLinker(m_Ctx, m_valMajor, m_valMinor));
   }
 
   ~DxcLinker() {
@@ -103,13 +117,92 @@ public:
   }
 
 private:
+  // Linker of one batch thread. Members are destroyed in reverse order, so
+  // the DxilLinker goes before its LLVMContext.
+  struct BatchLinkWorker {
+    LLVMContext Ctx;
+    std::unique_ptr<DxilLinker> pLinker;
+  };
+
+  // Loads the modules of a library container lazily into Ctx.
+  static HRESULT LoadLibraryModules(LLVMContext &Ctx, IDxcBlob *pBlob,
+                                    std::unique_ptr<llvm::Module> &pModule,
+                                    std::unique_ptr<llvm::Module> &pDebugModule);
+  // Loads a library container lazily into Ctx and registers it with Linker.
+  static HRESULT LoadLinkerLibrary(DxilLinker &Linker, LLVMContext &Ctx,
+                                   llvm::StringRef LibName, IDxcBlob *pBlob);
+
+  HRESULT LinkWithLinker(DxilLinker &Linker, LLVMContext &Ctx,
+                         LPCWSTR pEntryName, LPCWSTR pTargetProfile,
+                         const LPCWSTR *pLibNames, UINT32 libCount,
+                         const LPCWSTR *pArguments, UINT32 argCount,
+                         IDxcOperationResult **ppResult);
+
   DXC_MICROCOM_TM_REF_FIELDS()
   LLVMContext m_Ctx;
   std::unique_ptr<DxilLinker> m_pLinker;
+  UINT32 m_valMajor, m_valMinor;
   CComPtr<IDxcContainerEventsHandler> m_pDxcContainerEventsHandler;
-  std::vector<CComPtr<IDxcBlob>> m_blobs; // Keep blobs live for lazy load.
+  // Serializes calls to the events handler from batch threads.
+  std::mutex m_eventsHandlerMutex;
+  // Registered libraries by name. Keeps blobs live for lazy load, and lets
+  // batch threads load their own copy of each library.
+  std::map<std::string, CComPtr<IDxcBlob>> m_libBlobs;
 };
 
+HRESULT DxcLinker::LoadLibraryModules(LLVMContext &Ctx, IDxcBlob *pBlob,
+                                      std::unique_ptr<llvm::Module> &pModule,
+                                      std::unique_ptr<llvm::Module> &pDebugModule) {
+  CComPtr<IMalloc> pMalloc;
+  CComPtr<AbstractMemoryStream> pDiagStream;
+
+  IFR(CoGetMalloc(1, &pMalloc));
+  IFR(CreateMemoryStream(pMalloc, &pDiagStream));
+
+  raw_stream_ostream DiagStream(pDiagStream);
+
+  return ValidateLoadModuleFromContainerLazy(
+      pBlob->GetBufferPointer(), pBlob->GetBufferSize(), pModule,
+      pDebugModule, Ctx, Ctx, DiagStream);
+}
+
+HRESULT DxcLinker::LoadLinkerLibrary(DxilLinker &Linker, LLVMContext &Ctx,
+                                     llvm::StringRef LibName,
+                                     IDxcBlob *pBlob) {
+  // A library with an index part is registered from the index, and its
+  // module is only parsed once a link needs it.
+  const DxilContainerHeader *pContainer = IsDxilContainerLike(
+      pBlob->GetBufferPointer(), pBlob->GetBufferSize());
+  if (pContainer && IsValidDxilContainer(pContainer, pBlob->GetBufferSize())) {
+    const DxilPartHeader *pIndexPart =
+        GetDxilPartByType(pContainer, DFCC_LibraryIndex);
+    if (pIndexPart && IsDxilLibraryIndexValid(pIndexPart)) {
+      CComPtr<IDxcBlob> pLibBlob = pBlob;
+      auto loadModule = [pLibBlob, &Ctx]() -> std::unique_ptr<llvm::Module> {
+        std::unique_ptr<llvm::Module> pModule, pDebugModule;
+        try {
+          if (FAILED(LoadLibraryModules(Ctx, pLibBlob, pModule, pDebugModule)))
+            return nullptr;
+        } catch (...) {
+          return nullptr;
+        }
+        return pDebugModule ? std::move(pDebugModule) : std::move(pModule);
+      };
+      if (!Linker.RegisterLib(LibName, pIndexPart, loadModule))
+        return E_INVALIDARG;
+      return S_OK;
+    }
+  }
+
+  std::unique_ptr<llvm::Module> pModule, pDebugModule;
+  IFR(LoadLibraryModules(Ctx, pBlob, pModule, pDebugModule));
+
+  if (!Linker.RegisterLib(LibName, std::move(pModule),
+                          std::move(pDebugModule)))
+    return E_INVALIDARG;
+  return S_OK;
+}
+
 HRESULT
 DxcLinker::RegisterLibrary(_In_opt_ LPCWSTR pLibName, // Name of the library.
                            _In_ IDxcBlob *pBlob       // Library to add.
@@ -123,27 +216,9 @@ DxcLinker::RegisterLibrary(_In_opt_ LPCWSTR pLibName, // Name of the library.
     return E_INVALIDARG;
 
   try {
-    std::unique_ptr<llvm::Module> pModule, pDebugModule;
-
-    CComPtr<IMalloc> pMalloc;
-    CComPtr<AbstractMemoryStream> pDiagStream;
-
-    IFT(CoGetMalloc(1, &pMalloc));
-    IFT(CreateMemoryStream(pMalloc, &pDiagStream));
-
-    raw_stream_ostream DiagStream(pDiagStream);
-
-    IFR(ValidateLoadModuleFromContainerLazy(
-        pBlob->GetBufferPointer(), pBlob->GetBufferSize(), pModule,
-        pDebugModule, m_Ctx, m_Ctx, DiagStream));
-
-    if (m_pLinker->RegisterLib(pUtf8LibName.m_psz, std::move(pModule),
-                               std::move(pDebugModule))) {
-      m_blobs.emplace_back(pBlob);
-      return S_OK;
-    } else {
-      return E_INVALIDARG;
-    }
+    IFR(LoadLinkerLibrary(*m_pLinker, m_Ctx, pUtf8LibName.m_psz, pBlob));
+    m_libBlobs[pUtf8LibName.m_psz] = pBlob;
+    return S_OK;
   } catch (hlsl::Exception &) {
     return E_INVALIDARG;
   }
@@ -164,6 +239,78 @@ HRESULT STDMETHODCALLTYPE DxcLinker::Link(
         *ppResult // Linker output status, buffer, and errors
 ) {
   DxcThreadMalloc TM(m_pMalloc);
+  return LinkWithLinker(*m_pLinker, m_Ctx, pEntryName, pTargetProfile,
+                        pLibNames, libCount, pArguments, argCount, ppResult);
+}
+
+HRESULT STDMETHODCALLTYPE DxcLinker::LinkBatch(
+    _In_count_(jobCount) const DxcLinkJob *pJobs, // Array of jobs
+    _In_ UINT32 jobCount,                         // Number of jobs
+    _In_ UINT32 threadCount,                      // Number of threads
+    _Out_writes_(jobCount) IDxcOperationResult *
+        *ppResults // Linker output status, buffer, and errors of each job
+) {
+  if (jobCount > 0 && (pJobs == nullptr || ppResults == nullptr))
+    return E_INVALIDARG;
+  std::fill(ppResults, ppResults + jobCount, nullptr);
+
+  DxcThreadMalloc TM(m_pMalloc);
+  try {
+    std::vector<CComPtr<IDxcOperationResult>> results(jobCount);
+    hlsl::WorkStealingThreadPool pool(threadCount);
+    // Tasks of one worker never run concurrently, so each worker links in its
+    // own context without locking, and loads a library once for all of its
+    // jobs.
+    std::vector<std::unique_ptr<BatchLinkWorker>> workers(
+        pool.getThreadCount());
+    pool.run(jobCount, [&](unsigned jobIndex, unsigned workerIndex) {
+      DxcThreadMalloc TM(m_pMalloc);
+      const DxcLinkJob &job = pJobs[jobIndex];
+      std::unique_ptr<BatchLinkWorker> &pWorker = workers[workerIndex];
+      if (!pWorker) {
+        pWorker.reset(new BatchLinkWorker());
+        pWorker->pLinker.reset(
+            DxilLinker::CreateLinker(pWorker->Ctx, m_valMajor, m_valMinor));
+      }
+      CComPtr<IDxcOperationResult> &pResult = results[jobIndex];
+      HRESULT hr = S_OK;
+      try {
+        for (UINT32 i = 0; i < job.libCount && SUCCEEDED(hr); ++i) {
+          CW2A pUtf8LibName(job.pLibNames[i], CP_UTF8);
+          if (pWorker->pLinker->HasLibNameRegistered(pUtf8LibName.m_psz))
+            continue;
+          // Unknown names are reported by the link.
+          auto it = m_libBlobs.find(pUtf8LibName.m_psz);
+          if (it != m_libBlobs.end())
+            hr = LoadLinkerLibrary(*pWorker->pLinker, pWorker->Ctx, it->first,
+                                   it->second);
+        }
+      }
+      CATCH_CPP_ASSIGN_HRESULT();
+      if (SUCCEEDED(hr))
+        hr = LinkWithLinker(*pWorker->pLinker, pWorker->Ctx, job.pEntryName,
+                            job.pTargetProfile, job.pLibNames, job.libCount,
+                            job.pArguments, job.argCount, &pResult);
+      if (FAILED(hr)) {
+        pResult.Release();
+        IFT(DxcOperationResult::CreateFromResultErrorStatus(nullptr, nullptr,
+                                                            hr, &pResult));
+      }
+    });
+    // Release the worker contexts before the pool threads go away.
+    workers.clear();
+    for (UINT32 i = 0; i < jobCount; ++i)
+      ppResults[i] = results[i].Detach();
+    return S_OK;
+  }
+  CATCH_CPP_RETURN_HRESULT();
+}
+
+HRESULT DxcLinker::LinkWithLinker(DxilLinker &Linker, LLVMContext &Ctx,
+                                  LPCWSTR pEntryName, LPCWSTR pTargetProfile,
+                                  const LPCWSTR *pLibNames, UINT32 libCount,
+                                  const LPCWSTR *pArguments, UINT32 argCount,
+                                  IDxcOperationResult **ppResult) {
   // Prepare UTF8-encoded versions of API values.
   CW2A pUtf8TargetProfile(pTargetProfile, CP_UTF8);
   CW2A pUtf8EntryPoint(pEntryName, CP_UTF8);
@@ -171,7 +318,7 @@ HRESULT STDMETHODCALLTYPE DxcLinker::Link(
   CComPtr<AbstractMemoryStream> pOutputStream;
 
   // Detach previous libraries.
-  m_pLinker->DetachAll();
+  Linker.DetachAll();
 
   HRESULT hr = S_OK;
   try {
@@ -206,14 +353,14 @@ HRESULT STDMETHODCALLTYPE DxcLinker::Link(
     raw_stream_ostream DiagStream(pDiagStream);
     llvm::DiagnosticPrinterRawOStream DiagPrinter(DiagStream);
     PrintDiagnosticContext DiagContext(DiagPrinter);
-    m_Ctx.setDiagnosticHandler(PrintDiagnosticContext::PrintDiagnosticHandler,
-                               &DiagContext, true);
+    Ctx.setDiagnosticHandler(PrintDiagnosticContext::PrintDiagnosticHandler,
+                             &DiagContext, true);
 
     // Attach libraries.
     bool bSuccess = true;
     for (unsigned i = 0; i < libCount; i++) {
       CW2A pUtf8LibName(pLibNames[i], CP_UTF8);
-      bSuccess &= m_pLinker->AttachLib(pUtf8LibName.m_psz);
+      bSuccess &= Linker.AttachLib(pUtf8LibName.m_psz);
     }
 
     dxilutil::ExportMap exportMap;
@@ -221,8 +368,18 @@ HRESULT STDMETHODCALLTYPE DxcLinker::Link(
 
     bool hasErrorOccurred = !bSuccess;
     if (bSuccess) {
-      std::unique_ptr<Module> pM = m_pLinker->Link(
+      std::unique_ptr<Module> pM = Linker.Link(
           opts.EntryPoint, pUtf8TargetProfile.m_psz, exportMap);
+      if (opts.ReportLinkStats) {
+        const DxilLinkStats &stats = Linker.GetLastLinkStats();
+        DiagStream << "note: " << stats.FunctionsLoaded
+                   << " library functions loaded in "
+                   << stats.LoadMicroseconds << "us, "
+                   << stats.FunctionsReused << " reused; "
+                   << stats.FunctionsCloned << " cloned in "
+                   << stats.CloneMicroseconds << "us; link passes took "
+                   << stats.PrepareMicroseconds << "us.\n";
+      }
       if (pM) {
         const IntrusiveRefCntPtr<clang::DiagnosticIDs> Diags(
             new clang::DiagnosticIDs);
@@ -249,6 +406,12 @@ HRESULT STDMETHODCALLTYPE DxcLinker::Link(
         if (opts.DebugNameForSource) {
           SerializeFlags |= SerializeDxilFlags::DebugNameDependOnSource;
         }
+        if (opts.LibraryIndex) {
+          SerializeFlags |= SerializeDxilFlags::IncludeLibraryIndexPart;
+        }
+        if (opts.CBufferLayout) {
+          SerializeFlags |= SerializeDxilFlags::IncludeCBufferLayoutPart;
+        }
         // Validation.
         HRESULT valHR = S_OK;
         // Skip validation on lib for now.
@@ -264,6 +427,7 @@ HRESULT STDMETHODCALLTYPE DxcLinker::Link(
         // Callback after valid DXIL is produced
         if (SUCCEEDED(valHR)) {
           CComPtr<IDxcBlob> pTargetBlob;
+          std::lock_guard<std::mutex> lock(m_eventsHandlerMutex);
           if (m_pDxcContainerEventsHandler != nullptr) {
             HRESULT hr = m_pDxcContainerEventsHandler->OnDxilContainerBuilt(
                 pOutputBlob, &pTargetBlob);
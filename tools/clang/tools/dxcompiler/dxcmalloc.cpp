@@ -0,0 +1,312 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// dxcmalloc.cpp                                                             //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Provides the counting and arena allocators of the compiler.               //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/Support/WinIncludes.h"
+#include "dxc/Support/Global.h"
+#include "dxcmalloc.h"
+#include <algorithm>
+#include <cstring>
+
+namespace dxcutil {
+
+void DxcCountingMalloc::Track(void *pOld, void *pNew, SIZE_T cb) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (pOld != nullptr) {
+    // Blocks allocated before this allocator was in use are not counted.
+    BlockSizeMap::iterator it = m_blockSizes.find(pOld);
+    if (it != m_blockSizes.end()) {
+      m_current -= it->second;
+      m_blockSizes.erase(it);
+      if (pNew == nullptr)
+        ++m_freeCount;
+    }
+  }
+  if (pNew != nullptr) {
+    ++m_allocCount;
+    m_totalBytes += cb;
+    try {
+      m_blockSizes[pNew] = cb;
+    } catch (std::bad_alloc &) {
+      return; // Leave the block uncounted rather than fail the allocation.
+    }
+    m_current += cb;
+    m_peak = std::max(m_peak, m_current);
+  }
+}
+
+void *STDMETHODCALLTYPE DxcCountingMalloc::Alloc(SIZE_T cb) {
+  void *p = m_pMalloc->Alloc(cb);
+  Track(nullptr, p, cb);
+  return p;
+}
+
+void *STDMETHODCALLTYPE DxcCountingMalloc::Realloc(void *pv, SIZE_T cb) {
+  void *p = m_pMalloc->Realloc(pv, cb);
+  // On failure the original block is left as it was.
+  if (p != nullptr || cb == 0)
+    Track(pv, p, cb);
+  return p;
+}
+
+void STDMETHODCALLTYPE DxcCountingMalloc::Free(void *pv) {
+  Track(pv, nullptr, 0);
+  m_pMalloc->Free(pv);
+}
+
+SIZE_T STDMETHODCALLTYPE DxcCountingMalloc::GetSize(void *pv) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  BlockSizeMap::iterator it = m_blockSizes.find(pv);
+  return it == m_blockSizes.end() ? (SIZE_T)-1 : it->second;
+}
+
+int STDMETHODCALLTYPE DxcCountingMalloc::DidAlloc(void *pv) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_blockSizes.count(pv) ? 1 : -1;
+}
+
+void STDMETHODCALLTYPE DxcCountingMalloc::HeapMinimize() {}
+
+HRESULT STDMETHODCALLTYPE DxcCountingMalloc::GetStats(DxcMallocStats *pStats) {
+  if (pStats == nullptr)
+    return E_POINTER;
+  std::lock_guard<std::mutex> lock(m_mutex);
+  pStats->AllocCount = m_allocCount;
+  pStats->FreeCount = m_freeCount;
+  pStats->TotalBytes = m_totalBytes;
+  pStats->CurrentBytes = (UINT64)std::max<int64_t>(m_current, 0);
+  pStats->PeakBytes = (UINT64)std::max<int64_t>(m_peak, 0);
+  return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE DxcCountingMalloc::ResetStats() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_allocCount = 0;
+  m_freeCount = 0;
+  m_totalBytes = 0;
+  m_peak = m_current;
+  return S_OK;
+}
+
+int64_t DxcCountingMalloc::GetCurrentBytes() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_current;
+}
+
+int64_t DxcCountingMalloc::ResetPeak() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  int64_t oldPeak = m_peak;
+  m_peak = m_current;
+  return oldPeak;
+}
+
+int64_t DxcCountingMalloc::RaisePeak(int64_t Bytes) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_peak = std::max(m_peak, Bytes);
+  return m_peak;
+}
+
+// Every block is preceded by its size, padded to keep the block aligned.
+static const SIZE_T ArenaAlignment = 2 * sizeof(void *);
+static const SIZE_T ArenaHeaderSize = ArenaAlignment;
+static const SIZE_T ArenaChunkSize = 256 * 1024;
+// Larger blocks get a chunk of their own, so that switching chunks never
+// leaves more than this much unused at the end of one.
+static const SIZE_T ArenaMaxSharedBlock = 16 * 1024;
+
+static SIZE_T ArenaAlign(SIZE_T cb) {
+  return (cb + ArenaAlignment - 1) & ~(ArenaAlignment - 1);
+}
+
+static SIZE_T &ArenaBlockSize(void *pv) {
+  return *(SIZE_T *)((char *)pv - ArenaHeaderSize);
+}
+
+DxcArenaMalloc::~DxcArenaMalloc() {
+  for (size_t i = 0; i < m_chunkCount; ++i)
+    m_pMalloc->Free(m_chunks[i].Begin);
+  m_pMalloc->Free(m_chunks);
+}
+
+const DxcArenaMalloc::Chunk *DxcArenaMalloc::FindChunk(void *pv) const {
+  const Chunk *pBegin = m_chunks;
+  const Chunk *pEnd = m_chunks + m_chunkCount;
+  const Chunk *pNext = std::upper_bound(
+      pBegin, pEnd, (char *)pv,
+      [](char *p, const Chunk &C) { return p < C.Begin; });
+  if (pNext == pBegin)
+    return nullptr;
+  const Chunk *pC = pNext - 1;
+  return (char *)pv < pC->End ? pC : nullptr;
+}
+
+bool DxcArenaMalloc::AddChunk(const Chunk &C) {
+  if (m_chunkCount == m_chunkCapacity) {
+    size_t capacity = std::max<size_t>(16, m_chunkCapacity * 2);
+    Chunk *pChunks =
+        (Chunk *)m_pMalloc->Realloc(m_chunks, capacity * sizeof(Chunk));
+    if (pChunks == nullptr)
+      return false;
+    m_chunks = pChunks;
+    m_chunkCapacity = capacity;
+  }
+  Chunk *pEnd = m_chunks + m_chunkCount;
+  Chunk *pPos = std::upper_bound(
+      m_chunks, pEnd, C.Begin,
+      [](char *p, const Chunk &Other) { return p < Other.Begin; });
+  std::memmove(pPos + 1, pPos, (pEnd - pPos) * sizeof(Chunk));
+  *pPos = C;
+  ++m_chunkCount;
+  return true;
+}
+
+void DxcArenaMalloc::RemoveChunk(const Chunk *pC) {
+  Chunk *pPos = m_chunks + (pC - m_chunks);
+  Chunk *pEnd = m_chunks + m_chunkCount;
+  std::memmove(pPos, pPos + 1, (pEnd - pPos - 1) * sizeof(Chunk));
+  --m_chunkCount;
+}
+
+void *DxcArenaMalloc::AllocLocked(SIZE_T cb) {
+  if (cb > ArenaMaxSharedBlock) {
+    if (cb > (SIZE_T)-1 - ArenaHeaderSize)
+      return nullptr;
+    char *pBegin = (char *)m_pMalloc->Alloc(ArenaHeaderSize + cb);
+    if (pBegin == nullptr)
+      return nullptr;
+    Chunk C = { pBegin, pBegin + ArenaHeaderSize + cb, true };
+    if (!AddChunk(C)) {
+      m_pMalloc->Free(pBegin);
+      return nullptr;
+    }
+    void *pv = pBegin + ArenaHeaderSize;
+    ArenaBlockSize(pv) = cb;
+    return pv;
+  }
+
+  SIZE_T size = ArenaHeaderSize + ArenaAlign(cb);
+  if ((SIZE_T)(m_end - m_pos) < size) {
+    char *pBegin = (char *)m_pMalloc->Alloc(ArenaChunkSize);
+    if (pBegin == nullptr)
+      return nullptr;
+    Chunk C = { pBegin, pBegin + ArenaChunkSize, false };
+    if (!AddChunk(C)) {
+      m_pMalloc->Free(pBegin);
+      return nullptr;
+    }
+    m_pos = C.Begin;
+    m_end = C.End;
+  }
+  void *pv = m_pos + ArenaHeaderSize;
+  m_pos += size;
+  m_last = (char *)pv;
+  ArenaBlockSize(pv) = cb;
+  return pv;
+}
+
+void DxcArenaMalloc::FreeLocked(void *pv, const Chunk *pC) {
+  if (pC->Dedicated) {
+    char *pBegin = pC->Begin;
+    RemoveChunk(pC);
+    m_pMalloc->Free(pBegin);
+  } else if (pv == m_last) {
+    m_pos = m_last - ArenaHeaderSize;
+    m_last = nullptr;
+  }
+}
+
+void *STDMETHODCALLTYPE DxcArenaMalloc::Alloc(SIZE_T cb) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return AllocLocked(cb);
+}
+
+void *STDMETHODCALLTYPE DxcArenaMalloc::Realloc(void *pv, SIZE_T cb) {
+  if (pv == nullptr)
+    return Alloc(cb);
+  if (cb == 0) {
+    Free(pv);
+    return nullptr;
+  }
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  const Chunk *pC = FindChunk(pv);
+  if (pC == nullptr)
+    return m_pMalloc->Realloc(pv, cb);
+
+  SIZE_T oldSize = ArenaBlockSize(pv);
+  if (!pC->Dedicated) {
+    if (pv == m_last && cb <= ArenaMaxSharedBlock &&
+        ArenaAlign(cb) <= (SIZE_T)(m_end - m_last)) {
+      m_pos = m_last + ArenaAlign(cb);
+      ArenaBlockSize(pv) = cb;
+      return pv;
+    }
+    if (cb <= oldSize) {
+      ArenaBlockSize(pv) = cb;
+      return pv;
+    }
+  }
+
+  void *pNew = AllocLocked(cb);
+  if (pNew == nullptr)
+    return nullptr;
+  std::memcpy(pNew, pv, std::min(oldSize, cb));
+  // Adding a chunk may have moved the table, so look the old block up again.
+  FreeLocked(pv, FindChunk(pv));
+  return pNew;
+}
+
+void STDMETHODCALLTYPE DxcArenaMalloc::Free(void *pv) {
+  if (pv == nullptr)
+    return;
+  std::lock_guard<std::mutex> lock(m_mutex);
+  const Chunk *pC = FindChunk(pv);
+  if (pC == nullptr) {
+    m_pMalloc->Free(pv);
+    return;
+  }
+  FreeLocked(pv, pC);
+}
+
+SIZE_T STDMETHODCALLTYPE DxcArenaMalloc::GetSize(void *pv) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (pv == nullptr || FindChunk(pv) == nullptr)
+    return (SIZE_T)-1;
+  return ArenaBlockSize(pv);
+}
+
+int STDMETHODCALLTYPE DxcArenaMalloc::DidAlloc(void *pv) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return FindChunk(pv) != nullptr ? 1 : 0;
+}
+
+void STDMETHODCALLTYPE DxcArenaMalloc::HeapMinimize() {}
+
+} // namespace dxcutil
+
+HRESULT CreateDxcArenaMalloc(_In_ REFIID riid, _Out_ LPVOID *ppv) {
+  CComPtr<dxcutil::DxcArenaMalloc> result =
+      CreateOnMalloc<dxcutil::DxcArenaMalloc>(DxcGetThreadMallocNoRef());
+  if (result == nullptr) {
+    *ppv = nullptr;
+    return E_OUTOFMEMORY;
+  }
+  return result.p->QueryInterface(riid, ppv);
+}
+
+HRESULT CreateDxcProfilingMalloc(_In_ REFIID riid, _Out_ LPVOID *ppv) {
+  CComPtr<dxcutil::DxcCountingMalloc> result =
+      CreateOnMalloc<dxcutil::DxcCountingMalloc>(DxcGetThreadMallocNoRef());
+  if (result == nullptr) {
+    *ppv = nullptr;
+    return E_OUTOFMEMORY;
+  }
+  return result.p->QueryInterface(riid, ppv);
+}
@@ -0,0 +1,144 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// dxcmalloc.h                                                               //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Provides the counting and arena allocators of the compiler.               //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "dxc/dxcapi.h"
+#include "dxc/Support/Global.h"
+#include "dxc/Support/microcom.h"
+#include <mutex>
+#include <new>
+#include <unordered_map>
+
+namespace dxcutil {
+
+/// Forwards to another allocator and tracks the bytes allocated through this
+/// one that are not freed yet, and their high-water mark. Block sizes are
+/// kept in a table whose storage comes from the forwarded-to allocator, so
+/// keeping it does not allocate through this one.
+class DxcCountingMalloc : public IMalloc, public IDxcMallocStats {
+private:
+  DXC_MICROCOM_TM_REF_FIELDS()
+
+  template <typename T> struct ForwardAllocator {
+    typedef T value_type;
+    IMalloc *pMalloc;
+    ForwardAllocator(IMalloc *pMalloc) : pMalloc(pMalloc) {}
+    template <typename U>
+    ForwardAllocator(const ForwardAllocator<U> &Other) : pMalloc(Other.pMalloc) {}
+    T *allocate(size_t n) {
+      void *p = pMalloc->Alloc(n * sizeof(T));
+      if (p == nullptr)
+        throw std::bad_alloc();
+      return (T *)p;
+    }
+    void deallocate(T *p, size_t) { pMalloc->Free(p); }
+    template <typename U> bool operator==(const ForwardAllocator<U> &Other) const {
+      return pMalloc == Other.pMalloc;
+    }
+    template <typename U> bool operator!=(const ForwardAllocator<U> &Other) const {
+      return pMalloc != Other.pMalloc;
+    }
+  };
+  typedef std::unordered_map<void *, SIZE_T, std::hash<void *>,
+                             std::equal_to<void *>,
+                             ForwardAllocator<std::pair<void *const, SIZE_T>>>
+      BlockSizeMap;
+
+  std::mutex m_mutex;
+  BlockSizeMap m_blockSizes;
+  int64_t m_current;
+  int64_t m_peak;
+  uint64_t m_allocCount;
+  uint64_t m_freeCount;
+  uint64_t m_totalBytes;
+
+  void Track(void *pOld, void *pNew, SIZE_T cb);
+
+public:
+  DXC_MICROCOM_TM_ADDREF_RELEASE_IMPL()
+  DxcCountingMalloc(IMalloc *pMalloc)
+      : m_dwRef(0), m_pMalloc(pMalloc),
+        m_blockSizes(0, std::hash<void *>(), std::equal_to<void *>(),
+                     ForwardAllocator<std::pair<void *const, SIZE_T>>(pMalloc)),
+        m_current(0), m_peak(0), m_allocCount(0), m_freeCount(0),
+        m_totalBytes(0) {}
+
+  HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void **ppvObject) override {
+    return DoBasicQueryInterface<IMalloc, IDxcMallocStats>(this, iid, ppvObject);
+  }
+
+  void *STDMETHODCALLTYPE Alloc(_In_ SIZE_T cb) override;
+  void *STDMETHODCALLTYPE Realloc(_In_opt_ void *pv, _In_ SIZE_T cb) override;
+  void STDMETHODCALLTYPE Free(_In_opt_ void *pv) override;
+  virtual SIZE_T STDMETHODCALLTYPE GetSize(_In_opt_ void *pv);
+  virtual int STDMETHODCALLTYPE DidAlloc(_In_opt_ void *pv);
+  virtual void STDMETHODCALLTYPE HeapMinimize();
+
+  HRESULT STDMETHODCALLTYPE GetStats(_Out_ DxcMallocStats *pStats) override;
+  HRESULT STDMETHODCALLTYPE ResetStats() override;
+
+  int64_t GetCurrentBytes();
+  /// Restarts the high-water mark at the current bytes; returns the old one.
+  int64_t ResetPeak();
+  /// Returns the high-water mark after raising it to at least Bytes.
+  int64_t RaisePeak(int64_t Bytes);
+};
+
+/// Hands out memory by bumping a pointer through chunks taken from another
+/// allocator, and returns the chunks to it all at once when released.
+/// Freeing a block only reclaims its memory if it is the most recent block
+/// or a large block with a chunk of its own. Blocks that were not allocated
+/// here are forwarded to the allocator the chunks come from.
+class DxcArenaMalloc : public IMalloc {
+private:
+  DXC_MICROCOM_TM_REF_FIELDS()
+
+  struct Chunk {
+    char *Begin;
+    char *End;
+    bool Dedicated; // Holds a single large block.
+  };
+
+  std::mutex m_mutex;
+  Chunk *m_chunks; // Sorted by address.
+  size_t m_chunkCount;
+  size_t m_chunkCapacity;
+  char *m_pos;  // Free space left in the current chunk.
+  char *m_end;
+  char *m_last; // Most recent block, which can still shrink or grow in place.
+
+  const Chunk *FindChunk(void *pv) const;
+  bool AddChunk(const Chunk &C);
+  void RemoveChunk(const Chunk *pC);
+  void *AllocLocked(SIZE_T cb);
+  void FreeLocked(void *pv, const Chunk *pC);
+
+public:
+  DXC_MICROCOM_TM_ADDREF_RELEASE_IMPL()
+  DxcArenaMalloc(IMalloc *pMalloc)
+      : m_dwRef(0), m_pMalloc(pMalloc), m_chunks(nullptr), m_chunkCount(0),
+        m_chunkCapacity(0), m_pos(nullptr), m_end(nullptr), m_last(nullptr) {}
+  ~DxcArenaMalloc();
+
+  HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void **ppvObject) override {
+    return DoBasicQueryInterface<IMalloc>(this, iid, ppvObject);
+  }
+
+  void *STDMETHODCALLTYPE Alloc(_In_ SIZE_T cb) override;
+  void *STDMETHODCALLTYPE Realloc(_In_opt_ void *pv, _In_ SIZE_T cb) override;
+  void STDMETHODCALLTYPE Free(_In_opt_ void *pv) override;
+  virtual SIZE_T STDMETHODCALLTYPE GetSize(_In_opt_ void *pv);
+  virtual int STDMETHODCALLTYPE DidAlloc(_In_opt_ void *pv);
+  virtual void STDMETHODCALLTYPE HeapMinimize();
+};
+
+} // namespace dxcutil
@@ -17,6 +17,7 @@
 #include "clang/Frontend/CompilerInstance.h"
 #include "clang/Lex/Preprocessor.h"
 #include "clang/Lex/HLSLMacroExpander.h"
+#include "clang/Lex/PPCallbacks.h"
 #include "clang/Frontend/ASTUnit.h"
 #include "clang/Frontend/TextDiagnosticPrinter.h"
 #include "clang/Sema/SemaHLSL.h"
@@ -24,10 +25,15 @@
 #include "clang/Frontend/FrontendActions.h"
 #include "clang/CodeGen/CodeGenAction.h"
 #include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/ADT/StringSet.h"
+#include "llvm/Support/MD5.h"
 #include "dxc/Support/WinIncludes.h"
 #include "dxc/HLSL/HLSLExtensionsCodegenHelper.h"
 #include "dxc/DxilRootSignature/DxilRootSignature.h"
 #include "dxcutil.h"
+#include "dxccompilecache.h"
+#include "dxctimereport.h"
 #include "dxc/Support/dxcfilesystem.h"
 #include "dxc/Support/WinIncludes.h"
 #include "dxc/DxilContainer/DxilContainerAssembler.h"
@@ -42,16 +48,19 @@
 #include "dxc/Support/dxcapi.impl.h"
 #include "dxc/Support/DxcLangExtensionsHelper.h"
 #include "dxc/Support/HLSLOptions.h"
+#include "dxc/Support/dxcthreadpool.h"
 #ifdef _WIN32
 #include "dxcetw.h"
 #endif
 #include "dxillib.h"
 #include <algorithm>
 #include <cfloat>
+#include <mutex>
 
 // SPIRV change starts
 #ifdef ENABLE_SPIRV_CODEGEN
 #include "clang/SPIRV/EmitSpirvAction.h"
+#include "clang/SPIRV/SpirvToolsPool.h"
 #endif
 // SPIRV change ends
 
@@ -102,6 +111,41 @@ static void CreateOperationResultFromOutputs(
                                    ppResult);
 }
 
+namespace {
+// Records the macros that are expanded or tested while preprocessing. The
+// output of the preprocessor only depends on the definitions of these macros.
+class MacroReferenceRecorder : public PPCallbacks {
+public:
+  explicit MacroReferenceRecorder(llvm::StringSet<> &Macros)
+      : m_Macros(Macros) {}
+
+  void MacroExpands(const Token &MacroNameTok, const MacroDefinition &MD,
+                    SourceRange Range, const MacroArgs *Args) override {
+    Record(MacroNameTok);
+  }
+  void Defined(const Token &MacroNameTok, const MacroDefinition &MD,
+               SourceRange Range) override {
+    Record(MacroNameTok);
+  }
+  void Ifdef(SourceLocation Loc, const Token &MacroNameTok,
+             const MacroDefinition &MD) override {
+    Record(MacroNameTok);
+  }
+  void Ifndef(SourceLocation Loc, const Token &MacroNameTok,
+              const MacroDefinition &MD) override {
+    Record(MacroNameTok);
+  }
+
+private:
+  void Record(const Token &MacroNameTok) {
+    if (const IdentifierInfo *II = MacroNameTok.getIdentifierInfo())
+      m_Macros.insert(II->getName());
+  }
+
+  llvm::StringSet<> &m_Macros;
+};
+} // namespace
+
 static bool ShouldPartBeIncludedInPDB(UINT32 FourCC) {
   switch (FourCC) {
   case hlsl::DFCC_ShaderDebugName:
@@ -379,6 +423,9 @@ public:
 class DxcCompiler : public IDxcCompiler2,
                     public IDxcLangExtensions,
                     public IDxcContainerEvent,
+                    public IDxcCompileCache,
+                    public IDxcBatchCompiler,
+                    public IDxcPermutationCompiler,
 #ifdef SUPPORT_QUERY_GIT_COMMIT_INFO
                     public IDxcVersionInfo2
 #else
@@ -389,6 +436,11 @@ private:
   DXC_MICROCOM_TM_REF_FIELDS()
   DxcLangExtensionsHelper m_langExtensionsHelper;
   CComPtr<IDxcContainerEventsHandler> m_pDxcContainerEventsHandler;
+  // Reused by batches that ask for the same thread count, so their threads
+  // are started once. Held while a batch runs on it.
+  std::mutex m_batchPoolMutex;
+  std::unique_ptr<hlsl::WorkStealingThreadPool> m_pBatchPool;
+  UINT32 m_batchPoolThreadCount = 0;
 
   void CreateDefineStrings(_In_count_(defineCount) const DxcDefine *pDefines,
                            UINT defineCount,
@@ -404,6 +456,68 @@ private:
     }
   }
 
+  bool IsCompileCacheEnabled(hlsl::options::DxcOpts &opts) {
+    // A time report describes the compile that produced it, so it is never
+    // restored from the cache.
+    if (opts.CompileCacheDir.empty() || opts.AstDump || opts.OptDump ||
+        opts.TimeReport)
+      return false;
+#ifdef ENABLE_SPIRV_CODEGEN
+    if (opts.GenSPIRV)
+      return false;
+#endif
+    // The container event handler may rewrite the output, so its results
+    // cannot be reproduced without invoking it.
+    return m_pDxcContainerEventsHandler == nullptr;
+  }
+
+  // Computes the key of a compilation for the result cache. The key covers
+  // the preprocessed source, so changes in included files and in defines
+  // are picked up. Returns false if the source does not preprocess cleanly;
+  // such compilations are not cached.
+  bool ComputeCompileCacheKey(
+      _In_ IDxcBlob *pSource, _In_ LPCWSTR pSourceName,
+      _In_ LPCWSTR pEntryPoint, _In_ LPCWSTR pTargetProfile,
+      _In_count_(argCount) LPCWSTR *pArguments, _In_ UINT32 argCount,
+      _In_count_(defineCount) const DxcDefine *pDefines,
+      _In_ UINT32 defineCount, _In_opt_ IDxcIncludeHandler *pIncludeHandler,
+      hlsl::options::DxcOpts &opts, bool debugBlobRequested,
+      bool debugBlobNameRequested, std::string &key) {
+    CComPtr<IDxcOperationResult> pPreprocessResult;
+    IFT(Preprocess(pSource, pSourceName, pArguments, argCount, pDefines,
+                   defineCount, pIncludeHandler, &pPreprocessResult));
+    HRESULT status;
+    IFT(pPreprocessResult->GetStatus(&status));
+    if (FAILED(status))
+      return false;
+    CComPtr<IDxcBlob> pPreprocessed;
+    IFT(pPreprocessResult->GetResult(&pPreprocessed));
+
+    dxcutil::DxcCompileCacheKeyBuilder builder;
+    builder.AddWideString(pSourceName);
+    builder.AddWideString(pEntryPoint);
+    builder.AddWideString(pTargetProfile);
+    for (const llvm::opt::Arg *A : opts.Args) {
+      // Where results are cached does not change them.
+      if (A->getOption().matches(options::OPT_compile_cache) ||
+          A->getOption().matches(options::OPT_compile_cache_size))
+        continue;
+      builder.AddString(A->getAsString(opts.Args));
+    }
+    builder.AddValue(defineCount);
+    for (UINT32 i = 0; i < defineCount; ++i) {
+      builder.AddWideString(pDefines[i].Name);
+      builder.AddWideString(pDefines[i].Value);
+    }
+    // Requesting the debug outputs changes what is placed in the container.
+    builder.AddValue(debugBlobRequested);
+    builder.AddValue(debugBlobNameRequested);
+    builder.AddString(StringRef((const char *)pPreprocessed->GetBufferPointer(),
+                                pPreprocessed->GetBufferSize()));
+    key = builder.Finish();
+    return true;
+  }
+
 public:
   DXC_MICROCOM_TM_ADDREF_RELEASE_IMPL()
   DXC_MICROCOM_TM_CTOR(DxcCompiler)
@@ -426,6 +540,9 @@ public:
                                  IDxcCompiler2,
                                  IDxcLangExtensions,
                                  IDxcContainerEvent,
+                                 IDxcCompileCache,
+                                 IDxcBatchCompiler,
+                                 IDxcPermutationCompiler,
                                  IDxcVersionInfo
 #ifdef SUPPORT_QUERY_GIT_COMMIT_INFO
                                 ,IDxcVersionInfo2
@@ -482,6 +599,8 @@ public:
     CComPtr<AbstractMemoryStream> pOutputStream;
     CComHeapPtr<wchar_t> DebugBlobName;
     DxilShaderHash ShaderHashContent;
+    std::unique_ptr<dxcutil::DxcCompileCache> pCompileCache;
+    std::string compileCacheKey;
 
     DxcEtw_DXCompilerCompile_Start();
     pSourceName = (pSourceName && *pSourceName) ? pSourceName : L"hlsl.hlsl"; // declared optional, so pick a default
@@ -507,6 +626,41 @@ public:
         goto Cleanup;
       }
 
+      if (IsCompileCacheEnabled(opts)) {
+        pCompileCache.reset(new dxcutil::DxcCompileCache(
+            opts.CompileCacheDir, (uint64_t)opts.CompileCacheSizeMB << 20));
+        if (!ComputeCompileCacheKey(pSource, pSourceName, pEntryPoint,
+                                    pTargetProfile, pArguments, argCount,
+                                    pDefines, defineCount, pIncludeHandler,
+                                    opts, ppDebugBlob != nullptr,
+                                    ppDebugBlobName != nullptr,
+                                    compileCacheKey)) {
+          pCompileCache.reset();
+        } else {
+          dxcutil::DxcCompileCacheEntry cacheEntry;
+          if (pCompileCache->Lookup(compileCacheKey, cacheEntry)) {
+            if (ppDebugBlobName && !cacheEntry.DebugBlobName.empty()) {
+              IFTBOOL(Unicode::UTF8BufferToUTF16ComHeap(
+                          cacheEntry.DebugBlobName.c_str(), &DebugBlobName),
+                      DXC_E_CONTAINER_INVALID);
+            }
+            CComPtr<IDxcBlobEncoding> pWarnings;
+            IFT(DxcCreateBlobWithEncodingOnHeapCopy(
+                cacheEntry.Warnings.data(), cacheEntry.Warnings.size(),
+                CP_UTF8, &pWarnings));
+            IFT(DxcOperationResult::CreateFromResultErrorStatus(
+                cacheEntry.pResultBlob, pWarnings, S_OK, ppResult));
+            // After assigning ppResult, nothing should fail.
+            if (ppDebugBlob)
+              *ppDebugBlob = cacheEntry.pDebugBlob.Detach();
+            if (ppDebugBlobName)
+              *ppDebugBlobName = DebugBlobName.Detach();
+            hr = S_OK;
+            goto Cleanup;
+          }
+        }
+      }
+
 #ifdef ENABLE_SPIRV_CODEGEN
       // We want to embed the preprocessed source code in the final SPIR-V if
       // debug information is enabled. Therefore, we invoke Preprocess() here
@@ -527,6 +681,19 @@ public:
       }
 #endif // ENABLE_SPIRV_CODEGEN
 
+      // With -ftime-report, count the bytes allocated by the compile and
+      // record each of its phases and passes.
+      CComPtr<dxcutil::DxcCountingMalloc> pCountingMalloc;
+      std::unique_ptr<dxcutil::DxcTimeReport> pTimeReport;
+      if (opts.TimeReport) {
+        pCountingMalloc = CreateOnMalloc<dxcutil::DxcCountingMalloc>(m_pMalloc);
+        IFTOOM(pCountingMalloc.p);
+        pTimeReport.reset(new dxcutil::DxcTimeReport(pCountingMalloc));
+      }
+      DxcThreadMalloc TMReport(pCountingMalloc ? (IMalloc *)pCountingMalloc
+                                               : m_pMalloc.p);
+      llvm::legacy::ScopedPassObserver passObserver(pTimeReport.get());
+
       // Convert source code encoding
       IFC(hlsl::DxcGetBlobAsUtf8(pSource, &utf8Source));
 
@@ -546,24 +713,10 @@ public:
       // Prepare UTF8-encoded versions of API values.
       CW2A pUtf8EntryPoint(pEntryPoint, CP_UTF8);
       CW2A utf8SourceName(pSourceName, CP_UTF8);
-      const char *pUtf8SourceName = utf8SourceName.m_psz;
-      if (pUtf8SourceName == nullptr) {
-        if (opts.InputFile.empty()) {
-          pUtf8SourceName = "input.hlsl";
-        }
-        else {
-          pUtf8SourceName = opts.InputFile.data();
-        }
-      }
 
       IFT(msfPtr->RegisterOutputStream(L"output.bc", pOutputStream));
       IFT(msfPtr->CreateStdStreams(m_pMalloc));
 
-      StringRef Data((LPSTR)utf8Source->GetBufferPointer(),
-                     utf8Source->GetBufferSize());
-      std::unique_ptr<llvm::MemoryBuffer> pBuffer(
-          llvm::MemoryBuffer::getMemBufferCopy(Data, pUtf8SourceName));
-
       // Not very efficient but also not very important.
       std::vector<std::string> defines;
       CreateDefineStrings(pDefines, defineCount, defines);
@@ -688,12 +841,35 @@ public:
             opts.SpirvOptions.clOptions += " " + std::string(opt);
 
         compiler.getCodeGenOpts().SpirvOptions = opts.SpirvOptions;
+        const clang::spirv::SpirvToolsPoolStats poolBefore =
+            clang::spirv::getSpirvToolsPoolStats();
         clang::EmitSpirvAction action;
         FrontendInputFile file(utf8SourceName.m_psz, IK_HLSL);
         action.BeginSourceFile(compiler, file);
         action.Execute();
         action.EndSourceFile();
         outStream.flush();
+        if (pTimeReport) {
+          // The pool is shared by the process, so concurrent compiles may
+          // show up in these deltas as well.
+          const clang::spirv::SpirvToolsPoolStats poolAfter =
+              clang::spirv::getSpirvToolsPoolStats();
+          pTimeReport->AddCounter("spirvOptimizersCreated",
+                                  poolAfter.optimizersCreated -
+                                      poolBefore.optimizersCreated);
+          pTimeReport->AddCounter("spirvOptimizersReused",
+                                  poolAfter.optimizersReused -
+                                      poolBefore.optimizersReused);
+          pTimeReport->AddCounter("spirvValidatorsCreated",
+                                  poolAfter.validatorsCreated -
+                                      poolBefore.validatorsCreated);
+          pTimeReport->AddCounter("spirvValidatorsReused",
+                                  poolAfter.validatorsReused -
+                                      poolBefore.validatorsReused);
+          pTimeReport->AddCounter("spirvToolsConstructionMicroseconds",
+                                  poolAfter.constructionMicroseconds -
+                                      poolBefore.constructionMicroseconds);
+        }
       }
 #endif
       // SPIRV change ends
@@ -701,13 +877,16 @@ public:
         EmitBCAction action(&llvmContext);
         FrontendInputFile file(utf8SourceName.m_psz, IK_HLSL);
         bool compileOK;
-        if (action.BeginSourceFile(compiler, file)) {
-          action.Execute();
-          action.EndSourceFile();
-          compileOK = !compiler.getDiagnostics().hasErrorOccurred();
-        }
-        else {
-          compileOK = false;
+        {
+          dxcutil::DxcTimeReportPhase phase(pTimeReport.get(), "frontend");
+          if (action.BeginSourceFile(compiler, file)) {
+            action.Execute();
+            action.EndSourceFile();
+            compileOK = !compiler.getDiagnostics().hasErrorOccurred();
+          }
+          else {
+            compileOK = false;
+          }
         }
         outStream.flush();
 
@@ -735,22 +914,36 @@ public:
         if (opts.StripReflection) {
           SerializeFlags |= SerializeDxilFlags::StripReflectionFromDxilPart;
         }
+        if (opts.LibraryIndex) {
+          SerializeFlags |= SerializeDxilFlags::IncludeLibraryIndexPart;
+        }
+        if (opts.CBufferLayout) {
+          SerializeFlags |= SerializeDxilFlags::IncludeCBufferLayoutPart;
+        }
 
         // Don't do work to put in a container if an error has occurred
         // Do not create a container when there is only a a high-level representation in the module.
         if (compileOK && !opts.CodeGenHighLevel) {
           HRESULT valHR = S_OK;
+          uint64_t bytesCopied = 0;
 
           if (needsValidation) {
             valHR = dxcutil::ValidateAndAssembleToContainer(
                 action.takeModule(), pOutputBlob, m_pMalloc, SerializeFlags,
                 pOutputStream, opts.IsDebugInfoEnabled(), opts.GetPDBName(), compiler.getDiagnostics(),
-                (SerializeFlags & SerializeDxilFlags::IncludeDebugNamePart) ? &ShaderHashContent : nullptr);
+                (SerializeFlags & SerializeDxilFlags::IncludeDebugNamePart) ? &ShaderHashContent : nullptr,
+                &bytesCopied, pTimeReport.get());
           } else {
             dxcutil::AssembleToContainer(action.takeModule(),
                                          pOutputBlob, m_pMalloc,
                                          SerializeFlags, pOutputStream,
-                (SerializeFlags & SerializeDxilFlags::IncludeDebugNamePart) ? &ShaderHashContent : nullptr);
+                (SerializeFlags & SerializeDxilFlags::IncludeDebugNamePart) ? &ShaderHashContent : nullptr,
+                &bytesCopied, pTimeReport.get());
+          }
+          if (opts.ReportCopies) {
+            w << "note: " << bytesCopied
+              << " bytes of bitcode copied to assemble a container of "
+              << (pOutputBlob ? pOutputBlob->GetBufferSize() : 0) << " bytes.\n";
           }
 
           // Callback after valid DXIL is produced
@@ -784,6 +977,12 @@ public:
 
       CreateOperationResultFromOutputs(pOutputBlob, msfPtr, warnings,
                                        compiler.getDiagnostics(), ppResult);
+      if (pTimeReport) {
+        CComPtr<IDxcOperationResult> pResult;
+        pResult.Attach(*ppResult);
+        *ppResult = nullptr;
+        dxcutil::CreateTimeReportResult(pResult, *pTimeReport, ppResult);
+      }
 
       // On success, return values. After assigning ppResult, nothing should fail.
       HRESULT status;
@@ -796,6 +995,22 @@ public:
           DXVERIFY_NOMSG(SUCCEEDED(CreateContainerForPDB(m_pMalloc, pOutputBlob, pDebugBitcodeBlob, &pStrippedContainer)));
           DXVERIFY_NOMSG(SUCCEEDED((hlsl::pdb::WriteDxilPDB(m_pMalloc, pStrippedContainer, ShaderHashContent.Digest, ppDebugBlob))));
         }
+        if (pCompileCache && pOutputBlob) {
+          dxcutil::DxcCompileCacheEntry cacheEntry;
+          cacheEntry.pResultBlob = pOutputBlob;
+          if (ppDebugBlob)
+            cacheEntry.pDebugBlob = *ppDebugBlob;
+          if (DebugBlobName)
+            Unicode::UTF16ToUTF8String(DebugBlobName, &cacheEntry.DebugBlobName);
+          CComPtr<IDxcBlobEncoding> pWarnings;
+          if (SUCCEEDED((*ppResult)->GetErrorBuffer(&pWarnings)) && pWarnings) {
+            cacheEntry.Warnings.assign(
+                (const char *)pWarnings->GetBufferPointer(),
+                pWarnings->GetBufferSize());
+          }
+          // A result that cannot be cached is still a valid result.
+          pCompileCache->Store(compileCacheKey, cacheEntry);
+        }
         if (ppDebugBlobName) {
           *ppDebugBlobName = DebugBlobName.Detach();
         }
@@ -834,6 +1049,19 @@ public:
     _In_opt_ IDxcIncludeHandler *pIncludeHandler, // user-provided interface to handle #include directives (optional)
     _COM_Outptr_ IDxcOperationResult **ppResult   // Preprocessor output status, buffer, and errors
     ) override {
+    return PreprocessImpl(pSource, pSourceName, pArguments, argCount, pDefines,
+                          defineCount, pIncludeHandler, ppResult, nullptr);
+  }
+
+  // Preprocesses source text, adding the names of the macros that were
+  // expanded or tested to pReferencedMacros if it is not null.
+  HRESULT PreprocessImpl(
+    _In_ IDxcBlob *pSource, _In_opt_ LPCWSTR pSourceName,
+    _In_count_(argCount) LPCWSTR *pArguments, _In_ UINT32 argCount,
+    _In_count_(defineCount) const DxcDefine *pDefines,
+    _In_ UINT32 defineCount, _In_opt_ IDxcIncludeHandler *pIncludeHandler,
+    _COM_Outptr_ IDxcOperationResult **ppResult,
+    _Inout_opt_ llvm::StringSet<> *pReferencedMacros) {
     if (pSource == nullptr || ppResult == nullptr ||
         (defineCount > 0 && pDefines == nullptr) ||
         (argCount > 0 && pArguments == nullptr))
@@ -871,24 +1099,10 @@ public:
 
       // Prepare UTF8-encoded versions of API values.
       CW2A utf8SourceName(pSourceName, CP_UTF8);
-      const char *pUtf8SourceName = utf8SourceName.m_psz;
-      if (pUtf8SourceName == nullptr) {
-        if (opts.InputFile.empty()) {
-          pUtf8SourceName = "input.hlsl";
-        }
-        else {
-          pUtf8SourceName = opts.InputFile.data();
-        }
-      }
 
       IFT(msfPtr->RegisterOutputStream(L"output.hlsl", pOutputStream));
       IFT(msfPtr->CreateStdStreams(m_pMalloc));
 
-      StringRef Data((LPSTR)utf8Source->GetBufferPointer(),
-        utf8Source->GetBufferSize());
-      std::unique_ptr<llvm::MemoryBuffer> pBuffer(
-        llvm::MemoryBuffer::getMemBufferCopy(Data, pUtf8SourceName));
-
       // Not very efficient but also not very important.
       std::vector<std::string> defines;
       CreateDefineStrings(pDefines, defineCount, defines);
@@ -924,6 +1138,9 @@ public:
       FrontendInputFile file(utf8SourceName.m_psz, IK_HLSL);
       clang::PrintPreprocessedAction action;
       if (action.BeginSourceFile(compiler, file)) {
+        if (pReferencedMacros != nullptr)
+          compiler.getPreprocessor().addPPCallbacks(
+              llvm::make_unique<MacroReferenceRecorder>(*pReferencedMacros));
         action.Execute();
         action.EndSourceFile();
       }
@@ -1151,6 +1368,259 @@ public:
     }
   }
 
+  // IDxcCompileCache
+  HRESULT STDMETHODCALLTYPE GetStats(_Out_ DxcCompileCacheStats *pStats) override {
+    if (pStats == nullptr)
+      return E_INVALIDARG;
+    dxcutil::DxcCompileCache::GetStats(pStats);
+    return S_OK;
+  }
+  HRESULT STDMETHODCALLTYPE ResetStats() override {
+    dxcutil::DxcCompileCache::ResetStats();
+    return S_OK;
+  }
+
+  // Compiles jobs on a work-stealing pool and passes each result to report,
+  // one call at a time. A failure from report cancels the jobs that have not
+  // started and is thrown once the running ones finish.
+  void RunCompileJobs(
+      const DxcCompileJob *pJobs, UINT32 jobCount,
+      IDxcIncludeHandler *pIncludeHandler, UINT32 threadCount,
+      const std::function<HRESULT(UINT32, IDxcOperationResult *)> &report) {
+    std::mutex reportMutex;
+    HRESULT reportHR = S_OK;
+    // A batch that overlaps another on this compiler gets a pool of its own.
+    std::unique_lock<std::mutex> poolLock(m_batchPoolMutex, std::try_to_lock);
+    std::unique_ptr<hlsl::WorkStealingThreadPool> pOwnPool;
+    hlsl::WorkStealingThreadPool *pPool;
+    if (poolLock.owns_lock()) {
+      if (!m_pBatchPool || m_batchPoolThreadCount != threadCount) {
+        m_pBatchPool.reset(new hlsl::WorkStealingThreadPool(threadCount));
+        m_batchPoolThreadCount = threadCount;
+      }
+      pPool = m_pBatchPool.get();
+    } else {
+      pOwnPool.reset(new hlsl::WorkStealingThreadPool(threadCount));
+      pPool = pOwnPool.get();
+    }
+    pPool->run(jobCount, [&](unsigned jobIndex, unsigned) {
+      DxcThreadMalloc TM(m_pMalloc);
+      const DxcCompileJob &job = pJobs[jobIndex];
+      CComPtr<IDxcOperationResult> pResult;
+      HRESULT hr = CompileWithDebug(
+          job.pSource, job.pSourceName, job.pEntryPoint, job.pTargetProfile,
+          job.pArguments, job.argCount, job.pDefines, job.defineCount,
+          pIncludeHandler, &pResult, nullptr, nullptr);
+      if (FAILED(hr)) {
+        pResult.Release();
+        IFT(DxcOperationResult::CreateFromResultErrorStatus(nullptr, nullptr,
+                                                            hr, &pResult));
+      }
+      std::lock_guard<std::mutex> lock(reportMutex);
+      // Results of jobs that were running when the batch was cancelled are
+      // dropped.
+      if (SUCCEEDED(reportHR))
+        reportHR = report(jobIndex, pResult);
+      IFT(reportHR);
+    });
+  }
+
+  // Permutations that preprocess to the same tokens compile to the same
+  // output, unless the defines also reach the compiler some other way.
+  bool CanSharePermutationFrontend(_In_ LPCWSTR pTargetProfile,
+                                   _In_count_(argCount) LPCWSTR *pArguments,
+                                   _In_ UINT32 argCount) {
+    // Semantic defines are read from the preprocessor after parsing.
+    if (!m_langExtensionsHelper.GetSemanticDefines().empty())
+      return false;
+    int argCountInt;
+    if (FAILED(UIntToInt(argCount, &argCountInt)))
+      return false;
+    hlsl::options::MainArgs mainArgs(argCountInt, pArguments, 0);
+    hlsl::options::DxcOpts opts;
+    CW2A pUtf8TargetProfile(pTargetProfile, CP_UTF8);
+    opts.TargetProfile = pUtf8TargetProfile.m_psz;
+    std::string errors;
+    raw_string_ostream errorStream(errors);
+    // Invalid arguments are reported by the compile of each permutation.
+    if (0 != hlsl::options::ReadDxcOpts(::options::getHlslOptTable(),
+                                        hlsl::options::CompilerFlags,
+                                        mainArgs, opts, errorStream))
+      return false;
+    // Debug information records the defines, and the root signature may be
+    // taken from one.
+    return !opts.IsDebugInfoEnabled() && opts.RootSignatureDefine.empty();
+  }
+
+  // Groups the rows of a define matrix whose preprocessed token streams are
+  // identical. A row that agrees with an already preprocessed row on every
+  // macro that row's preprocessing expanded or tested yields the same tokens,
+  // so it is grouped without being preprocessed itself.
+  void GroupPermutations(
+      _In_ IDxcBlob *pSource, _In_opt_ LPCWSTR pSourceName,
+      _In_count_(argCount) LPCWSTR *pArguments, _In_ UINT32 argCount,
+      _In_ const DxcDefine *pDefines, _In_ UINT32 defineCount,
+      _In_ UINT32 permutationCount,
+      _In_opt_ IDxcIncludeHandler *pIncludeHandler,
+      std::vector<std::vector<UINT32>> &groups) {
+    struct PreprocessedRow {
+      UINT32 Row;
+      UINT32 Group;
+      std::vector<UINT32> ReferencedColumns;
+    };
+    std::vector<PreprocessedRow> preprocessedRows;
+    llvm::StringMap<UINT32> groupByTokens;
+    llvm::StringMap<llvm::SmallVector<UINT32, 1>> columnsByName;
+    for (UINT32 d = 0; d < defineCount; ++d) {
+      // The preprocessor reports a function-like define such as F(x) as F.
+      CW2A utf8Name(pDefines[d].Name, CP_UTF8);
+      StringRef macroName = StringRef(utf8Name.m_psz).split('(').first;
+      columnsByName[macroName].push_back(d);
+    }
+    auto valueAt = [&](UINT32 row, UINT32 column) -> LPCWSTR {
+      LPCWSTR pValue = pDefines[(size_t)row * defineCount + column].Value;
+      return pValue ? pValue : L"1"; // as in CreateDefineStrings
+    };
+
+    for (UINT32 row = 0; row < permutationCount; ++row) {
+      auto match = std::find_if(
+          preprocessedRows.begin(), preprocessedRows.end(),
+          [&](const PreprocessedRow &known) {
+            for (UINT32 column : known.ReferencedColumns) {
+              if (wcscmp(valueAt(row, column), valueAt(known.Row, column)) != 0)
+                return false;
+            }
+            return true;
+          });
+      if (match != preprocessedRows.end()) {
+        groups[match->Group].push_back(row);
+        continue;
+      }
+
+      llvm::StringSet<> referencedMacros;
+      CComPtr<IDxcOperationResult> pResult;
+      IFT(PreprocessImpl(pSource, pSourceName, pArguments, argCount,
+                         pDefines + (size_t)row * defineCount, defineCount,
+                         pIncludeHandler, &pResult, &referencedMacros));
+      HRESULT status;
+      IFT(pResult->GetStatus(&status));
+      if (FAILED(status)) {
+        // Compiling on its own reports the errors.
+        groups.push_back(std::vector<UINT32>(1, row));
+        continue;
+      }
+      CComPtr<IDxcBlob> pTokens;
+      IFT(pResult->GetResult(&pTokens));
+      llvm::MD5 hasher;
+      hasher.update(StringRef((const char *)pTokens->GetBufferPointer(),
+                              pTokens->GetBufferSize()));
+      llvm::MD5::MD5Result digest;
+      hasher.final(digest);
+      auto inserted = groupByTokens.insert(std::make_pair(
+          StringRef((const char *)digest, sizeof(digest)), (UINT32)groups.size()));
+      if (inserted.second)
+        groups.emplace_back();
+      UINT32 group = inserted.first->second;
+      groups[group].push_back(row);
+
+      PreprocessedRow known;
+      known.Row = row;
+      known.Group = group;
+      for (const auto &macro : referencedMacros) {
+        auto it = columnsByName.find(macro.getKey());
+        if (it != columnsByName.end())
+          known.ReferencedColumns.insert(known.ReferencedColumns.end(),
+                                         it->second.begin(), it->second.end());
+      }
+      preprocessedRows.push_back(std::move(known));
+    }
+  }
+
+  // IDxcBatchCompiler
+  HRESULT STDMETHODCALLTYPE CompileBatch(
+    _In_count_(jobCount) const DxcCompileJob *pJobs,
+    _In_ UINT32 jobCount,
+    _In_opt_ IDxcIncludeHandler *pIncludeHandler,
+    _In_ UINT32 threadCount,
+    _In_ IDxcBatchCompileHandler *pHandler) override {
+    if ((jobCount > 0 && pJobs == nullptr) || pHandler == nullptr)
+      return E_INVALIDARG;
+
+    DxcThreadMalloc TM(m_pMalloc);
+    try {
+      RunCompileJobs(pJobs, jobCount, pIncludeHandler, threadCount,
+                     [&](UINT32 jobIndex, IDxcOperationResult *pResult) {
+                       return pHandler->OnJobCompleted(jobIndex, pResult);
+                     });
+      return S_OK;
+    }
+    CATCH_CPP_RETURN_HRESULT();
+  }
+
+  // IDxcPermutationCompiler
+  HRESULT STDMETHODCALLTYPE CompilePermutations(
+    _In_ IDxcBlob *pSource,
+    _In_opt_ LPCWSTR pSourceName,
+    _In_ LPCWSTR pEntryPoint,
+    _In_ LPCWSTR pTargetProfile,
+    _In_count_(argCount) LPCWSTR *pArguments,
+    _In_ UINT32 argCount,
+    _In_count_(defineCount * permutationCount) const DxcDefine *pDefines,
+    _In_ UINT32 defineCount,
+    _In_ UINT32 permutationCount,
+    _In_opt_ IDxcIncludeHandler *pIncludeHandler,
+    _In_ UINT32 threadCount,
+    _In_ IDxcBatchCompileHandler *pHandler,
+    _Out_opt_ UINT32 *pUniqueCount) override {
+    if (pSource == nullptr || pEntryPoint == nullptr ||
+        pTargetProfile == nullptr || pHandler == nullptr ||
+        (argCount > 0 && pArguments == nullptr) ||
+        (defineCount > 0 && permutationCount > 0 && pDefines == nullptr))
+      return E_INVALIDARG;
+    // Every row defines the same macros in the same order.
+    for (UINT32 row = 0; row < permutationCount; ++row) {
+      for (UINT32 d = 0; d < defineCount; ++d) {
+        LPCWSTR pName = pDefines[(size_t)row * defineCount + d].Name;
+        if (pName == nullptr || wcscmp(pName, pDefines[d].Name) != 0)
+          return E_INVALIDARG;
+      }
+    }
+
+    DxcThreadMalloc TM(m_pMalloc);
+    try {
+      std::vector<std::vector<UINT32>> groups;
+      if (CanSharePermutationFrontend(pTargetProfile, pArguments, argCount)) {
+        GroupPermutations(pSource, pSourceName, pArguments, argCount, pDefines,
+                          defineCount, permutationCount, pIncludeHandler,
+                          groups);
+      } else {
+        for (UINT32 row = 0; row < permutationCount; ++row)
+          groups.push_back(std::vector<UINT32>(1, row));
+      }
+
+      // Each group is compiled once, with the defines of its first row.
+      std::vector<DxcCompileJob> jobs;
+      jobs.reserve(groups.size());
+      for (const std::vector<UINT32> &group : groups) {
+        DxcCompileJob job = {
+            pSource,   pSourceName, pEntryPoint,
+            pTargetProfile, pArguments, argCount,
+            pDefines + (size_t)group.front() * defineCount, defineCount};
+        jobs.push_back(job);
+      }
+      RunCompileJobs(jobs.data(), (UINT32)jobs.size(), pIncludeHandler,
+                     threadCount,
+                     [&](UINT32 groupIndex, IDxcOperationResult *pResult) {
+                       for (UINT32 row : groups[groupIndex])
+                         IFR(pHandler->OnJobCompleted(row, pResult));
+                       return S_OK;
+                     });
+      AssignToOutOpt((UINT32)groups.size(), pUniqueCount);
+      return S_OK;
+    }
+    CATCH_CPP_RETURN_HRESULT();
+  }
+
   // IDxcVersionInfo
   HRESULT STDMETHODCALLTYPE GetVersion(_Out_ UINT32 *pMajor, _Out_ UINT32 *pMinor) override {
     if (pMajor == nullptr || pMinor == nullptr)
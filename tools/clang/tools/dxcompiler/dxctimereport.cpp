@@ -0,0 +1,263 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// dxctimereport.cpp                                                         //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Provides the per-phase and per-pass report of a compile (-ftime-report).  //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/Support/WinIncludes.h"
+#include "dxc/Support/Global.h"
+#include "dxc/Support/FileIOHelper.h"
+#include "dxc/Support/dxcapi.impl.h"
+#include "dxctimereport.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Pass.h"
+#include "llvm/PassInfo.h"
+#include "llvm/PassRegistry.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+
+using namespace llvm;
+using namespace hlsl;
+
+namespace dxcutil {
+
+static uint64_t CountInstructions(Function &F) {
+  uint64_t count = 0;
+  for (BasicBlock &BB : F)
+    count += BB.size();
+  return count;
+}
+
+static uint64_t CountInstructions(Module &M, Function *F) {
+  if (F)
+    return CountInstructions(*F);
+  uint64_t count = 0;
+  for (Function &MF : M)
+    count += CountInstructions(MF);
+  return count;
+}
+
+static uint64_t MicrosecondsBetween(std::chrono::steady_clock::time_point Start,
+                                    std::chrono::steady_clock::time_point End) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(End - Start)
+      .count();
+}
+
+DxcTimeReport::DxcTimeReport(DxcCountingMalloc *pMalloc)
+    : m_pMalloc(pMalloc), m_baseBytes(0), m_inPhase(false),
+      m_phaseOuterPeak(0), m_phasePassMicroseconds(0) {
+  if (m_pMalloc)
+    m_baseBytes = m_pMalloc->GetCurrentBytes();
+}
+
+int64_t DxcTimeReport::ResetPeak() {
+  return m_pMalloc ? m_pMalloc->ResetPeak() : 0;
+}
+
+// Returns the peak of the region that began with ResetPeak, and folds it
+// into the peak of the enclosing region.
+int64_t DxcTimeReport::EndPeak(int64_t OuterPeak) {
+  if (!m_pMalloc)
+    return 0;
+  int64_t peak = m_pMalloc->ResetPeak();
+  m_pMalloc->RaisePeak(std::max(OuterPeak, peak));
+  return std::max<int64_t>(0, peak - m_baseBytes);
+}
+
+void DxcTimeReport::BeginPhase(StringRef Name) {
+  DXASSERT(!m_inPhase, "else phases are nested");
+  PhaseRecord phase;
+  phase.Name = Name;
+  phase.Microseconds = 0;
+  phase.PassMicroseconds = 0;
+  phase.PeakBytes = 0;
+  m_phases.push_back(phase);
+  m_inPhase = true;
+  m_phasePassMicroseconds = 0;
+  m_phaseOuterPeak = ResetPeak();
+  m_phaseStart = Clock::now();
+}
+
+void DxcTimeReport::EndPhase() {
+  DXASSERT(m_inPhase, "else EndPhase without BeginPhase");
+  PhaseRecord &phase = m_phases.back();
+  phase.Microseconds = MicrosecondsBetween(m_phaseStart, Clock::now());
+  phase.PassMicroseconds = m_phasePassMicroseconds;
+  phase.PeakBytes = EndPeak(m_phaseOuterPeak);
+  m_inPhase = false;
+}
+
+void DxcTimeReport::beforePass(Pass *P, Module &M, Function *F) {
+  unsigned &index = m_passIndex[P];
+  // A pass that was freed may leave its address to a different pass.
+  if (index == 0 || m_passes[index - 1].PassID != P->getPassID()) {
+    PassRecord record;
+    record.PassID = P->getPassID();
+    record.Name = P->getPassName();
+    if (const PassInfo *PI =
+            PassRegistry::getPassRegistry()->getPassInfo(P->getPassID()))
+      record.Argument = PI->getPassArgument();
+    record.IsFunctionPass = F != nullptr;
+    record.Runs = 0;
+    record.Microseconds = 0;
+    record.InstructionsBefore = 0;
+    record.InstructionsAfter = 0;
+    record.PeakBytes = 0;
+    m_passes.push_back(record);
+    index = m_passes.size();
+  }
+
+  PassRecord &record = m_passes[index - 1];
+  ++record.Runs;
+  record.InstructionsBefore += CountInstructions(M, F);
+
+  ActivePass active;
+  active.Index = index - 1;
+  active.OuterPeak = ResetPeak();
+  active.Start = Clock::now();
+  m_activePasses.push_back(active);
+}
+
+void DxcTimeReport::afterPass(Pass *P, Module &M, Function *F) {
+  DXASSERT(!m_activePasses.empty(), "else afterPass without beforePass");
+  ActivePass active = m_activePasses.back();
+  m_activePasses.pop_back();
+  uint64_t microseconds = MicrosecondsBetween(active.Start, Clock::now());
+
+  PassRecord &record = m_passes[active.Index];
+  record.Microseconds += microseconds;
+  record.InstructionsAfter += CountInstructions(M, F);
+  record.PeakBytes = std::max(record.PeakBytes, EndPeak(active.OuterPeak));
+
+  // Passes run by other passes are already in the time of the outer pass.
+  if (m_activePasses.empty())
+    m_phasePassMicroseconds += microseconds;
+}
+
+static void WriteJSONString(raw_ostream &OS, StringRef Str) {
+  OS << '"';
+  for (char c : Str) {
+    if (c == '"' || c == '\\')
+      OS << '\\' << c;
+    else if ((unsigned char)c < 0x20)
+      OS << format("\\u%04x", (unsigned)c);
+    else
+      OS << c;
+  }
+  OS << '"';
+}
+
+void DxcTimeReport::AddCounter(StringRef Name, uint64_t Value) {
+  for (auto &counter : m_counters) {
+    if (counter.first == Name) {
+      counter.second += Value;
+      return;
+    }
+  }
+  m_counters.emplace_back(Name.str(), Value);
+}
+
+void DxcTimeReport::WriteJSON(raw_ostream &OS) const {
+  OS << "{\n  \"phases\": [";
+  for (size_t i = 0; i < m_phases.size(); ++i) {
+    const PhaseRecord &phase = m_phases[i];
+    OS << (i ? ",\n" : "\n") << "    {\"name\": ";
+    WriteJSONString(OS, phase.Name);
+    OS << ", \"wallMicroseconds\": " << phase.Microseconds
+       << ", \"passMicroseconds\": " << phase.PassMicroseconds
+       << ", \"peakAllocatedBytes\": " << phase.PeakBytes << "}";
+  }
+  OS << "\n  ],\n  \"passes\": [";
+  for (size_t i = 0; i < m_passes.size(); ++i) {
+    const PassRecord &pass = m_passes[i];
+    OS << (i ? ",\n" : "\n") << "    {\"name\": ";
+    WriteJSONString(OS, pass.Name);
+    OS << ", \"argument\": ";
+    WriteJSONString(OS, pass.Argument);
+    OS << ", \"kind\": " << (pass.IsFunctionPass ? "\"function\"" : "\"module\"")
+       << ", \"runs\": " << pass.Runs
+       << ", \"wallMicroseconds\": " << pass.Microseconds
+       << ", \"instructionsBefore\": " << pass.InstructionsBefore
+       << ", \"instructionsAfter\": " << pass.InstructionsAfter
+       << ", \"peakAllocatedBytes\": " << pass.PeakBytes << "}";
+  }
+  OS << "\n  ]";
+  // Counters are only written when some step of the compile reported one.
+  if (!m_counters.empty()) {
+    OS << ",\n  \"counters\": {";
+    for (size_t i = 0; i < m_counters.size(); ++i) {
+      OS << (i ? ",\n    " : "\n    ");
+      WriteJSONString(OS, m_counters[i].first);
+      OS << ": " << m_counters[i].second;
+    }
+    OS << "\n  }";
+  }
+  OS << "\n}\n";
+}
+
+namespace {
+class DxcTimeReportResult : public IDxcOperationResult,
+                            public IDxcTimeReportResult {
+private:
+  DXC_MICROCOM_TM_REF_FIELDS()
+  CComPtr<IDxcOperationResult> m_pResult;
+  CComPtr<IDxcBlobEncoding> m_pReport;
+
+public:
+  DXC_MICROCOM_TM_ADDREF_RELEASE_IMPL()
+  DXC_MICROCOM_TM_CTOR(DxcTimeReportResult)
+
+  void Init(IDxcOperationResult *pResult, IDxcBlobEncoding *pReport) {
+    m_pResult = pResult;
+    m_pReport = pReport;
+  }
+
+  HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void **ppvObject) override {
+    return DoBasicQueryInterface<IDxcOperationResult, IDxcTimeReportResult>(
+        this, iid, ppvObject);
+  }
+
+  HRESULT STDMETHODCALLTYPE GetStatus(_Out_ HRESULT *pStatus) override {
+    return m_pResult->GetStatus(pStatus);
+  }
+  HRESULT STDMETHODCALLTYPE
+  GetResult(_COM_Outptr_result_maybenull_ IDxcBlob **ppResult) override {
+    return m_pResult->GetResult(ppResult);
+  }
+  HRESULT STDMETHODCALLTYPE
+  GetErrorBuffer(_COM_Outptr_result_maybenull_ IDxcBlobEncoding **ppErrors) override {
+    return m_pResult->GetErrorBuffer(ppErrors);
+  }
+  HRESULT STDMETHODCALLTYPE
+  GetTimeReport(_COM_Outptr_ IDxcBlobEncoding **ppReport) override {
+    return m_pReport.CopyTo(ppReport);
+  }
+};
+} // namespace
+
+void CreateTimeReportResult(IDxcOperationResult *pResult,
+                            const DxcTimeReport &Report,
+                            IDxcOperationResult **ppResult) {
+  std::string json;
+  raw_string_ostream OS(json);
+  Report.WriteJSON(OS);
+  OS.flush();
+
+  CComPtr<IDxcBlobEncoding> pReport;
+  IFT(DxcCreateBlobWithEncodingOnHeapCopy(json.data(), json.size(), CP_UTF8,
+                                          &pReport));
+  CComPtr<DxcTimeReportResult> pReportResult =
+      DxcTimeReportResult::Alloc(DxcGetThreadMallocNoRef());
+  IFTOOM(pReportResult.p);
+  pReportResult->Init(pResult, pReport);
+  *ppResult = pReportResult.Detach();
+}
+
+} // namespace dxcutil
@@ -0,0 +1,121 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// dxctimereport.h                                                           //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Provides the per-phase and per-pass report of a compile (-ftime-report).  //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "dxc/dxcapi.h"
+#include "dxc/Support/Global.h"
+#include "dxc/Support/microcom.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "dxcmalloc.h"
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace llvm {
+class raw_ostream;
+}
+
+namespace dxcutil {
+
+/// Collects the wall time and peak allocator bytes of the phases of a
+/// compile, and the wall time and instruction counts of every pass run on
+/// this thread while the report is installed as the pass observer. Runs of
+/// a function pass over different functions add up in a single entry.
+class DxcTimeReport : public llvm::legacy::PassObserver {
+public:
+  /// pMalloc may be null, in which case no bytes are reported.
+  explicit DxcTimeReport(DxcCountingMalloc *pMalloc);
+
+  void BeginPhase(llvm::StringRef Name);
+  void EndPhase();
+
+  void beforePass(llvm::Pass *P, llvm::Module &M, llvm::Function *F) override;
+  void afterPass(llvm::Pass *P, llvm::Module &M, llvm::Function *F) override;
+
+  /// Adds Value to the named counter of the report.
+  void AddCounter(llvm::StringRef Name, uint64_t Value);
+
+  void addCounter(llvm::StringRef Name, uint64_t Value) override {
+    AddCounter(Name, Value);
+  }
+
+  void WriteJSON(llvm::raw_ostream &OS) const;
+
+private:
+  typedef std::chrono::steady_clock Clock;
+
+  struct PhaseRecord {
+    std::string Name;
+    uint64_t Microseconds;
+    uint64_t PassMicroseconds; // Time in passes run by the phase.
+    int64_t PeakBytes;
+  };
+  struct PassRecord {
+    const void *PassID;
+    std::string Name;
+    std::string Argument;
+    bool IsFunctionPass;
+    unsigned Runs;
+    uint64_t Microseconds;
+    uint64_t InstructionsBefore;
+    uint64_t InstructionsAfter;
+    int64_t PeakBytes;
+  };
+  struct ActivePass {
+    unsigned Index;
+    Clock::time_point Start;
+    int64_t OuterPeak;
+  };
+
+  int64_t ResetPeak();
+  int64_t EndPeak(int64_t OuterPeak);
+
+  CComPtr<DxcCountingMalloc> m_pMalloc;
+  int64_t m_baseBytes;
+  std::vector<PhaseRecord> m_phases;
+  std::vector<PassRecord> m_passes;
+  std::vector<std::pair<std::string, uint64_t>> m_counters;
+  llvm::DenseMap<llvm::Pass *, unsigned> m_passIndex;
+  std::vector<ActivePass> m_activePasses;
+  bool m_inPhase;
+  Clock::time_point m_phaseStart;
+  int64_t m_phaseOuterPeak;
+  uint64_t m_phasePassMicroseconds;
+};
+
+/// Records a phase of a compile for the lifetime of this object, if there
+/// is a report.
+class DxcTimeReportPhase {
+public:
+  DxcTimeReportPhase(DxcTimeReport *pReport, llvm::StringRef Name)
+      : m_pReport(pReport) {
+    if (m_pReport)
+      m_pReport->BeginPhase(Name);
+  }
+  ~DxcTimeReportPhase() {
+    if (m_pReport)
+      m_pReport->EndPhase();
+  }
+
+private:
+  DxcTimeReport *m_pReport;
+};
+
+/// Wraps pResult in a result that also implements IDxcTimeReportResult and
+/// returns the report as JSON.
+void CreateTimeReportResult(IDxcOperationResult *pResult,
+                            const DxcTimeReport &Report,
+                            _COM_Outptr_ IDxcOperationResult **ppResult);
+
+} // namespace dxcutil
@@ -15,6 +15,7 @@
 #include "dxc/Support/FileIOHelper.h"
 #include "dxc/dxcapi.h"
 #include "dxcutil.h"
+#include "dxctimereport.h"
 #include "dxillib.h"
 #include "clang/Basic/Diagnostic.h"
 #include "llvm/Bitcode/ReaderWriter.h"
@@ -75,12 +76,13 @@ public:
                                  AbstractMemoryStream *pModuleBitcode,
                                  CComPtr<IDxcBlob> &pDxilContainerBlob,
                                  SerializeDxilFlags Flags,
-                                 DxilShaderHash *pShaderHashOut) {
+                                 DxilShaderHash *pShaderHashOut,
+                                 uint64_t *pBytesCopied) {
     CComPtr<AbstractMemoryStream> pContainerStream;
     IFT(CreateMemoryStream(pMalloc, &pContainerStream));
     SerializeDxilContainerForModule(&m_llvmModule->GetOrCreateDxilModule(),
                                     pModuleBitcode, pContainerStream, m_debugName, Flags,
-                                    pShaderHashOut);
+                                    pShaderHashOut, pBytesCopied);
 
     pDxilContainerBlob.Release();
     IFT(pContainerStream.QueryInterface(&pDxilContainerBlob));
@@ -123,12 +125,16 @@ void AssembleToContainer(std::unique_ptr<llvm::Module> pM,
                          IMalloc *pMalloc,
                          SerializeDxilFlags SerializeFlags,
                          CComPtr<AbstractMemoryStream> &pOutputStream,
-                         DxilShaderHash *pShaderHashOut) {
+                         DxilShaderHash *pShaderHashOut,
+                         uint64_t *pBytesCopied,
+                         DxcTimeReport *pTimeReport) {
   // Take ownership of the module from the action.
   DxilCompilerLLVMModuleOutput llvmModule(std::move(pM));
 
+  DxcTimeReportPhase phase(pTimeReport, "container");
   llvmModule.WrapModuleInDxilContainer(pMalloc, pOutputStream, pOutputBlob,
-                                       SerializeFlags, pShaderHashOut);
+                                       SerializeFlags, pShaderHashOut,
+                                       pBytesCopied);
 }
 
 void ReadOptsAndValidate(hlsl::options::MainArgs &mainArgs,
@@ -160,7 +166,9 @@ HRESULT ValidateAndAssembleToContainer(
     std::unique_ptr<llvm::Module> pM, CComPtr<IDxcBlob> &pOutputBlob,
     IMalloc *pMalloc, SerializeDxilFlags SerializeFlags,
     CComPtr<AbstractMemoryStream> &pOutputStream, bool bDebugInfo, llvm::StringRef DebugName,
-    clang::DiagnosticsEngine &Diag, DxilShaderHash *pShaderHashOut) {
+    clang::DiagnosticsEngine &Diag, DxilShaderHash *pShaderHashOut,
+    uint64_t *pBytesCopied,
+    DxcTimeReport *pTimeReport) {
   HRESULT valHR = S_OK;
 
   // Take ownership of the module from the action.
@@ -190,19 +198,26 @@ HRESULT ValidateAndAssembleToContainer(
     llvmModule.SetDebugName(DebugName);
   }
 
-  llvmModule.WrapModuleInDxilContainer(pMalloc, pOutputStream, pOutputBlob,
-                                       SerializeFlags, pShaderHashOut);
+  {
+    DxcTimeReportPhase phase(pTimeReport, "container");
+    llvmModule.WrapModuleInDxilContainer(pMalloc, pOutputStream, pOutputBlob,
+                                         SerializeFlags, pShaderHashOut,
+                                         pBytesCopied);
+  }
 
   CComPtr<IDxcOperationResult> pValResult;
   // Important: in-place edit is required so the blob is reused and thus
   // dxil.dll can be released.
-  if (bInternalValidator) {
-    IFT(RunInternalValidator(pValidator, llvmModule.get(),
-                             llvmModule.getWithDebugInfo(), pOutputBlob,
-                             DxcValidatorFlags_InPlaceEdit, &pValResult));
-  } else {
-    IFT(pValidator->Validate(pOutputBlob, DxcValidatorFlags_InPlaceEdit,
-                             &pValResult));
+  {
+    DxcTimeReportPhase phase(pTimeReport, "validation");
+    if (bInternalValidator) {
+      IFT(RunInternalValidator(pValidator, llvmModule.get(),
+                               llvmModule.getWithDebugInfo(), pOutputBlob,
+                               DxcValidatorFlags_InPlaceEdit, &pValResult));
+    } else {
+      IFT(pValidator->Validate(pOutputBlob, DxcValidatorFlags_InPlaceEdit,
+                               &pValResult));
+    }
   }
   IFT(pValResult->GetStatus(&valHR));
   if (FAILED(valHR)) {
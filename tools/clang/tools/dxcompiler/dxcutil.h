@@ -39,18 +39,23 @@ class DxcOpts;
 } // namespace hlsl
 
 namespace dxcutil {
+class DxcTimeReport;
+
 HRESULT ValidateAndAssembleToContainer(
     std::unique_ptr<llvm::Module> pM, CComPtr<IDxcBlob> &pOutputContainerBlob,
     IMalloc *pMalloc, hlsl::SerializeDxilFlags SerializeFlags,
     CComPtr<hlsl::AbstractMemoryStream> &pModuleBitcode, bool bDebugInfo, llvm::StringRef DebugName,
-    clang::DiagnosticsEngine &Diag, hlsl::DxilShaderHash *pShaderHashOut = nullptr);
+    clang::DiagnosticsEngine &Diag, hlsl::DxilShaderHash *pShaderHashOut = nullptr,
+    uint64_t *pBytesCopied = nullptr, DxcTimeReport *pTimeReport = nullptr);
 void GetValidatorVersion(unsigned *pMajor, unsigned *pMinor);
 void AssembleToContainer(std::unique_ptr<llvm::Module> pM,
                          CComPtr<IDxcBlob> &pOutputContainerBlob,
                          IMalloc *pMalloc,
                          hlsl::SerializeDxilFlags SerializeFlags,
                          CComPtr<hlsl::AbstractMemoryStream> &pModuleBitcode,
-                         hlsl::DxilShaderHash *pShaderHashOut = nullptr);
+                         hlsl::DxilShaderHash *pShaderHashOut = nullptr,
+                         uint64_t *pBytesCopied = nullptr,
+                         DxcTimeReport *pTimeReport = nullptr);
 HRESULT Disassemble(IDxcBlob *pProgram, llvm::raw_string_ostream &Stream);
 void ReadOptsAndValidate(hlsl::options::MainArgs &mainArgs,
                          hlsl::options::DxcOpts &opts,
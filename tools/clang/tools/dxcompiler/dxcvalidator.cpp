@@ -54,6 +54,8 @@ struct DiagRestore {
 };
 
 class DxcValidator : public IDxcValidator,
+                     public IDxcIncrementalValidator,
+                     public IDxcValidatorOptions,
 #ifdef SUPPORT_QUERY_GIT_COMMIT_INFO
                      public IDxcVersionInfo2
 #else
@@ -62,13 +64,15 @@ class DxcValidator : public IDxcValidator,
 {
 private:
   DXC_MICROCOM_TM_REF_FIELDS()
+  UINT32 m_ThreadCount = 1;
 
   HRESULT RunValidation(
     _In_ IDxcBlob *pShader,                       // Shader to validate.
     _In_ UINT32 Flags,                            // Validation flags.
     _In_ llvm::Module *pModule,                   // Module to validate, if available.
     _In_ llvm::Module *pDebugModule,              // Debug module to validate, if available
-    _In_ AbstractMemoryStream *pDiagStream);
+    _In_ AbstractMemoryStream *pDiagStream,
+    _Inout_opt_ DxilIncrementalValidation *pIncremental);
 
   HRESULT RunRootSignatureValidation(
     _In_ IDxcBlob *pShader,                       // Shader to validate.
@@ -79,7 +83,9 @@ public:
   DXC_MICROCOM_TM_CTOR(DxcValidator)
 
   HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void **ppvObject) override {
-    return DoBasicQueryInterface<IDxcValidator, IDxcVersionInfo>(this, iid, ppvObject);
+    return DoBasicQueryInterface<IDxcValidator, IDxcIncrementalValidator,
+                                 IDxcValidatorOptions, IDxcVersionInfo>(
+        this, iid, ppvObject);
   }
 
   // For internal use only.
@@ -88,7 +94,8 @@ public:
     _In_ UINT32 Flags,                            // Validation flags.
     _In_ llvm::Module *pModule,                   // Module to validate, if available.
     _In_ llvm::Module *pDebugModule,              // Debug module to validate, if available
-    _COM_Outptr_ IDxcOperationResult **ppResult   // Validation output status, buffer, and errors
+    _COM_Outptr_ IDxcOperationResult **ppResult,  // Validation output status, buffer, and errors
+    _Inout_opt_ DxilIncrementalValidation *pIncremental = nullptr
   );
 
   // IDxcValidator
@@ -98,6 +105,23 @@ public:
     _COM_Outptr_ IDxcOperationResult **ppResult   // Validation output status, buffer, and errors
     ) override;
 
+  // IDxcIncrementalValidator
+  HRESULT STDMETHODCALLTYPE ValidateIncremental(
+    _In_ IDxcBlob *pShader,
+    _In_ UINT32 Flags,
+    _In_opt_ IDxcBlob *pPriorState,
+    _COM_Outptr_ IDxcOperationResult **ppResult,
+    _COM_Outptr_opt_ IDxcBlob **ppState,
+    _Out_opt_ UINT32 *pFunctionCount,
+    _Out_opt_ UINT32 *pRevalidatedCount
+    ) override;
+
+  // IDxcValidatorOptions
+  HRESULT STDMETHODCALLTYPE SetThreadCount(UINT32 threadCount) override {
+    m_ThreadCount = threadCount;
+    return S_OK;
+  }
+
   // IDxcVersionInfo
   HRESULT STDMETHODCALLTYPE GetVersion(_Out_ UINT32 *pMajor, _Out_ UINT32 *pMinor) override;
   HRESULT STDMETHODCALLTYPE GetFlags(_Out_ UINT32 *pFlags) override;
@@ -119,15 +143,60 @@ HRESULT STDMETHODCALLTYPE DxcValidator::Validate(
     return E_INVALIDARG;
   if ((Flags & DxcValidatorFlags_ModuleOnly) && (Flags & (DxcValidatorFlags_InPlaceEdit | DxcValidatorFlags_RootSignatureOnly)))
     return E_INVALIDARG;
+  if ((Flags & DxcValidatorFlags_ContainerPartsOnly) && (Flags & (DxcValidatorFlags_ModuleOnly | DxcValidatorFlags_RootSignatureOnly)))
+    return E_INVALIDARG;
   return ValidateWithOptModules(pShader, Flags, nullptr, nullptr, ppResult);
 }
 
+HRESULT STDMETHODCALLTYPE DxcValidator::ValidateIncremental(
+  _In_ IDxcBlob *pShader,
+  _In_ UINT32 Flags,
+  _In_opt_ IDxcBlob *pPriorState,
+  _COM_Outptr_ IDxcOperationResult **ppResult,
+  _COM_Outptr_opt_ IDxcBlob **ppState,
+  _Out_opt_ UINT32 *pFunctionCount,
+  _Out_opt_ UINT32 *pRevalidatedCount
+) {
+  DxcThreadMalloc TM(m_pMalloc);
+  if (ppState != nullptr)
+    *ppState = nullptr;
+  if (pShader == nullptr || ppResult == nullptr || Flags & ~DxcValidatorFlags_ValidMask)
+    return E_INVALIDARG;
+  if (Flags & (DxcValidatorFlags_InPlaceEdit | DxcValidatorFlags_RootSignatureOnly | DxcValidatorFlags_ContainerPartsOnly))
+    return E_INVALIDARG;
+
+  try {
+    DxilValidationFingerprints Prior;
+    DxilIncrementalValidation Incremental;
+    // A state blob from another validator version is not an error; every
+    // function is simply validated again.
+    if (pPriorState != nullptr &&
+        Prior.Deserialize(pPriorState->GetBufferPointer(),
+                          pPriorState->GetBufferSize()))
+      Incremental.pPrior = &Prior;
+
+    IFR(ValidateWithOptModules(pShader, Flags, nullptr, nullptr, ppResult,
+                               &Incremental));
+
+    if (ppState != nullptr) {
+      std::vector<uint8_t> State;
+      Incremental.Current.Serialize(State);
+      IFT(DxcCreateBlobOnHeapCopy(State.data(), (uint32_t)State.size(), ppState));
+    }
+    AssignToOutOpt(Incremental.FunctionCount, pFunctionCount);
+    AssignToOutOpt(Incremental.RevalidatedCount, pRevalidatedCount);
+    return S_OK;
+  }
+  CATCH_CPP_RETURN_HRESULT();
+}
+
 HRESULT DxcValidator::ValidateWithOptModules(
   _In_ IDxcBlob *pShader,                       // Shader to validate.
   _In_ UINT32 Flags,                            // Validation flags.
   _In_ llvm::Module *pModule,                   // Module to validate, if available.
   _In_ llvm::Module *pDebugModule,              // Debug module to validate, if available
-  _COM_Outptr_ IDxcOperationResult **ppResult   // Validation output status, buffer, and errors
+  _COM_Outptr_ IDxcOperationResult **ppResult,  // Validation output status, buffer, and errors
+  _Inout_opt_ DxilIncrementalValidation *pIncremental
 ) {
   *ppResult = nullptr;
   HRESULT hr = S_OK;
@@ -143,7 +212,8 @@ HRESULT DxcValidator::ValidateWithOptModules(
     if (Flags & DxcValidatorFlags_RootSignatureOnly) {
       validationStatus = RunRootSignatureValidation(pShader, pDiagStream);
     } else {
-      validationStatus = RunValidation(pShader, Flags, pModule, pDebugModule, pDiagStream);
+      validationStatus = RunValidation(pShader, Flags, pModule, pDebugModule,
+                                       pDiagStream, pIncremental);
     }
     if (FAILED(validationStatus)) {
       std::string msg("Validation failed.\n");
@@ -205,7 +275,8 @@ HRESULT DxcValidator::RunValidation(
   _In_ UINT32 Flags,                            // Validation flags.
   _In_ llvm::Module *pModule,                   // Module to validate, if available.
   _In_ llvm::Module *pDebugModule,              // Debug module to validate, if available
-  _In_ AbstractMemoryStream *pDiagStream) {
+  _In_ AbstractMemoryStream *pDiagStream,
+  _Inout_opt_ DxilIncrementalValidation *pIncremental) {
 
   // Run validation may throw, but that indicates an inability to validate,
   // not that the validation failed (eg out of memory). That is indicated
@@ -222,9 +293,11 @@ HRESULT DxcValidator::RunValidation(
   if (!pModule) {
     DXASSERT_NOMSG(pDebugModule == nullptr);
     if (Flags & DxcValidatorFlags_ModuleOnly) {
-      return ValidateDxilBitcode((const char*)pShader->GetBufferPointer(), (uint32_t)pShader->GetBufferSize(), DiagStream);
+      return ValidateDxilBitcode((const char*)pShader->GetBufferPointer(), (uint32_t)pShader->GetBufferSize(), DiagStream, pIncremental, m_ThreadCount);
+    } else if (Flags & DxcValidatorFlags_ContainerPartsOnly) {
+      return ValidateDxilContainerPartsOnly(pShader->GetBufferPointer(), pShader->GetBufferSize(), DiagStream);
     } else {
-      return ValidateDxilContainer(pShader->GetBufferPointer(), pShader->GetBufferSize(), DiagStream);
+      return ValidateDxilContainer(pShader->GetBufferPointer(), pShader->GetBufferSize(), DiagStream, pIncremental, m_ThreadCount);
     }
   }
 
@@ -232,7 +305,8 @@ HRESULT DxcValidator::RunValidation(
   PrintDiagnosticContext DiagContext(DiagPrinter);
   DiagRestore DR(pModule->getContext(), &DiagContext);
 
-  IFR(hlsl::ValidateDxilModule(pModule, pDebugModule));
+  if (!(Flags & DxcValidatorFlags_ContainerPartsOnly))
+    IFR(hlsl::ValidateDxilModule(pModule, pDebugModule, pIncremental, m_ThreadCount));
   if (!(Flags & DxcValidatorFlags_ModuleOnly)) {
     IFR(ValidateDxilContainerParts(pModule, pDebugModule,
                       IsDxilContainerLike(pShader->GetBufferPointer(), pShader->GetBufferSize()),
@@ -28,6 +28,12 @@ using namespace hlsl::options;
 static cl::opt<std::string>
 InputFilename(cl::Positional, cl::desc("<input dxil file>"), cl::init("-"));
 
+static cl::opt<unsigned>
+ValidationThreads("threads",
+                  cl::desc("Number of threads validating functions; 0 uses "
+                           "all hardware threads"),
+                  cl::init(1));
+
 class DxvContext {
 private:
   DxcDllSupport &m_dxcSupport;
@@ -68,6 +74,12 @@ void DxvContext::Validate() {
     CComPtr<IDxcOperationResult> pResult;
 
     IFT(m_dxcSupport.CreateInstance(CLSID_DxcValidator, &pValidator));
+    if (ValidationThreads != 1) {
+      // Validators that predate the option validate on a single thread.
+      CComPtr<IDxcValidatorOptions> pOptions;
+      if (SUCCEEDED(pValidator.QueryInterface(&pOptions)))
+        IFT(pOptions->SetThreadCount(ValidationThreads));
+    }
     IFT(pValidator->Validate(pContainerBlob, DxcValidatorFlags_InPlaceEdit, &pResult));
 
     HRESULT status;
@@ -15,7 +15,10 @@
 #include "HlslTestUtils.h"
 
 #include "dxc/HLSL/DxilSpanAllocator.h"
+#include "dxc/dxcapi.h"
+#include "dxc/Support/dxcapi.use.h"
 #include <cstdlib>
+#include <cstring>
 #include <random>
 #include <algorithm>
 #include <iterator>
@@ -547,6 +550,9 @@ public:
   TEST_METHOD(Intersections)
   TEST_METHOD(GapFilling)
   TEST_METHOD(Allocate)
+  TEST_METHOD(ArenaMallocWhenManyBlocksThenContentsKept)
+
+  dxc::DxcDllSupport m_dllSupport;
 
   void InitScenarios() {
     struct P {
@@ -588,6 +594,9 @@ public:
 
 bool AllocatorTest::AllocatorTestSetup() {
   InitScenarios();
+  if (!m_dllSupport.IsEnabled()) {
+    VERIFY_SUCCEEDED(m_dllSupport.Initialize());
+  }
   return true;
 }
 
@@ -766,3 +775,53 @@ TEST_F(AllocatorTest, Allocate) {
     TestSizesFn();
   }
 }
+
+// Returns whether all cb bytes at p are equal to value.
+static bool IsFilledWith(const unsigned char *p, SIZE_T cb, unsigned char value) {
+  return std::all_of(p, p + cb, [=](unsigned char c) { return c == value; });
+}
+
+TEST_F(AllocatorTest, ArenaMallocWhenManyBlocksThenContentsKept) {
+  CComPtr<IMalloc> pArena;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcArenaMalloc, &pArena));
+
+  // Enough blocks to fill several chunks, with some large enough to get a
+  // chunk of their own.
+  std::vector<std::pair<unsigned char *, SIZE_T>> Blocks;
+  for (unsigned i = 0; i < 400; ++i) {
+    SIZE_T cb = (i % 50 == 49) ? 20000 + i : 1 + (i * 37) % 3000;
+    unsigned char *p = (unsigned char *)pArena->Alloc(cb);
+    VERIFY_IS_NOT_NULL(p);
+    std::memset(p, (int)(i & 0xFF), cb);
+    Blocks.emplace_back(p, cb);
+  }
+
+  // Growing an older block moves it and keeps its contents.
+  unsigned char *pGrown = (unsigned char *)pArena->Realloc(Blocks[3].first, 5000);
+  VERIFY_IS_NOT_NULL(pGrown);
+  VERIFY_IS_TRUE(IsFilledWith(pGrown, Blocks[3].second, 3));
+  Blocks[3] = std::make_pair(pGrown, (SIZE_T)5000);
+  std::memset(pGrown, 3, 5000);
+
+  // The most recent block grows in place.
+  void *pLast = pArena->Alloc(16);
+  VERIFY_IS_NOT_NULL(pLast);
+  VERIFY_IS_TRUE(pLast == pArena->Realloc(pLast, 64));
+  pArena->Free(pLast);
+
+  // Freeing the large blocks returns their chunks without touching others.
+  for (unsigned i = 49; i < Blocks.size(); i += 50) {
+    pArena->Free(Blocks[i].first);
+    Blocks[i].first = nullptr;
+  }
+
+  for (unsigned i = 0; i < Blocks.size(); ++i) {
+    unsigned char *p = Blocks[i].first;
+    if (p == nullptr)
+      continue;
+    VERIFY_IS_TRUE(IsFilledWith(p, Blocks[i].second, (unsigned char)(i & 0xFF)));
+  }
+
+  for (auto &Block : Blocks)
+    pArena->Free(Block.first);
+}
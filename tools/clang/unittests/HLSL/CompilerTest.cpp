@@ -43,6 +43,7 @@
 #include <fstream>
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/MSFileSystem.h"
+#include "llvm/Support/MD5.h"
 #include "llvm/Support/Path.h"
 #include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/StringSwitch.h"
@@ -190,6 +191,60 @@ public:
   }
 };
 
+class TestStampedIncludeHandler : public IDxcIncludeHandler,
+                                  public IDxcIncludeHandlerStamp {
+  DXC_MICROCOM_REF_FIELD(m_dwRef)
+public:
+  DXC_MICROCOM_ADDREF_RELEASE_IMPL(m_dwRef)
+  dxc::DxcDllSupport &m_dllSupport;
+  std::string Source;
+  UINT64 Stamp;
+  UINT32 LoadCount;
+  TestStampedIncludeHandler(dxc::DxcDllSupport &dllSupport, const char *pSource, UINT64 stamp)
+    : m_dwRef(0), m_dllSupport(dllSupport), Source(pSource), Stamp(stamp), LoadCount(0) { }
+  HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void** ppvObject) override {
+    return DoBasicQueryInterface<IDxcIncludeHandler, IDxcIncludeHandlerStamp>(this, iid, ppvObject);
+  }
+
+  HRESULT STDMETHODCALLTYPE LoadSource(
+    _In_ LPCWSTR pFilename,
+    _COM_Outptr_ IDxcBlob **ppIncludeSource
+    ) override {
+    ++LoadCount;
+    MultiByteStringToBlob(m_dllSupport, Source, CP_UTF8, ppIncludeSource);
+    return S_OK;
+  }
+
+  HRESULT STDMETHODCALLTYPE GetSourceStamp(
+    _In_ LPCWSTR pFilename,
+    _Out_ UINT64 *pStamp
+    ) override {
+    *pStamp = Stamp;
+    return S_OK;
+  }
+};
+
+class TestBatchCompileHandler : public IDxcBatchCompileHandler {
+  DXC_MICROCOM_REF_FIELD(m_dwRef)
+public:
+  DXC_MICROCOM_ADDREF_RELEASE_IMPL(m_dwRef)
+  TestBatchCompileHandler(UINT32 jobCount) : m_dwRef(0), Results(jobCount) { }
+  HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void** ppvObject) override {
+    return DoBasicQueryInterface<IDxcBatchCompileHandler>(this, iid, ppvObject);
+  }
+
+  std::vector<CComPtr<IDxcOperationResult>> Results;
+  UINT32 CallCount = 0;
+
+  HRESULT STDMETHODCALLTYPE OnJobCompleted(UINT32 jobIndex, IDxcOperationResult *pResult) override {
+    ++CallCount;
+    if (jobIndex >= Results.size() || Results[jobIndex] != nullptr)
+      return E_INVALIDARG;
+    Results[jobIndex] = pResult;
+    return S_OK;
+  }
+};
+
 #ifdef _WIN32
 class CompilerTest {
 #else
@@ -219,6 +274,8 @@ public:
 
   TEST_METHOD(CompileWhenIncludeThenLoadInvoked)
   TEST_METHOD(CompileWhenIncludeThenLoadUsed)
+  TEST_METHOD(CompileWhenIncludeStampedThenLoadCached)
+  TEST_METHOD(PreprocessWhenIncludeStampedByTwoHandlersThenEachUsed)
   TEST_METHOD(CompileWhenIncludeAbsoluteThenLoadAbsolute)
   TEST_METHOD(CompileWhenIncludeLocalThenLoadRelative)
   TEST_METHOD(CompileWhenIncludeSystemThenLoadNotRelative)
@@ -231,6 +288,16 @@ public:
   TEST_METHOD(CompileWhenODumpThenPassConfig)
   TEST_METHOD(CompileWhenODumpThenOptimizerMatch)
   TEST_METHOD(CompileWhenVdThenProducesDxilContainer)
+  TEST_METHOD(CompileWhenCacheEnabledThenSecondCompileHits)
+  TEST_METHOD(CompileBatchWhenJobsThenEachResultReported)
+  TEST_METHOD(CompilePermutationsWhenTokensMatchThenResultShared)
+  TEST_METHOD(CompilePermutationsWhenFunctionLikeDefineDiffersThenNotShared)
+  TEST_METHOD(CompileWhenReflectionStrippedThenProgramWrittenInPlace)
+  TEST_METHOD(CompileWhenTimeReportThenPhasesAndPassesReported)
+#ifdef ENABLE_SPIRV_CODEGEN
+  TEST_METHOD(CompileWhenSpirvTimeReportThenPoolCountersReported)
+#endif
+  TEST_METHOD(CompileWhenArenaAndProfilingMallocThenStatsReported)
 
 #if _ITERATOR_DEBUG_LEVEL==0 
   // CompileWhenNoMemThenOOM can properly detect leaks only when debug iterators are disabled
@@ -1558,6 +1625,64 @@ TEST_F(CompilerTest, CompileWhenIncludeThenLoadInvoked) {
   VERIFY_ARE_EQUAL_WSTR(L"./helper.h;", pInclude->GetAllFileNames().c_str());
 }
 
+TEST_F(CompilerTest, CompileWhenIncludeStampedThenLoadCached) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcBlobEncoding> pSource;
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  CreateBlobFromText(
+    "#include \"stamped_cache_helper.h\"\r\n"
+    "float4 main() : SV_Target { return ZERO; }", &pSource);
+
+  // A handler reused with the same stamp is served from the cache.
+  CComPtr<TestStampedIncludeHandler> pInclude =
+      new TestStampedIncludeHandler(m_dllSupport, "#define ZERO 0", 1);
+  for (int i = 0; i < 2; ++i) {
+    CComPtr<IDxcOperationResult> pResult;
+    VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+      L"ps_6_0", nullptr, 0, nullptr, 0, pInclude, &pResult));
+    VerifyOperationSucceeded(pResult);
+    VERIFY_ARE_EQUAL(1U, pInclude->LoadCount);
+  }
+
+  // A new stamp loads the file again.
+  CComPtr<IDxcOperationResult> pResult;
+  pInclude->Source = "#define ZERO 1";
+  pInclude->Stamp = 2;
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+    L"ps_6_0", nullptr, 0, nullptr, 0, pInclude, &pResult));
+  VerifyOperationSucceeded(pResult);
+  VERIFY_ARE_EQUAL(2U, pInclude->LoadCount);
+}
+
+TEST_F(CompilerTest, PreprocessWhenIncludeStampedByTwoHandlersThenEachUsed) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcBlobEncoding> pSource;
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  CreateBlobFromText("#include \"stamped_shared_name.h\"\r\n", &pSource);
+
+  // Both handlers report the same stamp for the same name, but each must
+  // get its own contents, also when asked again after the other.
+  CComPtr<TestStampedIncludeHandler> pIncludes[2] = {
+    new TestStampedIncludeHandler(m_dllSupport, "int first_handler;", 7),
+    new TestStampedIncludeHandler(m_dllSupport, "int second_handler;", 7)
+  };
+  const char *Expected[2] = { "first_handler", "second_handler" };
+  for (int i = 0; i < 4; ++i) {
+    CComPtr<IDxcOperationResult> pResult;
+    CComPtr<IDxcBlob> pText;
+    VERIFY_SUCCEEDED(pCompiler->Preprocess(pSource, L"file.hlsl", nullptr, 0,
+                                           nullptr, 0, pIncludes[i % 2],
+                                           &pResult));
+    VerifyOperationSucceeded(pResult);
+    VERIFY_SUCCEEDED(pResult->GetResult(&pText));
+    std::string Text = BlobToUtf8(pText);
+    VERIFY_ARE_NOT_EQUAL(std::string::npos, Text.find(Expected[i % 2]));
+    VERIFY_ARE_EQUAL(std::string::npos, Text.find(Expected[(i + 1) % 2]));
+  }
+  VERIFY_ARE_EQUAL(1U, pIncludes[0]->LoadCount);
+  VERIFY_ARE_EQUAL(1U, pIncludes[1]->LoadCount);
+}
+
 TEST_F(CompilerTest, CompileWhenIncludeThenLoadUsed) {
   CComPtr<IDxcCompiler> pCompiler;
   CComPtr<IDxcOperationResult> pResult;
@@ -1824,6 +1949,376 @@ TEST_F(CompilerTest, CompileWhenVdThenProducesDxilContainer) {
   VERIFY_IS_TRUE(hlsl::IsValidDxilContainer(reinterpret_cast<hlsl::DxilContainerHeader *>(pResultBlob->GetBufferPointer()), pResultBlob->GetBufferSize()));
 }
 
+TEST_F(CompilerTest, CompileWhenCacheEnabledThenSecondCompileHits) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcCompileCache> pCache;
+  CComPtr<IDxcBlobEncoding> pSource;
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  VERIFY_SUCCEEDED(pCompiler.QueryInterface(&pCache));
+  CreateBlobFromText(EmptyCompute, &pSource);
+
+  // Statistics are shared by the process, so only changes from this point on
+  // are checked.
+  DxcCompileCacheStats before, after;
+  VERIFY_SUCCEEDED(pCache->GetStats(&before));
+
+  // Use a fresh directory so that results of earlier runs are not reused,
+  // and remove it with its entries when the test ends.
+  struct CacheDirectory {
+    llvm::SmallString<128> Path;
+    ~CacheDirectory() {
+      if (Path.empty())
+        return;
+      ::llvm::sys::fs::MSFileSystem *msfPtr;
+      if (FAILED(CreateMSFileSystemForDisk(&msfPtr)))
+        return;
+      std::unique_ptr<::llvm::sys::fs::MSFileSystem> msf(msfPtr);
+      ::llvm::sys::fs::AutoPerThreadSystem pts(msf.get());
+      if (pts.error_code())
+        return;
+      std::vector<std::string> Files;
+      std::error_code EC;
+      for (llvm::sys::fs::directory_iterator It(Path, EC), End;
+           It != End && !EC; It.increment(EC))
+        Files.push_back(It->path());
+      for (const std::string &File : Files)
+        llvm::sys::fs::remove(File);
+      llvm::sys::fs::remove(Path);
+    }
+  } cacheDir;
+  {
+    ::llvm::sys::fs::MSFileSystem *msfPtr;
+    VERIFY_SUCCEEDED(CreateMSFileSystemForDisk(&msfPtr));
+    std::unique_ptr<::llvm::sys::fs::MSFileSystem> msf(msfPtr);
+    ::llvm::sys::fs::AutoPerThreadSystem pts(msf.get());
+    IFTLLVM(pts.error_code());
+    VERIFY_IS_FALSE((bool)llvm::sys::fs::createUniqueDirectory(
+        "dxc-compile-cache", cacheDir.Path));
+  }
+  std::wstring cacheDirW = CA2W(cacheDir.Path.c_str(), CP_UTF8);
+
+  LPCWSTR Args[] = { L"-compile-cache", cacheDirW.c_str() };
+
+  CComPtr<IDxcBlob> pResultBlobs[2];
+  for (CComPtr<IDxcBlob> &pResultBlob : pResultBlobs) {
+    CComPtr<IDxcOperationResult> pResult;
+    VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+      L"cs_6_0", Args, _countof(Args), nullptr, 0, nullptr, &pResult));
+    VerifyOperationSucceeded(pResult);
+    VERIFY_SUCCEEDED(pResult->GetResult(&pResultBlob));
+  }
+
+  VERIFY_SUCCEEDED(pCache->GetStats(&after));
+  VERIFY_ARE_EQUAL((UINT64)1, after.Misses - before.Misses);
+  VERIFY_ARE_EQUAL((UINT64)1, after.Stores - before.Stores);
+  VERIFY_ARE_EQUAL((UINT64)1, after.Hits - before.Hits);
+  VERIFY_ARE_EQUAL(pResultBlobs[0]->GetBufferSize(), pResultBlobs[1]->GetBufferSize());
+  VERIFY_IS_TRUE(0 == memcmp(pResultBlobs[0]->GetBufferPointer(),
+                             pResultBlobs[1]->GetBufferPointer(),
+                             pResultBlobs[0]->GetBufferSize()));
+}
+
+TEST_F(CompilerTest, CompileBatchWhenJobsThenEachResultReported) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcBatchCompiler> pBatchCompiler;
+  CComPtr<IDxcBlobEncoding> pSource;
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  VERIFY_SUCCEEDED(pCompiler.QueryInterface(&pBatchCompiler));
+  CreateBlobFromText(
+    "RWStructuredBuffer<uint> o;\r\n"
+    "[numthreads(1, 1, 1)] void main() { o[0] = VALUE; }", &pSource);
+
+  // Every fourth job names a missing entry point and fails.
+  const UINT32 jobCount = 16;
+  std::vector<std::wstring> values(jobCount);
+  std::vector<DxcDefine> defines(jobCount);
+  std::vector<DxcCompileJob> jobs(jobCount);
+  for (UINT32 i = 0; i < jobCount; ++i) {
+    values[i] = std::to_wstring(i);
+    defines[i] = { L"VALUE", values[i].c_str() };
+    jobs[i] = { pSource, L"source.hlsl", (i % 4 == 3) ? L"missing" : L"main",
+                L"cs_6_0", nullptr, 0, &defines[i], 1 };
+  }
+
+  CComPtr<TestBatchCompileHandler> pHandler = new TestBatchCompileHandler(jobCount);
+  VERIFY_SUCCEEDED(pBatchCompiler->CompileBatch(jobs.data(), jobCount, nullptr,
+                                                4, pHandler));
+  VERIFY_ARE_EQUAL(jobCount, pHandler->CallCount);
+  for (UINT32 i = 0; i < jobCount; ++i) {
+    HRESULT status;
+    VERIFY_IS_NOT_NULL(pHandler->Results[i].p);
+    VERIFY_SUCCEEDED(pHandler->Results[i]->GetStatus(&status));
+    VERIFY_ARE_EQUAL(i % 4 == 3, FAILED(status));
+  }
+}
+
+TEST_F(CompilerTest, CompilePermutationsWhenTokensMatchThenResultShared) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcPermutationCompiler> pPermutationCompiler;
+  CComPtr<IDxcBlobEncoding> pSource;
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  VERIFY_SUCCEEDED(pCompiler.QueryInterface(&pPermutationCompiler));
+  CreateBlobFromText(
+    "RWStructuredBuffer<uint> o;\r\n"
+    "#if A == 1\r\n"
+    "[numthreads(1, 1, 1)] void main() { o[0] = 1; }\r\n"
+    "#else\r\n"
+    "[numthreads(1, 1, 1)] void main() { o[0] = 0; }\r\n"
+    "#endif", &pSource);
+
+  // A=0 and A=2 preprocess to the same tokens, and B is never referenced.
+  const DxcDefine defines[] = {
+    { L"A", L"0" }, { L"B", L"0" },
+    { L"A", L"1" }, { L"B", L"0" },
+    { L"A", L"2" }, { L"B", L"0" },
+    { L"A", L"0" }, { L"B", L"1" },
+    { L"A", L"1" }, { L"B", L"1" },
+    { L"A", L"2" }, { L"B", L"1" },
+  };
+  const UINT32 permutationCount = _countof(defines) / 2;
+  CComPtr<TestBatchCompileHandler> pHandler =
+      new TestBatchCompileHandler(permutationCount);
+  UINT32 uniqueCount = 0;
+  VERIFY_SUCCEEDED(pPermutationCompiler->CompilePermutations(
+      pSource, L"source.hlsl", L"main", L"cs_6_0", nullptr, 0, defines, 2,
+      permutationCount, nullptr, 2, pHandler, &uniqueCount));
+  VERIFY_ARE_EQUAL(2U, uniqueCount);
+  VERIFY_ARE_EQUAL(permutationCount, pHandler->CallCount);
+  for (UINT32 i = 0; i < permutationCount; ++i) {
+    HRESULT status;
+    VERIFY_IS_NOT_NULL(pHandler->Results[i].p);
+    VERIFY_SUCCEEDED(pHandler->Results[i]->GetStatus(&status));
+    VERIFY_SUCCEEDED(status);
+  }
+  VERIFY_ARE_EQUAL(pHandler->Results[0].p, pHandler->Results[2].p);
+  VERIFY_ARE_EQUAL(pHandler->Results[0].p, pHandler->Results[5].p);
+  VERIFY_ARE_EQUAL(pHandler->Results[1].p, pHandler->Results[4].p);
+  VERIFY_ARE_NOT_EQUAL(pHandler->Results[0].p, pHandler->Results[1].p);
+
+  // Rows that name different macros are rejected.
+  const DxcDefine mismatched[] = {
+    { L"A", L"0" }, { L"B", L"0" },
+    { L"B", L"0" }, { L"A", L"0" },
+  };
+  CComPtr<TestBatchCompileHandler> pRejected = new TestBatchCompileHandler(2);
+  VERIFY_ARE_EQUAL(E_INVALIDARG, pPermutationCompiler->CompilePermutations(
+      pSource, L"source.hlsl", L"main", L"cs_6_0", nullptr, 0, mismatched, 2,
+      2, nullptr, 2, pRejected, nullptr));
+}
+
+TEST_F(CompilerTest, CompilePermutationsWhenFunctionLikeDefineDiffersThenNotShared) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcPermutationCompiler> pPermutationCompiler;
+  CComPtr<IDxcBlobEncoding> pSource;
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  VERIFY_SUCCEEDED(pCompiler.QueryInterface(&pPermutationCompiler));
+  CreateBlobFromText(
+    "RWStructuredBuffer<uint> o;\r\n"
+    "[numthreads(1, 1, 1)] void main() { o[0] = F(1); }", &pSource);
+
+  // The preprocessor reports F(x) as F, so rows whose bodies of F differ
+  // must not be grouped, while rows with the same body still are.
+  const DxcDefine defines[] = {
+    { L"F(x)", L"x" },
+    { L"F(x)", L"x + 1" },
+    { L"F(x)", L"x" },
+  };
+  const UINT32 permutationCount = _countof(defines);
+  CComPtr<TestBatchCompileHandler> pHandler =
+      new TestBatchCompileHandler(permutationCount);
+  UINT32 uniqueCount = 0;
+  VERIFY_SUCCEEDED(pPermutationCompiler->CompilePermutations(
+      pSource, L"source.hlsl", L"main", L"cs_6_0", nullptr, 0, defines, 1,
+      permutationCount, nullptr, 2, pHandler, &uniqueCount));
+  VERIFY_ARE_EQUAL(2U, uniqueCount);
+  VERIFY_ARE_EQUAL(permutationCount, pHandler->CallCount);
+  for (UINT32 i = 0; i < permutationCount; ++i) {
+    HRESULT status;
+    VERIFY_IS_NOT_NULL(pHandler->Results[i].p);
+    VERIFY_SUCCEEDED(pHandler->Results[i]->GetStatus(&status));
+    VERIFY_SUCCEEDED(status);
+  }
+  VERIFY_ARE_NOT_EQUAL(pHandler->Results[0].p, pHandler->Results[1].p);
+  VERIFY_ARE_EQUAL(pHandler->Results[0].p, pHandler->Results[2].p);
+}
+
+TEST_F(CompilerTest, CompileWhenReflectionStrippedThenProgramWrittenInPlace) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcBlobEncoding> pSource;
+  CComPtr<IDxcOperationResult> pResult;
+  CComPtr<IDxcBlob> pProgram;
+  CComPtr<IDxcBlobEncoding> pErrors;
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  CreateBlobFromText("float4 main(float4 p : P) : SV_Target { return p; }", &pSource);
+
+  LPCWSTR Args[] = { L"-Qstrip_reflect", L"-Zsb", L"-report-copies" };
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+    L"ps_6_0", Args, _countof(Args), nullptr, 0, nullptr, &pResult));
+  VerifyOperationSucceeded(pResult);
+  VERIFY_SUCCEEDED(pResult->GetResult(&pProgram));
+  VERIFY_SUCCEEDED(pResult->GetErrorBuffer(&pErrors));
+
+  // The stripped module is serialized straight into the program part.
+  std::string Errors = BlobToUtf8(pErrors);
+  VERIFY_ARE_NOT_EQUAL(std::string::npos,
+                       Errors.find("note: 0 bytes of bitcode copied"));
+
+  const hlsl::DxilContainerHeader *pContainer = hlsl::IsDxilContainerLike(
+      pProgram->GetBufferPointer(), pProgram->GetBufferSize());
+  VERIFY_IS_TRUE(hlsl::IsValidDxilContainer(pContainer, pProgram->GetBufferSize()));
+  const hlsl::DxilPartHeader *pProgramPart =
+      hlsl::GetDxilPartByType(pContainer, hlsl::DFCC_DXIL);
+  VERIFY_IS_NOT_NULL(pProgramPart);
+  const hlsl::DxilProgramHeader *pProgramHeader =
+      (const hlsl::DxilProgramHeader *)hlsl::GetDxilPartData(pProgramPart);
+  VERIFY_IS_TRUE(hlsl::IsValidDxilProgramHeader(pProgramHeader, pProgramPart->PartSize));
+
+  // The hash and the debug name derived from it cover the program that was
+  // written in place.
+  const char *pBitcode;
+  uint32_t bitcodeLength;
+  hlsl::GetDxilProgramBitcode(pProgramHeader, &pBitcode, &bitcodeLength);
+  llvm::MD5 md5;
+  llvm::MD5::MD5Result digest;
+  md5.update(llvm::ArrayRef<uint8_t>((const uint8_t *)pBitcode, bitcodeLength));
+  md5.final(digest);
+  llvm::SmallString<32> expectedName;
+  llvm::MD5::stringifyResult(digest, expectedName);
+  expectedName += ".pdb";
+
+  const hlsl::DxilPartHeader *pHashPart =
+      hlsl::GetDxilPartByType(pContainer, hlsl::DFCC_ShaderHash);
+  VERIFY_IS_NOT_NULL(pHashPart);
+  const hlsl::DxilShaderHash *pHash =
+      (const hlsl::DxilShaderHash *)hlsl::GetDxilPartData(pHashPart);
+  VERIFY_IS_TRUE(0 == memcmp(pHash->Digest, digest, sizeof(digest)));
+
+  const hlsl::DxilPartHeader *pNamePart =
+      hlsl::GetDxilPartByType(pContainer, hlsl::DFCC_ShaderDebugName);
+  VERIFY_IS_NOT_NULL(pNamePart);
+  const char *pName;
+  VERIFY_IS_TRUE(hlsl::GetDxilShaderDebugName(pNamePart, &pName, nullptr));
+  VERIFY_ARE_EQUAL_STR(expectedName.c_str(), pName);
+}
+
+TEST_F(CompilerTest, CompileWhenTimeReportThenPhasesAndPassesReported) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcBlobEncoding> pSource;
+  CComPtr<IDxcOperationResult> pResult;
+  CComPtr<IDxcTimeReportResult> pTimeReportResult;
+  CComPtr<IDxcBlobEncoding> pReport;
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  CreateBlobFromText("float4 main(float4 p : P) : SV_Target { return sin(p); }", &pSource);
+
+  // Without the option, the result carries no report.
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+    L"ps_6_0", nullptr, 0, nullptr, 0, nullptr, &pResult));
+  VerifyOperationSucceeded(pResult);
+  VERIFY_FAILED(pResult.QueryInterface(&pTimeReportResult));
+  pResult.Release();
+
+  LPCWSTR Args[] = { L"-ftime-report" };
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+    L"ps_6_0", Args, _countof(Args), nullptr, 0, nullptr, &pResult));
+  VerifyOperationSucceeded(pResult);
+  VERIFY_SUCCEEDED(pResult.QueryInterface(&pTimeReportResult));
+  VERIFY_SUCCEEDED(pTimeReportResult->GetTimeReport(&pReport));
+
+  std::string Report = BlobToUtf8(pReport);
+  const char *Expected[] = {
+    "\"phases\": [", "{\"name\": \"frontend\"", "{\"name\": \"container\"",
+    "{\"name\": \"validation\"", "\"passes\": [",
+    "\"argument\": \"hlsl-hlemit\"", "\"argument\": \"dxilgen\"",
+    "\"kind\": \"function\"", "\"instructionsAfter\": ",
+    "\"dxilgen.intrinsic."
+  };
+  for (const char *pExpected : Expected) {
+    VERIFY_ARE_NOT_EQUAL(std::string::npos, Report.find(pExpected));
+  }
+}
+
+#ifdef ENABLE_SPIRV_CODEGEN
+TEST_F(CompilerTest, CompileWhenSpirvTimeReportThenPoolCountersReported) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcBlobEncoding> pSource;
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  CreateBlobFromText("float4 main(float4 p : P) : SV_Target { return p; }", &pSource);
+
+  // The second compile borrows the optimizer and validator pooled by the
+  // first one.
+  std::string Report;
+  LPCWSTR Args[] = { L"-spirv", L"-ftime-report" };
+  for (int i = 0; i < 2; ++i) {
+    CComPtr<IDxcOperationResult> pResult;
+    CComPtr<IDxcTimeReportResult> pTimeReportResult;
+    CComPtr<IDxcBlobEncoding> pReport;
+    VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+      L"ps_6_0", Args, _countof(Args), nullptr, 0, nullptr, &pResult));
+    VerifyOperationSucceeded(pResult);
+    VERIFY_SUCCEEDED(pResult.QueryInterface(&pTimeReportResult));
+    VERIFY_SUCCEEDED(pTimeReportResult->GetTimeReport(&pReport));
+    Report = BlobToUtf8(pReport);
+  }
+
+  const char *Counters[] = {
+    "\"spirvOptimizersReused\": ", "\"spirvValidatorsReused\": "
+  };
+  for (const char *pCounter : Counters) {
+    size_t pos = Report.find(pCounter);
+    VERIFY_ARE_NOT_EQUAL(std::string::npos, pos);
+    VERIFY_IS_TRUE(strtoull(Report.c_str() + pos + strlen(pCounter), nullptr, 10) > 0);
+  }
+}
+#endif // ENABLE_SPIRV_CODEGEN
+
+TEST_F(CompilerTest, CompileWhenArenaAndProfilingMallocThenStatsReported) {
+  // Stack a profiling allocator on an arena, and compile with both.
+  CComPtr<IMalloc> pArena;
+  CComPtr<IMalloc> pProfiler;
+  CComPtr<IDxcMallocStats> pStats;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcArenaMalloc, &pArena));
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance2(pArena, CLSID_DxcProfilingMalloc, &pProfiler));
+  VERIFY_SUCCEEDED(pProfiler.QueryInterface(&pStats));
+
+  void *pBlock = pArena->Alloc(24);
+  VERIFY_IS_NOT_NULL(pBlock);
+  VERIFY_ARE_EQUAL(1, pArena->DidAlloc(pBlock));
+  VERIFY_ARE_EQUAL(24U, (unsigned)pArena->GetSize(pBlock));
+  pBlock = pArena->Realloc(pBlock, 64 * 1024);
+  VERIFY_IS_NOT_NULL(pBlock);
+  VERIFY_ARE_EQUAL(64U * 1024, (unsigned)pArena->GetSize(pBlock));
+  pArena->Free(pBlock);
+
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcBlobEncoding> pSource;
+  CComPtr<IDxcOperationResult> pResult;
+  CComPtr<IDxcBlob> pProgram;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance2(pProfiler, CLSID_DxcCompiler, &pCompiler));
+  CreateBlobFromText(EmptyCompute, &pSource);
+  VERIFY_SUCCEEDED(pStats->ResetStats());
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+    L"cs_6_0", nullptr, 0, nullptr, 0, nullptr, &pResult));
+  VerifyOperationSucceeded(pResult);
+  VERIFY_SUCCEEDED(pResult->GetResult(&pProgram));
+
+  DxcMallocStats stats;
+  VERIFY_SUCCEEDED(pStats->GetStats(&stats));
+  VERIFY_IS_TRUE(stats.AllocCount > 0);
+  VERIFY_IS_TRUE(stats.FreeCount > 0);
+  VERIFY_IS_TRUE(stats.PeakBytes >= stats.CurrentBytes);
+  VERIFY_IS_TRUE(stats.TotalBytes >= stats.PeakBytes);
+
+  // The result keeps the allocators alive after the compiler is released.
+  pCompiler.Release();
+  pResult.Release();
+  pStats.Release();
+  pProfiler.Release();
+  pArena.Release();
+  VERIFY_IS_TRUE(hlsl::IsValidDxilContainer(
+      (const hlsl::DxilContainerHeader *)pProgram->GetBufferPointer(),
+      pProgram->GetBufferSize()));
+}
+
 TEST_F(CompilerTest, CompileWhenODumpThenOptimizerMatch) {
   LPCWSTR OptLevels[] = { L"/Od", L"/O1", L"/O2" };
   CComPtr<IDxcCompiler> pCompiler;
@@ -36,6 +36,8 @@
 #endif
 
 #include "llvm/Support/Format.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MSFileSystem.h"
 #include "llvm/Support/raw_ostream.h"
 
 #include "HLSLTestData.h"
@@ -43,9 +45,12 @@
 #include "DxcTestUtils.h"
 
 #include "dxc/Support/Global.h"
+#include "dxc/Support/FileIOHelper.h"
 #include "dxc/Support/dxcapi.use.h"
 #include "dxc/Support/HLSLOptions.h"
 #include "dxc/DxilContainer/DxilContainer.h"
+#include "dxc/DxilContainer/DxilContainerArchive.h"
+#include "dxc/DxilContainer/DxilContainerReader.h"
 #include "dxc/DxilContainer/DxilRuntimeReflection.h"
 #include "dxc/DXIL/DxilShaderFlags.h"
 #include "dxc/DXIL/DxilUtil.h"
@@ -99,7 +104,12 @@ public:
   TEST_METHOD(DisassemblyWhenValidThenOK)
   TEST_METHOD(ValidateFromLL_Abs2)
   TEST_METHOD(DxilContainerUnitTest)
+  TEST_METHOD(DxilContainerReaderWhenLoadedThenPartsIndexed)
+  TEST_METHOD(DxilContainerReaderWhenLoadFileThenFileRead)
+  TEST_METHOD(DxilContainerArchiveWhenProgramsSharedThenContainersRebuilt)
 
+  TEST_METHOD(ReflectionFromPSVMatchesDXIL)
+  TEST_METHOD(ReflectionFromCBufferLayoutMatchesDXIL)
   TEST_METHOD(ReflectionMatchesDXBC_CheckIn)
   BEGIN_TEST_METHOD(ReflectionMatchesDXBC_Full)
     TEST_METHOD_PROPERTY(L"Priority", L"1")
@@ -370,6 +380,15 @@ public:
     VERIFY_SUCCEEDED(pReflection->GetPartReflection(shaderIdx, __uuidof(ID3D12ShaderReflection), (void**)ppReflection));
   }
 
+  void CreateReflectionFromPSV(IDxcBlob *pBlob, ID3D12ShaderReflection **ppReflection) {
+    CComPtr<IDxcContainerReflection> pReflection;
+    UINT32 psvIdx;
+    m_dllSupport.CreateInstance(CLSID_DxcContainerReflection, &pReflection);
+    VERIFY_SUCCEEDED(pReflection->Load(pBlob));
+    VERIFY_SUCCEEDED(pReflection->FindFirstPartKind(hlsl::DFCC_PipelineStateValidation, &psvIdx));
+    VERIFY_SUCCEEDED(pReflection->GetPartReflection(psvIdx, __uuidof(ID3D12ShaderReflection), (void**)ppReflection));
+  }
+
   void CreateReflectionFromDXBC(IDxcBlob *pBlob, ID3D12ShaderReflection **ppReflection) {
     VERIFY_SUCCEEDED(
         D3DReflect(pBlob->GetBufferPointer(), pBlob->GetBufferSize(),
@@ -1464,6 +1483,89 @@ HRESULT HlslFileVariables::SetFromText(_In_count_(len) const char *pText, size_t
 }
 
 #ifdef _WIN32 // Reflection unsupported
+TEST_F(DxilContainerTest, ReflectionFromPSVMatchesDXIL) {
+  WEX::TestExecution::SetVerifyOutput verifySettings(WEX::TestExecution::VerifyOutputSettings::LogOnlyFailures);
+  LPCWSTR Paths[] = {
+    L"..\\CodeGenHLSL\\container\\SimpleBezier11DS.hlsl",
+    L"..\\CodeGenHLSL\\container\\SubD11_SmoothPS.hlsl",
+    L"..\\CodeGenHLSL\\Samples\\DX11\\SimpleBezier11HS.hlsl",
+    L"..\\CodeGenHLSL\\Samples\\MiniEngine\\GenerateHistogramCS.hlsl"
+  };
+  for (LPCWSTR Path : Paths) {
+    std::wstring fullPath = hlsl_test::GetPathToHlslDataFile(Path);
+    WEX::Logging::Log::Comment(WEX::Common::String().Format(L"PSV reflection comparison for %s", fullPath.c_str()));
+    CComPtr<IDxcBlob> pProgram;
+    VERIFY_SUCCEEDED(CompileFromFile(fullPath.c_str(), false, &pProgram));
+
+    CComPtr<ID3D12ShaderReflection> pPSVReflection;
+    CComPtr<ID3D12ShaderReflection> pProgramReflection;
+    CreateReflectionFromPSV(pProgram, &pPSVReflection);
+    CreateReflectionFromBlob(pProgram, &pProgramReflection);
+
+    // Queried before anything that loads the module from the PSV reflection.
+    VERIFY_ARE_EQUAL(pPSVReflection->GetRequiresFlags(), pProgramReflection->GetRequiresFlags());
+    VERIFY_ARE_EQUAL(pPSVReflection->GetGSInputPrimitive(), pProgramReflection->GetGSInputPrimitive());
+    D3D12_SHADER_DESC psvDesc, programDesc;
+    VERIFY_SUCCEEDED(pPSVReflection->GetDesc(&psvDesc));
+    VERIFY_SUCCEEDED(pProgramReflection->GetDesc(&programDesc));
+    VERIFY_ARE_EQUAL(psvDesc.Version, programDesc.Version);
+    VERIFY_ARE_EQUAL(psvDesc.InputPrimitive, programDesc.InputPrimitive);
+    VERIFY_ARE_EQUAL(psvDesc.cControlPoints, programDesc.cControlPoints);
+    VERIFY_ARE_EQUAL(psvDesc.HSOutputPrimitive, programDesc.HSOutputPrimitive);
+    VERIFY_ARE_EQUAL(psvDesc.HSPartitioning, programDesc.HSPartitioning);
+    VERIFY_ARE_EQUAL(psvDesc.TessellatorDomain, programDesc.TessellatorDomain);
+
+    CompareReflection(pPSVReflection, pProgramReflection);
+  }
+}
+
+TEST_F(DxilContainerTest, ReflectionFromCBufferLayoutMatchesDXIL) {
+  WEX::TestExecution::SetVerifyOutput verifySettings(WEX::TestExecution::VerifyOutputSettings::LogOnlyFailures);
+  const char *program =
+      "struct Light { float3 dir; float intensity; float4x3 xform; };\n"
+      "cbuffer Scene : register(b0) {\n"
+      "  float4x4 viewProj; Light lights[3]; int2 counts; float unusedValue;\n"
+      "};\n"
+      "struct Particle { float3 pos; uint id; };\n"
+      "StructuredBuffer<Particle> particles : register(t0);\n"
+      "float4 main(uint i : IDX) : SV_Target {\n"
+      "  float4 p = mul(float4(particles[i].pos, 1), viewProj);\n"
+      "  return p * lights[i % 3].intensity + counts.x;\n"
+      "}";
+  // Validation is done below with the in-tree validator, which knows the part.
+  LPCWSTR layoutArgs[] = { L"-Qcbuffer_layout", L"-Vd" };
+  CComPtr<IDxcBlob> pProgram;
+  CComPtr<IDxcBlob> pLayoutProgram;
+  CompileToProgram(program, L"main", L"ps_6_0", nullptr, 0, &pProgram);
+  CompileToProgram(program, L"main", L"ps_6_0", layoutArgs,
+                   _countof(layoutArgs), &pLayoutProgram);
+
+  const hlsl::DxilContainerHeader *pHeader = hlsl::IsDxilContainerLike(
+      pLayoutProgram->GetBufferPointer(), pLayoutProgram->GetBufferSize());
+  VERIFY_IS_NOT_NULL(pHeader);
+  const hlsl::DxilPartHeader *pLayoutPart =
+      hlsl::GetDxilPartByType(pHeader, hlsl::DFCC_ConstantBufferLayout);
+  VERIFY_IS_NOT_NULL(pLayoutPart);
+  VERIFY_IS_TRUE(hlsl::IsDxilCBufferLayoutValid(pLayoutPart));
+
+  CComPtr<IDxcValidator> pValidator;
+  CComPtr<IDxcOperationResult> pResult;
+  HRESULT status;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcValidator, &pValidator));
+  VERIFY_SUCCEEDED(pValidator->Validate(pLayoutProgram, DxcValidatorFlags_Default, &pResult));
+  VERIFY_SUCCEEDED(pResult->GetStatus(&status));
+  VERIFY_SUCCEEDED(status);
+
+  CComPtr<ID3D12ShaderReflection> pProgramReflection;
+  CComPtr<ID3D12ShaderReflection> pLayoutReflection;
+  CComPtr<ID3D12ShaderReflection> pLayoutPSVReflection;
+  CreateReflectionFromBlob(pProgram, &pProgramReflection);
+  CreateReflectionFromBlob(pLayoutProgram, &pLayoutReflection);
+  CreateReflectionFromPSV(pLayoutProgram, &pLayoutPSVReflection);
+  CompareReflection(pLayoutReflection, pProgramReflection);
+  CompareReflection(pLayoutPSVReflection, pProgramReflection);
+}
+
 TEST_F(DxilContainerTest, ReflectionMatchesDXBC_CheckIn) {
   WEX::TestExecution::SetVerifyOutput verifySettings(WEX::TestExecution::VerifyOutputSettings::LogOnlyFailures);
   ReflectionTest(hlsl_test::GetPathToHlslDataFile(L"..\\CodeGenHLSL\\container\\SimpleBezier11DS.hlsl").c_str(), false);
@@ -1571,3 +1673,190 @@ TEST_F(DxilContainerTest, DxilContainerUnitTest) {
   VERIFY_IS_NULL(hlsl::GetDxilPartByType(&header, hlsl::DxilFourCC::DFCC_DXIL));
 
 }
+
+TEST_F(DxilContainerTest, DxilContainerReaderWhenLoadedThenPartsIndexed) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcBlobEncoding> pSource;
+  CComPtr<IDxcBlob> pProgram;
+  CComPtr<IDxcOperationResult> pResult;
+  LPCWSTR arguments[] = { L"/Zi", L"/Qembed_debug" };
+
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  CreateBlobFromText("float4 main() : SV_Target { return 0; }", &pSource);
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"hlsl.hlsl", L"main", L"ps_6_0",
+    arguments, _countof(arguments), nullptr, 0, nullptr, &pResult));
+  VERIFY_SUCCEEDED(pResult->GetResult(&pProgram));
+
+  const hlsl::DxilContainerHeader *pHeader =
+      static_cast<const hlsl::DxilContainerHeader *>(pProgram->GetBufferPointer());
+  hlsl::DxilContainerReader reader;
+  VERIFY_SUCCEEDED(reader.Load(pProgram->GetBufferPointer(), pProgram->GetBufferSize()));
+  VERIFY_IS_TRUE(reader.IsLoaded());
+  VERIFY_ARE_EQUAL(pHeader->PartCount, reader.GetPartCount());
+
+  // Every part is found where a search of the container finds it.
+  uint32_t index = 0;
+  for (const hlsl::DxilPartHeader *pPart : reader) {
+    VERIFY_ARE_EQUAL(hlsl::GetDxilContainerPart(pHeader, index++), pPart);
+    hlsl::DxilFourCC fourCC = (hlsl::DxilFourCC)pPart->PartFourCC;
+    VERIFY_ARE_EQUAL(hlsl::GetDxilPartByType(pHeader, fourCC), reader.FindPart(fourCC));
+  }
+  VERIFY_ARE_EQUAL(pHeader->PartCount, index);
+
+  const char *pData;
+  uint32_t size;
+  VERIFY_IS_TRUE(reader.GetPartContent(hlsl::DFCC_ShaderDebugInfoDXIL, &pData, &size));
+  VERIFY_ARE_EQUAL(hlsl::GetDxilPartData(hlsl::GetDxilPartByType(pHeader, hlsl::DFCC_ShaderDebugInfoDXIL)), pData);
+  VERIFY_IS_NULL(reader.FindPart(hlsl::DFCC_RootSignature));
+  VERIFY_IS_FALSE(reader.GetPartContent(hlsl::DFCC_RootSignature, &pData, &size));
+
+  // A truncated container is rejected and leaves the reader empty.
+  VERIFY_ARE_EQUAL(DXC_E_CONTAINER_INVALID,
+    reader.Load(pProgram->GetBufferPointer(), pProgram->GetBufferSize() - 1));
+  VERIFY_IS_FALSE(reader.IsLoaded());
+  VERIFY_IS_NULL(reader.FindPart(hlsl::DFCC_DXIL));
+}
+
+TEST_F(DxilContainerTest, DxilContainerReaderWhenLoadFileThenFileRead) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcBlobEncoding> pSource;
+  CComPtr<IDxcBlob> pProgram;
+  CComPtr<IDxcOperationResult> pResult;
+
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  CreateBlobFromText("float4 main() : SV_Target { return 0; }", &pSource);
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"hlsl.hlsl", L"main", L"ps_6_0",
+    nullptr, 0, nullptr, 0, nullptr, &pResult));
+  VERIFY_SUCCEEDED(pResult->GetResult(&pProgram));
+
+  ::llvm::sys::fs::MSFileSystem *msfPtr;
+  VERIFY_SUCCEEDED(CreateMSFileSystemForDisk(&msfPtr));
+  std::unique_ptr<::llvm::sys::fs::MSFileSystem> msf(msfPtr);
+  ::llvm::sys::fs::AutoPerThreadSystem pts(msf.get());
+  IFTLLVM(pts.error_code());
+
+  WCHAR TempPath[MAX_PATH];
+  VERIFY_ARE_NOT_EQUAL(0U, GetTempPathW(MAX_PATH, TempPath));
+  std::wstring FileName(TempPath);
+  FileName += L"DxilContainerReaderTest.dxbc";
+  CW2A pUtf8FileName(FileName.c_str());
+  {
+    std::ofstream File(FileName, std::ios::binary);
+    File.write((const char *)pProgram->GetBufferPointer(),
+               pProgram->GetBufferSize());
+    VERIFY_IS_TRUE(File.good());
+  }
+
+  // The file contents are read as a whole container.
+  hlsl::DxilContainerReader reader;
+  VERIFY_SUCCEEDED(reader.LoadFile(pUtf8FileName.m_psz));
+  VERIFY_IS_TRUE(reader.IsLoaded());
+  const hlsl::DxilContainerHeader *pHeader =
+      static_cast<const hlsl::DxilContainerHeader *>(pProgram->GetBufferPointer());
+  VERIFY_ARE_EQUAL(pHeader->PartCount, reader.GetPartCount());
+  VERIFY_ARE_EQUAL(0, memcmp(pHeader, reader.GetHeader(), pProgram->GetBufferSize()));
+  VERIFY_IS_NOT_NULL(reader.FindPart(hlsl::DFCC_DXIL));
+  reader.Reset();
+  VERIFY_WIN32_BOOL_SUCCEEDED(DeleteFileW(FileName.c_str()));
+
+  // A missing file reports that it was not found, on every platform.
+  VERIFY_ARE_EQUAL(HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND),
+                   reader.LoadFile(pUtf8FileName.m_psz));
+  VERIFY_IS_FALSE(reader.IsLoaded());
+}
+
+TEST_F(DxilContainerTest, DxilContainerArchiveWhenProgramsSharedThenContainersRebuilt) {
+  CComPtr<IDxcCompiler> pCompiler;
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+
+  auto Compile = [&](LPCSTR pText, std::vector<char> &Container) {
+    CComPtr<IDxcBlobEncoding> pSource;
+    CComPtr<IDxcOperationResult> pResult;
+    CComPtr<IDxcBlob> pProgram;
+    CreateBlobFromText(pText, &pSource);
+    VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"hlsl.hlsl", L"main", L"ps_6_0",
+      nullptr, 0, nullptr, 0, nullptr, &pResult));
+    VERIFY_SUCCEEDED(pResult->GetResult(&pProgram));
+    const char *pData = (const char *)pProgram->GetBufferPointer();
+    Container.assign(pData, pData + pProgram->GetBufferSize());
+  };
+
+  // Two containers with the same program that differ only in their hash,
+  // as containers signed differently would, and one with another program.
+  std::vector<char> Containers[3];
+  Compile("float4 main() : SV_Target { return 0; }", Containers[0]);
+  Containers[1] = Containers[0];
+  ((hlsl::DxilContainerHeader *)Containers[1].data())->Hash.Digest[0] ^= 0xff;
+  Compile("float4 main() : SV_Target { return 1; }", Containers[2]);
+  const char *Names[3] = { "zero.dxbc", "zero_resigned.dxbc", "one.dxbc" };
+
+  hlsl::DxilContainerArchiveWriter writer;
+  for (unsigned i = 0; i < 3; ++i)
+    VERIFY_SUCCEEDED(writer.AddContainer(Names[i], Containers[i].data(), Containers[i].size()));
+  VERIFY_ARE_EQUAL(DXC_E_CONTAINER_INVALID,
+    writer.AddContainer("truncated.dxbc", Containers[0].data(), Containers[0].size() - 1));
+  // Names are where containers are extracted, so they must be plain file names.
+  const char *BadNames[] = { "", "..", "../zero.dxbc", "dir\\zero.dxbc", "/zero.dxbc", "c:zero.dxbc" };
+  for (const char *pBadName : BadNames)
+    VERIFY_ARE_EQUAL(E_INVALIDARG,
+      writer.AddContainer(pBadName, Containers[0].data(), Containers[0].size()));
+
+  CComPtr<IMalloc> pMalloc;
+  VERIFY_SUCCEEDED(CoGetMalloc(1, &pMalloc));
+  CComPtr<hlsl::AbstractMemoryStream> pArchive;
+  VERIFY_SUCCEEDED(hlsl::CreateMemoryStream(pMalloc, &pArchive));
+  writer.write(pArchive);
+  VERIFY_ARE_EQUAL(writer.size(), pArchive->GetPtrSize());
+
+  const hlsl::DxilContainerArchiveStats &stats = writer.GetStats();
+  VERIFY_ARE_EQUAL(3u, stats.ContainerCount);
+  VERIFY_ARE_EQUAL(3u, stats.ProgramCount);
+  VERIFY_ARE_EQUAL(2u, stats.UniqueProgramCount);
+  VERIFY_ARE_EQUAL((uint64_t)pArchive->GetPtrSize(), stats.ArchiveBytes);
+  VERIFY_IS_TRUE(stats.ArchiveBytes <
+    Containers[0].size() + Containers[1].size() + Containers[2].size());
+
+  hlsl::DxilContainerArchiveReader reader;
+  VERIFY_SUCCEEDED(reader.Load(pArchive->GetPtr(), pArchive->GetPtrSize()));
+  VERIFY_ARE_EQUAL(3u, reader.GetContainerCount());
+  hlsl::DxilContainerArchiveStats readStats = reader.GetStats();
+  VERIFY_ARE_EQUAL(stats.ContainerBytes, readStats.ContainerBytes);
+  VERIFY_ARE_EQUAL(stats.UniqueProgramBytes, readStats.UniqueProgramBytes);
+
+  // The program is keyed by the hash the compiler put in the container.
+  const hlsl::DxilPartHeader *pHashPart = hlsl::GetDxilPartByType(
+    (const hlsl::DxilContainerHeader *)Containers[0].data(), hlsl::DFCC_ShaderHash);
+  if (pHashPart) {
+    const hlsl::DxilShaderHash *pHash = (const hlsl::DxilShaderHash *)hlsl::GetDxilPartData(pHashPart);
+    VERIFY_ARE_EQUAL(0, memcmp(pHash->Digest, reader.GetProgramHash(0)->Digest, hlsl::DxilContainerHashSize));
+  }
+  VERIFY_ARE_EQUAL(reader.GetProgramHash(0), reader.GetProgramHash(1));
+  VERIFY_ARE_NOT_EQUAL(reader.GetProgramHash(0), reader.GetProgramHash(2));
+
+  // Every container is rebuilt as it was added.
+  for (unsigned i = 0; i < 3; ++i) {
+    uint32_t index = reader.FindContainer(Names[i]);
+    VERIFY_ARE_EQUAL(i, index);
+    VERIFY_ARE_EQUAL((uint32_t)Containers[i].size(), reader.GetContainerSize(index));
+    CComPtr<hlsl::AbstractMemoryStream> pContainer;
+    VERIFY_SUCCEEDED(hlsl::CreateMemoryStream(pMalloc, &pContainer));
+    reader.ExtractContainer(index, pContainer);
+    VERIFY_ARE_EQUAL(Containers[i].size(), (size_t)pContainer->GetPtrSize());
+    VERIFY_ARE_EQUAL(0, memcmp(Containers[i].data(), pContainer->GetPtr(), Containers[i].size()));
+  }
+  VERIFY_ARE_EQUAL(UINT32_MAX, reader.FindContainer("missing.dxbc"));
+
+  // A truncated archive is rejected.
+  VERIFY_ARE_EQUAL(DXC_E_CONTAINER_INVALID,
+    reader.Load(pArchive->GetPtr(), pArchive->GetPtrSize() - 1));
+  VERIFY_IS_FALSE(reader.IsLoaded());
+
+  // So is an archive with a container name that leaves the output directory.
+  std::string Tampered((const char *)pArchive->GetPtr(), pArchive->GetPtrSize());
+  size_t NamePos = Tampered.rfind("one.dxbc");
+  VERIFY_ARE_NOT_EQUAL(std::string::npos, NamePos);
+  Tampered.replace(NamePos, 3, "../");
+  VERIFY_ARE_EQUAL(DXC_E_CONTAINER_INVALID,
+    reader.Load(Tampered.data(), Tampered.size()));
+  VERIFY_IS_FALSE(reader.IsLoaded());
+}
@@ -21,6 +21,7 @@
 #include "WexTestClass.h"
 #include "HlslTestUtils.h"
 #include "dxc/dxcapi.h"
+#include "dxc/DxilContainer/DxilContainer.h"
 #include "DxcTestUtils.h"
 
 using namespace std;
@@ -40,6 +41,9 @@ public:
 
   TEST_METHOD(RunLinkResource);
   TEST_METHOD(RunLinkAllProfiles);
+  TEST_METHOD(RunLinkBatch);
+  TEST_METHOD(RunLinkReusesLoadedFunctions);
+  TEST_METHOD(RunLinkWithLibraryIndex);
   TEST_METHOD(RunLinkFailNoDefine);
   TEST_METHOD(RunLinkFailReDefine);
   TEST_METHOD(RunLinkGlobalInit);
@@ -187,6 +191,127 @@ TEST_F(LinkerTest, RunLinkAllProfiles) {
   Link(L"cs_main", L"cs_6_0", pLinker, {libName, libResName}, {},{});
 }
 
+TEST_F(LinkerTest, RunLinkBatch) {
+  CComPtr<IDxcLinker> pLinker;
+  CreateLinker(&pLinker);
+  CComPtr<IDxcBatchLinker> pBatchLinker;
+  VERIFY_SUCCEEDED(pLinker.QueryInterface(&pBatchLinker));
+
+  LPCWSTR libName = L"entry";
+  CComPtr<IDxcBlob> pEntryLib;
+  CompileLib(L"..\\CodeGenHLSL\\lib_entries2.hlsl", &pEntryLib);
+  RegisterDxcModule(libName, pEntryLib, pLinker);
+
+  LPCWSTR libResName = L"res";
+  CComPtr<IDxcBlob> pResLib;
+  CompileLib(L"..\\CodeGenHLSL\\lib_resource2.hlsl", &pResLib);
+  RegisterDxcModule(libResName, pResLib, pLinker);
+
+  LPCWSTR libNames[] = { libName, libResName };
+  LPCWSTR unknownLibNames[] = { L"unknown" };
+  const DxcLinkJob jobs[] = {
+    { L"vs_main", L"vs_6_0", libNames, 1, nullptr, 0 },
+    { L"hs_main", L"hs_6_0", libNames, 1, nullptr, 0 },
+    { L"ds_main", L"ds_6_0", libNames, 1, nullptr, 0 },
+    { L"gs_main", L"gs_6_0", libNames, 1, nullptr, 0 },
+    { L"ps_main", L"ps_6_0", libNames, 1, nullptr, 0 },
+    { L"cs_main", L"cs_6_0", libNames, 2, nullptr, 0 },
+    { L"vs_main", L"vs_6_0", unknownLibNames, 1, nullptr, 0 },
+  };
+  const UINT32 jobCount = _countof(jobs);
+  IDxcOperationResult *pResults[jobCount];
+  VERIFY_SUCCEEDED(pBatchLinker->LinkBatch(jobs, jobCount, 3, pResults));
+  std::vector<CComPtr<IDxcOperationResult>> results(jobCount);
+  for (UINT32 i = 0; i < jobCount; ++i)
+    results[i].Attach(pResults[i]);
+
+  // Each linked job matches a link of the same entry on its own.
+  for (UINT32 i = 0; i + 1 < jobCount; ++i) {
+    CComPtr<IDxcBlob> pBatchProgram;
+    CheckOperationSucceeded(results[i], &pBatchProgram);
+    CComPtr<IDxcOperationResult> pResult;
+    VERIFY_SUCCEEDED(pLinker->Link(jobs[i].pEntryName, jobs[i].pTargetProfile,
+                                   jobs[i].pLibNames, jobs[i].libCount,
+                                   nullptr, 0, &pResult));
+    CComPtr<IDxcBlob> pProgram;
+    CheckOperationSucceeded(pResult, &pProgram);
+    VERIFY_ARE_EQUAL(pProgram->GetBufferSize(), pBatchProgram->GetBufferSize());
+    VERIFY_IS_TRUE(0 == memcmp(pProgram->GetBufferPointer(),
+                               pBatchProgram->GetBufferPointer(),
+                               pProgram->GetBufferSize()));
+  }
+
+  // A job that fails does not fail the batch.
+  HRESULT status;
+  VERIFY_SUCCEEDED(results[jobCount - 1]->GetStatus(&status));
+  VERIFY_FAILED(status);
+}
+
+TEST_F(LinkerTest, RunLinkReusesLoadedFunctions) {
+  CComPtr<IDxcLinker> pLinker;
+  CreateLinker(&pLinker);
+
+  LPCWSTR libName = L"entry";
+  CComPtr<IDxcBlob> pEntryLib;
+  CompileLib(L"..\\CodeGenHLSL\\lib_entries2.hlsl", &pEntryLib);
+  RegisterDxcModule(libName, pEntryLib, pLinker);
+
+  LPCWSTR option[] = { L"-report-link-stats" };
+  LPCSTR firstMsgs[] = {
+    "note: [1-9][0-9]* library functions loaded in [0-9]+us, 0 reused; "
+    "[1-9][0-9]* cloned" };
+  LPCSTR secondMsgs[] = {
+    "note: 0 library functions loaded in [0-9]+us, [1-9][0-9]* reused; "
+    "[1-9][0-9]* cloned" };
+  for (LPCSTR *pMsgs : { firstMsgs, secondMsgs }) {
+    CComPtr<IDxcOperationResult> pResult;
+    VERIFY_SUCCEEDED(pLinker->Link(L"ps_main", L"ps_6_0", &libName, 1, option,
+                                   _countof(option), &pResult));
+    CheckOperationResultMsgs(pResult, pMsgs, 1, false, /*bRegex*/ true);
+    HRESULT status;
+    VERIFY_SUCCEEDED(pResult->GetStatus(&status));
+    VERIFY_SUCCEEDED(status);
+  }
+}
+
+TEST_F(LinkerTest, RunLinkWithLibraryIndex) {
+  LPCWSTR option[] = { L"-Qlibrary_index" };
+  CComPtr<IDxcBlob> pIndexedLib;
+  CompileLib(L"..\\CodeGenHLSL\\lib_entries2.hlsl", &pIndexedLib, option);
+  const DxilContainerHeader *pContainer = IsDxilContainerLike(
+      pIndexedLib->GetBufferPointer(), pIndexedLib->GetBufferSize());
+  VERIFY_IS_NOT_NULL(pContainer);
+  const DxilPartHeader *pIndexPart =
+      GetDxilPartByType(pContainer, DFCC_LibraryIndex);
+  VERIFY_IS_NOT_NULL(pIndexPart);
+  VERIFY_IS_TRUE(IsDxilLibraryIndexValid(pIndexPart));
+
+  CComPtr<IDxcBlob> pLib;
+  CompileLib(L"..\\CodeGenHLSL\\lib_entries2.hlsl", &pLib);
+
+  // Linking a library registered from its index gives the same result.
+  LPCWSTR libName = L"entry";
+  LPCWSTR entries[][2] = { { L"vs_main", L"vs_6_0" }, { L"ps_main", L"ps_6_0" } };
+  for (auto &entry : entries) {
+    CComPtr<IDxcBlob> pPrograms[2];
+    IDxcBlob *pLibs[] = { pIndexedLib, pLib };
+    for (unsigned i = 0; i < 2; ++i) {
+      CComPtr<IDxcLinker> pLinker;
+      CreateLinker(&pLinker);
+      RegisterDxcModule(libName, pLibs[i], pLinker);
+      CComPtr<IDxcOperationResult> pResult;
+      VERIFY_SUCCEEDED(pLinker->Link(entry[0], entry[1], &libName, 1, nullptr,
+                                     0, &pResult));
+      CheckOperationSucceeded(pResult, &pPrograms[i]);
+    }
+    VERIFY_ARE_EQUAL(pPrograms[0]->GetBufferSize(),
+                     pPrograms[1]->GetBufferSize());
+    VERIFY_IS_TRUE(0 == memcmp(pPrograms[0]->GetBufferPointer(),
+                               pPrograms[1]->GetBufferPointer(),
+                               pPrograms[0]->GetBufferSize()));
+  }
+}
+
 TEST_F(LinkerTest, RunLinkFailNoDefine) {
   CComPtr<IDxcBlob> pEntryLib;
   CompileLib(L"..\\CodeGenHLSL\\lib_cs_entry.hlsl", &pEntryLib);
@@ -66,6 +66,7 @@ public:
   TEST_METHOD(OptimizerWhenSlice2ThenOK)
   TEST_METHOD(OptimizerWhenSlice3ThenOK)
   TEST_METHOD(OptimizerWhenSliceWithIntermediateOptionsThenOK)
+  TEST_METHOD(OptimizerWhenPipelineReusedThenSameAsRunOptimizer)
 
   void OptimizerWhenSliceNThenOK(int optLevel);
   void OptimizerWhenSliceNThenOK(int optLevel, LPCWSTR pText, LPCWSTR pTarget, llvm::ArrayRef<LPCWSTR> args = {});
@@ -152,6 +153,77 @@ static void ExtractFunctionPasses(std::vector<LPCWSTR> &passes, std::vector<LPCW
   passes.erase(firstPass, lastPass);
 }
 
+TEST_F(OptimizerTest, OptimizerWhenPipelineReusedThenSameAsRunOptimizer) {
+  LPCWSTR SampleProgram =
+    L"Texture2D g_Tex;\r\n"
+    L"SamplerState g_Sampler;\r\n"
+    L"float4 main(float4 pos : SV_Position, float4 user : USER, bool b : B) : SV_Target {\r\n"
+    L"  if (b) user = g_Tex.Sample(g_Sampler, pos.xy);\r\n"
+    L"  return user * pos;\r\n"
+    L"}";
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcOptimizer2> pOptimizer;
+  CComPtr<IDxcOperationResult> pResult;
+  CComPtr<IDxcBlobEncoding> pSource;
+  CComPtr<IDxcBlob> pOptDump;
+  CComPtr<IDxcBlob> pHighLevelBlob;
+  std::vector<LPCWSTR> passList;
+  std::vector<LPCWSTR> prefixPassList;
+
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcCompiler, &pCompiler));
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcOptimizer, &pOptimizer));
+  Utf16ToBlob(m_dllSupport, SampleProgram, &pSource);
+
+  // Get the passes and the high-level compile of the program.
+  LPCWSTR dumpArgs[] = { L"/Vd", L"/O3", L"/Odump" };
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main", L"ps_6_0",
+    dumpArgs, _countof(dumpArgs), nullptr, 0, nullptr, &pResult));
+  VerifyOperationSucceeded(pResult);
+  VERIFY_SUCCEEDED(pResult->GetResult(&pOptDump));
+  pResult.Release();
+  LPCWSTR highLevelArgs[] = { L"/Vd", L"/O3", L"/fcgl" };
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main", L"ps_6_0",
+    highLevelArgs, _countof(highLevelArgs), nullptr, 0, nullptr, &pResult));
+  VerifyOperationSucceeded(pResult);
+  VERIFY_SUCCEEDED(pResult->GetResult(&pHighLevelBlob));
+  pResult.Release();
+
+  std::string passes = BlobToUtf8(pOptDump);
+  CA2W passesW(passes.c_str(), CP_UTF8);
+  SplitPassList(passesW.m_psz, passList);
+  ExtractFunctionPasses(passList, prefixPassList);
+  std::vector<LPCWSTR> options = prefixPassList;
+  options.push_back(L"-opt-mod-passes");
+  options.insert(options.end(), passList.begin(), passList.end());
+
+  CComPtr<IDxcBlob> pExpected;
+  VERIFY_SUCCEEDED(pOptimizer->RunOptimizer(pHighLevelBlob, options.data(),
+    (UINT32)options.size(), &pExpected, nullptr));
+
+  CComPtr<IDxcOptimizerPipeline> pPipeline;
+  VERIFY_SUCCEEDED(pOptimizer->CreatePipeline(options.data(),
+    (UINT32)options.size(), &pPipeline));
+
+  // The same passes run every module, one after another and in parallel.
+  const UINT32 blobCount = 4;
+  IDxcBlob *pBlobs[blobCount] = { pHighLevelBlob, pHighLevelBlob,
+                                  pHighLevelBlob, pHighLevelBlob };
+  IDxcBlob *pOutputs[blobCount];
+  VERIFY_SUCCEEDED(pPipeline->RunBatch(pBlobs, blobCount, 2, pOutputs, nullptr));
+  std::vector<CComPtr<IDxcBlob>> outputs(blobCount + 2);
+  for (UINT32 i = 0; i < blobCount; ++i)
+    outputs[i].Attach(pOutputs[i]);
+  VERIFY_SUCCEEDED(pPipeline->Run(pHighLevelBlob, &outputs[blobCount], nullptr));
+  VERIFY_SUCCEEDED(pPipeline->Run(pHighLevelBlob, &outputs[blobCount + 1], nullptr));
+
+  for (CComPtr<IDxcBlob> &pOutput : outputs) {
+    VERIFY_ARE_EQUAL(pExpected->GetBufferSize(), pOutput->GetBufferSize());
+    VERIFY_IS_TRUE(0 == memcmp(pExpected->GetBufferPointer(),
+                               pOutput->GetBufferPointer(),
+                               pExpected->GetBufferSize()));
+  }
+}
+
 void OptimizerTest::OptimizerWhenSliceNThenOK(int optLevel, LPCWSTR pText, LPCWSTR pTarget, llvm::ArrayRef<LPCWSTR> args) {
   CComPtr<IDxcCompiler> pCompiler;
   CComPtr<IDxcOptimizer> pOptimizer;
@@ -257,6 +257,9 @@ public:
   TEST_METHOD(ShaderFunctionReturnTypeVoid)
 
   TEST_METHOD(WhenDisassembleInvalidBlobThenFail)
+  TEST_METHOD(WhenRevalidatedUnchangedThenFunctionsSkipped)
+  TEST_METHOD(WhenValidatedOnThreadsThenSameDiagnostics)
+  TEST_METHOD(WhenContainerPartsOnlyThenBodiesNotValidated)
 
   dxc::DxcDllSupport m_dllSupport;
   VersionSupportInfo m_ver;
@@ -3069,6 +3072,185 @@ TEST_F(ValidationTest, WhenDisassembleInvalidBlobThenFail) {
   VERIFY_FAILED(pCompiler->Disassemble(pInvalidBitcode, &pDisassembly));
 }
 
+TEST_F(ValidationTest, WhenRevalidatedUnchangedThenFunctionsSkipped) {
+  if (m_ver.SkipDxilVersion(1, 3)) return;
+  if (!m_ver.m_InternalValidator) {
+    WEX::Logging::Log::Comment(L"Test skipped; incremental validation requires the internal validator.");
+    return;
+  }
+
+  CComPtr<IDxcBlob> pProgram;
+  CompileSource("export float Helper(float f) { return f * 2; }\n"
+                "export float Other(float f) { return Helper(f) + 1; }\n",
+                "lib_6_3", &pProgram);
+
+  CComPtr<IDxcIncrementalValidator> pValidator;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcValidator, &pValidator));
+
+  CComPtr<IDxcOperationResult> pResult;
+  CComPtr<IDxcBlob> pState;
+  UINT32 functionCount = 0, revalidatedCount = 0;
+  VERIFY_SUCCEEDED(pValidator->ValidateIncremental(
+      pProgram, DxcValidatorFlags_Default, nullptr, &pResult, &pState,
+      &functionCount, &revalidatedCount));
+  CheckOperationResultMsgs(pResult, {}, false, false);
+  VERIFY_IS_TRUE(functionCount >= 2);
+  VERIFY_ARE_EQUAL(functionCount, revalidatedCount);
+
+  pResult.Release();
+  CComPtr<IDxcBlob> pNextState;
+  VERIFY_SUCCEEDED(pValidator->ValidateIncremental(
+      pProgram, DxcValidatorFlags_Default, pState, &pResult, &pNextState,
+      &functionCount, &revalidatedCount));
+  CheckOperationResultMsgs(pResult, {}, false, false);
+  VERIFY_ARE_EQUAL(0u, revalidatedCount);
+  VERIFY_ARE_EQUAL(pState->GetBufferSize(), pNextState->GetBufferSize());
+}
+
+TEST_F(ValidationTest, WhenValidatedOnThreadsThenSameDiagnostics) {
+  if (m_ver.SkipDxilVersion(1, 3)) return;
+  if (!m_ver.m_InternalValidator) {
+    WEX::Logging::Log::Comment(L"Test skipped; threaded validation requires the internal validator.");
+    return;
+  }
+
+  // Validates pProgram with one thread and with several, and checks that
+  // both report the same diagnostics.
+  auto ValidateOnThreads = [&](IDxcBlob *pProgram) {
+    std::string diagnostics[2];
+    UINT32 threadCounts[2] = { 1, 4 };
+    for (unsigned i = 0; i < 2; ++i) {
+      CComPtr<IDxcValidator> pValidator;
+      CComPtr<IDxcValidatorOptions> pOptions;
+      CComPtr<IDxcOperationResult> pResult;
+      CComPtr<IDxcBlobEncoding> pErrors;
+      HRESULT status;
+      VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcValidator, &pValidator));
+      VERIFY_SUCCEEDED(pValidator.QueryInterface(&pOptions));
+      VERIFY_SUCCEEDED(pOptions->SetThreadCount(threadCounts[i]));
+      VERIFY_SUCCEEDED(pValidator->Validate(pProgram, DxcValidatorFlags_Default, &pResult));
+      VERIFY_SUCCEEDED(pResult->GetStatus(&status));
+      VERIFY_FAILED(status);
+      VERIFY_SUCCEEDED(pResult->GetErrorBuffer(&pErrors));
+      diagnostics[i] = BlobToUtf8(pErrors);
+    }
+    VERIFY_ARE_NOT_EQUAL(std::string::npos,
+                         diagnostics[0].find("No signed integer division by zero"));
+    VERIFY_ARE_EQUAL(std::string::npos,
+                     diagnostics[0].find("Resource handle should returned by createHandle"));
+    VERIFY_ARE_EQUAL(std::string::npos,
+                     diagnostics[0].find("must be in entryPoints"));
+    VERIFY_ARE_EQUAL(diagnostics[0], diagnostics[1]);
+  };
+  auto AssembleText = [&](IDxcBlob *pText, IDxcBlob **ppProgram) {
+    CComPtr<IDxcAssembler> pAssembler;
+    CComPtr<IDxcOperationResult> pAssembleResult;
+    VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcAssembler, &pAssembler));
+    VERIFY_SUCCEEDED(pAssembler->AssembleToContainer(pText, &pAssembleResult));
+    VERIFY_SUCCEEDED(pAssembleResult->GetResult(ppProgram));
+  };
+
+  // Library functions that use no resources or signatures.
+  {
+    CComPtr<IDxcBlobEncoding> pSource;
+    Utf8ToBlob(m_dllSupport,
+               "export int F0(int a) { return a / 3; }\n"
+               "export int F1(int a) { return a / 5 + 1; }\n"
+               "export int F2(int a) { return a / 7 + 2; }\n"
+               "export int F3(int a) { return a / 9 + 3; }\n",
+               &pSource);
+    CComPtr<IDxcBlob> pText;
+    RewriteAssemblyToText(pSource, "lib_6_3", nullptr, 0, nullptr, 0,
+                          { "sdiv i32 (%[0-9A-Za-z.]+), 3",
+                            "sdiv i32 (%[0-9A-Za-z.]+), 5",
+                            "sdiv i32 (%[0-9A-Za-z.]+), 7",
+                            "sdiv i32 (%[0-9A-Za-z.]+), 9" },
+                          { "sdiv i32 \\1, 0", "sdiv i32 \\1, 0",
+                            "sdiv i32 \\1, 0", "sdiv i32 \\1, 0" },
+                          &pText, /*bRegex*/ true);
+    CComPtr<IDxcBlob> pProgram;
+    AssembleText(pText, &pProgram);
+    ValidateOnThreads(pProgram);
+  }
+
+  // Entry shaders that use resources and signatures, next to a library
+  // function. Their checks read the resource and entry state of the module.
+  {
+    CComPtr<IDxcBlobEncoding> pSource;
+    Utf8ToBlob(m_dllSupport,
+               "Texture2D<float4> tex : register(t0);\n"
+               "SamplerState samp : register(s0);\n"
+               "RWBuffer<int> outBuf : register(u0);\n"
+               "cbuffer Consts : register(b0) { float4 scale; int divisor; };\n"
+               "export int F0(int a) { return a / 3; }\n"
+               "[shader(\"vertex\")]\n"
+               "float4 VSMain(float4 p : POSITION, uint id : SV_VertexID) : SV_Position {\n"
+               "  outBuf[id] = (int)id + divisor;\n"
+               "  return p * scale;\n"
+               "}\n"
+               "[shader(\"pixel\")]\n"
+               "float4 PSMain(float4 p : SV_Position, float2 uv : TEXCOORD) : SV_Target {\n"
+               "  return tex.Sample(samp, uv) * (divisor / 7);\n"
+               "}\n"
+               "[shader(\"compute\")] [numthreads(8, 1, 1)]\n"
+               "void CSMain(uint id : SV_DispatchThreadID) {\n"
+               "  outBuf[id] = (int)tex.Load(int3(id, 0, 0)).x;\n"
+               "}\n",
+               &pSource);
+    CComPtr<IDxcBlob> pText;
+    RewriteAssemblyToText(pSource, "lib_6_3", nullptr, 0, nullptr, 0,
+                          { "sdiv i32 (%[0-9A-Za-z.]+), 3",
+                            "sdiv i32 (%[0-9A-Za-z.]+), 7" },
+                          { "sdiv i32 \\1, 0", "sdiv i32 \\1, 0" },
+                          &pText, /*bRegex*/ true);
+    CComPtr<IDxcBlob> pProgram;
+    AssembleText(pText, &pProgram);
+    ValidateOnThreads(pProgram);
+  }
+}
+
+TEST_F(ValidationTest, WhenContainerPartsOnlyThenBodiesNotValidated) {
+  if (!m_ver.m_InternalValidator) {
+    WEX::Logging::Log::Comment(L"Test skipped; parts-only validation requires the internal validator.");
+    return;
+  }
+
+  CComPtr<IDxcBlobEncoding> pSource;
+  Utf8ToBlob(m_dllSupport,
+             "int i; float4 main(float4 p : P) : SV_Target { return p / (i / 3); }",
+             &pSource);
+  CComPtr<IDxcBlob> pText;
+  RewriteAssemblyToText(pSource, "ps_6_0", nullptr, 0, nullptr, 0,
+                        { "sdiv i32 (%[0-9A-Za-z.]+), 3" },
+                        { "sdiv i32 \\1, 0" },
+                        &pText, /*bRegex*/ true);
+  CComPtr<IDxcAssembler> pAssembler;
+  CComPtr<IDxcOperationResult> pAssembleResult;
+  CComPtr<IDxcBlob> pProgram;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcAssembler, &pAssembler));
+  VERIFY_SUCCEEDED(pAssembler->AssembleToContainer(pText, &pAssembleResult));
+  VERIFY_SUCCEEDED(pAssembleResult->GetResult(&pProgram));
+
+  // The division by zero is only found by validating the function body.
+  CheckValidationMsgs(pProgram, { "No signed integer division by zero" });
+
+  // The parts were built from the same metadata, so they still match.
+  CComPtr<IDxcValidator> pValidator;
+  CComPtr<IDxcOperationResult> pResult;
+  HRESULT status;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcValidator, &pValidator));
+  VERIFY_SUCCEEDED(pValidator->Validate(pProgram, DxcValidatorFlags_ContainerPartsOnly, &pResult));
+  VERIFY_SUCCEEDED(pResult->GetStatus(&status));
+  VERIFY_SUCCEEDED(status);
+
+  pResult.Release();
+  VERIFY_ARE_EQUAL(E_INVALIDARG,
+                   pValidator->Validate(pProgram,
+                                        DxcValidatorFlags_ContainerPartsOnly |
+                                        DxcValidatorFlags_ModuleOnly,
+                                        &pResult));
+}
+
 TEST_F(ValidationTest, GSMainMissingAttributeFail) {
   TestCheck(L"..\\CodeGenHLSL\\attributes-gs-no-inout-main.hlsl");
 }
@@ -37,7 +37,9 @@ public:
   TEST_METHOD(RunArrayIndexOutOfBounds)
   TEST_METHOD(RunArrayLength)
   TEST_METHOD(RunAttributes)
+  TEST_METHOD(RunBuiltinTypesLazyDeclaration)
   TEST_METHOD(RunBuiltinTypesNoInheritance)
+  TEST_METHOD(RunBuiltinTypesQualifiedLookup)
   TEST_METHOD(RunConstExpr)
   TEST_METHOD(RunConstAssign)
   TEST_METHOD(RunConstDefault)
@@ -154,10 +156,18 @@ TEST_F(VerifierTest, RunAttributes) {
   CheckVerifiesHLSL(L"attributes.hlsl");
 }
 
+TEST_F(VerifierTest, RunBuiltinTypesLazyDeclaration) {
+  CheckVerifiesHLSL(L"builtin-types-lazy-declaration.hlsl");
+}
+
 TEST_F(VerifierTest, RunBuiltinTypesNoInheritance) {
   CheckVerifiesHLSL(L"builtin-types-no-inheritance.hlsl");
 }
 
+TEST_F(VerifierTest, RunBuiltinTypesQualifiedLookup) {
+  CheckVerifiesHLSL(L"builtin-types-qualified-lookup.hlsl");
+}
+
 TEST_F(VerifierTest, RunConstExpr) {
   CheckVerifiesHLSL(L"const-expr.hlsl");
 }
@@ -1414,6 +1414,15 @@ TEST_F(FileTest, SpirvLegalizationStructuredBufferInStruct) {
   setBeforeHLSLLegalization();
   runFileTest("spirv.legal.sbuffer.struct.hlsl");
 }
+TEST_F(FileTest, SpirvLegalizationReport) {
+  runFileTest("spirv.legal.report.hlsl", Expect::Warning);
+}
+TEST_F(FileTest, SpirvLegalizationArgumentScope) {
+  runFileTest("spirv.legal.argument-scope.hlsl");
+}
+TEST_F(FileTest, SpirvLegalizationStageInstruction) {
+  runFileTest("spirv.legal.stage-instruction.hlsl");
+}
 TEST_F(FileTest, SpirvLegalizationConstantBuffer) {
   runFileTest("spirv.legal.cbuffer.hlsl");
 }
@@ -157,7 +157,7 @@ bool runCompilerWithSpirvGeneration(const llvm::StringRef inputFilePath,
 
     bool requires_opt = false;
     for (const auto &arg : rest)
-      if (arg == L"-O3" || arg.substr(0, 8) == L"-Oconfig")
+      if (arg == L"-O0" || arg == L"-O3" || arg.substr(0, 8) == L"-Oconfig")
         requires_opt = true;
 
     std::vector<LPCWSTR> flags;
@@ -170,7 +170,7 @@ bool runCompilerWithSpirvGeneration(const llvm::StringRef inputFilePath,
     flags.push_back(profile.c_str());
     flags.push_back(L"-spirv");
     // Disable legalization and optimization for testing, unless the caller
-    // wants to run a specific optimization recipe (with -Oconfig).
+    // wants to run a specific optimization level or recipe (with -Oconfig).
     if (!requires_opt)
       flags.push_back(L"-fcgl");
     // Disable validation. We'll run it manually.
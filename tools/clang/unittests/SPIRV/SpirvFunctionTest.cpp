@@ -0,0 +1,131 @@
+//===- unittests/SPIRV/SpirvFunctionTest.cpp ------- Function Tests -------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "SpirvTestBase.h"
+#include "clang/SPIRV/SpirvBasicBlock.h"
+#include "clang/SPIRV/SpirvFunction.h"
+#include "clang/SPIRV/SpirvInstruction.h"
+#include "clang/SPIRV/SpirvVisitor.h"
+
+using namespace clang::spirv;
+
+namespace {
+
+/// Records every basic block and instruction in the order a visitor sees
+/// them, which is the order EmitVisitor serializes them in.
+class TraceVisitor : public Visitor {
+public:
+  TraceVisitor(const SpirvCodeGenOptions &opts, SpirvContext &ctx)
+      : Visitor(opts, ctx) {}
+
+  using Visitor::visit;
+
+  bool visit(SpirvBasicBlock *bb, Phase phase) override {
+    if (phase == Phase::Init)
+      trace.push_back(bb);
+    return true;
+  }
+  bool visitInstruction(SpirvInstruction *inst) override {
+    trace.push_back(inst);
+    return true;
+  }
+
+  std::vector<const void *> trace;
+};
+
+/// A selection construct whose blocks are added to the function in a
+/// different order than the readable one:
+///
+///   entry -> then, else; merge target is merge
+///   then  -> merge
+///   else  -> merge
+class SpirvFunctionTest : public SpirvTestBase {
+public:
+  SpirvFunctionTest()
+      : fn(clang::QualType(), nullptr, {}, "fn"), entry("entry"),
+        thenBB("then"), elseBB("else"), merge("merge"),
+        selectionMerge({}, &merge, spv::SelectionControlMask::MaskNone),
+        condBranch({}, nullptr, &thenBB, &elseBB), thenBranch({}, &merge),
+        elseBranch({}, &merge), ret({}) {
+    entry.addInstruction(&selectionMerge);
+    entry.addInstruction(&condBranch);
+    entry.setMergeTarget(&merge);
+    entry.addSuccessor(&thenBB);
+    entry.addSuccessor(&elseBB);
+    thenBB.addInstruction(&thenBranch);
+    thenBB.addSuccessor(&merge);
+    elseBB.addInstruction(&elseBranch);
+    elseBB.addSuccessor(&merge);
+    merge.addInstruction(&ret);
+
+    fn.addBasicBlock(&entry);
+    fn.addBasicBlock(&merge);
+    fn.addBasicBlock(&elseBB);
+    fn.addBasicBlock(&thenBB);
+  }
+
+  std::vector<const void *> visitFunction(bool reverseOrder = false) {
+    TraceVisitor visitor(options, getSpirvContext());
+    EXPECT_TRUE(fn.invokeVisitor(&visitor, reverseOrder));
+    return visitor.trace;
+  }
+
+  std::vector<const void *> readableTrace() {
+    return {&entry,  &selectionMerge, &condBranch, &thenBB, &thenBranch,
+            &elseBB, &elseBranch,     &merge,      &ret};
+  }
+
+protected:
+  SpirvCodeGenOptions options = {};
+  SpirvFunction fn;
+  SpirvBasicBlock entry, thenBB, elseBB, merge;
+  SpirvSelectionMerge selectionMerge;
+  SpirvBranchConditional condBranch;
+  SpirvBranch thenBranch, elseBranch;
+  SpirvReturn ret;
+};
+
+TEST_F(SpirvFunctionTest, VisitsBlocksInReadableOrder) {
+  EXPECT_EQ(visitFunction(), readableTrace());
+}
+
+TEST_F(SpirvFunctionTest, RepeatedVisitsSeeIdenticalOrder) {
+  const std::vector<const void *> first = visitFunction();
+  EXPECT_EQ(visitFunction(), first);
+  EXPECT_EQ(visitFunction(), first);
+}
+
+TEST_F(SpirvFunctionTest, ReverseVisitDoesNotChangeLaterVisits) {
+  // A reverse visit walks the blocks and their instructions backwards, but
+  // still reports each block before its instructions.
+  const std::vector<const void *> expectedReverse = {
+      &merge,      &ret,   &elseBB,     &elseBranch,    &thenBB,
+      &thenBranch, &entry, &condBranch, &selectionMerge};
+
+  EXPECT_EQ(visitFunction(), readableTrace());
+  EXPECT_EQ(visitFunction(/*reverseOrder*/ true), expectedReverse);
+  EXPECT_EQ(visitFunction(), readableTrace());
+}
+
+TEST_F(SpirvFunctionTest, AddingBlockRecomputesOrder) {
+  EXPECT_EQ(visitFunction(), readableTrace());
+
+  SpirvBasicBlock exit("exit");
+  SpirvReturn exitRet({});
+  exit.addInstruction(&exitRet);
+  merge.addSuccessor(&exit);
+  fn.addBasicBlock(&exit);
+
+  std::vector<const void *> expected = readableTrace();
+  expected.push_back(&exit);
+  expected.push_back(&exitRet);
+  EXPECT_EQ(visitFunction(), expected);
+}
+
+} // anonymous namespace
@@ -9,6 +9,7 @@
 
 #include "gmock/gmock.h"
 #include "clang/SPIRV/String.h"
+#include "llvm/ADT/SmallVector.h"
 #include "gtest/gtest.h"
 
 namespace {
@@ -55,6 +56,12 @@ TEST(String, EncodeString) {
   std::vector<uint32_t> words = string::encodeSPIRVString(str);
   EXPECT_THAT(words, ElementsAre(1953719636, 1769108563, 26478));
 }
+TEST(String, AppendStringAfterExistingWords) {
+  llvm::SmallVector<uint32_t, 4> words;
+  words.push_back(5u);
+  string::appendSPIRVString("TestString", &words);
+  EXPECT_THAT(words, ElementsAre(5u, 1953719636, 1769108563, 26478));
+}
 TEST(String, DecodeString) {
   // Bin  01110100   01110011    01100101    01010100 = unsigned(1,953,719,636)
   // Hex     74         73          65          54
@@ -730,6 +730,26 @@ def enum_hlsl_intrinsics():
     result += "  Num_Intrinsics,\n"
     return result
 
+def get_hlsl_intrinsic_names():
+    db = get_db_hlsl()
+    result = ""
+    enumed = []
+    for i in sorted(db.intrinsics, key=lambda x: x.key):
+        if (i.enum_name not in enumed):
+            name = "  \"%s\",\n" % (i.enum_name)
+            result += wrap_with_ifdef_if_vulkan_specific(i, name)  # SPIRV Change
+            enumed.append(i.enum_name)
+    # unsigned
+    result += "  // unsigned\n"
+
+    for i in sorted(db.intrinsics, key=lambda x: x.key):
+        if (i.unsigned_op != ""):
+          if (i.unsigned_op not in enumed):
+            result += "  \"%s\",\n" % (i.unsigned_op)
+            enumed.append(i.unsigned_op)
+
+    return result
+
 def has_unsigned_hlsl_intrinsics():
     db = get_db_hlsl()
     result = ""